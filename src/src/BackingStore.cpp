@@ -0,0 +1,251 @@
+
+#include "BackingStore.h"
+
+#include <string.h>
+
+#include <cmath>
+
+#include "base/debug/trace_event.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkPicture.h"
+
+#include "../../web/WebWidget.h"
+
+#include "TileRasterizer.h"
+#include "WebThemeBatch.h"
+
+
+namespace
+{
+
+    // Every WebWidget::paint() call walks the render tree, so past this many
+    // separate rects, or once they cover most of their bounds, the bounds
+    // are painted in one call instead.
+    const int maxPaintRects = 8;
+    const int unionCoveragePercent = 70;
+
+    // Below this much damage, recording a picture and handing out tiles costs
+    // more than painting directly.
+    const int64 minTiledPixels = 2 * TileRasterizer::tileSize * TileRasterizer::tileSize;
+
+    SkIRect toSkIRect(const WebRect& rect)
+    {
+        return SkIRect::MakeXYWH(rect.x, rect.y, rect.width, rect.height);
+    }
+
+    WebRect toWebRect(const SkIRect& rect)
+    {
+        return WebRect(rect.x(), rect.y(), rect.width(), rect.height());
+    }
+
+    // The smallest rect covering |rect| times |scale|.
+    SkIRect scaleOut(const SkIRect& rect, float scale)
+    {
+        if (scale == 1)
+            return rect;
+        SkRect scaled = SkRect::Make(rect);
+        scaled.set(scaled.left() * scale, scaled.top() * scale, scaled.right() * scale, scaled.bottom() * scale);
+        SkIRect covering;
+        scaled.roundOut(&covering);
+        return covering;
+    }
+
+    int64 area(const SkIRect& rect)
+    {
+        return static_cast<int64>(rect.width()) * rect.height();
+    }
+
+}
+
+BackingStore::BackingStore(const WebSize& size)
+    : m_scale(1)
+    , m_rasterizer(0)
+    , m_paintedPixels(0)
+    , m_copiedPixels(0)
+    , m_pendingCopiedPixels(0)
+    , m_lastFramePaintedPixels(0)
+    , m_lastFrameCopiedPixels(0)
+    , m_themeShapes(0)
+    , m_themeDraws(0)
+{
+    resize(size);
+}
+
+BackingStore::~BackingStore()
+{
+}
+
+void BackingStore::setDamageCallback(const DamageCallback& callback)
+{
+    m_damageCallback = callback;
+}
+
+void BackingStore::resize(const WebSize& size)
+{
+    m_size = size;
+    m_bitmap.setConfig(SkBitmap::kARGB_8888_Config, size.width, size.height);
+    m_bitmap.allocPixels();
+    m_bitmap.eraseColor(SK_ColorWHITE);
+    m_canvas.reset(new SkCanvas(m_bitmap));
+    m_scrolled.setEmpty();
+    invalidateAll();
+}
+
+void BackingStore::setDeviceScaleFactor(float scale)
+{
+    if (scale <= 0 || scale == m_scale)
+        return;
+    m_scale = scale;
+    invalidateAll();
+}
+
+void BackingStore::setRasterizer(TileRasterizer* rasterizer)
+{
+    m_rasterizer = rasterizer;
+}
+
+void BackingStore::invalidate(const WebRect& rect)
+{
+    damage(scaleOut(toSkIRect(rect), m_scale));
+}
+
+void BackingStore::invalidateAll()
+{
+    damage(SkIRect::MakeWH(m_size.width, m_size.height));
+}
+
+void BackingStore::damage(const SkIRect& rect)
+{
+    SkIRect damage = rect;
+    if (!damage.intersect(SkIRect::MakeWH(m_size.width, m_size.height)))
+        return;
+    m_damage.op(damage, SkRegion::kUnion_Op);
+    if (!m_damageCallback.is_null())
+        m_damageCallback.Run(toWebRect(damage));
+}
+
+void BackingStore::scrollRect(int dx, int dy, const WebRect& clipRect)
+{
+    SkIRect clip = scaleOut(toSkIRect(clipRect), m_scale);
+    if (m_scale != floorf(m_scale)) {
+        damage(clip);
+        return;
+    }
+    dx *= static_cast<int>(m_scale);
+    dy *= static_cast<int>(m_scale);
+    if (!clip.intersect(SkIRect::MakeWH(m_size.width, m_size.height)))
+        return;
+
+    // The pixels that stay visible, at their new position.
+    SkIRect destination = clip;
+    destination.offset(dx, dy);
+    if (!destination.intersect(clip)) {
+        damage(clip);
+        return;
+    }
+
+    {
+        SkAutoLockPixels lock(m_bitmap);
+        size_t rowBytes = m_bitmap.rowBytes();
+        size_t copyBytes = destination.width() * m_bitmap.bytesPerPixel();
+        char* pixels = static_cast<char*>(m_bitmap.getPixels());
+        // Walk against the direction of the move so every source row is read
+        // before it is overwritten; memmove handles the overlap within a row.
+        int firstRow = dy > 0 ? destination.bottom() - 1 : destination.top();
+        int step = dy > 0 ? -1 : 1;
+        for (int i = 0; i < destination.height(); ++i) {
+            int y = firstRow + i * step;
+            char* to = pixels + y * rowBytes + destination.left() * m_bitmap.bytesPerPixel();
+            const char* from = to - dy * rowBytes - dx * m_bitmap.bytesPerPixel();
+            memmove(to, from, copyBytes);
+        }
+        m_bitmap.notifyPixelsChanged();
+    }
+    m_copiedPixels += area(destination);
+    m_pendingCopiedPixels += area(destination);
+    m_scrolled.op(destination, SkRegion::kUnion_Op);
+
+    // Damage inside the clip still describes stale pixels, which have just
+    // moved. Damage outside the clip stays where it is.
+    SkRegion moved(m_damage);
+    moved.op(clip, SkRegion::kIntersect_Op);
+    moved.translate(dx, dy);
+    moved.op(clip, SkRegion::kIntersect_Op);
+    m_damage.op(clip, SkRegion::kDifference_Op);
+    m_damage.op(moved, SkRegion::kUnion_Op);
+
+    // The exposed strip.
+    SkRegion exposed(clip);
+    exposed.op(destination, SkRegion::kDifference_Op);
+    m_damage.op(exposed, SkRegion::kUnion_Op);
+
+    if (!m_damageCallback.is_null())
+        m_damageCallback.Run(toWebRect(clip));
+}
+
+void BackingStore::paint(WebWidget* widget, SkRegion* updated)
+{
+    m_lastFrameCopiedPixels = m_pendingCopiedPixels;
+    m_lastFramePaintedPixels = 0;
+    m_pendingCopiedPixels = 0;
+    updated->op(m_scrolled, SkRegion::kUnion_Op);
+    m_scrolled.setEmpty();
+
+    if (m_damage.isEmpty()) {
+        TRACE_COUNTER2("webui", "BackingStore", "painted", 0, "copied", m_lastFrameCopiedPixels);
+        return;
+    }
+
+    int rects = 0;
+    int64 damagedArea = 0;
+    for (SkRegion::Iterator it(m_damage); !it.done(); it.next()) {
+        ++rects;
+        damagedArea += area(it.rect());
+    }
+    SkIRect bounds = m_damage.getBounds();
+    if (m_rasterizer && m_rasterizer->threadCount() > 1 && damagedArea >= minTiledPixels) {
+        // One recording of the bounds; playback is clipped to the damage,
+        // so fragmented damage costs nothing extra here.
+        SkPicture picture;
+        SkCanvas* recording = picture.beginRecording(bounds.width(), bounds.height());
+        recording->translate(-SkIntToScalar(bounds.x()), -SkIntToScalar(bounds.y()));
+        paintWidget(widget, recording, bounds);
+        picture.endRecording();
+        m_rasterizer->rasterize(&picture, bounds.x(), bounds.y(), m_damage, &m_bitmap);
+        m_bitmap.notifyPixelsChanged();
+        m_lastFramePaintedPixels = damagedArea;
+    } else {
+        if (rects > maxPaintRects || damagedArea * 100 >= area(bounds) * unionCoveragePercent)
+            m_damage.setRect(bounds);
+
+        for (SkRegion::Iterator it(m_damage); !it.done(); it.next()) {
+            const SkIRect& rect = it.rect();
+            m_canvas->save();
+            m_canvas->clipRect(SkRect::Make(rect));
+            paintWidget(widget, m_canvas.get(), rect);
+            m_canvas->restore();
+            m_lastFramePaintedPixels += area(rect);
+        }
+    }
+    m_paintedPixels += m_lastFramePaintedPixels;
+    TRACE_COUNTER2("webui", "BackingStore", "painted", m_lastFramePaintedPixels, "copied", m_lastFrameCopiedPixels);
+
+    updated->op(m_damage, SkRegion::kUnion_Op);
+    m_damage.setEmpty();
+}
+
+void BackingStore::paintWidget(WebWidget* widget, SkCanvas* canvas, const SkIRect& rect)
+{
+    // The DIPs covering |rect|; the canvas clip keeps the rest out.
+    SkIRect dipRect = scaleOut(rect, 1 / m_scale);
+    canvas->save();
+    canvas->scale(SkFloatToScalar(m_scale), SkFloatToScalar(m_scale));
+    {
+        WebThemeBatchCanvas batching(canvas);
+        widget->paint(&batching, toWebRect(dipRect));
+        batching.batch().flush();
+        m_themeShapes += batching.batch().shapeCount();
+        m_themeDraws += batching.batch().drawCount();
+    }
+    canvas->restore();
+}
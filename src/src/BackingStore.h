@@ -0,0 +1,121 @@
+#ifndef BackingStore_h
+#define BackingStore_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/memory/scoped_ptr.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkRegion.h"
+
+#include "../../platform/WebRect.h"
+#include "../../platform/WebSize.h"
+
+class SkCanvas;
+class TileRasterizer;
+
+namespace blink {
+    class WebWidget;
+}
+
+using namespace blink;
+
+// Persistent software surface for a WebWidget.
+//
+// Invalidations from the widget client accumulate into a damage region.
+// paint() repaints only that region into the bitmap and reports what
+// changed, so hosts copy just those pixels to the screen and the cost of a
+// frame follows the size of the change rather than the size of the view.
+//
+// The bitmap, the damage and everything reported to the host are in device
+// pixels. The widget lays out, invalidates and scrolls in DIPs, and paints
+// through a canvas scaled by the device scale factor.
+class BackingStore
+{
+public:
+    // Run for every invalidation, e.g. to have the window system schedule a
+    // paint for that rect.
+    typedef base::Callback<void(const WebRect&)> DamageCallback;
+
+    explicit BackingStore(const WebSize&);
+    ~BackingStore();
+
+    void setDamageCallback(const DamageCallback&);
+
+    // With a rasterizer of more than one thread, large damage is recorded
+    // into an SkPicture once and played back in tiles on its threads. Not
+    // owned; may be null.
+    void setRasterizer(TileRasterizer*);
+
+    // Reallocates the bitmap and damages all of it. In device pixels.
+    void resize(const WebSize&);
+
+    // Device pixels per DIP. Damages everything.
+    void setDeviceScaleFactor(float scale);
+    const WebSize& size() const { return m_size; }
+    const SkBitmap& bitmap() const { return m_bitmap; }
+
+    // In DIPs, as the widget client reports them.
+    void invalidate(const WebRect&);
+    void invalidateAll();
+    bool hasDamage() const { return !m_damage.isEmpty(); }
+
+    // Moves the pixels inside |clipRect| by (dx, dy) in place and damages
+    // only the strip the move exposes. Pending damage inside the clip moves
+    // along with the pixels it covers. The damage callback gets the whole
+    // clip, since the copied pixels have to reach the screen as well. In
+    // DIPs; at a fractional scale the clip is only damaged, since its edges
+    // fall inside device pixels.
+    void scrollRect(int dx, int dy, const WebRect& clipRect);
+
+    // Paints the damage with WebWidget::paint() and clears it. The caller
+    // lays the widget out first. Adds the repainted and scrolled area to
+    // |updated|.
+    void paint(WebWidget*, SkRegion* updated);
+
+    // Pixels repainted and pixels moved by scrollRect() since construction.
+    int64 paintedPixels() const { return m_paintedPixels; }
+    int64 copiedPixels() const { return m_copiedPixels; }
+
+    // The same counts for the most recent paint() call, covering the
+    // scrolls since the one before it.
+    int64 lastFramePaintedPixels() const { return m_lastFramePaintedPixels; }
+    int64 lastFrameCopiedPixels() const { return m_lastFrameCopiedPixels; }
+
+    // Theme control shapes painted, and the Skia draws they were batched
+    // into, since construction.
+    int64 themeShapes() const { return m_themeShapes; }
+    int64 themeDraws() const { return m_themeDraws; }
+
+private:
+    // Damages |rect|, in device pixels.
+    void damage(const SkIRect& rect);
+    // Paints |rect| of |widget|, in device pixels, through a theme batching
+    // canvas.
+    void paintWidget(WebWidget*, SkCanvas*, const SkIRect&);
+
+    WebSize m_size;
+    float m_scale;
+    SkBitmap m_bitmap;
+    scoped_ptr<SkCanvas> m_canvas;
+    SkRegion m_damage;
+    // Moved by scrollRect() since the last paint().
+    SkRegion m_scrolled;
+    DamageCallback m_damageCallback;
+    TileRasterizer* m_rasterizer;
+    int64 m_paintedPixels;
+    int64 m_copiedPixels;
+    int64 m_pendingCopiedPixels;
+    int64 m_lastFramePaintedPixels;
+    int64 m_lastFrameCopiedPixels;
+    int64 m_themeShapes;
+    int64 m_themeDraws;
+
+    DISALLOW_COPY_AND_ASSIGN(BackingStore);
+};
+
+
+#endif // BackingStore_h
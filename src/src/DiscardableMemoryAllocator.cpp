@@ -0,0 +1,235 @@
+
+#include "DiscardableMemoryAllocator.h"
+
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "base/logging.h"
+
+#if defined(OS_POSIX) && !defined(MADV_FREE)
+// Linux 4.5 and later; older kernels reject it and get MADV_DONTNEED.
+#define MADV_FREE 8
+#endif
+
+
+namespace
+{
+
+    size_t pageSize()
+    {
+#if defined(OS_WIN)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    void* mapPages(size_t size)
+    {
+#if defined(OS_WIN)
+        return VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        void* memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return memory == MAP_FAILED ? 0 : memory;
+#endif
+    }
+
+    void unmapPages(void* memory, size_t size)
+    {
+#if defined(OS_WIN)
+        VirtualFree(memory, 0, MEM_RELEASE);
+#else
+        munmap(memory, size);
+#endif
+    }
+
+    // The contents become garbage; the pages stay mapped and are reclaimed
+    // whenever the kernel needs them.
+    void discardPages(void* memory, size_t size)
+    {
+#if defined(OS_WIN)
+        VirtualAlloc(memory, size, MEM_RESET, PAGE_READWRITE);
+#else
+        static bool hasFree = true;
+        if (hasFree && !madvise(memory, size, MADV_FREE))
+            return;
+        if (errno == EINVAL)
+            hasFree = false;
+        madvise(memory, size, MADV_DONTNEED);
+#endif
+    }
+
+}
+
+class DiscardableMemoryAllocator::Chunk : public WebDiscardableMemory
+{
+public:
+    Chunk(DiscardableMemoryAllocator* allocator, void* memory, size_t size)
+        : m_allocator(allocator)
+        , m_memory(memory)
+        , m_size(size)
+        , m_locked(true)
+        , m_purged(false)
+    {
+    }
+
+    virtual ~Chunk()
+    {
+        m_allocator->releaseChunk(this);
+        unmapPages(m_memory, m_size);
+    }
+
+    // WebDiscardableMemory methods:
+    virtual bool lock()
+    {
+        return m_allocator->lockChunk(this);
+    }
+
+    virtual void* data()
+    {
+        DCHECK(m_locked);
+        return m_memory;
+    }
+
+    virtual void unlock()
+    {
+        m_allocator->unlockChunk(this);
+    }
+
+private:
+    friend class DiscardableMemoryAllocator;
+
+    scoped_refptr<DiscardableMemoryAllocator> m_allocator;
+    void* m_memory;
+    const size_t m_size;
+
+    // Guarded by the allocator's lock.
+    bool m_locked;
+    bool m_purged;
+    std::list<Chunk*>::iterator m_lruPosition;
+};
+
+DiscardableMemoryAllocator::DiscardableMemoryAllocator(size_t budgetBytes)
+    : m_budget(budgetBytes)
+    , m_residentBytes(0)
+    , m_lockedBytes(0)
+    , m_purgedChunks(0)
+{
+}
+
+DiscardableMemoryAllocator::~DiscardableMemoryAllocator()
+{
+    DCHECK(m_unlocked.empty());
+}
+
+WebDiscardableMemory* DiscardableMemoryAllocator::allocateAndLock(size_t size)
+{
+    size_t page = pageSize();
+    size = (size + page - 1) / page * page;
+    if (!size)
+        return 0;
+
+    {
+        // Make room first so the new chunk doesn't push RSS over the budget.
+        base::AutoLock locker(m_lock);
+        purgeTo(m_budget > size ? m_budget - size : 0);
+    }
+
+    void* memory = mapPages(size);
+    if (!memory)
+        return 0;
+
+    base::AutoLock locker(m_lock);
+    m_residentBytes += size;
+    m_lockedBytes += size;
+    return new Chunk(this, memory, size);
+}
+
+void DiscardableMemoryAllocator::setBudget(size_t bytes)
+{
+    base::AutoLock locker(m_lock);
+    m_budget = bytes;
+    purgeTo(m_budget);
+}
+
+size_t DiscardableMemoryAllocator::budget() const
+{
+    base::AutoLock locker(m_lock);
+    return m_budget;
+}
+
+void DiscardableMemoryAllocator::purgeUnlocked()
+{
+    base::AutoLock locker(m_lock);
+    purgeTo(0);
+}
+
+DiscardableMemoryAllocator::Stats DiscardableMemoryAllocator::stats() const
+{
+    base::AutoLock locker(m_lock);
+    Stats stats;
+    stats.residentBytes = m_residentBytes;
+    stats.lockedBytes = m_lockedBytes;
+    stats.purgedChunks = m_purgedChunks;
+    return stats;
+}
+
+bool DiscardableMemoryAllocator::lockChunk(Chunk* chunk)
+{
+    base::AutoLock locker(m_lock);
+    DCHECK(!chunk->m_locked);
+    if (chunk->m_purged)
+        return false;
+    m_unlocked.erase(chunk->m_lruPosition);
+    chunk->m_locked = true;
+    m_lockedBytes += chunk->m_size;
+    return true;
+}
+
+void DiscardableMemoryAllocator::unlockChunk(Chunk* chunk)
+{
+    base::AutoLock locker(m_lock);
+    DCHECK(chunk->m_locked);
+    chunk->m_locked = false;
+    m_lockedBytes -= chunk->m_size;
+    chunk->m_lruPosition = m_unlocked.insert(m_unlocked.end(), chunk);
+    purgeTo(m_budget);
+}
+
+void DiscardableMemoryAllocator::releaseChunk(Chunk* chunk)
+{
+    base::AutoLock locker(m_lock);
+    if (chunk->m_purged)
+        return;
+    if (chunk->m_locked)
+        m_lockedBytes -= chunk->m_size;
+    else
+        m_unlocked.erase(chunk->m_lruPosition);
+    m_residentBytes -= chunk->m_size;
+}
+
+void DiscardableMemoryAllocator::purgeTo(size_t bytes)
+{
+    m_lock.AssertAcquired();
+    while (m_residentBytes > bytes && !m_unlocked.empty())
+        purgeChunk(m_unlocked.front());
+}
+
+void DiscardableMemoryAllocator::purgeChunk(Chunk* chunk)
+{
+    DCHECK(!chunk->m_locked && !chunk->m_purged);
+    m_unlocked.erase(chunk->m_lruPosition);
+    discardPages(chunk->m_memory, chunk->m_size);
+    chunk->m_purged = true;
+    m_residentBytes -= chunk->m_size;
+    ++m_purgedChunks;
+}
@@ -0,0 +1,79 @@
+#ifndef DiscardableMemoryAllocator_h
+#define DiscardableMemoryAllocator_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <list>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+
+#include "../../platform/WebDiscardableMemory.h"
+
+using namespace blink;
+
+// Backs Platform::allocateAndLockDiscardableMemory().
+//
+// Every allocation is its own page-aligned mapping. While locked it is
+// ordinary memory; once unlocked it joins an LRU list, and whenever the
+// resident total goes over the budget the oldest unlocked chunks are purged:
+// their pages are handed back with madvise(MADV_FREE) (MEM_RESET on
+// Windows), which lets the kernel reclaim them lazily, and the next lock()
+// fails so Blink decodes the image again. Locked chunks are never purged, so
+// the budget can be exceeded while everything resident is in use.
+//
+// Chunks keep the allocator alive; both may be used from any thread.
+class DiscardableMemoryAllocator : public base::RefCountedThreadSafe<DiscardableMemoryAllocator>
+{
+public:
+    struct Stats {
+        size_t residentBytes;
+        size_t lockedBytes;
+        int64 purgedChunks;
+    };
+
+    explicit DiscardableMemoryAllocator(size_t budgetBytes);
+
+    // Returns a locked chunk of at least |size| bytes, or 0 if the mapping
+    // failed.
+    WebDiscardableMemory* allocateAndLock(size_t size);
+
+    // Purges down to the new budget right away.
+    void setBudget(size_t bytes);
+    size_t budget() const;
+
+    // Purges every unlocked chunk, e.g. under memory pressure.
+    void purgeUnlocked();
+
+    Stats stats() const;
+
+private:
+    class Chunk;
+    friend class base::RefCountedThreadSafe<DiscardableMemoryAllocator>;
+
+    ~DiscardableMemoryAllocator();
+
+    bool lockChunk(Chunk*);
+    void unlockChunk(Chunk*);
+    void releaseChunk(Chunk*);
+
+    // Called with m_lock held.
+    void purgeTo(size_t bytes);
+    void purgeChunk(Chunk*);
+
+    mutable base::Lock m_lock;
+    size_t m_budget;
+    size_t m_residentBytes;
+    size_t m_lockedBytes;
+    int64 m_purgedChunks;
+    // Unlocked, unpurged chunks, least recently unlocked first.
+    std::list<Chunk*> m_unlocked;
+
+    DISALLOW_COPY_AND_ASSIGN(DiscardableMemoryAllocator);
+};
+
+
+#endif // DiscardableMemoryAllocator_h
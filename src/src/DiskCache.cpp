@@ -0,0 +1,715 @@
+
+#include "DiskCache.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/logging.h"
+#include "base/sha1.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/time/time.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+    const uint32 indexMagic = 0x43495557; // "WUIC"
+    const uint32 indexVersion = 2;
+    const uint32 indexCapacity = 8192;
+
+    // The index is never filled beyond this many entries so that linear
+    // probing stays short.
+    const uint32 maxIndexEntries = indexCapacity * 3 / 4;
+
+    // Eviction trims each store to this fraction of its budget so that the
+    // next few writes don't evict again.
+    const int64 evictionTargetPercent = 90;
+
+    uint64 hashURL(const GURL& url)
+    {
+        std::string sha1 = base::SHA1HashString(url.spec());
+        uint64 hash;
+        memcpy(&hash, sha1.data(), sizeof(hash));
+        // 0 marks an empty slot.
+        return hash ? hash : 1;
+    }
+
+    bool hasValidator(const URLResponseHead& head)
+    {
+        return !head.header("etag").empty() || !head.header("last-modified").empty();
+    }
+
+    // Returns false if the response must not be stored. Otherwise sets
+    // |expiry| to the wall-clock time it stops being fresh. A response that
+    // must be revalidated before each use, or states no lifetime, expires
+    // at its response time and is kept only if it has a validator.
+    bool cachePolicy(const URLResponseHead& head, double* expiry)
+    {
+        *expiry = head.responseTime;
+        if (head.httpStatusCode != 200)
+            return false;
+
+        bool hasLifetime = false;
+        bool mustRevalidate = false;
+        std::string cacheControl = head.header("cache-control");
+        std::vector<std::string> directives;
+        base::SplitString(cacheControl, ',', &directives);
+        for (size_t i = 0; i < directives.size(); ++i) {
+            std::string directive = StringToLowerASCII(directives[i]);
+            if (directive == "no-store")
+                return false;
+            if (directive == "no-cache")
+                mustRevalidate = true;
+            int64 maxAge;
+            if (StartsWithASCII(directive, "max-age=", true)
+                    && base::StringToInt64(directive.substr(8), &maxAge)) {
+                hasLifetime = true;
+                *expiry = head.responseTime + std::max<int64>(maxAge, 0);
+            }
+        }
+
+        // Cache-Control max-age overrides Expires, which is measured against
+        // the response's own Date so that clock skew doesn't stretch it. An
+        // unparsable Expires, such as "0", means already expired.
+        std::string expires = head.header("expires");
+        if (!hasLifetime && !expires.empty()) {
+            base::Time expiresTime;
+            base::Time date;
+            if (base::Time::FromString(expires.c_str(), &expiresTime)) {
+                if (!base::Time::FromString(head.header("date").c_str(), &date))
+                    date = base::Time::FromDoubleT(head.responseTime);
+                *expiry = head.responseTime + std::max(0.0, (expiresTime - date).InSecondsF());
+            }
+        }
+
+        // Pragma only speaks for HTTP/1.0 servers that send no Cache-Control.
+        if (cacheControl.empty() && StringToLowerASCII(head.header("pragma")).find("no-cache") != std::string::npos)
+            mustRevalidate = true;
+
+        if (mustRevalidate)
+            *expiry = head.responseTime;
+        return *expiry > head.responseTime || hasValidator(head);
+    }
+
+    // A head file holds the status text on its first line, then one
+    // "name: value" line per header.
+    std::string serializeHead(const URLResponseHead& head)
+    {
+        std::string data = head.httpStatusText + "\n";
+        for (size_t i = 0; i < head.headers.size(); ++i)
+            data += head.headers[i].first + ": " + head.headers[i].second + "\n";
+        return data;
+    }
+
+    void parseHead(const std::string& data, URLResponseHead* head)
+    {
+        std::vector<std::string> lines;
+        base::SplitString(data, '\n', &lines);
+        head->httpStatusText = lines.empty() ? std::string() : lines[0];
+        head->headers.clear();
+        for (size_t i = 1; i < lines.size(); ++i) {
+            size_t colon = lines[i].find(':');
+            if (colon == std::string::npos)
+                continue;
+            std::string value;
+            TrimWhitespaceASCII(lines[i].substr(colon + 1), TRIM_ALL, &value);
+            head->headers.push_back(std::make_pair(lines[i].substr(0, colon), value));
+        }
+    }
+
+    class CachedBody : public URLResponseBody
+    {
+    public:
+        bool initialize(const base::FilePath& path)
+        {
+            return m_file.Initialize(path);
+        }
+
+        virtual const char* data() const
+        {
+            return reinterpret_cast<const char*>(m_file.data());
+        }
+
+        virtual size_t size() const
+        {
+            return m_file.length();
+        }
+
+    private:
+        virtual ~CachedBody() { }
+
+        base::MemoryMappedFile m_file;
+    };
+
+    bool writeFileAtomically(const base::FilePath& path, const char* data, size_t size)
+    {
+        base::FilePath temp = path.AddExtension(FILE_PATH_LITERAL("tmp"));
+        if (file_util::WriteFile(temp, data, static_cast<int>(size)) != static_cast<int>(size)) {
+            base::DeleteFile(temp, false);
+            return false;
+        }
+        return base::Move(temp, path);
+    }
+
+    // The same, for a body in segments, which are written one after another.
+    bool writeBodyAtomically(const base::FilePath& path, const std::vector<scoped_refptr<URLResponseBody> >& body)
+    {
+        base::FilePath temp = path.AddExtension(FILE_PATH_LITERAL("tmp"));
+        bool written = file_util::WriteFile(temp, "", 0) == 0;
+        for (size_t i = 0; written && i < body.size(); ++i) {
+            int size = static_cast<int>(body[i]->size());
+            written = file_util::AppendToFile(temp, body[i]->data(), size) == size;
+        }
+        if (!written) {
+            base::DeleteFile(temp, false);
+            return false;
+        }
+        return base::Move(temp, path);
+    }
+
+    // SHA-1 needs the body in one piece; only a body in several segments is
+    // joined for it.
+    std::string hashBody(const std::vector<scoped_refptr<URLResponseBody> >& body, size_t size)
+    {
+        if (body.size() == 1) {
+            unsigned char hash[base::kSHA1Length];
+            base::SHA1HashBytes(reinterpret_cast<const unsigned char*>(body[0]->data()), body[0]->size(), hash);
+            return std::string(reinterpret_cast<const char*>(hash), sizeof(hash));
+        }
+        std::string data;
+        data.reserve(size);
+        for (size_t i = 0; i < body.size(); ++i)
+            data.append(body[i]->data(), body[i]->size());
+        return base::SHA1HashString(data);
+    }
+
+}
+
+struct DiskCache::IndexHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 capacity;
+    uint32 entryCount;
+    int64 bodyBytes;
+    int64 metadataBytes;
+    // Incremented on every use; entries remember the value of their last use.
+    uint64 clock;
+};
+
+struct DiskCache::IndexEntry {
+    uint64 urlHash;          // 0 for an empty slot.
+    char bodyHash[base::kSHA1Length];
+    int32 httpStatusCode;
+    int64 bodySize;
+    int64 metadataSize;
+    uint64 lastUsed;
+    double responseTime;
+    double expiry;
+    char mimeType[64];
+    char charset[32];
+};
+
+// A read-write shared mapping of the index file, held with an exclusive lock.
+class DiskCache::MappedIndex
+{
+public:
+    MappedIndex()
+        : m_data(0)
+        , m_size(0)
+#if defined(OS_WIN)
+        , m_file(INVALID_HANDLE_VALUE)
+        , m_mapping(0)
+#else
+        , m_fd(-1)
+#endif
+    {
+    }
+
+    ~MappedIndex()
+    {
+#if defined(OS_WIN)
+        if (m_data) {
+            FlushViewOfFile(m_data, 0);
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+#else
+        if (m_data) {
+            msync(m_data, m_size, MS_ASYNC);
+            munmap(m_data, m_size);
+        }
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+
+    // Maps |size| bytes of |path|, creating or growing the file as needed.
+    // Newly created bytes read as zero.
+    bool initialize(const base::FilePath& path, size_t size)
+    {
+        m_size = size;
+#if defined(OS_WIN)
+        // No sharing: a second process fails here and runs uncached.
+        m_file = CreateFileW(path.value().c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE)
+            return false;
+        m_mapping = CreateFileMapping(m_file, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(size), NULL);
+        if (!m_mapping)
+            return false;
+        m_data = MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, size);
+#else
+        m_fd = open(path.value().c_str(), O_RDWR | O_CREAT, 0600);
+        if (m_fd < 0)
+            return false;
+        if (flock(m_fd, LOCK_EX | LOCK_NB) < 0)
+            return false;
+        struct stat info;
+        if (fstat(m_fd, &info) < 0)
+            return false;
+        if (static_cast<size_t>(info.st_size) != size && ftruncate(m_fd, size) < 0)
+            return false;
+        void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        m_data = data == MAP_FAILED ? 0 : data;
+#endif
+        return m_data != 0;
+    }
+
+    void* data() const { return m_data; }
+
+private:
+    void* m_data;
+    size_t m_size;
+#if defined(OS_WIN)
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+DiskCache::DiskCache(const base::FilePath& directory, int64 maxBodyBytes, int64 maxMetadataBytes)
+    : m_directory(directory)
+    , m_maxBodyBytes(maxBodyBytes)
+    , m_maxMetadataBytes(maxMetadataBytes)
+    , m_header(0)
+    , m_entries(0)
+    , m_thread("DiskCache")
+{
+    if (!base::CreateDirectory(m_directory.AppendASCII("heads"))
+            || !base::CreateDirectory(m_directory.AppendASCII("bodies"))
+            || !base::CreateDirectory(m_directory.AppendASCII("metadata")))
+        return;
+
+    size_t indexSize = sizeof(IndexHeader) + indexCapacity * sizeof(IndexEntry);
+    scoped_ptr<MappedIndex> index(new MappedIndex);
+    if (!index->initialize(m_directory.AppendASCII("index"), indexSize)) {
+        LOG(WARNING) << "Disk cache at " << m_directory.value() << " is unavailable";
+        return;
+    }
+
+    IndexHeader* header = static_cast<IndexHeader*>(index->data());
+    if (header->magic != indexMagic || header->version != indexVersion || header->capacity != indexCapacity) {
+        // New or incompatible: start empty. Orphaned bodies and metadata are
+        // overwritten or ignored as entries are added again.
+        memset(index->data(), 0, indexSize);
+        header->magic = indexMagic;
+        header->version = indexVersion;
+        header->capacity = indexCapacity;
+    }
+
+    m_index = index.Pass();
+    m_header = header;
+    m_entries = reinterpret_cast<IndexEntry*>(header + 1);
+    m_thread.Start();
+}
+
+DiskCache::~DiskCache()
+{
+    // Finish pending writes before unmapping the index.
+    m_thread.Stop();
+}
+
+bool DiskCache::lookup(const GURL& url, URLResponseHead* head, scoped_refptr<URLResponseBody>* body, bool* fresh)
+{
+    if (!isUsable())
+        return false;
+
+    uint64 urlHash = hashURL(url);
+    char bodyHash[base::kSHA1Length];
+    int64 bodySize;
+    int64 metadataSize;
+    {
+        base::AutoLock locker(m_lock);
+        IndexEntry* entry = findEntry(urlHash);
+        if (!entry)
+            return false;
+
+        entry->lastUsed = ++m_header->clock;
+        memcpy(bodyHash, entry->bodyHash, sizeof(bodyHash));
+        bodySize = entry->bodySize;
+        metadataSize = entry->metadataSize;
+
+        *fresh = entry->expiry > base::Time::Now().ToDoubleT();
+        head->httpStatusCode = entry->httpStatusCode;
+        head->mimeType = entry->mimeType;
+        head->charset = entry->charset;
+        head->expectedContentLength = bodySize;
+        head->responseTime = entry->responseTime;
+        head->wasCached = true;
+    }
+
+    // Files are opened outside the lock; an entry evicted meanwhile simply
+    // misses.
+    std::string headData;
+    if (!base::ReadFileToString(headPath(urlHash), &headData))
+        return false;
+    parseHead(headData, head);
+    if (!*fresh && !hasValidator(*head))
+        return false;
+    if (bodySize) {
+        scoped_refptr<CachedBody> mapped = new CachedBody;
+        if (!mapped->initialize(bodyPath(bodyHash)) || static_cast<int64>(mapped->size()) != bodySize)
+            return false;
+        *body = mapped;
+    }
+    if (metadataSize) {
+        std::string metadata;
+        if (base::ReadFileToString(metadataPath(urlHash), &metadata) && static_cast<int64>(metadata.size()) == metadataSize)
+            head->cachedMetadata = new StringResponseBody(&metadata);
+    }
+    return true;
+}
+
+void DiskCache::store(const GURL& url, const URLResponseHead& head, const std::vector<scoped_refptr<URLResponseBody> >& body)
+{
+    double expiry;
+    if (!isUsable() || !cachePolicy(head, &expiry))
+        return;
+
+    size_t size = 0;
+    for (size_t i = 0; i < body.size(); ++i)
+        size += body[i]->size();
+    if (static_cast<int64>(size) > m_maxBodyBytes / 4)
+        return;
+
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE,
+        base::Bind(&DiskCache::storeOnCacheThread, base::Unretained(this), url, head, body));
+}
+
+void DiskCache::storeMetadata(const GURL& url, double responseTime, const char* data, size_t size)
+{
+    if (!isUsable() || !size || static_cast<int64>(size) > m_maxMetadataBytes / 4)
+        return;
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE,
+        base::Bind(&DiskCache::storeMetadataOnCacheThread, base::Unretained(this), url, responseTime, std::string(data, size)));
+}
+
+void DiskCache::refresh(const GURL& url, const URLResponseHead& notModified)
+{
+    if (!isUsable())
+        return;
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE,
+        base::Bind(&DiskCache::refreshOnCacheThread, base::Unretained(this), url, notModified));
+}
+
+// All index mutations happen on the cache thread, so the index can't change
+// between the locked sections below except for lookups bumping lastUsed.
+void DiskCache::storeOnCacheThread(const GURL& url, const URLResponseHead& head, const std::vector<scoped_refptr<URLResponseBody> >& body)
+{
+    double expiry;
+    cachePolicy(head, &expiry);
+
+    size_t bodySize = 0;
+    for (size_t i = 0; i < body.size(); ++i)
+        bodySize += body[i]->size();
+
+    uint64 urlHash = hashURL(url);
+    std::string bodyHash = hashBody(body, bodySize);
+
+    std::string headData = serializeHead(head);
+
+    bool sameBody;
+    bool bodyIsNew;
+    {
+        base::AutoLock locker(m_lock);
+        IndexEntry* entry = findEntry(urlHash);
+        sameBody = entry && !memcmp(entry->bodyHash, bodyHash.data(), sizeof(entry->bodyHash));
+        bodyIsNew = !sameBody && bodySize && !isBodyReferenced(bodyHash.data(), 0);
+    }
+
+    if (sameBody) {
+        // Same content again: refresh the head, keep body and metadata.
+        std::string oldHeadData;
+        if (!base::ReadFileToString(headPath(urlHash), &oldHeadData) || oldHeadData != headData) {
+            if (!writeFileAtomically(headPath(urlHash), headData.data(), headData.size()))
+                return;
+        }
+        base::AutoLock locker(m_lock);
+        fillEntry(findEntry(urlHash), head, expiry);
+        return;
+    }
+
+    // Content addressing: a body some entry already references is on disk.
+    if (bodyIsNew && !writeBodyAtomically(bodyPath(bodyHash.data()), body))
+        return;
+    // Staged next to the head file and renamed over it once the old entry,
+    // which deletes its head file, is gone.
+    base::FilePath stagedHead = headPath(urlHash).AddExtension(FILE_PATH_LITERAL("new"));
+    if (file_util::WriteFile(stagedHead, headData.data(), static_cast<int>(headData.size())) != static_cast<int>(headData.size())) {
+        base::DeleteFile(stagedHead, false);
+        return;
+    }
+
+    base::AutoLock locker(m_lock);
+    IndexEntry* entry = findEntry(urlHash);
+    if (entry)
+        removeEntry(entry);
+    if (!base::Move(stagedHead, headPath(urlHash))) {
+        if (bodyIsNew)
+            base::DeleteFile(bodyPath(bodyHash.data()), false);
+        return;
+    }
+    if (m_header->entryCount >= maxIndexEntries) {
+        // Make room by dropping the least recently used entry.
+        IndexEntry* oldest = 0;
+        for (uint32 i = 0; i < indexCapacity; ++i) {
+            if (m_entries[i].urlHash && (!oldest || m_entries[i].lastUsed < oldest->lastUsed))
+                oldest = &m_entries[i];
+        }
+        removeEntry(oldest);
+    }
+
+    entry = insertEntry(urlHash);
+    memcpy(entry->bodyHash, bodyHash.data(), sizeof(entry->bodyHash));
+    entry->bodySize = bodySize;
+    fillEntry(entry, head, expiry);
+    if (bodyIsNew)
+        m_header->bodyBytes += bodySize;
+
+    evictBodies();
+}
+
+void DiskCache::storeMetadataOnCacheThread(const GURL& url, double responseTime, const std::string& data)
+{
+    uint64 urlHash = hashURL(url);
+    {
+        base::AutoLock locker(m_lock);
+        IndexEntry* entry = findEntry(urlHash);
+        if (!entry || entry->responseTime != responseTime)
+            return;
+    }
+
+    if (!writeFileAtomically(metadataPath(urlHash), data.data(), data.size()))
+        return;
+
+    base::AutoLock locker(m_lock);
+    IndexEntry* entry = findEntry(urlHash);
+    if (!entry || entry->responseTime != responseTime)
+        return;
+    m_header->metadataBytes += data.size() - entry->metadataSize;
+    entry->metadataSize = data.size();
+    evictMetadata();
+}
+
+void DiskCache::refreshOnCacheThread(const GURL& url, const URLResponseHead& notModified)
+{
+    uint64 urlHash = hashURL(url);
+    std::string headData;
+    if (!base::ReadFileToString(headPath(urlHash), &headData))
+        return;
+
+    // The 304's headers replace the stored ones of the same name, and the
+    // lifetime they give counts from now. Date differs on every answer but
+    // only matters to the expiry computed here, so it alone doesn't cost a
+    // write.
+    URLResponseHead head;
+    parseHead(headData, &head);
+    head.httpStatusCode = 200;
+    head.responseTime = base::Time::Now().ToDoubleT();
+    bool changed = false;
+    for (size_t i = 0; i < notModified.headers.size(); ++i) {
+        const std::pair<std::string, std::string>& header = notModified.headers[i];
+        size_t j = 0;
+        while (j < head.headers.size() && !LowerCaseEqualsASCII(head.headers[j].first, header.first.c_str()))
+            ++j;
+        if (j < head.headers.size() && head.headers[j].second == header.second)
+            continue;
+        if (!LowerCaseEqualsASCII(header.first, "date"))
+            changed = true;
+        if (j < head.headers.size())
+            head.headers[j].second = header.second;
+        else
+            head.headers.push_back(header);
+    }
+
+    double expiry;
+    bool keep = cachePolicy(head, &expiry);
+    if (keep && changed) {
+        headData = serializeHead(head);
+        keep = writeFileAtomically(headPath(urlHash), headData.data(), headData.size());
+    }
+
+    base::AutoLock locker(m_lock);
+    IndexEntry* entry = findEntry(urlHash);
+    if (!entry)
+        return;
+    if (!keep) {
+        removeEntry(entry);
+        return;
+    }
+    entry->lastUsed = ++m_header->clock;
+    entry->expiry = expiry;
+}
+
+void DiskCache::fillEntry(IndexEntry* entry, const URLResponseHead& head, double expiry)
+{
+    entry->httpStatusCode = head.httpStatusCode;
+    entry->lastUsed = ++m_header->clock;
+    entry->responseTime = head.responseTime;
+    entry->expiry = expiry;
+    base::strlcpy(entry->mimeType, head.mimeType.c_str(), sizeof(entry->mimeType));
+    base::strlcpy(entry->charset, head.charset.c_str(), sizeof(entry->charset));
+}
+
+DiskCache::IndexEntry* DiskCache::findEntry(uint64 urlHash)
+{
+    for (uint32 i = 0; i < indexCapacity; ++i) {
+        IndexEntry* entry = &m_entries[(urlHash + i) % indexCapacity];
+        if (!entry->urlHash)
+            return 0;
+        if (entry->urlHash == urlHash)
+            return entry;
+    }
+    return 0;
+}
+
+DiskCache::IndexEntry* DiskCache::insertEntry(uint64 urlHash)
+{
+    DCHECK(m_header->entryCount < maxIndexEntries);
+    uint32 slot = urlHash % indexCapacity;
+    while (m_entries[slot].urlHash)
+        slot = (slot + 1) % indexCapacity;
+    IndexEntry* entry = &m_entries[slot];
+    memset(entry, 0, sizeof(*entry));
+    entry->urlHash = urlHash;
+    ++m_header->entryCount;
+    return entry;
+}
+
+void DiskCache::removeEntry(IndexEntry* entry)
+{
+    removeMetadata(entry);
+    base::DeleteFile(headPath(entry->urlHash), false);
+    if (entry->bodySize && !isBodyReferenced(entry->bodyHash, entry)) {
+        base::DeleteFile(bodyPath(entry->bodyHash), false);
+        m_header->bodyBytes -= entry->bodySize;
+    }
+
+    // Backward-shift deletion keeps probe sequences intact without
+    // tombstones.
+    uint32 hole = entry - m_entries;
+    uint32 slot = hole;
+    while (true) {
+        slot = (slot + 1) % indexCapacity;
+        if (!m_entries[slot].urlHash)
+            break;
+        uint32 home = m_entries[slot].urlHash % indexCapacity;
+        bool movable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (movable) {
+            m_entries[hole] = m_entries[slot];
+            hole = slot;
+        }
+    }
+    memset(&m_entries[hole], 0, sizeof(IndexEntry));
+    --m_header->entryCount;
+}
+
+void DiskCache::removeMetadata(IndexEntry* entry)
+{
+    if (!entry->metadataSize)
+        return;
+    base::DeleteFile(metadataPath(entry->urlHash), false);
+    m_header->metadataBytes -= entry->metadataSize;
+    entry->metadataSize = 0;
+}
+
+bool DiskCache::isBodyReferenced(const char* bodyHash, const IndexEntry* except) const
+{
+    for (uint32 i = 0; i < indexCapacity; ++i) {
+        const IndexEntry& entry = m_entries[i];
+        if (entry.urlHash && &entry != except && !memcmp(entry.bodyHash, bodyHash, sizeof(entry.bodyHash)))
+            return true;
+    }
+    return false;
+}
+
+void DiskCache::evictBodies()
+{
+    if (m_header->bodyBytes <= m_maxBodyBytes)
+        return;
+
+    std::vector<std::pair<uint64, uint64> > byAge;
+    for (uint32 i = 0; i < indexCapacity; ++i) {
+        if (m_entries[i].urlHash)
+            byAge.push_back(std::make_pair(m_entries[i].lastUsed, m_entries[i].urlHash));
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    int64 target = m_maxBodyBytes * evictionTargetPercent / 100;
+    for (size_t i = 0; i < byAge.size() && m_header->bodyBytes > target; ++i) {
+        // Entries move during removal, so look each one up again.
+        IndexEntry* entry = findEntry(byAge[i].second);
+        if (entry)
+            removeEntry(entry);
+    }
+}
+
+void DiskCache::evictMetadata()
+{
+    if (m_header->metadataBytes <= m_maxMetadataBytes)
+        return;
+
+    std::vector<std::pair<uint64, uint32> > byAge;
+    for (uint32 i = 0; i < indexCapacity; ++i) {
+        if (m_entries[i].urlHash && m_entries[i].metadataSize)
+            byAge.push_back(std::make_pair(m_entries[i].lastUsed, i));
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    int64 target = m_maxMetadataBytes * evictionTargetPercent / 100;
+    for (size_t i = 0; i < byAge.size() && m_header->metadataBytes > target; ++i)
+        removeMetadata(&m_entries[byAge[i].second]);
+}
+
+base::FilePath DiskCache::bodyPath(const char* bodyHash) const
+{
+    return m_directory.AppendASCII("bodies").AppendASCII(base::HexEncode(bodyHash, base::kSHA1Length));
+}
+
+base::FilePath DiskCache::headPath(uint64 urlHash) const
+{
+    return m_directory.AppendASCII("heads").AppendASCII(base::HexEncode(&urlHash, sizeof(urlHash)));
+}
+
+base::FilePath DiskCache::metadataPath(uint64 urlHash) const
+{
+    return m_directory.AppendASCII("metadata").AppendASCII(base::HexEncode(&urlHash, sizeof(urlHash)));
+}
@@ -0,0 +1,113 @@
+#ifndef DiskCache_h
+#define DiskCache_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+#include "url/gurl.h"
+
+#include "URLLoaderEngine.h"
+
+// HTTP cache shared by the URL loader and PlatformImpl::cacheMetadata().
+//
+// On disk it is a directory holding:
+//   index      - a fixed-size open-addressed table, memory-mapped, with one
+//                entry per cached URL (response head, body hash, LRU stamp);
+//   heads/     - the status text and headers of each entry, one file per
+//                URL;
+//   bodies/    - response bodies named by the SHA-1 of their contents, so
+//                identical resources under different URLs are stored once;
+//   metadata/  - the compiled-script metadata V8 hands to cacheMetadata(),
+//                one file per URL, kept under its own byte budget.
+//
+// Bodies and metadata are evicted least-recently-used first once their
+// budgets are exceeded. Lookups run on the caller's thread and only touch
+// the mapped index, the head file and an mmap of the body; writes go to a
+// cache thread.
+//
+// Freshness follows Cache-Control, then Expires, then Pragma. A response
+// with no lifetime is kept only if it has a validator (ETag or
+// Last-Modified), and is then stale at once: the loader revalidates it
+// before every reuse.
+//
+// The index is locked for the lifetime of the cache, so a second process
+// pointed at the same directory runs without a cache instead of corrupting
+// it.
+class DiskCache
+{
+public:
+    DiskCache(const base::FilePath& directory, int64 maxBodyBytes, int64 maxMetadataBytes);
+    ~DiskCache();
+
+    // False if the directory or index could not be opened.
+    bool isUsable() const { return m_header != 0; }
+
+    // Any thread. On a hit fills |head| (including its headers, the cached
+    // metadata, if any, and the original response time) and |body|, which
+    // is null for an empty body. |fresh| is false for a response that must
+    // be revalidated before use; stale responses without validators miss.
+    bool lookup(const GURL&, URLResponseHead* head, scoped_refptr<URLResponseBody>* body, bool* fresh);
+
+    // Any thread. Stores a complete response unless its head forbids it.
+    // The body segments are shared with the cache thread, not copied.
+    void store(const GURL&, const URLResponseHead&, const std::vector<scoped_refptr<URLResponseBody> >& body);
+
+    // Any thread. Ignored unless the cached response for the URL has the
+    // same response time, i.e. the metadata was compiled from that body.
+    void storeMetadata(const GURL&, double responseTime, const char* data, size_t size);
+
+    // Any thread. Takes the headers of a 304 answer for the cached response
+    // and renews its lifetime; body, response time and metadata stay. The
+    // head file is only rewritten if a header other than Date changed.
+    void refresh(const GURL&, const URLResponseHead& notModified);
+
+private:
+    struct IndexHeader;
+    struct IndexEntry;
+    class MappedIndex;
+
+    // Cache thread.
+    void storeOnCacheThread(const GURL&, const URLResponseHead&, const std::vector<scoped_refptr<URLResponseBody> >& body);
+    void storeMetadataOnCacheThread(const GURL&, double responseTime, const std::string& data);
+    void refreshOnCacheThread(const GURL&, const URLResponseHead& notModified);
+
+    // Called with m_lock held.
+    IndexEntry* findEntry(uint64 urlHash);
+    IndexEntry* insertEntry(uint64 urlHash);
+    void fillEntry(IndexEntry*, const URLResponseHead&, double expiry);
+    void removeEntry(IndexEntry*);
+    void removeMetadata(IndexEntry*);
+    bool isBodyReferenced(const char* bodyHash, const IndexEntry* except) const;
+    void evictBodies();
+    void evictMetadata();
+
+    base::FilePath bodyPath(const char* bodyHash) const;
+    base::FilePath headPath(uint64 urlHash) const;
+    base::FilePath metadataPath(uint64 urlHash) const;
+
+    const base::FilePath m_directory;
+    const int64 m_maxBodyBytes;
+    const int64 m_maxMetadataBytes;
+
+    base::Lock m_lock;
+    scoped_ptr<MappedIndex> m_index;
+    IndexHeader* m_header;
+    IndexEntry* m_entries;
+
+    base::Thread m_thread;
+
+    DISALLOW_COPY_AND_ASSIGN(DiskCache);
+};
+
+
+#endif // DiskCache_h
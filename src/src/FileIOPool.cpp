@@ -0,0 +1,99 @@
+#include "FileIOPool.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
+
+
+namespace
+{
+
+    const int maxQueueDepthSample = 1000;
+    // Ten seconds.
+    const int maxLatencySampleUs = 10 * 1000 * 1000;
+    const int histogramBuckets = 50;
+
+}
+
+FileIOPool::FileIOPool(const std::string& name, size_t threadCount, size_t sequenceThreadCount, blink::Platform* platform)
+    : m_platform(platform)
+    , m_sequenceThreadCount(std::max<size_t>(sequenceThreadCount, 1))
+    , m_queueDepths(std::max<size_t>(threadCount, 1), 0)
+    , m_queueDepth(0)
+    , m_nextSequence(0)
+{
+    for (size_t i = 0; i < m_queueDepths.size() + m_sequenceThreadCount; ++i) {
+        std::string threadName = i < m_queueDepths.size()
+            ? base::StringPrintf("%s%d", name.c_str(), static_cast<int>(i))
+            : base::StringPrintf("%sSequence%d", name.c_str(), static_cast<int>(i - m_queueDepths.size()));
+        base::Thread* thread = new base::Thread(threadName);
+        thread->Start();
+        m_threads.push_back(thread);
+    }
+}
+
+FileIOPool::~FileIOPool()
+{
+    for (size_t i = 0; i < m_threads.size(); ++i)
+        m_threads[i]->Stop();
+    STLDeleteElements(&m_threads);
+}
+
+void FileIOPool::post(const char* operation, const base::Closure& task)
+{
+    size_t thread;
+    {
+        base::AutoLock locker(m_lock);
+        thread = std::min_element(m_queueDepths.begin(), m_queueDepths.end()) - m_queueDepths.begin();
+    }
+    postToThread(thread, operation, task);
+}
+
+void FileIOPool::postInSequence(size_t sequence, const char* operation, const base::Closure& task)
+{
+    postToThread(m_queueDepths.size() + sequence % m_sequenceThreadCount, operation, task);
+}
+
+size_t FileIOPool::newSequence()
+{
+    base::AutoLock locker(m_lock);
+    return m_nextSequence++;
+}
+
+void FileIOPool::postToThread(size_t thread, const char* operation, const base::Closure& task)
+{
+    int queueDepth;
+    {
+        base::AutoLock locker(m_lock);
+        if (thread < m_queueDepths.size())
+            ++m_queueDepths[thread];
+        queueDepth = ++m_queueDepth;
+    }
+    m_platform->histogramCustomCounts("WebUI.FileIO.QueueDepth", queueDepth, 1, maxQueueDepthSample, histogramBuckets);
+    m_threads[thread]->message_loop_proxy()->PostTask(FROM_HERE,
+        base::Bind(&FileIOPool::run, base::Unretained(this), thread, operation, base::TimeTicks::Now(), task));
+}
+
+void FileIOPool::run(size_t thread, const char* operation, base::TimeTicks posted, const base::Closure& task)
+{
+    {
+        TRACE_EVENT1("webui", "FileIOPool::run", "operation", operation);
+        task.Run();
+    }
+
+    {
+        base::AutoLock locker(m_lock);
+        if (thread < m_queueDepths.size())
+            --m_queueDepths[thread];
+        --m_queueDepth;
+    }
+
+    int64 latency = (base::TimeTicks::Now() - posted).InMicroseconds();
+    m_platform->histogramCustomCounts(base::StringPrintf("WebUI.FileIO.%s", operation).c_str(),
+        static_cast<int>(std::min<int64>(latency, maxLatencySampleUs)), 1, maxLatencySampleUs, histogramBuckets);
+}
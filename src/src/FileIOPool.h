@@ -0,0 +1,78 @@
+#ifndef FileIOPool_h
+#define FileIOPool_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+
+#include "../../platform/Platform.h"
+
+namespace base {
+    class Thread;
+}
+
+// A fixed set of threads for blocking file I/O, so that no file operation
+// runs on the main thread or on a Blink thread.
+//
+// Ordered operations run on threads of their own, so that a long sequence
+// never holds up the operations posted to the rest of the pool.
+//
+// Operations are named. Each time one is posted the number of operations
+// outstanding across the pool is reported as "WebUI.FileIO.QueueDepth", and
+// once it has run, the microseconds from post to completion as
+// "WebUI.FileIO.<name>", both through Platform::histogramCustomCounts().
+class FileIOPool
+{
+public:
+    static const size_t defaultThreadCount = 3;
+    static const size_t defaultSequenceThreadCount = 1;
+
+    // |threadCount| threads serve post(), |sequenceThreadCount| more serve
+    // postInSequence(). |platform| receives the histograms, from the pool's
+    // threads.
+    FileIOPool(const std::string& name, size_t threadCount, size_t sequenceThreadCount, blink::Platform* platform);
+    // Runs the operations already queued, then joins the threads.
+    ~FileIOPool();
+
+    // Any thread. Runs |task| on the post() thread with the fewest
+    // operations outstanding. |operation| must be a string literal.
+    void post(const char* operation, const base::Closure& task);
+
+    // Any thread. Runs |task| after every task posted before it with the
+    // same |sequence|, for operations that must stay in order.
+    void postInSequence(size_t sequence, const char* operation, const base::Closure& task);
+
+    // A sequence for postInSequence(); sequences are spread over the
+    // sequence threads.
+    size_t newSequence();
+
+private:
+    void postToThread(size_t thread, const char* operation, const base::Closure& task);
+    // Pool thread.
+    void run(size_t thread, const char* operation, base::TimeTicks posted, const base::Closure& task);
+
+    blink::Platform* m_platform;
+    // The post() threads, then the sequence threads.
+    std::vector<base::Thread*> m_threads;
+    size_t m_sequenceThreadCount;
+
+    base::Lock m_lock;
+    // Operations posted and not yet completed, per post() thread. An
+    // operation counts while it runs, so a busy thread never looks idle.
+    std::vector<int> m_queueDepths;
+    int m_queueDepth;
+    size_t m_nextSequence;
+
+    DISALLOW_COPY_AND_ASSIGN(FileIOPool);
+};
+
+
+#endif // FileIOPool_h
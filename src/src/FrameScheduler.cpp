@@ -0,0 +1,162 @@
+
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+#include "base/debug/trace_event.h"
+#include "base/logging.h"
+
+
+namespace
+{
+
+    // Frame durations kept for the percentiles.
+    const size_t frameTimeHistory = 1024;
+
+    double toSeconds(base::TimeTicks time)
+    {
+        return time.ToInternalValue() / static_cast<double>(base::Time::kMicrosecondsPerSecond);
+    }
+
+}
+
+FrameScheduler::FrameScheduler(const FrameCallback& callback, base::TimeDelta interval)
+    : m_callback(callback)
+    , m_interval(interval)
+    , m_virtualClock(false)
+    , m_timebase(base::TimeTicks::Now())
+    , m_virtualTime(m_timebase)
+    , m_needsFrame(false)
+    , m_inFrame(false)
+    , m_frameCount(0)
+    , m_skippedFrames(0)
+    , m_nextFrameTime(0)
+{
+    DCHECK(m_interval > base::TimeDelta());
+}
+
+FrameScheduler::~FrameScheduler()
+{
+}
+
+void FrameScheduler::setInterval(base::TimeDelta interval)
+{
+    DCHECK(interval > base::TimeDelta());
+    m_interval = interval;
+    // Restart the tick grid at the last frame so the next one stays a full
+    // interval away from it.
+    m_timebase = m_lastVsync.is_null() ? base::TimeTicks::Now() : m_lastVsync;
+    if (m_timer.IsRunning()) {
+        m_timer.Stop();
+        scheduleFrame(base::TimeTicks::Now());
+    }
+}
+
+void FrameScheduler::setVirtualClock(bool virtualClock)
+{
+    if (virtualClock == m_virtualClock)
+        return;
+    m_virtualClock = virtualClock;
+    // Either clock continues from the other's last frame.
+    if (m_virtualClock)
+        m_virtualTime = m_lastVsync.is_null() ? base::TimeTicks::Now() : m_lastVsync;
+    else
+        m_timebase = base::TimeTicks::Now();
+    m_lastVsync = base::TimeTicks();
+    if (m_timer.IsRunning()) {
+        m_timer.Stop();
+        scheduleFrame(base::TimeTicks::Now());
+    }
+}
+
+void FrameScheduler::setNeedsFrame()
+{
+    if (m_needsFrame)
+        return;
+    m_needsFrame = true;
+    // A request made by the frame itself is scheduled once it returns.
+    if (!m_inFrame)
+        scheduleFrame(base::TimeTicks::Now());
+}
+
+base::TimeDelta FrameScheduler::frameTimePercentile(double percentile) const
+{
+    if (m_frameTimes.empty())
+        return base::TimeDelta();
+    std::vector<base::TimeDelta> sorted(m_frameTimes);
+    size_t index = static_cast<size_t>(std::max(0.0, std::min(100.0, percentile)) / 100 * (sorted.size() - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+void FrameScheduler::resetStats()
+{
+    m_frameCount = 0;
+    m_skippedFrames = 0;
+    m_frameTimes.clear();
+    m_nextFrameTime = 0;
+}
+
+void FrameScheduler::scheduleFrame(base::TimeTicks earliest)
+{
+    if (m_virtualClock) {
+        m_timer.Start(FROM_HERE, base::TimeDelta(), this, &FrameScheduler::runFrame);
+        return;
+    }
+
+    base::TimeTicks target = vsyncBefore(earliest);
+    if (target < earliest)
+        target += m_interval;
+    if (!m_lastVsync.is_null() && target <= m_lastVsync)
+        target = m_lastVsync + m_interval;
+    m_targetVsync = target;
+    m_timer.Start(FROM_HERE, std::max(base::TimeDelta(), target - base::TimeTicks::Now()),
+                  this, &FrameScheduler::runFrame);
+}
+
+void FrameScheduler::runFrame()
+{
+    DCHECK(m_needsFrame);
+
+    base::TimeTicks vsync;
+    if (m_virtualClock) {
+        m_virtualTime += m_interval;
+        vsync = m_virtualTime;
+    } else {
+        // Timers may fire a little early; never go back before the target.
+        vsync = std::max(vsyncBefore(base::TimeTicks::Now()), m_targetVsync);
+        int64 missed = (vsync - m_targetVsync) / m_interval;
+        if (missed) {
+            m_skippedFrames += missed;
+            TRACE_EVENT_INSTANT1("webui", "FrameScheduler::skippedFrames", TRACE_EVENT_SCOPE_THREAD, "count", missed);
+        }
+    }
+
+    m_needsFrame = false;
+    m_inFrame = true;
+    m_lastVsync = vsync;
+    base::TimeTicks start = base::TimeTicks::Now();
+    {
+        TRACE_EVENT0("webui", "FrameScheduler::runFrame");
+        m_callback.Run(toSeconds(vsync));
+    }
+    base::TimeDelta duration = base::TimeTicks::Now() - start;
+    m_inFrame = false;
+
+    ++m_frameCount;
+    if (m_frameTimes.size() < frameTimeHistory)
+        m_frameTimes.push_back(duration);
+    else
+        m_frameTimes[m_nextFrameTime] = duration;
+    m_nextFrameTime = (m_nextFrameTime + 1) % frameTimeHistory;
+
+    if (m_needsFrame)
+        scheduleFrame(m_lastVsync + m_interval);
+}
+
+base::TimeTicks FrameScheduler::vsyncBefore(base::TimeTicks time) const
+{
+    if (time <= m_timebase)
+        return m_timebase;
+    return m_timebase + m_interval * ((time - m_timebase) / m_interval);
+}
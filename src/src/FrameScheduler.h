@@ -0,0 +1,87 @@
+#ifndef FrameScheduler_h
+#define FrameScheduler_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+// Turns WebWidgetClient::scheduleAnimation() requests into frames.
+//
+// Any number of setNeedsFrame() calls between two vsync ticks produce a
+// single run of the frame callback, which does animate + layout + paint.
+// Ticks are aligned to a fixed-interval virtual vsync, since there is no
+// display to sync to off screen. A frame that overruns its interval misses
+// the ticks it spans; those are counted as skipped and the next frame starts
+// on the first tick after it, so the timeline never drifts or bunches up.
+//
+// With setVirtualClock(true), frames run as soon as the message loop is
+// free and the frame time advances by exactly one interval per frame. Pages
+// then see a steady frame rate however fast or slow the machine is, which
+// keeps headless renders reproducible.
+//
+// Lives on the main thread.
+class FrameScheduler
+{
+public:
+    // Gets the vsync time of the frame, in seconds on the
+    // monotonicallyIncreasingTime() clock, for WebWidget::animate().
+    typedef base::Callback<void(double frameTime)> FrameCallback;
+
+    FrameScheduler(const FrameCallback&, base::TimeDelta interval);
+    ~FrameScheduler();
+
+    void setInterval(base::TimeDelta);
+    base::TimeDelta interval() const { return m_interval; }
+
+    void setVirtualClock(bool);
+    bool virtualClock() const { return m_virtualClock; }
+
+    // Asks for a frame on the next vsync tick.
+    void setNeedsFrame();
+    // True from setNeedsFrame() until the frame callback starts.
+    bool framePending() const { return m_needsFrame; }
+
+    int64 frameCount() const { return m_frameCount; }
+    int64 skippedFrames() const { return m_skippedFrames; }
+    // How long the frame callback took, at |percentile| (0-100) over the
+    // most recent frames.
+    base::TimeDelta frameTimePercentile(double percentile) const;
+    void resetStats();
+
+private:
+    void scheduleFrame(base::TimeTicks now);
+    void runFrame();
+    // The latest tick at or before |time|.
+    base::TimeTicks vsyncBefore(base::TimeTicks time) const;
+
+    FrameCallback m_callback;
+    base::TimeDelta m_interval;
+    bool m_virtualClock;
+    base::TimeTicks m_timebase;
+    base::TimeTicks m_virtualTime;
+
+    bool m_needsFrame;
+    bool m_inFrame;
+    // The tick the pending frame is aimed at, and the tick of the last frame.
+    base::TimeTicks m_targetVsync;
+    base::TimeTicks m_lastVsync;
+    base::OneShotTimer<FrameScheduler> m_timer;
+
+    int64 m_frameCount;
+    int64 m_skippedFrames;
+    // Ring of the most recent frame durations.
+    std::vector<base::TimeDelta> m_frameTimes;
+    size_t m_nextFrameTime;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameScheduler);
+};
+
+
+#endif // FrameScheduler_h
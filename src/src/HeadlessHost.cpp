@@ -0,0 +1,239 @@
+
+#include "HeadlessHost.h"
+
+#include "base/bind.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/synchronization/lock.h"
+
+#include "../../platform/Platform.h"
+#include "../../platform/WebRect.h"
+#include "../../platform/WebURL.h"
+#include "../../platform/WebURLRequest.h"
+#include "../../web/WebFrame.h"
+#include "../../web/WebSettings.h"
+#include "../../web/WebView.h"
+
+#include "TileRasterizer.h"
+#include "WebFrameClientImpl.h"
+#include "WebLayerTreeViewImpl.h"
+#include "WebViewClientImpl.h"
+
+
+HeadlessHost::PageStats::PageStats()
+    : loaded(false)
+    , frameCount(0)
+    , skippedFrames(0)
+    , paintedPixels(0)
+    , copiedPixels(0)
+    , themeShapes(0)
+    , themeDraws(0)
+{
+}
+
+double HeadlessHost::PageStats::loadTimeMs() const
+{
+    return loadTime.InMillisecondsF();
+}
+
+double HeadlessHost::PageStats::averageFrameTimeMs() const
+{
+    if (!frameCount)
+        return 0;
+    return totalFrameTime.InMillisecondsF() / frameCount;
+}
+
+double HeadlessHost::PageStats::framesPerSecond() const
+{
+    if (totalFrameTime <= base::TimeDelta())
+        return 0;
+    return frameCount / totalFrameTime.InSecondsF();
+}
+
+double HeadlessHost::PageStats::repaintRatio() const
+{
+    int64 changed = paintedPixels + copiedPixels;
+    if (!changed)
+        return 0;
+    return static_cast<double>(paintedPixels) / changed;
+}
+
+HeadlessHost::HeadlessHost(const WebSize& viewportSize)
+    : m_viewportSize(viewportSize)
+    , m_viewClient(new WebViewClientImpl)
+    , m_frameClient(new WebFrameClientImpl)
+    , m_view(0)
+    , m_frame(0)
+    , m_backingStore(viewportSize)
+    , m_frameScheduler(base::Bind(&HeadlessHost::runFrame, base::Unretained(this)),
+                       base::TimeDelta::FromMicroseconds(base::Time::kMicrosecondsPerSecond / 60))
+    , m_framesLeft(0)
+    , m_pageStats(0)
+    , m_runLoop(0)
+    , m_loading(false)
+    , m_weakFactory(this)
+{
+    m_viewClient->setBackingStore(&m_backingStore);
+    m_viewClient->setFrameScheduler(&m_frameScheduler);
+    m_frameScheduler.setVirtualClock(true);
+    m_view = WebView::create(m_viewClient.get());
+    m_view->settings()->setThreadedHTMLParser(true);
+    m_frame = WebFrame::create(m_frameClient.get());
+    m_view->setMainFrame(m_frame);
+    m_viewClient->setWebView(m_view);
+    m_viewClient->resize(m_viewportSize);
+    setRasterThreads(Platform::current()->numberOfProcessors());
+
+    m_viewClient->setLoadingStoppedCallback(
+        base::Bind(&HeadlessHost::didStopLoading, m_weakFactory.GetWeakPtr()));
+}
+
+HeadlessHost::~HeadlessHost()
+{
+    m_viewClient->setLoadingStoppedCallback(base::Closure());
+    m_viewClient->setBackingStore(0);
+    m_viewClient->setFrameScheduler(0);
+    m_viewClient->setWebView(0);
+    m_backingStore.setRasterizer(0);
+    // The view owns the main frame but not its client; close the view first.
+    m_view->close();
+    m_frame->close();
+}
+
+void HeadlessHost::setRasterThreads(int threads)
+{
+    m_backingStore.setRasterizer(0);
+    m_rasterizer.reset(threads > 1 ? new TileRasterizer(threads) : 0);
+    m_backingStore.setRasterizer(m_rasterizer.get());
+    m_view->settings()->setDeferredImageDecodingEnabled(threads > 1);
+}
+
+void HeadlessHost::setCompositingEnabled(bool enabled)
+{
+    m_view->settings()->setAcceleratedCompositingEnabled(enabled);
+}
+
+void HeadlessHost::setDeviceScaleFactor(float scale)
+{
+    m_viewClient->setDeviceScaleFactor(scale);
+}
+
+const SkBitmap& HeadlessHost::bitmap() const
+{
+    return m_compositedBitmap.isNull() ? m_backingStore.bitmap() : m_compositedBitmap;
+}
+
+bool HeadlessHost::renderPage(const GURL& url, int frames, base::TimeDelta loadTimeout, PageStats* stats)
+{
+    DCHECK(!m_runLoop);
+    stats->url = url.spec();
+
+    WebURLRequest request;
+    request.initialize();
+    request.setURL(WebURL(url));
+
+    base::TimeTicks loadStart = base::TimeTicks::Now();
+    m_loading = true;
+    m_frame->loadRequest(request);
+
+    if (m_loading) {
+        base::RunLoop runLoop;
+        m_runLoop = &runLoop;
+        base::MessageLoop::current()->PostDelayedTask(FROM_HERE,
+            base::Bind(&HeadlessHost::didTimeOut, m_weakFactory.GetWeakPtr()),
+            loadTimeout);
+        runLoop.Run();
+        m_runLoop = 0;
+    }
+
+    stats->loaded = !m_loading;
+    stats->loadTime = base::TimeTicks::Now() - loadStart;
+
+    int64 paintedPixels = m_backingStore.paintedPixels();
+    int64 copiedPixels = m_backingStore.copiedPixels();
+    int64 themeShapes = m_backingStore.themeShapes();
+    int64 themeDraws = m_backingStore.themeDraws();
+    int64 rasteredPixels = 0;
+    if (WebLayerTreeViewImpl* layerTreeView = m_viewClient->activeLayerTreeView())
+        rasteredPixels = layerTreeView->rasteredPixels();
+    m_frameScheduler.resetStats();
+    if (frames > 0) {
+        // Timers and loader callbacks queued by a frame run before the next
+        // one, as the scheduler's ticks are ordinary tasks.
+        base::RunLoop runLoop;
+        m_runLoop = &runLoop;
+        m_framesLeft = frames;
+        m_pageStats = stats;
+        m_frameScheduler.setNeedsFrame();
+        runLoop.Run();
+        m_pageStats = 0;
+        m_runLoop = 0;
+    }
+    stats->frameTimeP50 = m_frameScheduler.frameTimePercentile(50);
+    stats->frameTimeP90 = m_frameScheduler.frameTimePercentile(90);
+    stats->frameTimeP99 = m_frameScheduler.frameTimePercentile(99);
+    stats->skippedFrames = m_frameScheduler.skippedFrames();
+    stats->paintedPixels = m_backingStore.paintedPixels() - paintedPixels;
+    stats->copiedPixels = m_backingStore.copiedPixels() - copiedPixels;
+    stats->themeShapes = m_backingStore.themeShapes() - themeShapes;
+    stats->themeDraws = m_backingStore.themeDraws() - themeDraws;
+
+    m_compositedBitmap.reset();
+    if (WebLayerTreeViewImpl* layerTreeView = m_viewClient->activeLayerTreeView()) {
+        stats->paintedPixels += layerTreeView->rasteredPixels() - rasteredPixels;
+        layerTreeView->finishAllRendering();
+        base::AutoLock locker(layerTreeView->outputLock());
+        layerTreeView->output().copyTo(&m_compositedBitmap, SkBitmap::kARGB_8888_Config);
+    }
+
+    m_weakFactory.InvalidateWeakPtrs();
+    m_viewClient->setLoadingStoppedCallback(
+        base::Bind(&HeadlessHost::didStopLoading, m_weakFactory.GetWeakPtr()));
+    return stats->loaded;
+}
+
+// Both only end the load wait, not the frame loop that may follow it.
+void HeadlessHost::didStopLoading()
+{
+    if (m_runLoop && m_loading)
+        m_runLoop->Quit();
+    m_loading = false;
+}
+
+void HeadlessHost::didTimeOut()
+{
+    if (m_runLoop && m_loading)
+        m_runLoop->Quit();
+}
+
+void HeadlessHost::runFrame(double frameTime)
+{
+    base::TimeTicks start = base::TimeTicks::Now();
+
+    m_view->animate(frameTime);
+    m_view->layout();
+    if (WebLayerTreeViewImpl* layerTreeView = m_viewClient->activeLayerTreeView()) {
+        layerTreeView->commit();
+    } else {
+        SkRegion updated;
+        m_backingStore.paint(m_view, &updated);
+    }
+
+    // Frames the page asks for outside renderPage() are painted but not
+    // counted.
+    if (!m_pageStats)
+        return;
+    base::TimeDelta paintTime = base::TimeTicks::Now() - start;
+    PageStats* stats = m_pageStats;
+    if (!stats->frameCount || paintTime < stats->minFrameTime)
+        stats->minFrameTime = paintTime;
+    if (paintTime > stats->maxFrameTime)
+        stats->maxFrameTime = paintTime;
+    stats->totalFrameTime += paintTime;
+    ++stats->frameCount;
+
+    if (--m_framesLeft > 0)
+        m_frameScheduler.setNeedsFrame();
+    else
+        m_runLoop->Quit();
+}
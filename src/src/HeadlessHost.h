@@ -0,0 +1,135 @@
+#ifndef HeadlessHost_h
+#define HeadlessHost_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/time/time.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "url/gurl.h"
+
+#include "BackingStore.h"
+#include "FrameScheduler.h"
+
+#include "../../platform/WebSize.h"
+
+using namespace blink;
+
+namespace blink {
+    class WebFrame;
+    class WebView;
+}
+
+namespace base {
+    class RunLoop;
+}
+
+class TileRasterizer;
+class WebFrameClientImpl;
+class WebViewClientImpl;
+
+// Drives a WebView without a window: pages are loaded on the current
+// base::MessageLoop and painted into an offscreen BackingStore, which only
+// repaints what the page invalidated. Frames are clocked by a FrameScheduler
+// on a virtual 60 Hz vsync unless frameScheduler() is reconfigured.
+//
+// Blink keeps a single main thread per process, so one host renders one page
+// at a time. Render farms scale out by running one host per process.
+class HeadlessHost
+{
+public:
+    struct PageStats {
+        PageStats();
+
+        double loadTimeMs() const;
+        double averageFrameTimeMs() const;
+        // Frames painted per second of paint time, excluding the load.
+        double framesPerSecond() const;
+        // Share of the changed pixels that had to be repainted rather than
+        // copied by a scroll; 0 if nothing changed.
+        double repaintRatio() const;
+
+        std::string url;
+        bool loaded;
+        base::TimeDelta loadTime;
+        int frameCount;
+        base::TimeDelta totalFrameTime;
+        base::TimeDelta minFrameTime;
+        base::TimeDelta maxFrameTime;
+        base::TimeDelta frameTimeP50;
+        base::TimeDelta frameTimeP90;
+        base::TimeDelta frameTimeP99;
+        // Vsync ticks missed because a frame overran; always 0 on the
+        // virtual clock.
+        int64 skippedFrames;
+        // Pixels repainted and pixels copied by scrolls over all frames.
+        int64 paintedPixels;
+        int64 copiedPixels;
+        // Theme control shapes painted into the backing store, and the Skia
+        // draws they were batched into.
+        int64 themeShapes;
+        int64 themeDraws;
+    };
+
+    explicit HeadlessHost(const WebSize& viewportSize);
+    ~HeadlessHost();
+
+    // Loads |url|, waits until the view stops loading (or |loadTimeout|
+    // expires) and then runs |frames| animate/layout/paint cycles into the
+    // offscreen canvas, one per vsync. Returns false if the load timed out.
+    bool renderPage(const GURL& url, int frames, base::TimeDelta loadTimeout, PageStats*);
+
+    FrameScheduler& frameScheduler() { return m_frameScheduler; }
+
+    // Threads used to raster large damage, numberOfProcessors() by default.
+    // 1 paints on the main thread only. More than 1 also turns on deferred
+    // image decoding, so images decode on the raster threads.
+    void setRasterThreads(int threads);
+
+    // Renders through the layer compositor (see WebLayerTreeViewImpl)
+    // instead of painting the whole view, for pages with composited layers.
+    void setCompositingEnabled(bool);
+
+    // Renders for a display of |scale| device pixels per DIP: the page lays
+    // out in DIPs and the bitmap keeps its size in device pixels; see
+    // WebViewClientImpl::setDeviceScaleFactor().
+    void setDeviceScaleFactor(float scale);
+
+    // The pixels of the last painted frame.
+    const SkBitmap& bitmap() const;
+
+private:
+    void didStopLoading();
+    void didTimeOut();
+    void runFrame(double frameTime);
+
+    WebSize m_viewportSize;
+    scoped_ptr<WebViewClientImpl> m_viewClient;
+    scoped_ptr<WebFrameClientImpl> m_frameClient;
+    WebView* m_view;
+    WebFrame* m_frame;
+
+    BackingStore m_backingStore;
+    scoped_ptr<TileRasterizer> m_rasterizer;
+    // A copy of the compositor's output after the last page, in compositing
+    // mode.
+    SkBitmap m_compositedBitmap;
+    FrameScheduler m_frameScheduler;
+    // Frames renderPage() still has to run, and where they are counted.
+    int m_framesLeft;
+    PageStats* m_pageStats;
+
+    base::RunLoop* m_runLoop;
+    bool m_loading;
+
+    // Invalidated after every page so a stale load timeout can't fire.
+    base::WeakPtrFactory<HeadlessHost> m_weakFactory;
+};
+
+
+#endif // HeadlessHost_h
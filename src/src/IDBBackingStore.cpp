@@ -0,0 +1,656 @@
+#include "IDBBackingStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "base/strings/string_number_conversions.h"
+
+
+namespace
+{
+
+    // The store's keys: the metadata, then per object store its key
+    // generator, its records by primary key, and its indexes' entries by
+    // index key and then primary key, which keep the entry unique.
+    const char metadataKey[] = "m";
+    const char generatorPrefix = 'g';
+    const char recordPrefix = 'r';
+    const char indexPrefix = 'i';
+    // Above the first byte of any encoded key, so appended to an index key
+    // it sorts after every entry with that key.
+    const char afterEntries = '\xff';
+    const uint64 signBit = GG_UINT64_C(1) << 63;
+
+    void appendBigEndian(uint64 value, std::string* out)
+    {
+        for (int shift = 56; shift >= 0; shift -= 8)
+            out->push_back(static_cast<char>((value >> shift) & 0xff));
+    }
+
+    std::string objectStorePrefix(char prefix, int64 objectStoreId)
+    {
+        std::string key(1, prefix);
+        appendBigEndian(static_cast<uint64>(objectStoreId), &key);
+        return key;
+    }
+
+    std::string indexEntryPrefix(int64 objectStoreId, int64 indexId)
+    {
+        std::string key = objectStorePrefix(indexPrefix, objectStoreId);
+        appendBigEndian(static_cast<uint64>(indexId), &key);
+        return key;
+    }
+
+    bool startsWith(const std::string& key, const std::string& prefix)
+    {
+        return !key.compare(0, prefix.size(), prefix);
+    }
+
+    // A record is its index keys, as a pickle, followed by the value as it
+    // is, so the value is never unpickled.
+    std::string encodeRecord(const std::string& value, const IDBBackingStore::IndexKeys& indexKeys)
+    {
+        Pickle pickle;
+        pickle.WriteUInt32(static_cast<uint32>(indexKeys.size()));
+        for (size_t i = 0; i < indexKeys.size(); ++i) {
+            pickle.WriteInt64(indexKeys[i].first);
+            pickle.WriteUInt32(static_cast<uint32>(indexKeys[i].second.size()));
+            for (size_t j = 0; j < indexKeys[i].second.size(); ++j)
+                pickle.WriteString(indexKeys[i].second[j]);
+        }
+        std::string record(static_cast<const char*>(pickle.data()), pickle.size());
+        record.append(value);
+        return record;
+    }
+
+    bool decodeRecord(const std::string& record, IDBBackingStore::IndexKeys* indexKeys, std::string* value)
+    {
+        const char* begin = record.data();
+        const char* end = begin + record.size();
+        const char* pickleEnd = Pickle::FindNext(sizeof(Pickle::Header), begin, end);
+        if (!pickleEnd)
+            return false;
+        if (value)
+            value->assign(pickleEnd, end);
+        if (!indexKeys)
+            return true;
+
+        Pickle pickle(begin, static_cast<int>(pickleEnd - begin));
+        PickleIterator iter(pickle);
+        uint32 count;
+        if (!pickle.ReadUInt32(&iter, &count))
+            return false;
+        indexKeys->resize(count);
+        for (uint32 i = 0; i < count; ++i) {
+            uint32 keyCount;
+            if (!pickle.ReadInt64(&iter, &(*indexKeys)[i].first) || !pickle.ReadUInt32(&iter, &keyCount))
+                return false;
+            (*indexKeys)[i].second.resize(keyCount);
+            for (uint32 j = 0; j < keyCount; ++j) {
+                if (!pickle.ReadString(&iter, &(*indexKeys)[i].second[j]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void writeKeyPath(const IDBKeyPathInfo& keyPath, Pickle* pickle)
+    {
+        pickle->WriteInt(keyPath.type);
+        pickle->WriteUInt32(static_cast<uint32>(keyPath.paths.size()));
+        for (size_t i = 0; i < keyPath.paths.size(); ++i)
+            pickle->WriteString16(keyPath.paths[i]);
+    }
+
+    bool readKeyPath(const Pickle& pickle, PickleIterator* iter, IDBKeyPathInfo* keyPath)
+    {
+        int type;
+        uint32 count;
+        if (!pickle.ReadInt(iter, &type) || type < IDBKeyPathInfo::NullType || type > IDBKeyPathInfo::ArrayType
+                || !pickle.ReadUInt32(iter, &count))
+            return false;
+        keyPath->type = static_cast<IDBKeyPathInfo::Type>(type);
+        keyPath->paths.resize(count);
+        for (uint32 i = 0; i < count; ++i) {
+            if (!pickle.ReadString16(iter, &keyPath->paths[i]))
+                return false;
+        }
+        return true;
+    }
+
+    std::string encodeMetadata(const IDBDatabaseInfo& metadata)
+    {
+        Pickle pickle;
+        pickle.WriteInt64(metadata.version);
+        pickle.WriteInt64(metadata.maxObjectStoreId);
+        pickle.WriteUInt32(static_cast<uint32>(metadata.objectStores.size()));
+        for (std::map<int64, IDBObjectStoreInfo>::const_iterator store = metadata.objectStores.begin();
+             store != metadata.objectStores.end(); ++store) {
+            pickle.WriteInt64(store->second.id);
+            pickle.WriteString16(store->second.name);
+            writeKeyPath(store->second.keyPath, &pickle);
+            pickle.WriteBool(store->second.autoIncrement);
+            pickle.WriteInt64(store->second.maxIndexId);
+            pickle.WriteUInt32(static_cast<uint32>(store->second.indexes.size()));
+            for (std::map<int64, IDBIndexInfo>::const_iterator index = store->second.indexes.begin();
+                 index != store->second.indexes.end(); ++index) {
+                pickle.WriteInt64(index->second.id);
+                pickle.WriteString16(index->second.name);
+                writeKeyPath(index->second.keyPath, &pickle);
+                pickle.WriteBool(index->second.unique);
+                pickle.WriteBool(index->second.multiEntry);
+            }
+        }
+        return std::string(static_cast<const char*>(pickle.data()), pickle.size());
+    }
+
+    bool decodeMetadata(const std::string& data, IDBDatabaseInfo* metadata)
+    {
+        Pickle pickle(data.data(), static_cast<int>(data.size()));
+        PickleIterator iter(pickle);
+        uint32 storeCount;
+        if (!pickle.ReadInt64(&iter, &metadata->version) || !pickle.ReadInt64(&iter, &metadata->maxObjectStoreId)
+                || !pickle.ReadUInt32(&iter, &storeCount))
+            return false;
+        for (uint32 i = 0; i < storeCount; ++i) {
+            IDBObjectStoreInfo store;
+            uint32 indexCount;
+            if (!pickle.ReadInt64(&iter, &store.id) || !pickle.ReadString16(&iter, &store.name)
+                    || !readKeyPath(pickle, &iter, &store.keyPath) || !pickle.ReadBool(&iter, &store.autoIncrement)
+                    || !pickle.ReadInt64(&iter, &store.maxIndexId) || !pickle.ReadUInt32(&iter, &indexCount))
+                return false;
+            for (uint32 j = 0; j < indexCount; ++j) {
+                IDBIndexInfo index;
+                if (!pickle.ReadInt64(&iter, &index.id) || !pickle.ReadString16(&iter, &index.name)
+                        || !readKeyPath(pickle, &iter, &index.keyPath) || !pickle.ReadBool(&iter, &index.unique)
+                        || !pickle.ReadBool(&iter, &index.multiEntry))
+                    return false;
+                store.indexes[index.id] = index;
+            }
+            metadata->objectStores[store.id] = store;
+        }
+        return true;
+    }
+
+}
+
+IDBKeyPathInfo::IDBKeyPathInfo()
+    : type(NullType)
+{
+}
+
+IDBIndexInfo::IDBIndexInfo()
+    : id(IDBBackingStore::noIndex)
+    , unique(false)
+    , multiEntry(false)
+{
+}
+
+IDBObjectStoreInfo::IDBObjectStoreInfo()
+    : id(0)
+    , autoIncrement(false)
+    , maxIndexId(0)
+{
+}
+
+IDBDatabaseInfo::IDBDatabaseInfo()
+    : version(IDBBackingStore::noVersion)
+    , maxObjectStoreId(0)
+{
+}
+
+IDBBackingStore::KeyRange::KeyRange()
+    : lowerOpen(false)
+    , upperOpen(false)
+{
+}
+
+IDBBackingStore::Cursor::Cursor()
+    : objectStoreId(0)
+    , indexId(noIndex)
+    , reverse(false)
+    , unique(false)
+    , keyOnly(false)
+    , positioned(false)
+{
+}
+
+IDBBackingStore::IDBBackingStore(const base::FilePath& directory, scoped_refptr<base::MessageLoopProxy> background)
+    : m_store(new LogStructuredStore(directory, background))
+{
+}
+
+IDBBackingStore::~IDBBackingStore()
+{
+}
+
+bool IDBBackingStore::open()
+{
+    if (!m_store->open())
+        return false;
+    std::string metadata;
+    if (m_store->get(metadataKey, &metadata) && !decodeMetadata(metadata, &m_metadata)) {
+        LOG(WARNING) << "An IndexedDB database has corrupt metadata";
+        return false;
+    }
+    return true;
+}
+
+void IDBBackingStore::encodeNumber(KeyTag tag, double number, std::string* out)
+{
+    // -0 is the same key as 0.
+    if (!number)
+        number = 0;
+    uint64 bits;
+    memcpy(&bits, &number, sizeof(bits));
+    // Negative numbers' bits sort in reverse, below all positive ones.
+    bits = (bits & signBit) ? ~bits : bits | signBit;
+    out->push_back(static_cast<char>(tag));
+    appendBigEndian(bits, out);
+}
+
+bool IDBBackingStore::decodeNumber(const std::string& key, size_t* offset, double* number)
+{
+    if (*offset > key.size() || key.size() - *offset < sizeof(uint64))
+        return false;
+    uint64 bits = 0;
+    for (size_t i = 0; i < sizeof(uint64); ++i)
+        bits = (bits << 8) | static_cast<unsigned char>(key[*offset + i]);
+    bits = (bits & signBit) ? bits & ~signBit : ~bits;
+    memcpy(number, &bits, sizeof(bits));
+    *offset += sizeof(uint64);
+    return true;
+}
+
+// Each unit is two bytes, big-endian, and the string ends with three zero
+// bytes; a zero unit is followed by a one to tell it from the end.
+void IDBBackingStore::encodeString(const base::string16& string, std::string* out)
+{
+    out->reserve(out->size() + 2 * string.size() + 4);
+    out->push_back(static_cast<char>(StringKey));
+    for (size_t i = 0; i < string.size(); ++i) {
+        out->push_back(static_cast<char>(string[i] >> 8));
+        out->push_back(static_cast<char>(string[i] & 0xff));
+        if (!string[i])
+            out->push_back(1);
+    }
+    out->append(3, '\0');
+}
+
+bool IDBBackingStore::decodeString(const std::string& key, size_t* offset, base::string16* string)
+{
+    size_t position = *offset;
+    for (;;) {
+        if (position > key.size() || key.size() - position < 2)
+            return false;
+        base::char16 unit = static_cast<base::char16>((static_cast<unsigned char>(key[position]) << 8)
+                                                      | static_cast<unsigned char>(key[position + 1]));
+        position += 2;
+        if (!unit) {
+            if (position >= key.size())
+                return false;
+            if (!key[position++])
+                break;
+        }
+        if (string)
+            string->push_back(unit);
+    }
+    *offset = position;
+    return true;
+}
+
+bool IDBBackingStore::skipKey(const std::string& key, size_t* offset)
+{
+    if (*offset >= key.size())
+        return false;
+    switch (key[(*offset)++]) {
+    case NumberKey:
+    case DateKey: {
+        double unused;
+        return decodeNumber(key, offset, &unused);
+    }
+    case StringKey:
+        return decodeString(key, offset, 0);
+    case ArrayKey:
+        for (;;) {
+            if (*offset >= key.size())
+                return false;
+            if (key[*offset] == KeyEnd) {
+                ++*offset;
+                return true;
+            }
+            if (!skipKey(key, offset))
+                return false;
+        }
+    default:
+        return false;
+    }
+}
+
+IDBBackingStore::Transaction::Transaction(IDBBackingStore* backingStore)
+    : m_backingStore(backingStore)
+    , m_metadata(backingStore->metadata())
+    , m_metadataChanged(false)
+{
+}
+
+void IDBBackingStore::Transaction::setVersion(int64 version)
+{
+    m_metadata.version = version;
+    m_metadataChanged = true;
+}
+
+void IDBBackingStore::Transaction::createObjectStore(const IDBObjectStoreInfo& info)
+{
+    m_metadata.objectStores[info.id] = info;
+    m_metadata.maxObjectStoreId = std::max(m_metadata.maxObjectStoreId, info.id);
+    m_metadataChanged = true;
+}
+
+void IDBBackingStore::Transaction::deleteObjectStore(int64 objectStoreId)
+{
+    m_metadata.objectStores.erase(objectStoreId);
+    m_metadataChanged = true;
+    removePrefix(objectStorePrefix(recordPrefix, objectStoreId));
+    removePrefix(objectStorePrefix(indexPrefix, objectStoreId));
+    m_batch.remove(objectStorePrefix(generatorPrefix, objectStoreId));
+}
+
+void IDBBackingStore::Transaction::createIndex(int64 objectStoreId, const IDBIndexInfo& info)
+{
+    std::map<int64, IDBObjectStoreInfo>::iterator store = m_metadata.objectStores.find(objectStoreId);
+    if (store == m_metadata.objectStores.end())
+        return;
+    store->second.indexes[info.id] = info;
+    store->second.maxIndexId = std::max(store->second.maxIndexId, info.id);
+    m_metadataChanged = true;
+}
+
+// Records keep their keys for the index; removing a record removes the
+// entries, which are gone already, again.
+void IDBBackingStore::Transaction::deleteIndex(int64 objectStoreId, int64 indexId)
+{
+    std::map<int64, IDBObjectStoreInfo>::iterator store = m_metadata.objectStores.find(objectStoreId);
+    if (store == m_metadata.objectStores.end())
+        return;
+    store->second.indexes.erase(indexId);
+    m_metadataChanged = true;
+    removePrefix(indexEntryPrefix(objectStoreId, indexId));
+}
+
+IDBBackingStore::Status IDBBackingStore::Transaction::put(int64 objectStoreId, const std::string& key, const std::string& value,
+                                                          bool addOnly, const IndexKeys& indexKeys, std::string* primaryKey)
+{
+    std::map<int64, IDBObjectStoreInfo>::const_iterator store = m_metadata.objectStores.find(objectStoreId);
+    DCHECK(store != m_metadata.objectStores.end());
+    bool autoIncrement = store != m_metadata.objectStores.end() && store->second.autoIncrement;
+
+    std::string generatorKey = objectStorePrefix(generatorPrefix, objectStoreId);
+    int64 nextGenerated = 0;
+    *primaryKey = key;
+    if (autoIncrement) {
+        int64 current = 1;
+        std::string stored;
+        if (m_backingStore->m_store->get(generatorKey, &stored, &m_batch))
+            base::StringToInt64(stored, &current);
+        if (key.empty()) {
+            if (current > maxGeneratedKey)
+                return KeyGeneratorExhausted;
+            encodeNumber(NumberKey, static_cast<double>(current), primaryKey);
+            nextGenerated = current + 1;
+        } else if (key[0] == NumberKey) {
+            // An explicit number key moves the generator past it.
+            size_t offset = 1;
+            double number;
+            if (decodeNumber(key, &offset, &number) && number >= current)
+                nextGenerated = number >= maxGeneratedKey ? maxGeneratedKey + 1 : static_cast<int64>(std::floor(number)) + 1;
+        }
+    }
+    DCHECK(!primaryKey->empty());
+
+    std::string recordKey = objectStorePrefix(recordPrefix, objectStoreId) + *primaryKey;
+    std::string existing;
+    bool exists = m_backingStore->m_store->get(recordKey, &existing, &m_batch);
+    if (exists && addOnly)
+        return KeyExists;
+    if (violatesUniqueIndex(objectStoreId, *primaryKey, indexKeys))
+        return UniqueIndexViolated;
+
+    if (exists)
+        removeRecord(objectStoreId, *primaryKey, existing);
+    writeRecord(objectStoreId, *primaryKey, value, indexKeys);
+    if (nextGenerated)
+        m_batch.put(generatorKey, base::Int64ToString(nextGenerated));
+    return Succeeded;
+}
+
+IDBBackingStore::Status IDBBackingStore::Transaction::setIndexKeys(int64 objectStoreId, const std::string& primaryKey,
+                                                                   const IndexKeys& keys)
+{
+    std::string record;
+    if (!m_backingStore->m_store->get(objectStorePrefix(recordPrefix, objectStoreId) + primaryKey, &record, &m_batch))
+        return Succeeded;
+    if (violatesUniqueIndex(objectStoreId, primaryKey, keys))
+        return UniqueIndexViolated;
+
+    IndexKeys indexKeys;
+    std::string value;
+    if (!decodeRecord(record, &indexKeys, &value))
+        return Succeeded;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t j = 0;
+        while (j < indexKeys.size() && indexKeys[j].first != keys[i].first)
+            ++j;
+        if (j == indexKeys.size())
+            indexKeys.push_back(keys[i]);
+        else
+            indexKeys[j] = keys[i];
+    }
+    writeRecord(objectStoreId, primaryKey, value, indexKeys);
+    return Succeeded;
+}
+
+bool IDBBackingStore::Transaction::get(int64 objectStoreId, const std::string& primaryKey, std::string* value)
+{
+    std::string record;
+    if (!m_backingStore->m_store->get(objectStorePrefix(recordPrefix, objectStoreId) + primaryKey, &record, &m_batch))
+        return false;
+    return decodeRecord(record, 0, value);
+}
+
+bool IDBBackingStore::Transaction::advance(Cursor* cursor, const std::string& target)
+{
+    const bool index = cursor->indexId != noIndex;
+    const KeyRange& range = cursor->range;
+    std::string prefix = index ? indexEntryPrefix(cursor->objectStoreId, cursor->indexId)
+                               : objectStorePrefix(recordPrefix, cursor->objectStoreId);
+
+    // Index entries are the index key followed by the primary key, so an
+    // index key bounds its entries from below, and with afterEntries
+    // appended, from above.
+    std::string from;
+    bool exclusive;
+    if (!cursor->positioned) {
+        if (!cursor->reverse) {
+            from = prefix + range.lower;
+            exclusive = !index && range.lowerOpen;
+            if (index && range.lowerOpen)
+                from.push_back(afterEntries);
+        } else if (range.upper.empty()) {
+            from = prefix;
+            from.push_back(afterEntries);
+            exclusive = true;
+        } else {
+            from = prefix + range.upper;
+            exclusive = index || range.upperOpen;
+            if (index && !range.upperOpen)
+                from.push_back(afterEntries);
+        }
+    } else if (index && cursor->unique) {
+        from = prefix + cursor->key;
+        exclusive = cursor->reverse;
+        if (!cursor->reverse)
+            from.push_back(afterEntries);
+    } else {
+        from = prefix + cursor->key + (index ? cursor->primaryKey : std::string());
+        exclusive = true;
+    }
+    if (cursor->positioned && !target.empty()
+            && (cursor->reverse ? target < cursor->key : target > cursor->key)) {
+        from = prefix + target;
+        exclusive = index && cursor->reverse;
+        if (exclusive)
+            from.push_back(afterEntries);
+    }
+
+    std::string found, value;
+    if (!seek(from, exclusive, cursor->reverse, &found, &value) || !startsWith(found, prefix))
+        return false;
+    std::string key, primaryKey;
+    if (index) {
+        size_t offset = prefix.size();
+        if (!skipKey(found, &offset))
+            return false;
+        key = found.substr(prefix.size(), offset - prefix.size());
+        primaryKey = found.substr(offset);
+    } else {
+        key = found.substr(prefix.size());
+    }
+
+    if (!cursor->reverse && !range.upper.empty()) {
+        int order = key.compare(range.upper);
+        if (order > 0 || (!order && range.upperOpen))
+            return false;
+    }
+    if (cursor->reverse && !range.lower.empty()) {
+        int order = key.compare(range.lower);
+        if (order < 0 || (!order && range.lowerOpen))
+            return false;
+    }
+    // Going back over unique keys, each key's first entry is the one seen.
+    if (index && cursor->unique && cursor->reverse && seek(prefix + key, false, false, &found, &value))
+        primaryKey = found.substr(prefix.size() + key.size());
+
+    cursor->positioned = true;
+    cursor->key.swap(key);
+    if (index)
+        cursor->primaryKey.swap(primaryKey);
+    else
+        cursor->primaryKey = cursor->key;
+    cursor->value.clear();
+    if (!cursor->keyOnly) {
+        if (index)
+            get(cursor->objectStoreId, cursor->primaryKey, &cursor->value);
+        else
+            decodeRecord(value, 0, &cursor->value);
+    }
+    return true;
+}
+
+int64 IDBBackingStore::Transaction::count(int64 objectStoreId, int64 indexId, const KeyRange& range)
+{
+    Cursor cursor;
+    cursor.objectStoreId = objectStoreId;
+    cursor.indexId = indexId;
+    cursor.range = range;
+    cursor.keyOnly = true;
+    int64 count = 0;
+    while (advance(&cursor))
+        ++count;
+    return count;
+}
+
+void IDBBackingStore::Transaction::deleteRange(int64 objectStoreId, const KeyRange& range)
+{
+    std::string prefix = objectStorePrefix(recordPrefix, objectStoreId);
+    std::string from = prefix + range.lower;
+    bool exclusive = range.lowerOpen;
+    std::string key, record;
+    while (seek(from, exclusive, false, &key, &record) && startsWith(key, prefix)) {
+        std::string primaryKey = key.substr(prefix.size());
+        if (!range.upper.empty()) {
+            int order = primaryKey.compare(range.upper);
+            if (order > 0 || (!order && range.upperOpen))
+                break;
+        }
+        removeRecord(objectStoreId, primaryKey, record);
+        from.swap(key);
+        exclusive = true;
+    }
+}
+
+bool IDBBackingStore::Transaction::commit()
+{
+    if (m_metadataChanged)
+        m_batch.put(metadataKey, encodeMetadata(m_metadata));
+    if (!m_backingStore->m_store->write(m_batch))
+        return false;
+    m_backingStore->m_metadata = m_metadata;
+    m_metadataChanged = false;
+    m_batch.clear();
+    return true;
+}
+
+bool IDBBackingStore::Transaction::violatesUniqueIndex(int64 objectStoreId, const std::string& primaryKey, const IndexKeys& indexKeys)
+{
+    std::map<int64, IDBObjectStoreInfo>::const_iterator store = m_metadata.objectStores.find(objectStoreId);
+    if (store == m_metadata.objectStores.end())
+        return false;
+    for (size_t i = 0; i < indexKeys.size(); ++i) {
+        std::map<int64, IDBIndexInfo>::const_iterator index = store->second.indexes.find(indexKeys[i].first);
+        if (index == store->second.indexes.end() || !index->second.unique)
+            continue;
+        for (size_t j = 0; j < indexKeys[i].second.size(); ++j) {
+            std::string prefix = indexEntryPrefix(objectStoreId, indexKeys[i].first) + indexKeys[i].second[j];
+            std::string found, unused;
+            if (seek(prefix, false, false, &found, &unused) && startsWith(found, prefix)
+                    && found.compare(prefix.size(), std::string::npos, primaryKey))
+                return true;
+        }
+    }
+    return false;
+}
+
+void IDBBackingStore::Transaction::writeRecord(int64 objectStoreId, const std::string& primaryKey, const std::string& value,
+                                               const IndexKeys& indexKeys)
+{
+    m_batch.put(objectStorePrefix(recordPrefix, objectStoreId) + primaryKey, encodeRecord(value, indexKeys));
+    for (size_t i = 0; i < indexKeys.size(); ++i) {
+        std::string prefix = indexEntryPrefix(objectStoreId, indexKeys[i].first);
+        for (size_t j = 0; j < indexKeys[i].second.size(); ++j)
+            m_batch.put(prefix + indexKeys[i].second[j] + primaryKey, std::string());
+    }
+}
+
+void IDBBackingStore::Transaction::removeRecord(int64 objectStoreId, const std::string& primaryKey, const std::string& record)
+{
+    IndexKeys indexKeys;
+    if (decodeRecord(record, &indexKeys, 0)) {
+        for (size_t i = 0; i < indexKeys.size(); ++i) {
+            std::string prefix = indexEntryPrefix(objectStoreId, indexKeys[i].first);
+            for (size_t j = 0; j < indexKeys[i].second.size(); ++j)
+                m_batch.remove(prefix + indexKeys[i].second[j] + primaryKey);
+        }
+    }
+    m_batch.remove(objectStorePrefix(recordPrefix, objectStoreId) + primaryKey);
+}
+
+void IDBBackingStore::Transaction::removePrefix(const std::string& prefix)
+{
+    std::string from = prefix;
+    bool exclusive = false;
+    std::string key, unused;
+    while (seek(from, exclusive, false, &key, &unused) && startsWith(key, prefix)) {
+        m_batch.remove(key);
+        from.swap(key);
+        exclusive = true;
+    }
+}
+
+bool IDBBackingStore::Transaction::seek(const std::string& target, bool exclusive, bool reverse, std::string* key, std::string* value)
+{
+    return m_backingStore->m_store->seek(target, exclusive, reverse, &m_batch, key, value);
+}
@@ -0,0 +1,205 @@
+#ifndef IDBBackingStore_h
+#define IDBBackingStore_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/strings/string16.h"
+
+#include "LogStructuredStore.h"
+
+struct IDBKeyPathInfo {
+    // As WebIDBKeyPath numbers them.
+    enum Type {
+        NullType = 0,
+        StringType,
+        ArrayType
+    };
+
+    IDBKeyPathInfo();
+
+    Type type;
+    // A single path for StringType.
+    std::vector<base::string16> paths;
+};
+
+struct IDBIndexInfo {
+    IDBIndexInfo();
+
+    int64 id;
+    base::string16 name;
+    IDBKeyPathInfo keyPath;
+    bool unique;
+    bool multiEntry;
+};
+
+struct IDBObjectStoreInfo {
+    IDBObjectStoreInfo();
+
+    int64 id;
+    base::string16 name;
+    IDBKeyPathInfo keyPath;
+    bool autoIncrement;
+    int64 maxIndexId;
+    std::map<int64, IDBIndexInfo> indexes;
+};
+
+struct IDBDatabaseInfo {
+    IDBDatabaseInfo();
+
+    int64 version;
+    int64 maxObjectStoreId;
+    std::map<int64, IDBObjectStoreInfo> objectStores;
+};
+
+// One IndexedDB database in a LogStructuredStore: its metadata, its object
+// stores' records and its indexes' entries, all under keys that sort the
+// way IndexedDB orders them, so that a cursor is a walk through the store.
+//
+// IndexedDB keys are encoded so that comparing the bytes compares the keys:
+// a type tag (numbers < dates < strings < arrays), then an order-preserving
+// double, UTF-16 units ending in a terminator, or the elements followed by
+// KeyEnd. Encoded keys are never empty, and none is a prefix of another.
+//
+// A Transaction gathers its writes in a WriteBatch that its own reads see,
+// and commits them with a single log write. Dropping it uncommitted aborts.
+// Not thread-safe: a database is used from one thread.
+class IDBBackingStore
+{
+public:
+    static const int64 noVersion = -1;
+    static const int64 noIndex = -1;
+    // Generated keys stop at 2^53, the last integer a double holds exactly.
+    static const int64 maxGeneratedKey = GG_INT64_C(9007199254740992);
+
+    enum KeyTag {
+        KeyEnd = 0x00,
+        NumberKey = 0x10,
+        DateKey = 0x20,
+        StringKey = 0x30,
+        ArrayKey = 0x40
+    };
+
+    enum Status {
+        Succeeded,
+        KeyExists,
+        UniqueIndexViolated,
+        KeyGeneratorExhausted
+    };
+
+    // Index ids and their keys for one record.
+    typedef std::vector<std::pair<int64, std::vector<std::string> > > IndexKeys;
+
+    // Encoded keys; an empty bound is unbounded.
+    struct KeyRange {
+        KeyRange();
+
+        std::string lower;
+        std::string upper;
+        bool lowerOpen;
+        bool upperOpen;
+    };
+
+    // A position in an object store, or in one of its indexes, and how to
+    // move from it.
+    struct Cursor {
+        Cursor();
+
+        int64 objectStoreId;
+        int64 indexId;
+        KeyRange range;
+        bool reverse;
+        // Visits only the first entry of each index key.
+        bool unique;
+        // Leaves |value| empty.
+        bool keyOnly;
+
+        bool positioned;
+        std::string key;
+        std::string primaryKey;
+        std::string value;
+    };
+
+    class Transaction
+    {
+    public:
+        explicit Transaction(IDBBackingStore*);
+
+        const IDBDatabaseInfo& metadata() const { return m_metadata; }
+
+        // Version change transactions only.
+        void setVersion(int64);
+        void createObjectStore(const IDBObjectStoreInfo&);
+        void deleteObjectStore(int64 objectStoreId);
+        void createIndex(int64 objectStoreId, const IDBIndexInfo&);
+        void deleteIndex(int64 objectStoreId, int64 indexId);
+
+        // Stores |value| under |key|, or under a generated key when |key| is
+        // empty, and sets |*primaryKey| to the key used.
+        Status put(int64 objectStoreId, const std::string& key, const std::string& value, bool addOnly,
+                   const IndexKeys&, std::string* primaryKey);
+        // Adds the entries of the record at |primaryKey| to the indexes in
+        // |keys|, for an index created over existing records.
+        Status setIndexKeys(int64 objectStoreId, const std::string& primaryKey, const IndexKeys& keys);
+        bool get(int64 objectStoreId, const std::string& primaryKey, std::string* value);
+        // Moves |cursor| to its first entry, or on from its position; with a
+        // |target|, to the first entry at or beyond that key. Returns false
+        // at the end of the range.
+        bool advance(Cursor*, const std::string& target = std::string());
+        int64 count(int64 objectStoreId, int64 indexId, const KeyRange&);
+        void deleteRange(int64 objectStoreId, const KeyRange&);
+
+        // Writes everything the transaction did with one log fsync.
+        bool commit();
+
+    private:
+        bool violatesUniqueIndex(int64 objectStoreId, const std::string& primaryKey, const IndexKeys&);
+        void writeRecord(int64 objectStoreId, const std::string& primaryKey, const std::string& value, const IndexKeys&);
+        void removeRecord(int64 objectStoreId, const std::string& primaryKey, const std::string& record);
+        void removePrefix(const std::string& prefix);
+        bool seek(const std::string& target, bool exclusive, bool reverse, std::string* key, std::string* value);
+
+        IDBBackingStore* m_backingStore;
+        IDBDatabaseInfo m_metadata;
+        bool m_metadataChanged;
+        LogStructuredStore::WriteBatch m_batch;
+
+        DISALLOW_COPY_AND_ASSIGN(Transaction);
+    };
+
+    IDBBackingStore(const base::FilePath& directory, scoped_refptr<base::MessageLoopProxy> background);
+    ~IDBBackingStore();
+
+    // Returns false if the store couldn't be opened.
+    bool open();
+
+    const IDBDatabaseInfo& metadata() const { return m_metadata; }
+    LogStructuredStore* store() { return m_store.get(); }
+
+    static void encodeNumber(KeyTag, double, std::string*);
+    static void encodeString(const base::string16&, std::string*);
+    // Read past the tag at |*offset|.
+    static bool decodeNumber(const std::string&, size_t* offset, double*);
+    static bool decodeString(const std::string&, size_t* offset, base::string16*);
+    // Moves |*offset| past the whole key there.
+    static bool skipKey(const std::string&, size_t* offset);
+
+private:
+    scoped_refptr<LogStructuredStore> m_store;
+    IDBDatabaseInfo m_metadata;
+
+    DISALLOW_COPY_AND_ASSIGN(IDBBackingStore);
+};
+
+
+#endif // IDBBackingStore_h
@@ -0,0 +1,926 @@
+#include "IDBDatabaseBackend.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
+
+#include "../../platform/WebData.h"
+#include "../../platform/WebIDBDatabaseError.h"
+#include "../../platform/WebIDBDatabaseException.h"
+#include "../../platform/WebIDBMetadata.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebVector.h"
+
+#include "WebIDBCursorImpl.h"
+#include "WebIDBDatabaseImpl.h"
+
+
+namespace
+{
+
+    const char abortedMessage[] = "The transaction was aborted.";
+
+    WebIDBKey decodeKeyAt(const std::string& key, size_t* offset)
+    {
+        if (*offset >= key.size())
+            return WebIDBKey::createInvalid();
+        char tag = key[(*offset)++];
+        switch (tag) {
+        case IDBBackingStore::NumberKey:
+        case IDBBackingStore::DateKey: {
+            double number;
+            if (!IDBBackingStore::decodeNumber(key, offset, &number))
+                return WebIDBKey::createInvalid();
+            return tag == IDBBackingStore::NumberKey ? WebIDBKey::createNumber(number) : WebIDBKey::createDate(number);
+        }
+        case IDBBackingStore::StringKey: {
+            base::string16 string;
+            if (!IDBBackingStore::decodeString(key, offset, &string))
+                return WebIDBKey::createInvalid();
+            return WebIDBKey::createString(WebString(string));
+        }
+        case IDBBackingStore::ArrayKey: {
+            std::vector<WebIDBKey> elements;
+            while (*offset < key.size() && key[*offset] != IDBBackingStore::KeyEnd) {
+                WebIDBKey element = decodeKeyAt(key, offset);
+                if (element.keyType() == WebIDBKey::InvalidType)
+                    return element;
+                elements.push_back(element);
+            }
+            if (*offset >= key.size())
+                return WebIDBKey::createInvalid();
+            ++*offset;
+            return WebIDBKey::createArray(WebVector<WebIDBKey>(elements));
+        }
+        default:
+            return WebIDBKey::createInvalid();
+        }
+    }
+
+    WebIDBKeyPath toWebKeyPath(const IDBKeyPathInfo& keyPath)
+    {
+        switch (keyPath.type) {
+        case IDBKeyPathInfo::StringType:
+            return WebIDBKeyPath::create(WebString(keyPath.paths.empty() ? base::string16() : keyPath.paths[0]));
+        case IDBKeyPathInfo::ArrayType: {
+            WebVector<WebString> paths(keyPath.paths.size());
+            for (size_t i = 0; i < keyPath.paths.size(); ++i)
+                paths[i] = WebString(keyPath.paths[i]);
+            return WebIDBKeyPath::create(paths);
+        }
+        default:
+            return WebIDBKeyPath::createNull();
+        }
+    }
+
+    WebIDBMetadata toWebMetadata(const base::string16& name, int64 id, const IDBDatabaseInfo& info)
+    {
+        WebIDBMetadata metadata;
+        metadata.name = WebString(name);
+        metadata.id = id;
+        metadata.intVersion = info.version;
+        metadata.maxObjectStoreId = info.maxObjectStoreId;
+        WebVector<WebIDBMetadata::ObjectStore> stores(info.objectStores.size());
+        size_t i = 0;
+        for (std::map<int64, IDBObjectStoreInfo>::const_iterator store = info.objectStores.begin();
+             store != info.objectStores.end(); ++store, ++i) {
+            stores[i].id = store->second.id;
+            stores[i].name = WebString(store->second.name);
+            stores[i].keyPath = toWebKeyPath(store->second.keyPath);
+            stores[i].autoIncrement = store->second.autoIncrement;
+            stores[i].maxIndexId = store->second.maxIndexId;
+            WebVector<WebIDBMetadata::Index> indexes(store->second.indexes.size());
+            size_t j = 0;
+            for (std::map<int64, IDBIndexInfo>::const_iterator index = store->second.indexes.begin();
+                 index != store->second.indexes.end(); ++index, ++j) {
+                indexes[j].id = index->second.id;
+                indexes[j].name = WebString(index->second.name);
+                indexes[j].keyPath = toWebKeyPath(index->second.keyPath);
+                indexes[j].unique = index->second.unique;
+                indexes[j].multiEntry = index->second.multiEntry;
+            }
+            stores[i].indexes.swap(indexes);
+        }
+        metadata.objectStores.swap(stores);
+        return metadata;
+    }
+
+    // Serialized script values are never empty; an empty one is a cursor
+    // that only has keys.
+    WebData toWebData(const std::string& value)
+    {
+        return value.empty() ? WebData() : WebData(value.data(), value.size());
+    }
+
+    // These run on the thread of the request. A request's callbacks are
+    // deleted with its final answer.
+    void deliverError(WebIDBCallbacks* callbacks, unsigned short code, const std::string& message)
+    {
+        callbacks->onError(WebIDBDatabaseError(code, WebString::fromUTF8(message)));
+        delete callbacks;
+    }
+
+    void deliverSuccess(WebIDBCallbacks* callbacks)
+    {
+        callbacks->onSuccess();
+        delete callbacks;
+    }
+
+    void deliverKey(WebIDBCallbacks* callbacks, const std::string& key)
+    {
+        callbacks->onSuccess(IDBDatabaseBackend::decodeKey(key));
+        delete callbacks;
+    }
+
+    void deliverValue(WebIDBCallbacks* callbacks, const std::string& value)
+    {
+        callbacks->onSuccess(toWebData(value));
+        delete callbacks;
+    }
+
+    // A value whose generated key Blink puts back into it at |keyPath|.
+    void deliverValueWithKey(WebIDBCallbacks* callbacks, const std::string& value, const std::string& primaryKey,
+                             const IDBKeyPathInfo& keyPath)
+    {
+        callbacks->onSuccess(toWebData(value), IDBDatabaseBackend::decodeKey(primaryKey), toWebKeyPath(keyPath));
+        delete callbacks;
+    }
+
+    void deliverCount(WebIDBCallbacks* callbacks, int64 count)
+    {
+        callbacks->onSuccess(static_cast<long long>(count));
+        delete callbacks;
+    }
+
+    // A cursor that has no (more) entries.
+    void deliverCursorEnd(WebIDBCallbacks* callbacks)
+    {
+        callbacks->onSuccess(WebData());
+        delete callbacks;
+    }
+
+    void deliverCursor(WebIDBCallbacks* callbacks, scoped_refptr<IDBDatabaseBackend> backend, int64 cursorId,
+                       const std::string& key, const std::string& primaryKey, const std::string& value)
+    {
+        callbacks->onSuccess(new WebIDBCursorImpl(backend, cursorId), IDBDatabaseBackend::decodeKey(key),
+                             IDBDatabaseBackend::decodeKey(primaryKey), toWebData(value));
+        delete callbacks;
+    }
+
+    void deliverCursorContinue(WebIDBCallbacks* callbacks, const std::string& key, const std::string& primaryKey,
+                               const std::string& value)
+    {
+        callbacks->onSuccess(IDBDatabaseBackend::decodeKey(key), IDBDatabaseBackend::decodeKey(primaryKey), toWebData(value));
+        delete callbacks;
+    }
+
+    // Without a connection after a version change: Blink has it already.
+    void deliverDatabase(WebIDBCallbacks* callbacks, scoped_refptr<IDBDatabaseBackend> backend, int64 connectionId,
+                         const base::string16& name, int64 id, const IDBDatabaseInfo& metadata)
+    {
+        callbacks->onSuccess(connectionId ? new WebIDBDatabaseImpl(backend, connectionId) : 0, toWebMetadata(name, id, metadata));
+        delete callbacks;
+    }
+
+    void deliverUpgradeNeeded(WebIDBCallbacks* callbacks, scoped_refptr<IDBDatabaseBackend> backend, int64 connectionId,
+                              int64 oldVersion, const base::string16& name, int64 id, const IDBDatabaseInfo& metadata)
+    {
+        callbacks->onUpgradeNeeded(oldVersion, new WebIDBDatabaseImpl(backend, connectionId), toWebMetadata(name, id, metadata),
+                                   WebIDBDataLossNone, WebString());
+    }
+
+    void deliverBlocked(WebIDBCallbacks* callbacks, int64 oldVersion)
+    {
+        callbacks->onBlocked(oldVersion);
+    }
+
+    void deliverDeleted(WebIDBCallbacks* callbacks, int64 oldVersion)
+    {
+        callbacks->onSuccess(static_cast<long long>(oldVersion));
+        delete callbacks;
+    }
+
+    void notifyVersionChange(WebIDBDatabaseCallbacks* callbacks, int64 oldVersion, int64 newVersion)
+    {
+        callbacks->onVersionChange(oldVersion, newVersion);
+    }
+
+    void notifyForcedClose(WebIDBDatabaseCallbacks* callbacks)
+    {
+        callbacks->onForcedClose();
+    }
+
+    void notifyComplete(WebIDBDatabaseCallbacks* callbacks, int64 transactionId)
+    {
+        callbacks->onComplete(transactionId);
+    }
+
+    void notifyAbort(WebIDBDatabaseCallbacks* callbacks, int64 transactionId, unsigned short code, const std::string& message)
+    {
+        callbacks->onAbort(transactionId, WebIDBDatabaseError(code, WebString::fromUTF8(message)));
+    }
+
+    void deleteDatabaseCallbacks(WebIDBDatabaseCallbacks* callbacks)
+    {
+        delete callbacks;
+    }
+
+}
+
+IDBDatabaseBackend::Reply::Reply()
+    : callbacks(0)
+{
+}
+
+IDBDatabaseBackend::Reply::Reply(WebIDBCallbacks* callbacks, scoped_refptr<base::MessageLoopProxy> loop)
+    : callbacks(callbacks)
+    , loop(loop)
+{
+}
+
+IDBDatabaseBackend::Write::Write()
+    : objectStoreId(0)
+    , addOnly(false)
+{
+}
+
+IDBDatabaseBackend::Transaction::Transaction(int64 id, int64 connectionId)
+    : id(id)
+    , connectionId(connectionId)
+    , newVersion(IDBBackingStore::noVersion)
+    , commitRequested(false)
+    , failed(false)
+    , errorCode(0)
+{
+}
+
+IDBDatabaseBackend::Connection::Connection()
+    : callbacks(0)
+{
+}
+
+IDBDatabaseBackend::Request::Request()
+    : deleteDatabase(false)
+    , version(IDBBackingStore::noVersion)
+    , transactionId(0)
+    , databaseCallbacks(0)
+    , blocked(false)
+{
+}
+
+IDBDatabaseBackend::VersionChange::VersionChange()
+    : active(false)
+    , transactionId(0)
+{
+}
+
+IDBDatabaseBackend::IDBDatabaseBackend(const base::string16& name, int64 id, const base::FilePath& directory,
+                                       scoped_refptr<base::MessageLoopProxy> databaseThread,
+                                       scoped_refptr<base::MessageLoopProxy> background)
+    : m_name(name)
+    , m_id(id)
+    , m_directory(directory)
+    , m_databaseThread(databaseThread)
+    , m_background(background)
+    , m_nextConnectionId(1)
+    , m_running(0)
+    , m_starting(false)
+    , m_processingRequests(false)
+    , m_nextCursorId(1)
+{
+}
+
+IDBDatabaseBackend::~IDBDatabaseBackend()
+{
+    STLDeleteValues(&m_transactions);
+}
+
+bool IDBDatabaseBackend::encodeKey(const WebIDBKey& key, std::string* out)
+{
+    switch (key.keyType()) {
+    case WebIDBKey::NumberType:
+        IDBBackingStore::encodeNumber(IDBBackingStore::NumberKey, key.number(), out);
+        return true;
+    case WebIDBKey::DateType:
+        IDBBackingStore::encodeNumber(IDBBackingStore::DateKey, key.date(), out);
+        return true;
+    case WebIDBKey::StringType:
+        IDBBackingStore::encodeString(key.string(), out);
+        return true;
+    case WebIDBKey::ArrayType: {
+        out->push_back(static_cast<char>(IDBBackingStore::ArrayKey));
+        WebVector<WebIDBKey> elements = key.array();
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (!encodeKey(elements[i], out))
+                return false;
+        }
+        out->push_back(static_cast<char>(IDBBackingStore::KeyEnd));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+WebIDBKey IDBDatabaseBackend::decodeKey(const std::string& key)
+{
+    size_t offset = 0;
+    return decodeKeyAt(key, &offset);
+}
+
+IDBBackingStore::KeyRange IDBDatabaseBackend::encodeKeyRange(const WebIDBKeyRange& range)
+{
+    IDBBackingStore::KeyRange result;
+    if (!encodeKey(range.lower(), &result.lower))
+        result.lower.clear();
+    if (!encodeKey(range.upper(), &result.upper))
+        result.upper.clear();
+    result.lowerOpen = range.lowerOpen();
+    result.upperOpen = range.upperOpen();
+    return result;
+}
+
+IDBKeyPathInfo IDBDatabaseBackend::encodeKeyPath(const WebIDBKeyPath& keyPath)
+{
+    IDBKeyPathInfo info;
+    switch (keyPath.keyPathType()) {
+    case WebIDBKeyPath::StringType:
+        info.type = IDBKeyPathInfo::StringType;
+        info.paths.push_back(keyPath.string());
+        break;
+    case WebIDBKeyPath::ArrayType: {
+        info.type = IDBKeyPathInfo::ArrayType;
+        WebVector<WebString> paths = keyPath.array();
+        for (size_t i = 0; i < paths.size(); ++i)
+            info.paths.push_back(paths[i]);
+        break;
+    }
+    default:
+        break;
+    }
+    return info;
+}
+
+void IDBDatabaseBackend::encodeIndexKeys(const WebVector<long long>& indexIds, const WebVector<WebIDBDatabase::WebIndexKeys>& keys,
+                                         IDBBackingStore::IndexKeys* indexKeys)
+{
+    indexKeys->resize(std::min(indexIds.size(), keys.size()));
+    for (size_t i = 0; i < indexKeys->size(); ++i) {
+        (*indexKeys)[i].first = indexIds[i];
+        for (size_t j = 0; j < keys[i].size(); ++j) {
+            std::string key;
+            if (encodeKey(keys[i][j], &key))
+                (*indexKeys)[i].second.push_back(key);
+        }
+    }
+}
+
+void IDBDatabaseBackend::open(int64 version, int64 transactionId, const Reply& reply, WebIDBDatabaseCallbacks* databaseCallbacks)
+{
+    Request request;
+    request.version = version;
+    request.transactionId = transactionId;
+    request.reply = reply;
+    request.databaseCallbacks = databaseCallbacks;
+    m_requests.push_back(request);
+    processRequests();
+}
+
+void IDBDatabaseBackend::deleteDatabase(const Reply& reply)
+{
+    Request request;
+    request.deleteDatabase = true;
+    request.reply = reply;
+    m_requests.push_back(request);
+    processRequests();
+}
+
+void IDBDatabaseBackend::close(int64 connectionId)
+{
+    std::vector<int64> transactions;
+    for (std::map<int64, Transaction*>::iterator it = m_transactions.begin(); it != m_transactions.end(); ++it) {
+        if (it->second->connectionId == connectionId)
+            transactions.push_back(it->first);
+    }
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        if (Transaction* closing = transaction(transactions[i]))
+            finishTransaction(closing, false, WebIDBDatabaseExceptionAbortError, "Connection is closing.");
+    }
+
+    std::map<int64, Connection>::iterator connection = m_connections.find(connectionId);
+    if (connection == m_connections.end())
+        return;
+    connection->second.loop->PostTask(FROM_HERE, base::Bind(&deleteDatabaseCallbacks, connection->second.callbacks));
+    m_connections.erase(connection);
+    processRequests();
+}
+
+void IDBDatabaseBackend::forceClose(int64 connectionId)
+{
+    std::map<int64, Connection>::iterator connection = m_connections.find(connectionId);
+    if (connection != m_connections.end())
+        connection->second.loop->PostTask(FROM_HERE, base::Bind(&notifyForcedClose, connection->second.callbacks));
+    close(connectionId);
+}
+
+bool IDBDatabaseBackend::openBackingStore()
+{
+    if (m_backingStore)
+        return true;
+    TRACE_EVENT0("webui", "IDBDatabaseBackend::openBackingStore");
+    scoped_ptr<IDBBackingStore> backingStore(new IDBBackingStore(m_directory, m_background));
+    if (!backingStore->open())
+        return false;
+    m_backingStore = backingStore.Pass();
+    return true;
+}
+
+// Its files must be left alone before they can go.
+void IDBDatabaseBackend::closeBackingStore()
+{
+    if (!m_backingStore)
+        return;
+    m_backingStore->store()->waitForBackgroundWork();
+    m_backingStore.reset();
+}
+
+int64 IDBDatabaseBackend::currentVersion()
+{
+    return m_backingStore ? m_backingStore->metadata().version : IDBBackingStore::noVersion;
+}
+
+int64 IDBDatabaseBackend::addConnection(WebIDBDatabaseCallbacks* callbacks, scoped_refptr<base::MessageLoopProxy> loop)
+{
+    int64 id = m_nextConnectionId++;
+    Connection& connection = m_connections[id];
+    connection.callbacks = callbacks;
+    connection.loop = loop;
+    return id;
+}
+
+// A version change or a delete waits for every other connection to close,
+// and nothing else is opened while a version change runs.
+void IDBDatabaseBackend::processRequests()
+{
+    if (m_processingRequests)
+        return;
+    m_processingRequests = true;
+    while (!m_requests.empty() && !m_versionChange.active && processRequest(&m_requests.front()))
+        m_requests.pop_front();
+    m_processingRequests = false;
+}
+
+bool IDBDatabaseBackend::processRequest(Request* request)
+{
+    const Reply& reply = request->reply;
+    int64 version = request->deleteDatabase ? IDBBackingStore::noVersion : request->version;
+    if (!request->deleteDatabase) {
+        if (!openBackingStore()) {
+            replyError(reply, WebIDBDatabaseExceptionUnknownError, "Internal error opening backing store for indexedDB.open.");
+            reply.loop->PostTask(FROM_HERE, base::Bind(&deleteDatabaseCallbacks, request->databaseCallbacks));
+            return true;
+        }
+        int64 current = currentVersion();
+        if (version == IDBBackingStore::noVersion)
+            version = current == IDBBackingStore::noVersion ? 1 : current;
+        if (version < current) {
+            replyError(reply, WebIDBDatabaseExceptionVersionError, "The requested version (" + base::Int64ToString(version)
+                       + ") is less than the existing version (" + base::Int64ToString(current) + ").");
+            reply.loop->PostTask(FROM_HERE, base::Bind(&deleteDatabaseCallbacks, request->databaseCallbacks));
+            return true;
+        }
+        if (version == current) {
+            int64 connectionId = addConnection(request->databaseCallbacks, reply.loop);
+            reply.loop->PostTask(FROM_HERE, base::Bind(&deliverDatabase, reply.callbacks, make_scoped_refptr(this),
+                                                       connectionId, m_name, m_id, m_backingStore->metadata()));
+            return true;
+        }
+    }
+
+    if (!m_connections.empty()) {
+        if (!request->blocked) {
+            request->blocked = true;
+            int64 current = currentVersion();
+            for (std::map<int64, Connection>::iterator it = m_connections.begin(); it != m_connections.end(); ++it)
+                it->second.loop->PostTask(FROM_HERE, base::Bind(&notifyVersionChange, it->second.callbacks, current, version));
+            reply.loop->PostTask(FROM_HERE, base::Bind(&deliverBlocked, reply.callbacks, current));
+        }
+        return false;
+    }
+
+    if (request->deleteDatabase) {
+        TRACE_EVENT0("webui", "IDBDatabaseBackend::deleteDatabase");
+        int64 oldVersion = openBackingStore() ? currentVersion() : IDBBackingStore::noVersion;
+        closeBackingStore();
+        if (!base::DeleteFile(m_directory, true))
+            replyError(reply, WebIDBDatabaseExceptionUnknownError, "Internal error deleting database.");
+        else
+            reply.loop->PostTask(FROM_HERE, base::Bind(&deliverDeleted, reply.callbacks, oldVersion));
+        return true;
+    }
+
+    // The version change transaction goes ahead of any that are waiting.
+    int64 connectionId = addConnection(request->databaseCallbacks, reply.loop);
+    Transaction* versionChange = new Transaction(request->transactionId, connectionId);
+    versionChange->newVersion = version;
+    m_transactions[versionChange->id] = versionChange;
+    m_queue.push_front(versionChange->id);
+    m_versionChange.active = true;
+    m_versionChange.transactionId = versionChange->id;
+    m_versionChange.reply = reply;
+
+    IDBDatabaseInfo metadata = m_backingStore->metadata();
+    metadata.version = version;
+    reply.loop->PostTask(FROM_HERE, base::Bind(&deliverUpgradeNeeded, reply.callbacks, make_scoped_refptr(this),
+                                               connectionId, currentVersion(), m_name, m_id, metadata));
+    startTransactions();
+    return true;
+}
+
+void IDBDatabaseBackend::createTransaction(int64 connectionId, int64 transactionId)
+{
+    if (m_transactions.count(transactionId) || !m_connections.count(connectionId))
+        return;
+    m_transactions[transactionId] = new Transaction(transactionId, connectionId);
+    m_queue.push_back(transactionId);
+    startTransactions();
+}
+
+void IDBDatabaseBackend::commit(int64 transactionId)
+{
+    Transaction* committing = transaction(transactionId);
+    if (!committing)
+        return;
+    if (committing == m_running)
+        finishTransaction(committing, true);
+    else
+        committing->commitRequested = true;
+}
+
+void IDBDatabaseBackend::abort(int64 transactionId)
+{
+    if (Transaction* aborting = transaction(transactionId))
+        finishTransaction(aborting, false, WebIDBDatabaseExceptionAbortError, abortedMessage);
+}
+
+IDBDatabaseBackend::Transaction* IDBDatabaseBackend::transaction(int64 id)
+{
+    std::map<int64, Transaction*>::iterator it = m_transactions.find(id);
+    return it == m_transactions.end() ? 0 : it->second;
+}
+
+void IDBDatabaseBackend::schedule(int64 transactionId, const Operation& operation)
+{
+    Transaction* target = transaction(transactionId);
+    if (!target)
+        operation.Run(0);
+    else if (target != m_running)
+        target->pending.push_back(operation);
+    else
+        run(target, operation);
+}
+
+void IDBDatabaseBackend::run(Transaction* running, const Operation& operation)
+{
+    operation.Run(running);
+    if (running->failed) {
+        unsigned short errorCode = running->errorCode;
+        std::string errorMessage = running->errorMessage;
+        finishTransaction(running, false, errorCode, errorMessage);
+    }
+}
+
+void IDBDatabaseBackend::startTransactions()
+{
+    if (m_starting)
+        return;
+    m_starting = true;
+    while (!m_running && !m_queue.empty()) {
+        Transaction* next = transaction(m_queue.front());
+        m_queue.pop_front();
+        if (!next)
+            continue;
+        m_running = next;
+        next->store.reset(new IDBBackingStore::Transaction(m_backingStore.get()));
+        if (next->newVersion != IDBBackingStore::noVersion)
+            next->store->setVersion(next->newVersion);
+        while (m_running == next && !next->pending.empty()) {
+            Operation operation = next->pending.front();
+            next->pending.pop_front();
+            run(next, operation);
+        }
+        if (m_running == next && next->commitRequested)
+            finishTransaction(next, true);
+    }
+    m_starting = false;
+}
+
+void IDBDatabaseBackend::finishTransaction(Transaction* finishing, bool commit, unsigned short errorCode, const std::string& errorMessage)
+{
+    TRACE_EVENT1("webui", "IDBDatabaseBackend::finishTransaction", "commit", commit);
+    int64 id = finishing->id;
+    unsigned short code = errorCode;
+    std::string message = errorMessage;
+    bool committed = false;
+    if (commit) {
+        committed = finishing->store->commit();
+        if (!committed) {
+            code = WebIDBDatabaseExceptionUnknownError;
+            message = "Internal error committing transaction.";
+        }
+    }
+
+    std::map<int64, Connection>::iterator connection = m_connections.find(finishing->connectionId);
+    if (connection != m_connections.end()) {
+        if (committed)
+            connection->second.loop->PostTask(FROM_HERE, base::Bind(&notifyComplete, connection->second.callbacks, id));
+        else
+            connection->second.loop->PostTask(FROM_HERE, base::Bind(&notifyAbort, connection->second.callbacks, id, code, message));
+    }
+
+    for (std::map<int64, CursorState>::iterator cursor = m_cursors.begin(); cursor != m_cursors.end();) {
+        if (cursor->second.transactionId == id)
+            m_cursors.erase(cursor++);
+        else
+            ++cursor;
+    }
+
+    if (m_versionChange.active && m_versionChange.transactionId == id) {
+        m_versionChange.active = false;
+        const Reply& reply = m_versionChange.reply;
+        if (committed)
+            reply.loop->PostTask(FROM_HERE, base::Bind(&deliverDatabase, reply.callbacks, make_scoped_refptr(this),
+                                                       static_cast<int64>(0), m_name, m_id, m_backingStore->metadata()));
+        else
+            replyError(reply, WebIDBDatabaseExceptionAbortError, "Version change transaction was aborted in upgradeneeded event handler.");
+    }
+
+    std::deque<Operation> pending;
+    pending.swap(finishing->pending);
+    m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), id), m_queue.end());
+    m_transactions.erase(id);
+    if (m_running == finishing)
+        m_running = 0;
+    delete finishing;
+
+    // Requests still waiting in it are answered with an abort.
+    for (size_t i = 0; i < pending.size(); ++i)
+        pending[i].Run(0);
+
+    startTransactions();
+    processRequests();
+}
+
+void IDBDatabaseBackend::replyError(const Reply& reply, unsigned short code, const std::string& message)
+{
+    if (reply.callbacks)
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverError, reply.callbacks, code, message));
+}
+
+void IDBDatabaseBackend::createObjectStore(int64 transactionId, const IDBObjectStoreInfo& info)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doCreateObjectStore, base::Unretained(this), info));
+}
+
+void IDBDatabaseBackend::deleteObjectStore(int64 transactionId, int64 objectStoreId)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doDeleteObjectStore, base::Unretained(this), objectStoreId));
+}
+
+void IDBDatabaseBackend::createIndex(int64 transactionId, int64 objectStoreId, const IDBIndexInfo& info)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doCreateIndex, base::Unretained(this), objectStoreId, info));
+}
+
+void IDBDatabaseBackend::deleteIndex(int64 transactionId, int64 objectStoreId, int64 indexId)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doDeleteIndex, base::Unretained(this), objectStoreId, indexId));
+}
+
+void IDBDatabaseBackend::get(int64 transactionId, int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange& range,
+                             bool keyOnly, const Reply& reply)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doGet, base::Unretained(this), objectStoreId, indexId, range, keyOnly, reply));
+}
+
+void IDBDatabaseBackend::put(int64 transactionId, const Write& write, const Reply& reply)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doPut, base::Unretained(this), write, reply));
+}
+
+void IDBDatabaseBackend::setIndexKeys(int64 transactionId, int64 objectStoreId, const std::string& primaryKey,
+                                      const IDBBackingStore::IndexKeys& indexKeys)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doSetIndexKeys, base::Unretained(this), objectStoreId, primaryKey, indexKeys));
+}
+
+void IDBDatabaseBackend::openCursor(int64 transactionId, const IDBBackingStore::Cursor& cursor, const Reply& reply)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doOpenCursor, base::Unretained(this), cursor, reply));
+}
+
+void IDBDatabaseBackend::count(int64 transactionId, int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange& range,
+                               const Reply& reply)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doCount, base::Unretained(this), objectStoreId, indexId, range, reply));
+}
+
+void IDBDatabaseBackend::deleteRange(int64 transactionId, int64 objectStoreId, const IDBBackingStore::KeyRange& range,
+                                     const Reply& reply)
+{
+    schedule(transactionId, base::Bind(&IDBDatabaseBackend::doDeleteRange, base::Unretained(this), objectStoreId, range, reply));
+}
+
+void IDBDatabaseBackend::clear(int64 transactionId, int64 objectStoreId, const Reply& reply)
+{
+    deleteRange(transactionId, objectStoreId, IDBBackingStore::KeyRange(), reply);
+}
+
+void IDBDatabaseBackend::continueCursor(int64 cursorId, const std::string& target, unsigned long steps, const Reply& reply)
+{
+    std::map<int64, CursorState>::iterator cursor = m_cursors.find(cursorId);
+    if (cursor == m_cursors.end()) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+    schedule(cursor->second.transactionId,
+             base::Bind(&IDBDatabaseBackend::doContinueCursor, base::Unretained(this), cursorId, target, steps, reply));
+}
+
+void IDBDatabaseBackend::closeCursor(int64 cursorId)
+{
+    m_cursors.erase(cursorId);
+}
+
+void IDBDatabaseBackend::doCreateObjectStore(const IDBObjectStoreInfo& info, Transaction* running)
+{
+    if (running)
+        running->store->createObjectStore(info);
+}
+
+void IDBDatabaseBackend::doDeleteObjectStore(int64 objectStoreId, Transaction* running)
+{
+    if (running)
+        running->store->deleteObjectStore(objectStoreId);
+}
+
+void IDBDatabaseBackend::doCreateIndex(int64 objectStoreId, const IDBIndexInfo& info, Transaction* running)
+{
+    if (running)
+        running->store->createIndex(objectStoreId, info);
+}
+
+void IDBDatabaseBackend::doDeleteIndex(int64 objectStoreId, int64 indexId, Transaction* running)
+{
+    if (running)
+        running->store->deleteIndex(objectStoreId, indexId);
+}
+
+void IDBDatabaseBackend::doGet(int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange& range, bool keyOnly,
+                               const Reply& reply, Transaction* running)
+{
+    if (!running) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+
+    IDBBackingStore::Cursor cursor;
+    cursor.objectStoreId = objectStoreId;
+    cursor.indexId = indexId;
+    cursor.range = range;
+    cursor.keyOnly = keyOnly;
+    bool found;
+    if (indexId == IDBBackingStore::noIndex && !range.lower.empty() && range.lower == range.upper
+            && !range.lowerOpen && !range.upperOpen) {
+        // One key: a lookup, not a seek.
+        cursor.primaryKey = range.lower;
+        found = running->store->get(objectStoreId, range.lower, &cursor.value);
+    } else {
+        found = running->store->advance(&cursor);
+    }
+
+    if (!found) {
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverSuccess, reply.callbacks));
+        return;
+    }
+    if (keyOnly) {
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverKey, reply.callbacks, cursor.primaryKey));
+        return;
+    }
+    const std::map<int64, IDBObjectStoreInfo>& stores = running->store->metadata().objectStores;
+    std::map<int64, IDBObjectStoreInfo>::const_iterator store = stores.find(objectStoreId);
+    if (store != stores.end() && store->second.autoIncrement && store->second.keyPath.type != IDBKeyPathInfo::NullType)
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverValueWithKey, reply.callbacks, cursor.value, cursor.primaryKey,
+                                                   store->second.keyPath));
+    else
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverValue, reply.callbacks, cursor.value));
+}
+
+void IDBDatabaseBackend::doPut(const Write& write, const Reply& reply, Transaction* running)
+{
+    if (!running) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+
+    std::string primaryKey;
+    switch (running->store->put(write.objectStoreId, write.key, write.value->data(), write.addOnly, write.indexKeys, &primaryKey)) {
+    case IDBBackingStore::Succeeded:
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverKey, reply.callbacks, primaryKey));
+        break;
+    case IDBBackingStore::KeyExists:
+        replyError(reply, WebIDBDatabaseExceptionConstraintError, "Key already exists in the object store.");
+        break;
+    case IDBBackingStore::UniqueIndexViolated:
+        replyError(reply, WebIDBDatabaseExceptionConstraintError,
+                   "Unable to add key to index: at least one key does not satisfy the uniqueness requirements.");
+        break;
+    case IDBBackingStore::KeyGeneratorExhausted:
+        replyError(reply, WebIDBDatabaseExceptionConstraintError, "Maximum key generator value reached.");
+        break;
+    }
+}
+
+// A record breaking a unique index being created aborts the transaction
+// that creates it.
+void IDBDatabaseBackend::doSetIndexKeys(int64 objectStoreId, const std::string& primaryKey,
+                                        const IDBBackingStore::IndexKeys& indexKeys, Transaction* running)
+{
+    if (!running || running->store->setIndexKeys(objectStoreId, primaryKey, indexKeys) != IDBBackingStore::UniqueIndexViolated)
+        return;
+    running->failed = true;
+    running->errorCode = WebIDBDatabaseExceptionConstraintError;
+    running->errorMessage = "Unable to add key to index: at least one key does not satisfy the uniqueness requirements.";
+}
+
+void IDBDatabaseBackend::doOpenCursor(const IDBBackingStore::Cursor& cursor, const Reply& reply, Transaction* running)
+{
+    if (!running) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+
+    IDBBackingStore::Cursor position = cursor;
+    if (!running->store->advance(&position)) {
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverCursorEnd, reply.callbacks));
+        return;
+    }
+    int64 cursorId = m_nextCursorId++;
+    CursorState& state = m_cursors[cursorId];
+    state.transactionId = running->id;
+    state.cursor = position;
+    reply.loop->PostTask(FROM_HERE, base::Bind(&deliverCursor, reply.callbacks, make_scoped_refptr(this), cursorId,
+                                               position.key, position.primaryKey, position.value));
+}
+
+void IDBDatabaseBackend::doCount(int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange& range, const Reply& reply,
+                                 Transaction* running)
+{
+    if (!running) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+    reply.loop->PostTask(FROM_HERE, base::Bind(&deliverCount, reply.callbacks,
+                                               running->store->count(objectStoreId, indexId, range)));
+}
+
+void IDBDatabaseBackend::doDeleteRange(int64 objectStoreId, const IDBBackingStore::KeyRange& range, const Reply& reply,
+                                       Transaction* running)
+{
+    if (!running) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+    running->store->deleteRange(objectStoreId, range);
+    reply.loop->PostTask(FROM_HERE, base::Bind(&deliverSuccess, reply.callbacks));
+}
+
+// The cursor keeps only its position; each step seeks from there, so no
+// more of the store than the entries it returns is ever read out.
+void IDBDatabaseBackend::doContinueCursor(int64 cursorId, const std::string& target, unsigned long steps, const Reply& reply,
+                                          Transaction* running)
+{
+    std::map<int64, CursorState>::iterator cursor = m_cursors.find(cursorId);
+    if (!running || cursor == m_cursors.end()) {
+        replyError(reply, WebIDBDatabaseExceptionAbortError, abortedMessage);
+        return;
+    }
+
+    IDBBackingStore::Cursor& position = cursor->second.cursor;
+    bool found = running->store->advance(&position, target);
+    while (found && steps-- > 1)
+        found = running->store->advance(&position);
+    if (!found) {
+        m_cursors.erase(cursor);
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverCursorEnd, reply.callbacks));
+        return;
+    }
+    reply.loop->PostTask(FROM_HERE, base::Bind(&deliverCursorContinue, reply.callbacks, position.key, position.primaryKey,
+                                               position.value));
+}
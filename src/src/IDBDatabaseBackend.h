@@ -0,0 +1,224 @@
+#ifndef IDBDatabaseBackend_h
+#define IDBDatabaseBackend_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/strings/string16.h"
+
+#include "../../platform/WebIDBCallbacks.h"
+#include "../../platform/WebIDBDatabase.h"
+#include "../../platform/WebIDBDatabaseCallbacks.h"
+#include "../../platform/WebIDBKey.h"
+#include "../../platform/WebIDBKeyPath.h"
+#include "../../platform/WebIDBKeyRange.h"
+
+#include "IDBBackingStore.h"
+
+using namespace blink;
+
+// One IndexedDB database as its connections share it: the backing store,
+// the open and delete requests, the connections, the transactions and the
+// cursors. All of it lives on the database thread; the Blink objects that
+// talk to it, WebIDBDatabaseImpl and WebIDBCursorImpl, hand it plain data
+// there, and each request's callbacks are answered, then deleted, back on
+// the thread that made the request.
+//
+// Transactions run one at a time, in the order they were created; the
+// operations of one that hasn't started wait in it. A transaction's writes
+// reach the disk when it commits, all in one log record with one fsync,
+// however many puts it made.
+class IDBDatabaseBackend : public base::RefCountedThreadSafe<IDBDatabaseBackend>
+{
+public:
+    // Where a request's answer goes.
+    struct Reply {
+        Reply();
+        Reply(WebIDBCallbacks*, scoped_refptr<base::MessageLoopProxy>);
+
+        WebIDBCallbacks* callbacks;
+        scoped_refptr<base::MessageLoopProxy> loop;
+    };
+
+    // A put.
+    struct Write {
+        Write();
+
+        int64 objectStoreId;
+        // Empty to have one generated.
+        std::string key;
+        scoped_refptr<base::RefCountedString> value;
+        bool addOnly;
+        IDBBackingStore::IndexKeys indexKeys;
+    };
+
+    // Directory is the backing store's; flushes and compactions run on
+    // |background|.
+    IDBDatabaseBackend(const base::string16& name, int64 id, const base::FilePath& directory,
+                       scoped_refptr<base::MessageLoopProxy> databaseThread,
+                       scoped_refptr<base::MessageLoopProxy> background);
+
+    // Any thread.
+    base::MessageLoopProxy* databaseThread() const { return m_databaseThread.get(); }
+
+    // Conversions, on the thread that owns the Blink objects. encodeKey()
+    // returns false for a key that isn't valid.
+    static bool encodeKey(const WebIDBKey&, std::string*);
+    static WebIDBKey decodeKey(const std::string&);
+    static IDBBackingStore::KeyRange encodeKeyRange(const WebIDBKeyRange&);
+    static IDBKeyPathInfo encodeKeyPath(const WebIDBKeyPath&);
+    static void encodeIndexKeys(const WebVector<long long>& indexIds, const WebVector<WebIDBDatabase::WebIndexKeys>&,
+                                IDBBackingStore::IndexKeys*);
+
+    // The rest on the database thread.
+    void open(int64 version, int64 transactionId, const Reply&, WebIDBDatabaseCallbacks*);
+    void deleteDatabase(const Reply&);
+    void close(int64 connectionId);
+    void forceClose(int64 connectionId);
+
+    void createTransaction(int64 connectionId, int64 transactionId);
+    void commit(int64 transactionId);
+    void abort(int64 transactionId);
+
+    void createObjectStore(int64 transactionId, const IDBObjectStoreInfo&);
+    void deleteObjectStore(int64 transactionId, int64 objectStoreId);
+    void createIndex(int64 transactionId, int64 objectStoreId, const IDBIndexInfo&);
+    void deleteIndex(int64 transactionId, int64 objectStoreId, int64 indexId);
+
+    void get(int64 transactionId, int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange&, bool keyOnly, const Reply&);
+    void put(int64 transactionId, const Write&, const Reply&);
+    void setIndexKeys(int64 transactionId, int64 objectStoreId, const std::string& primaryKey, const IDBBackingStore::IndexKeys&);
+    void openCursor(int64 transactionId, const IDBBackingStore::Cursor&, const Reply&);
+    void count(int64 transactionId, int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange&, const Reply&);
+    void deleteRange(int64 transactionId, int64 objectStoreId, const IDBBackingStore::KeyRange&, const Reply&);
+    void clear(int64 transactionId, int64 objectStoreId, const Reply&);
+
+    // Moves a cursor |steps| entries on, or to |target| when it isn't empty.
+    void continueCursor(int64 cursorId, const std::string& target, unsigned long steps, const Reply&);
+    void closeCursor(int64 cursorId);
+
+private:
+    friend class base::RefCountedThreadSafe<IDBDatabaseBackend>;
+
+    struct Transaction;
+    // Runs with the transaction, or with null if it is gone.
+    typedef base::Callback<void(Transaction*)> Operation;
+
+    struct Transaction {
+        Transaction(int64 id, int64 connectionId);
+
+        const int64 id;
+        const int64 connectionId;
+        // For a version change, the version it sets.
+        int64 newVersion;
+        // Created when the transaction starts.
+        scoped_ptr<IDBBackingStore::Transaction> store;
+        std::deque<Operation> pending;
+        bool commitRequested;
+        // Set by an operation that failed the transaction.
+        bool failed;
+        unsigned short errorCode;
+        std::string errorMessage;
+    };
+
+    struct Connection {
+        Connection();
+
+        WebIDBDatabaseCallbacks* callbacks;
+        scoped_refptr<base::MessageLoopProxy> loop;
+    };
+
+    // An open or a delete, waiting for its turn.
+    struct Request {
+        Request();
+
+        bool deleteDatabase;
+        int64 version;
+        int64 transactionId;
+        Reply reply;
+        WebIDBDatabaseCallbacks* databaseCallbacks;
+        // Whether the connections in its way have been told.
+        bool blocked;
+    };
+
+    struct VersionChange {
+        VersionChange();
+
+        bool active;
+        int64 transactionId;
+        Reply reply;
+    };
+
+    struct CursorState {
+        int64 transactionId;
+        IDBBackingStore::Cursor cursor;
+    };
+
+    ~IDBDatabaseBackend();
+
+    bool openBackingStore();
+    void closeBackingStore();
+    int64 currentVersion();
+    void processRequests();
+    // Returns false if |request| has to wait.
+    bool processRequest(Request*);
+    int64 addConnection(WebIDBDatabaseCallbacks*, scoped_refptr<base::MessageLoopProxy>);
+
+    Transaction* transaction(int64 id);
+    void schedule(int64 transactionId, const Operation&);
+    void run(Transaction*, const Operation&);
+    void startTransactions();
+    void finishTransaction(Transaction*, bool commit, unsigned short errorCode = 0, const std::string& errorMessage = std::string());
+    void replyError(const Reply&, unsigned short code, const std::string& message);
+
+    void doCreateObjectStore(const IDBObjectStoreInfo&, Transaction*);
+    void doDeleteObjectStore(int64 objectStoreId, Transaction*);
+    void doCreateIndex(int64 objectStoreId, const IDBIndexInfo&, Transaction*);
+    void doDeleteIndex(int64 objectStoreId, int64 indexId, Transaction*);
+    void doGet(int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange&, bool keyOnly, const Reply&, Transaction*);
+    void doPut(const Write&, const Reply&, Transaction*);
+    void doSetIndexKeys(int64 objectStoreId, const std::string& primaryKey, const IDBBackingStore::IndexKeys&, Transaction*);
+    void doOpenCursor(const IDBBackingStore::Cursor&, const Reply&, Transaction*);
+    void doCount(int64 objectStoreId, int64 indexId, const IDBBackingStore::KeyRange&, const Reply&, Transaction*);
+    void doDeleteRange(int64 objectStoreId, const IDBBackingStore::KeyRange&, const Reply&, Transaction*);
+    void doContinueCursor(int64 cursorId, const std::string& target, unsigned long steps, const Reply&, Transaction*);
+
+    const base::string16 m_name;
+    const int64 m_id;
+    const base::FilePath m_directory;
+    scoped_refptr<base::MessageLoopProxy> m_databaseThread;
+    scoped_refptr<base::MessageLoopProxy> m_background;
+
+    scoped_ptr<IDBBackingStore> m_backingStore;
+    std::deque<Request> m_requests;
+    VersionChange m_versionChange;
+    std::map<int64, Connection> m_connections;
+    int64 m_nextConnectionId;
+
+    std::map<int64, Transaction*> m_transactions;
+    // Created and not yet started, oldest first.
+    std::deque<int64> m_queue;
+    Transaction* m_running;
+    bool m_starting;
+    bool m_processingRequests;
+
+    std::map<int64, CursorState> m_cursors;
+    int64 m_nextCursorId;
+
+    DISALLOW_COPY_AND_ASSIGN(IDBDatabaseBackend);
+};
+
+
+#endif // IDBDatabaseBackend_h
@@ -0,0 +1,983 @@
+#include "LogStructuredStore.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/pickle.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/time/time.h"
+
+
+namespace
+{
+
+    const char tableMagic[] = "webUIsst";
+    const size_t tableMagicLength = sizeof(tableMagic) - 1;
+    // The index offset and the magic.
+    const size_t tableFooterLength = sizeof(uint64) + tableMagicLength;
+    const char manifestMagic[] = "webUIlsm1";
+    const char manifestName[] = "MANIFEST";
+    // A table has an index entry every this many bytes of records.
+    const size_t tableBlockSize = 4096;
+    // Table bytes buffered between writes.
+    const size_t tableWriteSize = 1024 * 1024;
+    const size_t maxWriteSize = 1024 * 1024;
+    // The value length of a deleted key.
+    const uint32 deletedLength = 0xffffffff;
+    // Memtable bookkeeping per key, roughly a map node.
+    const size_t memtableEntryOverhead = 64;
+    // Tables of similar size are merged once there are this many of them;
+    // past maxTables they're all merged.
+    const size_t compactionTrigger = 4;
+    const size_t maxTables = 16;
+    // A failed flush is retried after firstFlushRetryDelayMs, doubling each
+    // time; after maxFlushAttempts the store takes no more writes.
+    const int maxFlushAttempts = 5;
+    const int64 firstFlushRetryDelayMs = 100;
+
+    // A record in place, in a table or a map.
+    struct Record {
+        Record()
+            : key(0)
+            , keyLength(0)
+            , value(0)
+            , valueLength(0)
+            , deleted(false)
+        {
+        }
+
+        const char* key;
+        size_t keyLength;
+        const char* value;
+        size_t valueLength;
+        bool deleted;
+    };
+
+    struct IndexEntry {
+        std::string key;
+        size_t offset;
+    };
+
+    struct IndexEntryLess {
+        bool operator()(const IndexEntry& a, const std::string& b) const { return a.key < b; }
+        bool operator()(const std::string& a, const IndexEntry& b) const { return a < b.key; }
+        bool operator()(const IndexEntry& a, const IndexEntry& b) const { return a.key < b.key; }
+    };
+
+    int compareKeys(const char* a, size_t aLength, const char* b, size_t bLength)
+    {
+        int result = memcmp(a, b, std::min(aLength, bLength));
+        if (result)
+            return result;
+        return aLength < bLength ? -1 : (aLength > bLength ? 1 : 0);
+    }
+
+    int compareKeys(const Record& record, const std::string& key)
+    {
+        return compareKeys(record.key, record.keyLength, key.data(), key.size());
+    }
+
+    int compareKeys(const Record& a, const Record& b)
+    {
+        return compareKeys(a.key, a.keyLength, b.key, b.keyLength);
+    }
+
+    Record recordFor(LogStructuredStore::ValueMap::const_iterator entry)
+    {
+        Record record;
+        record.key = entry->first.data();
+        record.keyLength = entry->first.size();
+        record.value = entry->second.data.data();
+        record.valueLength = entry->second.data.size();
+        record.deleted = entry->second.deleted;
+        return record;
+    }
+
+    // Seeks in |map| the way LogStructuredStore::seek() does in the store.
+    bool seekMap(const LogStructuredStore::ValueMap& map, const std::string& target, bool exclusive, bool reverse, Record* found)
+    {
+        LogStructuredStore::ValueMap::const_iterator entry;
+        if (!reverse) {
+            entry = exclusive ? map.upper_bound(target) : map.lower_bound(target);
+            if (entry == map.end())
+                return false;
+        } else {
+            if (target.empty())
+                entry = map.end();
+            else
+                entry = exclusive ? map.lower_bound(target) : map.upper_bound(target);
+            if (entry == map.begin())
+                return false;
+            --entry;
+        }
+        *found = recordFor(entry);
+        return true;
+    }
+
+    void appendUInt32(uint32 value, std::string* out)
+    {
+        out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void appendUInt64(uint64 value, std::string* out)
+    {
+        out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    bool readUInt32(const char* data, size_t end, size_t* offset, uint32* value)
+    {
+        if (*offset > end || end - *offset < sizeof(*value))
+            return false;
+        memcpy(value, data + *offset, sizeof(*value));
+        *offset += sizeof(*value);
+        return true;
+    }
+
+    bool writeAll(base::PlatformFile file, const char* data, size_t length)
+    {
+        while (length) {
+            int chunk = static_cast<int>(std::min(length, maxWriteSize));
+            if (base::WritePlatformFileAtCurrentPos(file, data, chunk) != chunk)
+                return false;
+            data += chunk;
+            length -= chunk;
+        }
+        return true;
+    }
+
+    // Like writing through a temporary file and moving it into place, with
+    // the data synced before the move.
+    bool writeFileDurably(const base::FilePath& path, const std::string& data)
+    {
+        base::FilePath temp = path.AddExtension(FILE_PATH_LITERAL("tmp"));
+        base::PlatformFile file = base::CreatePlatformFile(temp, base::PLATFORM_FILE_CREATE_ALWAYS | base::PLATFORM_FILE_WRITE, NULL, NULL);
+        if (file == base::kInvalidPlatformFileValue)
+            return false;
+        bool written = writeAll(file, data.data(), data.size()) && base::FlushPlatformFile(file);
+        if (!base::ClosePlatformFile(file) || !written) {
+            base::DeleteFile(temp, false);
+            return false;
+        }
+        return base::Move(temp, path);
+    }
+
+    // A log record: the batch's writes, behind a hash of them so that a torn
+    // record is told from a whole one.
+    void serializeBatch(const LogStructuredStore::ValueMap& writes, std::string* out)
+    {
+        Pickle batch;
+        batch.WriteUInt32(static_cast<uint32>(writes.size()));
+        for (LogStructuredStore::ValueMap::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+            batch.WriteBool(it->second.deleted);
+            batch.WriteString(it->first);
+            if (!it->second.deleted)
+                batch.WriteString(it->second.data);
+        }
+        const char* batchData = static_cast<const char*>(batch.data());
+        Pickle record;
+        record.WriteUInt32(base::Hash(batchData, batch.size()));
+        record.WriteData(batchData, static_cast<int>(batch.size()));
+        out->assign(static_cast<const char*>(record.data()), record.size());
+    }
+
+    bool parseBatch(const char* data, int length, LogStructuredStore::ValueMap* writes)
+    {
+        Pickle batch(data, length);
+        PickleIterator iter(batch);
+        uint32 count;
+        if (!batch.ReadUInt32(&iter, &count))
+            return false;
+        for (uint32 i = 0; i < count; ++i) {
+            LogStructuredStore::Value value;
+            std::string key;
+            if (!batch.ReadBool(&iter, &value.deleted) || !batch.ReadString(&iter, &key)
+                    || (!value.deleted && !batch.ReadString(&iter, &value.data)))
+                return false;
+            (*writes)[key] = value;
+        }
+        return true;
+    }
+
+    void signalEvent(base::WaitableEvent* event)
+    {
+        event->Signal();
+    }
+
+    // Writes a table file: the records in key order, an index of the first
+    // key of every block, and a footer locating the index. The file is
+    // deleted unless finish() succeeds.
+    class TableBuilder
+    {
+    public:
+        explicit TableBuilder(const base::FilePath& path)
+            : m_path(path)
+            , m_file(base::CreatePlatformFile(path, base::PLATFORM_FILE_CREATE_ALWAYS | base::PLATFORM_FILE_WRITE, NULL, NULL))
+            , m_failed(m_file == base::kInvalidPlatformFileValue)
+            , m_offset(0)
+            , m_blockStart(0)
+        {
+        }
+
+        ~TableBuilder()
+        {
+            if (m_file == base::kInvalidPlatformFileValue)
+                return;
+            base::ClosePlatformFile(m_file);
+            base::DeleteFile(m_path, false);
+        }
+
+        void add(const Record& record)
+        {
+            if (m_index.empty() || m_offset - m_blockStart >= tableBlockSize) {
+                IndexEntry entry;
+                entry.key.assign(record.key, record.keyLength);
+                entry.offset = m_offset;
+                m_index.push_back(entry);
+                m_blockStart = m_offset;
+            }
+            size_t valueLength = record.deleted ? 0 : record.valueLength;
+            appendUInt32(static_cast<uint32>(record.keyLength), &m_buffer);
+            appendUInt32(record.deleted ? deletedLength : static_cast<uint32>(valueLength), &m_buffer);
+            m_buffer.append(record.key, record.keyLength);
+            m_buffer.append(record.value, valueLength);
+            m_offset += 2 * sizeof(uint32) + record.keyLength + valueLength;
+            if (m_buffer.size() >= tableWriteSize)
+                writeBuffer();
+        }
+
+        bool empty() const { return m_index.empty(); }
+
+        // Writes the index and the footer and syncs the file.
+        bool finish()
+        {
+            appendUInt32(static_cast<uint32>(m_index.size()), &m_buffer);
+            for (size_t i = 0; i < m_index.size(); ++i) {
+                appendUInt32(static_cast<uint32>(m_index[i].key.size()), &m_buffer);
+                m_buffer.append(m_index[i].key);
+                appendUInt64(m_index[i].offset, &m_buffer);
+            }
+            appendUInt64(m_offset, &m_buffer);
+            m_buffer.append(tableMagic, tableMagicLength);
+            writeBuffer();
+
+            bool finished = !m_failed && base::FlushPlatformFile(m_file);
+            finished = base::ClosePlatformFile(m_file) && finished;
+            m_file = base::kInvalidPlatformFileValue;
+            if (!finished)
+                base::DeleteFile(m_path, false);
+            return finished;
+        }
+
+    private:
+        void writeBuffer()
+        {
+            if (!m_failed && !writeAll(m_file, m_buffer.data(), m_buffer.size()))
+                m_failed = true;
+            m_buffer.clear();
+        }
+
+        base::FilePath m_path;
+        base::PlatformFile m_file;
+        bool m_failed;
+        std::string m_buffer;
+        size_t m_offset;
+        size_t m_blockStart;
+        std::vector<IndexEntry> m_index;
+
+        DISALLOW_COPY_AND_ASSIGN(TableBuilder);
+    };
+
+}
+
+// The sorted keys and values of a memtable, with their approximate size.
+// Only the store's write path changes one, under the store's lock; a frozen
+// memtable doesn't change at all.
+class LogStructuredStore::MemTable : public base::RefCountedThreadSafe<MemTable>
+{
+public:
+    MemTable()
+        : m_bytes(0)
+    {
+    }
+
+    void apply(const ValueMap& writes)
+    {
+        for (ValueMap::const_iterator it = writes.begin(); it != writes.end(); ++it) {
+            std::pair<ValueMap::iterator, bool> inserted = m_entries.insert(*it);
+            if (inserted.second) {
+                m_bytes += it->first.size() + memtableEntryOverhead;
+            } else {
+                m_bytes -= inserted.first->second.data.size();
+                inserted.first->second = it->second;
+            }
+            m_bytes += it->second.data.size();
+        }
+    }
+
+    const ValueMap& entries() const { return m_entries; }
+    size_t bytes() const { return m_bytes; }
+
+private:
+    friend class base::RefCountedThreadSafe<MemTable>;
+
+    ~MemTable() { }
+
+    ValueMap m_entries;
+    size_t m_bytes;
+};
+
+// A table file, mapped. Its index of block starts is kept in memory; a seek
+// binary-searches it, then scans one block, and only the record found is
+// copied out.
+class LogStructuredStore::Table : public base::RefCountedThreadSafe<Table>
+{
+public:
+    Table(uint64 number, const base::FilePath& path)
+        : m_number(number)
+        , m_path(path)
+        , m_file(new base::MemoryMappedFile)
+        , m_data(0)
+        , m_dataEnd(0)
+        , m_obsolete(false)
+    {
+    }
+
+    bool open()
+    {
+        if (!m_file->Initialize(m_path))
+            return false;
+        m_data = reinterpret_cast<const char*>(m_file->data());
+        size_t size = m_file->length();
+        if (size < tableFooterLength || memcmp(m_data + size - tableMagicLength, tableMagic, tableMagicLength))
+            return false;
+        size_t indexEnd = size - tableFooterLength;
+        uint64 indexOffset;
+        memcpy(&indexOffset, m_data + indexEnd, sizeof(indexOffset));
+        if (indexOffset > indexEnd)
+            return false;
+        m_dataEnd = static_cast<size_t>(indexOffset);
+
+        size_t offset = m_dataEnd;
+        uint32 count;
+        if (!readUInt32(m_data, indexEnd, &offset, &count))
+            return false;
+        m_index.resize(count);
+        for (uint32 i = 0; i < count; ++i) {
+            uint32 keyLength;
+            if (!readUInt32(m_data, indexEnd, &offset, &keyLength) || indexEnd - offset < keyLength + sizeof(uint64))
+                return false;
+            m_index[i].key.assign(m_data + offset, keyLength);
+            offset += keyLength;
+            uint64 blockOffset;
+            memcpy(&blockOffset, m_data + offset, sizeof(blockOffset));
+            offset += sizeof(blockOffset);
+            if (blockOffset >= m_dataEnd)
+                return false;
+            m_index[i].offset = static_cast<size_t>(blockOffset);
+        }
+        return !m_index.empty();
+    }
+
+    uint64 number() const { return m_number; }
+    size_t size() const { return m_file->length(); }
+
+    // Reads the record at |*offset| and moves past it. Returns false at the
+    // end of the records.
+    bool read(size_t* offset, Record* record) const
+    {
+        size_t position = *offset;
+        uint32 keyLength, valueLength;
+        if (!readUInt32(m_data, m_dataEnd, &position, &keyLength) || !readUInt32(m_data, m_dataEnd, &position, &valueLength))
+            return false;
+        record->deleted = valueLength == deletedLength;
+        size_t valueBytes = record->deleted ? 0 : valueLength;
+        if (m_dataEnd - position < keyLength || m_dataEnd - position - keyLength < valueBytes)
+            return false;
+        record->key = m_data + position;
+        record->keyLength = keyLength;
+        record->value = record->key + keyLength;
+        record->valueLength = valueBytes;
+        *offset = position + keyLength + valueBytes;
+        return true;
+    }
+
+    // Seeks the way LogStructuredStore::seek() does, within this table.
+    bool seek(const std::string& target, bool exclusive, bool reverse, Record* found) const
+    {
+        std::vector<IndexEntry>::const_iterator block;
+        if (!reverse) {
+            // The last block starting at or before |target|; the key sought
+            // is in it or is the first of the next.
+            block = std::upper_bound(m_index.begin(), m_index.end(), target, IndexEntryLess());
+            if (block != m_index.begin())
+                --block;
+            size_t offset = block->offset;
+            Record record;
+            while (read(&offset, &record)) {
+                int order = compareKeys(record, target);
+                if (order > 0 || (!order && !exclusive)) {
+                    *found = record;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // The last block starting with a key that qualifies.
+        if (target.empty())
+            block = m_index.end();
+        else if (exclusive)
+            block = std::lower_bound(m_index.begin(), m_index.end(), target, IndexEntryLess());
+        else
+            block = std::upper_bound(m_index.begin(), m_index.end(), target, IndexEntryLess());
+        if (block == m_index.begin())
+            return false;
+        --block;
+        size_t offset = block->offset;
+        Record record;
+        bool qualified = false;
+        while (read(&offset, &record)) {
+            int order = target.empty() ? -1 : compareKeys(record, target);
+            if (order > 0 || (!order && exclusive))
+                break;
+            *found = record;
+            qualified = true;
+        }
+        return qualified;
+    }
+
+    // The file goes once the last reader lets go of the table.
+    void markObsolete() { m_obsolete = true; }
+
+private:
+    friend class base::RefCountedThreadSafe<Table>;
+
+    ~Table()
+    {
+        // Windows can't delete a file that is mapped.
+        m_file.reset();
+        if (m_obsolete)
+            base::DeleteFile(m_path, false);
+    }
+
+    const uint64 m_number;
+    const base::FilePath m_path;
+    scoped_ptr<base::MemoryMappedFile> m_file;
+    const char* m_data;
+    size_t m_dataEnd;
+    std::vector<IndexEntry> m_index;
+    bool m_obsolete;
+};
+
+LogStructuredStore::Value::Value()
+    : deleted(false)
+{
+}
+
+LogStructuredStore::WriteBatch::WriteBatch()
+{
+}
+
+void LogStructuredStore::WriteBatch::put(const std::string& key, const std::string& value)
+{
+    Value& write = m_writes[key];
+    write.deleted = false;
+    write.data = value;
+}
+
+void LogStructuredStore::WriteBatch::remove(const std::string& key)
+{
+    Value& write = m_writes[key];
+    write.deleted = true;
+    write.data.clear();
+}
+
+void LogStructuredStore::WriteBatch::clear()
+{
+    m_writes.clear();
+}
+
+LogStructuredStore::Stats::Stats()
+    : logWrites(0)
+    , flushes(0)
+    , compactions(0)
+    , tables(0)
+    , memtableBytes(0)
+{
+}
+
+LogStructuredStore::LogStructuredStore(const base::FilePath& directory, scoped_refptr<base::MessageLoopProxy> background)
+    : m_directory(directory)
+    , m_background(background)
+    , m_log(base::kInvalidPlatformFileValue)
+    , m_logNumber(0)
+    , m_memtable(new MemTable)
+    , m_immutableLogLimit(0)
+    , m_minLogNumber(0)
+    , m_nextFileNumber(1)
+    , m_memtableLimit(defaultMemtableLimit)
+{
+}
+
+LogStructuredStore::~LogStructuredStore()
+{
+    if (m_log != base::kInvalidPlatformFileValue)
+        base::ClosePlatformFile(m_log);
+}
+
+base::FilePath LogStructuredStore::filePath(uint64 number, const char* extension) const
+{
+    return m_directory.AppendASCII(base::Uint64ToString(number) + "." + extension);
+}
+
+bool LogStructuredStore::open()
+{
+    TRACE_EVENT0("webui", "LogStructuredStore::open");
+    if (!base::CreateDirectory(m_directory)) {
+        LOG(WARNING) << "Failed to create the store at " << m_directory.value();
+        return false;
+    }
+
+    std::vector<uint64> tableNumbers;
+    std::string manifest;
+    if (base::ReadFileToString(m_directory.AppendASCII(manifestName), &manifest)) {
+        Pickle pickle(manifest.data(), static_cast<int>(manifest.size()));
+        PickleIterator iter(pickle);
+        std::string magic;
+        uint32 count;
+        if (!pickle.ReadString(&iter, &magic) || magic != manifestMagic
+                || !pickle.ReadUInt64(&iter, &m_minLogNumber) || !pickle.ReadUInt32(&iter, &count)) {
+            LOG(WARNING) << "The store at " << m_directory.value() << " has a corrupt manifest";
+            return false;
+        }
+        for (uint32 i = 0; i < count; ++i) {
+            uint64 number;
+            if (!pickle.ReadUInt64(&iter, &number)) {
+                LOG(WARNING) << "The store at " << m_directory.value() << " has a corrupt manifest";
+                return false;
+            }
+            tableNumbers.push_back(number);
+        }
+    }
+
+    std::vector<uint64> logNumbers;
+    base::FileEnumerator files(m_directory, false, base::FileEnumerator::FILES);
+    for (base::FilePath path = files.Next(); !path.empty(); path = files.Next()) {
+        uint64 number;
+        if (!base::StringToUint64(path.BaseName().RemoveExtension().MaybeAsASCII(), &number))
+            continue;
+        m_nextFileNumber = std::max(m_nextFileNumber, number + 1);
+        if (path.MatchesExtension(FILE_PATH_LITERAL(".log"))) {
+            if (number >= m_minLogNumber)
+                logNumbers.push_back(number);
+            else
+                base::DeleteFile(path, false);
+        } else if (path.MatchesExtension(FILE_PATH_LITERAL(".sst"))
+                   && std::find(tableNumbers.begin(), tableNumbers.end(), number) == tableNumbers.end()) {
+            // Left by a flush or a merge that didn't finish.
+            base::DeleteFile(path, false);
+        }
+    }
+
+    for (size_t i = 0; i < tableNumbers.size(); ++i) {
+        scoped_refptr<Table> table = new Table(tableNumbers[i], filePath(tableNumbers[i], "sst"));
+        if (!table->open()) {
+            LOG(WARNING) << "The store at " << m_directory.value() << " has an unreadable table " << tableNumbers[i];
+            return false;
+        }
+        m_tables.push_back(table);
+    }
+
+    std::sort(logNumbers.begin(), logNumbers.end());
+    for (size_t i = 0; i < logNumbers.size(); ++i)
+        replayLog(filePath(logNumbers[i], "log"));
+
+    // What was replayed goes into a table, and its logs with it; new
+    // records never follow a torn one.
+    base::AutoLock writeLocker(m_writeLock);
+    base::AutoLock locker(m_lock);
+    if (!(m_memtable->entries().empty() ? openLog() : rotate()))
+        return false;
+    if (m_tables.size() >= compactionTrigger)
+        m_background->PostTask(FROM_HERE, base::Bind(&LogStructuredStore::compactIfNeeded, this));
+    return true;
+}
+
+void LogStructuredStore::replayLog(const base::FilePath& path)
+{
+    std::string data;
+    if (!base::ReadFileToString(path, &data)) {
+        LOG(WARNING) << "Failed to read the log at " << path.value();
+        return;
+    }
+
+    const char* end = data.data() + data.size();
+    const char* next = data.data();
+    while (next < end) {
+        const char* recordEnd = Pickle::FindNext(sizeof(Pickle::Header), next, end);
+        if (!recordEnd)
+            break;
+        Pickle record(next, static_cast<int>(recordEnd - next));
+        next = recordEnd;
+
+        PickleIterator iter(record);
+        uint32 hash;
+        const char* batch;
+        int batchLength;
+        ValueMap writes;
+        // A torn record ends the log: it is the last one a crash left.
+        if (!record.ReadUInt32(&iter, &hash) || !record.ReadData(&iter, &batch, &batchLength)
+                || base::Hash(batch, batchLength) != hash || !parseBatch(batch, batchLength, &writes))
+            break;
+        m_memtable->apply(writes);
+    }
+}
+
+bool LogStructuredStore::openLog()
+{
+    uint64 number = m_nextFileNumber++;
+    base::PlatformFile log = base::CreatePlatformFile(filePath(number, "log"),
+        base::PLATFORM_FILE_CREATE_ALWAYS | base::PLATFORM_FILE_WRITE, NULL, NULL);
+    if (log == base::kInvalidPlatformFileValue) {
+        LOG(WARNING) << "Failed to create a log in " << m_directory.value();
+        return false;
+    }
+    if (m_log != base::kInvalidPlatformFileValue)
+        base::ClosePlatformFile(m_log);
+    m_log = log;
+    m_logNumber = number;
+    return true;
+}
+
+bool LogStructuredStore::rotate()
+{
+    if (!openLog())
+        return false;
+    m_immutable = m_memtable;
+    m_immutableLogLimit = m_logNumber;
+    m_memtable = new MemTable;
+    m_background->PostTask(FROM_HERE,
+        base::Bind(&LogStructuredStore::flush, this, m_immutable, m_immutableLogLimit, 1));
+    return true;
+}
+
+bool LogStructuredStore::writeManifest()
+{
+    Pickle manifest;
+    manifest.WriteString(manifestMagic);
+    manifest.WriteUInt64(m_minLogNumber);
+    manifest.WriteUInt32(static_cast<uint32>(m_tables.size()));
+    for (size_t i = 0; i < m_tables.size(); ++i)
+        manifest.WriteUInt64(m_tables[i]->number());
+    if (writeFileDurably(m_directory.AppendASCII(manifestName),
+                         std::string(static_cast<const char*>(manifest.data()), manifest.size())))
+        return true;
+    LOG(WARNING) << "Failed to write the manifest of the store at " << m_directory.value();
+    return false;
+}
+
+bool LogStructuredStore::write(const WriteBatch& batch)
+{
+    if (batch.empty())
+        return true;
+
+    TRACE_EVENT1("webui", "LogStructuredStore::write", "writes", batch.size());
+    std::string record;
+    serializeBatch(batch.m_writes, &record);
+
+    base::AutoLock writeLocker(m_writeLock);
+    if (m_log == base::kInvalidPlatformFileValue)
+        return false;
+    if (!writeAll(m_log, record.data(), record.size()) || !base::FlushPlatformFile(m_log)) {
+        // What follows a partial record would be lost on replay, so the
+        // store takes no more writes.
+        LOG(WARNING) << "Failed to write the log of the store at " << m_directory.value();
+        base::ClosePlatformFile(m_log);
+        m_log = base::kInvalidPlatformFileValue;
+        return false;
+    }
+
+    base::AutoLock locker(m_lock);
+    ++m_stats.logWrites;
+    m_memtable->apply(batch.m_writes);
+    // While a flush is running the memtable grows past its limit instead.
+    if (m_memtable->bytes() >= m_memtableLimit && !m_immutable.get())
+        rotate();
+    return true;
+}
+
+bool LogStructuredStore::get(const std::string& key, std::string* value, const WriteBatch* overlay)
+{
+    if (overlay) {
+        ValueMap::const_iterator write = overlay->m_writes.find(key);
+        if (write != overlay->m_writes.end()) {
+            if (write->second.deleted)
+                return false;
+            *value = write->second.data;
+            return true;
+        }
+    }
+
+    base::AutoLock locker(m_lock);
+    const MemTable* memtables[] = { m_memtable.get(), m_immutable.get() };
+    for (size_t i = 0; i < arraysize(memtables); ++i) {
+        if (!memtables[i])
+            continue;
+        ValueMap::const_iterator entry = memtables[i]->entries().find(key);
+        if (entry != memtables[i]->entries().end()) {
+            if (entry->second.deleted)
+                return false;
+            *value = entry->second.data;
+            return true;
+        }
+    }
+    for (size_t i = 0; i < m_tables.size(); ++i) {
+        Record record;
+        if (!m_tables[i]->seek(key, false, false, &record) || compareKeys(record, key))
+            continue;
+        if (record.deleted)
+            return false;
+        value->assign(record.value, record.valueLength);
+        return true;
+    }
+    return false;
+}
+
+bool LogStructuredStore::seek(const std::string& target, bool exclusive, bool reverse, const WriteBatch* overlay,
+                              std::string* key, std::string* value)
+{
+    base::AutoLock locker(m_lock);
+    return seekLocked(target, exclusive, reverse, overlay, key, value);
+}
+
+bool LogStructuredStore::seekLocked(const std::string& target, bool exclusive, bool reverse, const WriteBatch* overlay,
+                                    std::string* key, std::string* value)
+{
+    const ValueMap* maps[] = {
+        overlay ? &overlay->m_writes : 0,
+        &m_memtable->entries(),
+        m_immutable.get() ? &m_immutable->entries() : 0
+    };
+
+    std::string from = target;
+    for (;;) {
+        // Every source is asked, newest first, and only a strictly nearer
+        // key replaces the best so far: of equal keys the newest wins.
+        Record best;
+        bool found = false;
+        Record record;
+        for (size_t i = 0; i < arraysize(maps); ++i) {
+            if (maps[i] && seekMap(*maps[i], from, exclusive, reverse, &record)
+                    && (!found || (reverse ? compareKeys(record, best) > 0 : compareKeys(record, best) < 0))) {
+                best = record;
+                found = true;
+            }
+        }
+        for (size_t i = 0; i < m_tables.size(); ++i) {
+            if (m_tables[i]->seek(from, exclusive, reverse, &record)
+                    && (!found || (reverse ? compareKeys(record, best) > 0 : compareKeys(record, best) < 0))) {
+                best = record;
+                found = true;
+            }
+        }
+        if (!found)
+            return false;
+        if (!best.deleted) {
+            key->assign(best.key, best.keyLength);
+            value->assign(best.value, best.valueLength);
+            return true;
+        }
+        from.assign(best.key, best.keyLength);
+        exclusive = true;
+    }
+}
+
+LogStructuredStore::Stats LogStructuredStore::stats()
+{
+    base::AutoLock locker(m_lock);
+    Stats stats = m_stats;
+    stats.tables = m_tables.size();
+    stats.memtableBytes = m_memtable->bytes() + (m_immutable.get() ? m_immutable->bytes() : 0);
+    return stats;
+}
+
+void LogStructuredStore::setMemtableLimit(size_t bytes)
+{
+    base::AutoLock locker(m_lock);
+    m_memtableLimit = bytes;
+}
+
+void LogStructuredStore::waitForBackgroundWork()
+{
+    base::WaitableEvent done(false, false);
+    m_background->PostTask(FROM_HERE, base::Bind(&signalEvent, &done));
+    done.Wait();
+}
+
+void LogStructuredStore::flush(scoped_refptr<MemTable> memtable, uint64 logLimit, int attempt)
+{
+    TRACE_EVENT1("webui", "LogStructuredStore::flush", "bytes", memtable->bytes());
+    uint64 number;
+    {
+        base::AutoLock locker(m_lock);
+        number = m_nextFileNumber++;
+    }
+
+    // Deleted keys are kept: older tables may still hold the key.
+    scoped_refptr<Table> table;
+    const ValueMap& entries = memtable->entries();
+    if (!entries.empty()) {
+        base::FilePath path = filePath(number, "sst");
+        TableBuilder builder(path);
+        for (ValueMap::const_iterator it = entries.begin(); it != entries.end(); ++it)
+            builder.add(recordFor(it));
+        table = new Table(number, path);
+        if (!builder.finish() || !table->open()) {
+            // The memtable stays frozen, and its log stays on disk.
+            LOG(WARNING) << "Failed to write a table in " << m_directory.value();
+            table = NULL;
+            base::DeleteFile(path, false);
+            if (attempt < maxFlushAttempts) {
+                m_background->PostDelayedTask(FROM_HERE,
+                    base::Bind(&LogStructuredStore::flush, this, memtable, logLimit, attempt + 1),
+                    base::TimeDelta::FromMilliseconds(firstFlushRetryDelayMs << (attempt - 1)));
+                return;
+            }
+            // Without a flush the memtable would grow without bound, so
+            // stop taking writes as a failed log write does. Everything
+            // written so far is in the logs and replays on the next open.
+            LOG(WARNING) << "Giving up flushing the store at " << m_directory.value();
+            base::AutoLock writeLocker(m_writeLock);
+            if (m_log != base::kInvalidPlatformFileValue) {
+                base::ClosePlatformFile(m_log);
+                m_log = base::kInvalidPlatformFileValue;
+            }
+            return;
+        }
+    }
+
+    uint64 previousMinLog;
+    bool written;
+    {
+        base::AutoLock locker(m_lock);
+        if (table.get())
+            m_tables.insert(m_tables.begin(), table);
+        m_immutable = NULL;
+        previousMinLog = m_minLogNumber;
+        m_minLogNumber = logLimit;
+        ++m_stats.flushes;
+        written = writeManifest();
+    }
+    // Otherwise the next open deletes them, once a manifest is written.
+    if (written) {
+        for (uint64 log = previousMinLog; log < logLimit; ++log)
+            base::DeleteFile(filePath(log, "log"), false);
+    }
+
+    compactIfNeeded();
+}
+
+// Size-tiered: the newest tables are merged while each next one is no
+// larger than those before it together, so a large old table is only
+// rewritten once as much new data has piled up in front of it.
+void LogStructuredStore::compactIfNeeded()
+{
+    for (;;) {
+        TableList tables;
+        bool dropDeleted;
+        {
+            base::AutoLock locker(m_lock);
+            if (m_tables.size() < compactionTrigger)
+                return;
+            size_t count = 1;
+            size_t total = m_tables[0]->size();
+            if (m_tables.size() > maxTables)
+                count = m_tables.size();
+            while (count < m_tables.size() && m_tables[count]->size() <= total)
+                total += m_tables[count++]->size();
+            if (count < compactionTrigger)
+                return;
+            tables.assign(m_tables.begin(), m_tables.begin() + count);
+            dropDeleted = count == m_tables.size();
+        }
+
+        TRACE_EVENT1("webui", "LogStructuredStore::compact", "tables", tables.size());
+        scoped_refptr<Table> merged;
+        if (!mergeTables(tables, dropDeleted, &merged)) {
+            LOG(WARNING) << "Failed to merge tables in " << m_directory.value();
+            return;
+        }
+
+        bool written;
+        {
+            // Only flushes add tables, and they run on this runner too, so
+            // |tables| are still the newest.
+            base::AutoLock locker(m_lock);
+            m_tables.erase(m_tables.begin(), m_tables.begin() + tables.size());
+            if (merged.get())
+                m_tables.insert(m_tables.begin(), merged);
+            ++m_stats.compactions;
+            written = writeManifest();
+        }
+        // Otherwise the manifest on disk still names them.
+        if (written) {
+            for (size_t i = 0; i < tables.size(); ++i)
+                tables[i]->markObsolete();
+        }
+    }
+}
+
+bool LogStructuredStore::mergeTables(const TableList& tables, bool dropDeleted, scoped_refptr<Table>* merged)
+{
+    uint64 number;
+    {
+        base::AutoLock locker(m_lock);
+        number = m_nextFileNumber++;
+    }
+    base::FilePath path = filePath(number, "sst");
+    TableBuilder builder(path);
+
+    std::vector<size_t> offsets(tables.size(), 0);
+    std::vector<Record> heads(tables.size());
+    std::vector<bool> live(tables.size());
+    for (size_t i = 0; i < tables.size(); ++i)
+        live[i] = tables[i]->read(&offsets[i], &heads[i]);
+
+    for (;;) {
+        // |tables| are newest first, so of equal keys the newest is taken.
+        size_t best = tables.size();
+        for (size_t i = 0; i < tables.size(); ++i) {
+            if (live[i] && (best == tables.size() || compareKeys(heads[i], heads[best]) < 0))
+                best = i;
+        }
+        if (best == tables.size())
+            break;
+
+        Record winner = heads[best];
+        if (!dropDeleted || !winner.deleted)
+            builder.add(winner);
+        for (size_t i = 0; i < tables.size(); ++i) {
+            while (live[i] && !compareKeys(heads[i], winner))
+                live[i] = tables[i]->read(&offsets[i], &heads[i]);
+        }
+    }
+
+    if (builder.empty()) {
+        *merged = NULL;
+        return true;
+    }
+    scoped_refptr<Table> table = new Table(number, path);
+    if (!builder.finish() || !table->open())
+        return false;
+    *merged = table;
+    return true;
+}
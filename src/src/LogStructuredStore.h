@@ -0,0 +1,160 @@
+#ifndef LogStructuredStore_h
+#define LogStructuredStore_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/platform_file.h"
+#include "base/synchronization/lock.h"
+
+// An embedded, ordered key-value store, log-structured: every write batch
+// is appended to a write-ahead log and synced once, then applied to an
+// in-memory table. A memtable that has grown past its limit is frozen and
+// written out on the background runner as an immutable sorted table, after
+// which its log is deleted. Tables of similar size are merged there too,
+// and a merge that reaches the oldest table drops deleted keys for good.
+//
+// Keys are ordered bytewise. Reads see the memtables and then the tables
+// from newest to oldest; seek() steps through the store one key at a time,
+// so a caller can walk any range without it ever being copied out whole.
+//
+// The files live in one directory: "<n>.log" logs, "<n>.sst" tables, and
+// MANIFEST, which names the live tables and is replaced atomically.
+class LogStructuredStore : public base::RefCountedThreadSafe<LogStructuredStore>
+{
+public:
+    static const size_t defaultMemtableLimit = 4 * 1024 * 1024;
+
+    struct Value {
+        Value();
+
+        bool deleted;
+        std::string data;
+    };
+    typedef std::map<std::string, Value> ValueMap;
+
+    // Writes to apply together. The last write of a key wins. A batch is
+    // also a view of its own writes: reads given it as |overlay| see them
+    // above the store's contents.
+    class WriteBatch
+    {
+    public:
+        WriteBatch();
+
+        void put(const std::string& key, const std::string& value);
+        void remove(const std::string& key);
+        void clear();
+        bool empty() const { return m_writes.empty(); }
+        size_t size() const { return m_writes.size(); }
+
+    private:
+        friend class LogStructuredStore;
+
+        ValueMap m_writes;
+    };
+
+    struct Stats {
+        Stats();
+
+        // Each is one fsync of the log.
+        int64 logWrites;
+        int64 flushes;
+        int64 compactions;
+        size_t tables;
+        size_t memtableBytes;
+    };
+
+    // Flushes and compactions run on |background|.
+    LogStructuredStore(const base::FilePath& directory, scoped_refptr<base::MessageLoopProxy> background);
+
+    // Loads the tables and replays the logs left by the previous run.
+    // Returns false if the store couldn't be opened; it can't be used then.
+    bool open();
+
+    // Appends |batch| to the log as one record with one fsync, then applies
+    // it. Returns false, having applied nothing, if the log write failed.
+    // After a failed log write, or a flush that failed every retry, the
+    // store takes no more writes.
+    bool write(const WriteBatch&);
+
+    // Looks |key| up through |overlay|, when given, and the store.
+    bool get(const std::string& key, std::string* value, const WriteBatch* overlay = 0);
+
+    // Finds the first live key after |target| going forward, or before it
+    // with |reverse|; |target| itself qualifies unless |exclusive|. An empty
+    // |target| with |reverse| starts from the end of the store.
+    bool seek(const std::string& target, bool exclusive, bool reverse, const WriteBatch* overlay,
+              std::string* key, std::string* value);
+
+    Stats stats();
+    void setMemtableLimit(size_t bytes);
+
+    // Blocks until the flushes and compactions scheduled so far are done.
+    // Retries of a failed flush, which run later, aren't waited for.
+    void waitForBackgroundWork();
+
+private:
+    friend class base::RefCountedThreadSafe<LogStructuredStore>;
+    class MemTable;
+    class Table;
+
+    typedef std::vector<scoped_refptr<Table> > TableList;
+
+    ~LogStructuredStore();
+
+    base::FilePath filePath(uint64 number, const char* extension) const;
+    bool openLog();
+    void replayLog(const base::FilePath&);
+    // Caller holds m_lock.
+    bool writeManifest();
+    // Freezes the memtable and starts a new log. Caller holds m_writeLock
+    // and m_lock.
+    bool rotate();
+
+    // Background runner.
+    // |attempt| counts from 1; failures are retried with backoff.
+    void flush(scoped_refptr<MemTable>, uint64 logLimit, int attempt);
+    void compactIfNeeded();
+    // Leaves |*merged| null when nothing in |tables| survived the merge.
+    bool mergeTables(const TableList&, bool dropDeleted, scoped_refptr<Table>* merged);
+
+    // Caller holds m_lock.
+    bool seekLocked(const std::string& target, bool exclusive, bool reverse, const WriteBatch* overlay,
+                    std::string* key, std::string* value);
+
+    const base::FilePath m_directory;
+    scoped_refptr<base::MessageLoopProxy> m_background;
+
+    // Held across a log write, so records go out in the order they're
+    // applied in.
+    base::Lock m_writeLock;
+    base::PlatformFile m_log;
+    uint64 m_logNumber;
+
+    base::Lock m_lock;
+    scoped_refptr<MemTable> m_memtable;
+    // The memtable being flushed, and the first log not covered by it.
+    scoped_refptr<MemTable> m_immutable;
+    uint64 m_immutableLogLimit;
+    // Newest first.
+    TableList m_tables;
+    // Logs before this one are all in tables.
+    uint64 m_minLogNumber;
+    uint64 m_nextFileNumber;
+    size_t m_memtableLimit;
+    Stats m_stats;
+
+    DISALLOW_COPY_AND_ASSIGN(LogStructuredStore);
+};
+
+
+#endif // LogStructuredStore_h
@@ -1,24 +1,147 @@
 #include "PlatformImpl.h"
 
-
-
+#include <algorithm>
+
+#include "DiscardableMemoryAllocator.h"
+#include "DiskCache.h"
+#include "ProcessMemory.h"
+#include "URLLoaderEngine.h"
+#include "WebBlobRegistryImpl.h"
+#include "WebCompositorSupportImpl.h"
+#include "WebCookieJarImpl.h"
+#include "WebFileSystemImpl.h"
+#include "WebFileUtilitiesImpl.h"
+#include "WebIDBFactoryImpl.h"
+#include "WebThreadImpl.h"
+#include "WebURLLoaderImpl.h"
+
+#include "base/base_paths.h"
+#include "base/bind.h"
 #include "base/message_loop/message_loop.h"
 #include "base/metrics/stats_counters.h"
 #include "base/debug/trace_event.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/sparse_histogram.h"
+#include "base/path_service.h"
 #include "base/rand_util.h"
+#include "base/sys_info.h"
+#include "base/threading/worker_pool.h"
 #include "net/base/data_url.h"
-#include "net/base/mime_util.h"
+#include "net/base/net_errors.h"
+#include "../../platform/WebURLError.h"
+
+
+namespace
+{
+
+    const int64 maxCachedBodyBytes = 64 * 1024 * 1024;
+    const int64 maxCachedMetadataBytes = 16 * 1024 * 1024;
+
+    // memoryUsageMB() reads the kernel's figures at most this often.
+    const int defaultMemoryUsageCacheIntervalMs = 250;
+
+    // Unlocked discardable memory may stay resident up to this share of
+    // physical memory, but never below the floor.
+    const int discardableMemoryShare = 8;
+    const size_t minDiscardableMemoryBytes = 16 * 1024 * 1024;
+
+    size_t discardableMemoryBudget()
+    {
+        size_t budget = static_cast<size_t>(base::SysInfo::AmountOfPhysicalMemory() / discardableMemoryShare);
+        return std::max(budget, minDiscardableMemoryBytes);
+    }
+
+    // One decoded image may use this share of physical memory by default,
+    // within the bounds below.
+    const int decodedImageShare = 32;
+    const size_t minDecodedImageBytes = 4 * 1024 * 1024;
+    const size_t maxDecodedImageBytesCap = 64 * 1024 * 1024;
+
+    size_t defaultMaxDecodedImageBytes()
+    {
+        size_t bytes = static_cast<size_t>(base::SysInfo::AmountOfPhysicalMemory() / decodedImageShare);
+        return std::min(std::max(bytes, minDecodedImageBytes), maxDecodedImageBytesCap);
+    }
 
+    // Measured pressure: the process's private memory against physical
+    // memory, moderate from one half and critical from three quarters.
+    const size_t moderateMemoryPressureMultiplier = 1;
+    const size_t moderateMemoryPressureDivisor = 2;
+    const size_t criticalMemoryPressureMultiplier = 3;
+    const size_t criticalMemoryPressureDivisor = 4;
+
+    struct ProcessMemorySizes {
+        ProcessMemorySizes()
+            : privateBytes(0)
+            , sharedBytes(0)
+        {
+        }
+
+        size_t privateBytes;
+        size_t sharedBytes;
+    };
+
+    void measureProcessMemorySizes(ProcessMemorySizes* sizes)
+    {
+        ProcessMemory::sizes(true, &sizes->privateBytes, &sizes->sharedBytes);
+    }
+
+    void replyProcessMemorySizes(ProcessMemorySizes* sizes, scoped_ptr<Platform::ProcessMemorySizesCallback> callback)
+    {
+        callback->dataReceived(sizes->privateBytes, sizes->sharedBytes);
+    }
+
+    base::FilePath dataDirectory()
+    {
+        base::FilePath path;
+#if defined(OS_WIN)
+        if (!PathService::Get(base::DIR_LOCAL_APP_DATA, &path))
+#else
+        if (!PathService::Get(base::DIR_CACHE, &path))
+#endif
+            return base::FilePath();
+        return path.AppendASCII("webUI");
+    }
+
+    base::FilePath cacheDirectory()
+    {
+        base::FilePath path = dataDirectory();
+        return path.empty() ? path : path.AppendASCII("Cache");
+    }
+
+    base::FilePath cookieLogPath()
+    {
+        base::FilePath path = dataDirectory();
+        return path.empty() ? path : path.AppendASCII("Cookies");
+    }
+
+    base::FilePath fileSystemDirectory()
+    {
+        base::FilePath path = dataDirectory();
+        return path.empty() ? path : path.AppendASCII("FileSystem");
+    }
+
+    base::FilePath indexedDBDirectory()
+    {
+        base::FilePath path = dataDirectory();
+        return path.empty() ? path : path.AppendASCII("IndexedDB");
+    }
 
+}
 
 PlatformImpl::PlatformImpl()
     : main_loop_(base::MessageLoop::current()),
       shared_timer_func_(NULL),
       shared_timer_fire_time_(0.0),
       shared_timer_fire_time_was_set_while_suspended_(false),
-      shared_timer_suspended_(0)
+      shared_timer_suspended_(0),
+      m_memoryUsageMB(0),
+      m_memoryUsageCacheInterval(base::TimeDelta::FromMilliseconds(defaultMemoryUsageCacheIntervalMs)),
+      m_discardableMemory(new DiscardableMemoryAllocator(discardableMemoryBudget())),
+      m_maxDecodedImageBytes(0),
+      m_downsampleLargeImages(true),
+      m_reportedMemoryPressure(MemoryPressureNone),
+      m_lastMemoryPressure(MemoryPressureNone)
 {
 
 }
@@ -26,10 +149,66 @@ PlatformImpl::PlatformImpl()
 PlatformImpl::~PlatformImpl()
 {
 }
+
+URLLoaderEngine* PlatformImpl::urlLoaderEngine()
+{
+    // Created lazily: the loader thread needs the AtExitManager and main
+    // message loop that embedders set up after constructing the platform.
+    if (!m_urlLoaderEngine) {
+        m_urlLoaderEngine.reset(new URLLoaderEngine);
+        m_urlLoaderEngine->setDiskCache(diskCache());
+        m_urlLoaderEngine->registerSchemeHandler("blob", blobRegistryImpl()->createSchemeHandler());
+    }
+    return m_urlLoaderEngine.get();
+}
+
+WebCookieJarImpl* PlatformImpl::cookieJarImpl()
+{
+    // Created lazily for the same reason as the loader engine. Reading the
+    // log here, before the first request, keeps it off every later lookup.
+    if (!m_cookieJar)
+        m_cookieJar.reset(new WebCookieJarImpl(cookieLogPath()));
+    return m_cookieJar.get();
+}
+
+WebBlobRegistryImpl* PlatformImpl::blobRegistryImpl()
+{
+    // Created lazily for the same reason as the loader engine.
+    if (!m_blobRegistry)
+        m_blobRegistry.reset(new WebBlobRegistryImpl);
+    return m_blobRegistry.get();
+}
+
+WebFileSystemImpl* PlatformImpl::fileSystemImpl()
+{
+    // Created lazily: its I/O threads need the AtExitManager.
+    if (!m_fileSystem)
+        m_fileSystem.reset(new WebFileSystemImpl(fileSystemDirectory(), blobRegistryImpl(), this));
+    return m_fileSystem.get();
+}
+
+WebIDBFactoryImpl* PlatformImpl::idbFactoryImpl()
+{
+    // Created lazily: its threads need the AtExitManager.
+    if (!m_idbFactory)
+        m_idbFactory.reset(new WebIDBFactoryImpl(indexedDBDirectory()));
+    return m_idbFactory.get();
+}
+
+DiskCache* PlatformImpl::diskCache()
+{
+    if (!m_diskCache) {
+        base::FilePath directory = cacheDirectory();
+        if (directory.empty())
+            return 0;
+        m_diskCache.reset(new DiskCache(directory, maxCachedBodyBytes, maxCachedMetadataBytes));
+    }
+    return m_diskCache->isUsable() ? m_diskCache.get() : 0;
+}
 // May return null.
 WebCookieJar* PlatformImpl::cookieJar()
 {
-    return 0;
+    return cookieJarImpl();
 }
 
 // Must return non-null.
@@ -41,13 +220,15 @@ WebClipboard* PlatformImpl::clipboard()
 // Must return non-null.
 WebFileUtilities* PlatformImpl::fileUtilities()
 {
-    return 0;
+    if (!m_fileUtilities)
+        m_fileUtilities.reset(new WebFileUtilitiesImpl(fileSystemImpl()));
+    return m_fileUtilities.get();
 }
 
 // Must return non-null.
 WebMimeRegistry* PlatformImpl::mimeRegistry()
 {
-    return 0;
+    return &m_mimeRegistry;
 }
 
 // May return null if sandbox support is not necessary
@@ -56,7 +237,8 @@ WebSandboxSupport* PlatformImpl::sandboxSupport()
     return 0;
 }
 
-// May return null on some platforms.
+// The same engine on every platform; off Windows it maps Blink's parts onto
+// the Windows codes its tables use.
 WebThemeEngine* PlatformImpl::themeEngine()
 {
     return &m_themeEngine;
@@ -131,7 +313,7 @@ WebMIDIAccessor* PlatformImpl::createMIDIAccessor(WebMIDIAccessorClient*)
 // Must return non-null.
 WebBlobRegistry* PlatformImpl::blobRegistry()
 {
-    return 0;
+    return blobRegistryImpl();
 }
 
 
@@ -183,7 +365,7 @@ WebStorageNamespace* PlatformImpl::createLocalStorageNamespace()
 // Must return non-null.
 WebFileSystem* PlatformImpl::fileSystem()
 {
-    return 0;
+    return fileSystemImpl();
 }
 
 
@@ -200,7 +382,7 @@ WebString PlatformImpl::convertIDNToUnicode(const WebString& host, const WebStri
 // Must return non-null.
 WebIDBFactory* PlatformImpl::idbFactory()
 {
-    return 0;
+    return idbFactoryImpl();
 }
 
 
@@ -250,25 +432,32 @@ WebString PlatformImpl::signedPublicKeyAndChallengeString(unsigned keySizeIndex,
 // That is committed size for Windows and memory size for POSIX
 size_t PlatformImpl::memoryUsageMB()
 {
-    return 0;
+    // Blink asks on every resource load and GC, so reuse a recent reading.
+    base::TimeTicks now = base::TimeTicks::Now();
+    base::AutoLock locker(m_memoryUsageLock);
+    if (m_memoryUsageSampleTime.is_null() || now - m_memoryUsageSampleTime >= m_memoryUsageCacheInterval) {
+        m_memoryUsageMB = ProcessMemory::committedBytes() >> 20;
+        m_memoryUsageSampleTime = now;
+    }
+    return m_memoryUsageMB;
 }
 
 // Same as above, but always returns actual value, without any caches.
 size_t PlatformImpl::actualMemoryUsageMB()
 {
-    return 0;
+    return ProcessMemory::committedBytes() >> 20;
 }
 
 // Return the physical memory of the current machine, in MB.
 size_t PlatformImpl::physicalMemoryMB()
 {
-    return 0;
+    return static_cast<size_t>(base::SysInfo::AmountOfPhysicalMemoryMB());
 }
 
 // Return the number of of processors of the current machine.
 size_t PlatformImpl::numberOfProcessors()
 {
-    return 0;
+    return static_cast<size_t>(base::SysInfo::NumberOfProcessors());
 }
 
 // Returns private and shared usage, in bytes. Private bytes is the amount of
@@ -276,14 +465,29 @@ size_t PlatformImpl::numberOfProcessors()
 // false on platform specific error conditions.
 bool PlatformImpl::processMemorySizesInBytes(size_t* privateBytes, size_t* sharedBytes)
 {
-    return false;
+    return ProcessMemory::sizes(false, privateBytes, sharedBytes);
 }
 
 
 // Requests private and shared usage, in bytes. Private bytes is the amount of
 // memory currently allocated to this process that cannot be shared.
 // The callback ownership is passed to the callee.
-void PlatformImpl::requestProcessMemorySizes(ProcessMemorySizesCallback* requestCallback) { }
+void PlatformImpl::requestProcessMemorySizes(ProcessMemorySizesCallback* requestCallback)
+{
+    // The exact figures walk every mapping, so gather them on a worker and
+    // answer on this thread.
+    ProcessMemorySizes* sizes = new ProcessMemorySizes;
+    base::WorkerPool::PostTaskAndReply(FROM_HERE,
+        base::Bind(&measureProcessMemorySizes, sizes),
+        base::Bind(&replyProcessMemorySizes, base::Owned(sizes), base::Passed(make_scoped_ptr(requestCallback))),
+        true);
+}
+
+void PlatformImpl::setMemoryUsageCacheInterval(base::TimeDelta interval)
+{
+    base::AutoLock locker(m_memoryUsageLock);
+    m_memoryUsageCacheInterval = interval;
+}
 
 // Reports number of bytes used by memory allocator for internal needs.
 // Returns true if the size has been reported, or false otherwise.
@@ -299,7 +503,7 @@ bool PlatformImpl::memoryAllocatorWasteInBytes(size_t*)
 // discardable.
 WebDiscardableMemory* PlatformImpl::allocateAndLockDiscardableMemory(size_t bytes)
 {
-    return 0;
+    return m_discardableMemory->allocateAndLock(bytes);
 }
 
 // A wrapper for tcmalloc's HeapProfilerStart();
@@ -319,7 +523,54 @@ WebString PlatformImpl::getHeapProfile()
 // See comments on ImageDecoder::m_maxDecodedBytes.
 size_t PlatformImpl::maxDecodedImageBytes()
 {
-    return noDecodedImageByteLimit;
+    MemoryPressure pressure = memoryPressure();
+
+    base::AutoLock locker(m_decodedImageLock);
+    if (pressure == MemoryPressureCritical && m_lastMemoryPressure != MemoryPressureCritical)
+        m_discardableMemory->purgeUnlocked();
+    m_lastMemoryPressure = pressure;
+
+    if (!m_downsampleLargeImages)
+        return noDecodedImageByteLimit;
+    // Blink's decoders scale images above the limit down while decoding.
+    size_t limit = m_maxDecodedImageBytes ? m_maxDecodedImageBytes : defaultMaxDecodedImageBytes();
+    if (pressure == MemoryPressureModerate)
+        limit /= 2;
+    else if (pressure == MemoryPressureCritical)
+        limit /= 4;
+    return limit;
+}
+
+void PlatformImpl::setMaxDecodedImageBytes(size_t bytes)
+{
+    base::AutoLock locker(m_decodedImageLock);
+    m_maxDecodedImageBytes = bytes;
+}
+
+void PlatformImpl::setDownsampleLargeImages(bool downsample)
+{
+    base::AutoLock locker(m_decodedImageLock);
+    m_downsampleLargeImages = downsample;
+}
+
+void PlatformImpl::setMemoryPressure(MemoryPressure pressure)
+{
+    base::AutoLock locker(m_decodedImageLock);
+    m_reportedMemoryPressure = pressure;
+}
+
+PlatformImpl::MemoryPressure PlatformImpl::memoryPressure()
+{
+    MemoryPressure measured = MemoryPressureNone;
+    size_t usage = memoryUsageMB();
+    size_t physical = physicalMemoryMB();
+    if (usage * criticalMemoryPressureDivisor >= physical * criticalMemoryPressureMultiplier)
+        measured = MemoryPressureCritical;
+    else if (usage * moderateMemoryPressureDivisor >= physical * moderateMemoryPressureMultiplier)
+        measured = MemoryPressureModerate;
+
+    base::AutoLock locker(m_decodedImageLock);
+    return std::max(measured, m_reportedMemoryPressure);
 }
 
 
@@ -338,7 +589,7 @@ WebMessagePortChannel* PlatformImpl::createMessagePortChannel()
 // Returns a new WebURLLoader instance.
 WebURLLoader* PlatformImpl::createURLLoader()
 {
-    return 0;// new WebURLLoaderImpl(this);
+    return new WebURLLoaderImpl(urlLoaderEngine(), cookieJarImpl());
 }
 
 // May return null.
@@ -366,14 +617,18 @@ WebString PlatformImpl::userAgent(const WebURL&)
 }
 
 // A suggestion to cache this metadata in association with this URL.
-void PlatformImpl::cacheMetadata(const WebURL&, double responseTime, const char* data, size_t dataSize) { }
+void PlatformImpl::cacheMetadata(const WebURL& url, double responseTime, const char* data, size_t dataSize)
+{
+    if (DiskCache* cache = diskCache())
+        cache->storeMetadata(url, responseTime, data, dataSize);
+}
 
 // Returns the decoded data url if url had a supported mimetype and parsing was successful.
 WebData PlatformImpl::parseDataURL(const WebURL& url, WebString& mimetype, WebString& charset)
 {
     std::string mime_type, char_set, data;
     if (net::DataURL::Parse(url, &mime_type, &char_set, &data)
-            && net::IsSupportedMimeType(mime_type)) {
+            && m_mimeRegistry.isSupportedMimeType(mime_type)) {
         mimetype = WebString::fromUTF8(mime_type);
         charset = WebString::fromUTF8(char_set);
         return data;
@@ -381,9 +636,13 @@ WebData PlatformImpl::parseDataURL(const WebURL& url, WebString& mimetype, WebSt
     return WebData();
 }
 
-WebURLError PlatformImpl::cancelledError(const WebURL&) const
+WebURLError PlatformImpl::cancelledError(const WebURL& url) const
 {
-    return WebURLError();
+    WebURLError error;
+    error.domain = WebString::fromUTF8(net::kErrorDomain);
+    error.reason = net::ERR_ABORTED;
+    error.unreachableURL = url;
+    return error;
 }
 
 
@@ -425,14 +684,14 @@ WebString PlatformImpl::queryLocalizedString(WebLocalizedString::Name, const Web
 // Creates an embedder-defined thread.
 WebThread* PlatformImpl::createThread(const char* name)
 {
-    return 0;
+    return new WebThreadImpl(name);
 }
 
 // Returns an interface to the current thread. This is owned by the
 // embedder.
 WebThread* PlatformImpl::currentThread()
 {
-    return 0;
+    return WebThreadBase::current();
 }
 
 
@@ -537,16 +796,54 @@ void PlatformImpl::setSharedTimerFireInterval(double interval_seconds)
     if (interval < 0)
         interval = 0;
 
+    // Round the deadline up to the next multiple of the slack on the
+    // monotonic clock, so timers due within one slack period share a wakeup.
+    // Timers that are already due still fire right away.
+    int64 slack = shared_timer_slack_.InMicroseconds();
+    if (interval > 0 && slack > 0) {
+        int64 now = base::TimeTicks::Now().ToInternalValue();
+        int64 deadline = now + interval;
+        interval = (deadline + slack - 1) / slack * slack - now;
+    }
+
     shared_timer_.Stop();
-    // shared_timer_.Start(FROM_HERE, base::TimeDelta::FromMicroseconds(interval),
-    //     this, &WebKitPlatformSupportImpl::DoTimeout);
-    //OnStartSharedTimer(base::TimeDelta::FromMicroseconds(interval));
+    shared_timer_.Start(FROM_HERE, base::TimeDelta::FromMicroseconds(interval),
+        this, &PlatformImpl::DoTimeout);
 }
 void PlatformImpl::stopSharedTimer()
 {
     shared_timer_.Stop();
 }
 
+void PlatformImpl::SuspendSharedTimer()
+{
+    ++shared_timer_suspended_;
+}
+
+void PlatformImpl::ResumeSharedTimer()
+{
+    DCHECK_GT(shared_timer_suspended_, 0);
+    // The shared timer may have fired or been adjusted while we were suspended.
+    if (--shared_timer_suspended_ == 0 &&
+        (!shared_timer_.IsRunning() ||
+         shared_timer_fire_time_was_set_while_suspended_)) {
+        shared_timer_fire_time_was_set_while_suspended_ = false;
+        setSharedTimerFireInterval(
+            shared_timer_fire_time_ - monotonicallyIncreasingTime());
+    }
+}
+
+void PlatformImpl::SetSharedTimerSlack(base::TimeDelta slack)
+{
+    shared_timer_slack_ = slack;
+}
+
+void PlatformImpl::DoTimeout()
+{
+    if (shared_timer_func_ && !shared_timer_suspended_)
+        shared_timer_func_();
+}
+
 // Callable from a background WebKit thread.
 void PlatformImpl::callOnMainThread(void(*func)(void*), void* context)
 {
@@ -584,8 +881,8 @@ WebUnitTestSupport* PlatformImpl::unitTestSupport()
 // addTraceEvent is expected to be called by the trace event macros.
 const unsigned char* PlatformImpl::getTraceCategoryEnabledFlag(const char* categoryName)
 {
-    static const unsigned char kEnabled = 0;
-    return &kEnabled;
+    // TraceLog flips the flag as TraceRecorder starts and stops recording.
+    return TRACE_EVENT_API_GET_CATEGORY_GROUP_ENABLED(categoryName);
 }
 
 
@@ -595,16 +892,16 @@ const unsigned char* PlatformImpl::getTraceCategoryEnabledFlag(const char* categ
 // and reflects the sampling profiled results into about:tracing.
 Platform::TraceEventAPIAtomicWord* PlatformImpl::getTraceSamplingState(const unsigned bucketName)
 {
-    /* switch (bucketName) {
+    switch (bucketName) {
     case 0:
-    return reinterpret_cast<long*>(&TRACE_EVENT_API_THREAD_BUCKET(0));
+        return reinterpret_cast<long*>(&TRACE_EVENT_API_THREAD_BUCKET(0));
     case 1:
-    return reinterpret_cast<long*>(&TRACE_EVENT_API_THREAD_BUCKET(1));
+        return reinterpret_cast<long*>(&TRACE_EVENT_API_THREAD_BUCKET(1));
     case 2:
-    return reinterpret_cast<long*>(&TRACE_EVENT_API_THREAD_BUCKET(2));
+        return reinterpret_cast<long*>(&TRACE_EVENT_API_THREAD_BUCKET(2));
     default:
-    NOTREACHED() << "Unknown thread bucket type.";
-    }*/
+        NOTREACHED() << "Unknown thread bucket type.";
+    }
     return NULL;
 }
 
@@ -748,12 +1045,16 @@ bool PlatformImpl::canAccelerate2dCanvas()
 
 bool PlatformImpl::isThreadedCompositingEnabled()
 {
-    return false;
+    return true;
 }
 
 WebCompositorSupport* PlatformImpl::compositorSupport()
 {
-    return 0;
+    // Created lazily for the same reason as the URL loader engine: the
+    // compositor thread needs the embedder's AtExitManager.
+    if (!m_compositorSupport)
+        m_compositorSupport.reset(new WebCompositorSupportImpl);
+    return m_compositorSupport.get();
 }
 
 WebFlingAnimator* PlatformImpl::createFlingAnimator()
@@ -5,12 +5,16 @@
 #define NOMINMAX
 #endif
 
+#include "build/build_config.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
 #include "base/timer/timer.h"
 #include "base/platform_file.h"
 #include "../../platform/Platform.h"
 #include "../../platform/WebNonCopyable.h"
-
-#include "../../platform/win/WebThemeEngine.h"
+#include "SamplingProfiler.h"
+#include "WebMimeRegistryImpl.h"
 #include "WebThemeEngineImpl.h"
 
 
@@ -20,12 +24,91 @@ namespace base{
     class MessageLoop;
 }
 
+class DiscardableMemoryAllocator;
+class DiskCache;
+class URLLoaderEngine;
+class WebBlobRegistryImpl;
+class WebCompositorSupportImpl;
+class WebCookieJarImpl;
+class WebFileSystemImpl;
+class WebFileUtilitiesImpl;
+class WebIDBFactoryImpl;
+
 class PlatformImpl : public blink::Platform
 {
 public:
     PlatformImpl();
 
     ~PlatformImpl();
+
+    // The engine behind createURLLoader(). Embedders register extra
+    // local-origin schemes on it before loading pages that use them.
+    URLLoaderEngine* urlLoaderEngine();
+
+    // HTTP cache used by the URL loader and cacheMetadata(); null if the
+    // cache directory could not be opened.
+    DiskCache* diskCache();
+
+    // The cookie jar behind cookieJar(), shared by frames and the URL
+    // loader; persistent cookies are logged next to the disk cache.
+    WebCookieJarImpl* cookieJarImpl();
+
+    // The registry behind blobRegistry() and blob: URLs. Embedders may set
+    // its spill threshold.
+    WebBlobRegistryImpl* blobRegistryImpl();
+
+    // The sandboxed file systems behind fileSystem(), kept next to the disk
+    // cache.
+    WebFileSystemImpl* fileSystemImpl();
+
+    // The IndexedDB factory behind idbFactory(), its databases kept next to
+    // the file systems.
+    WebIDBFactoryImpl* idbFactoryImpl();
+
+    // While suspended the shared timer does not run Blink's timers; on the
+    // last resume it is rescheduled for whatever fire time Blink asked for
+    // in the meantime. Calls nest.
+    void SuspendSharedTimer();
+    void ResumeSharedTimer();
+
+    // Lets the shared timer fire up to |slack| late so that its wakeups land
+    // on a common grid of that period instead of wherever each timer falls.
+    // Zero (the default) fires every timer as early as possible.
+    void SetSharedTimerSlack(base::TimeDelta slack);
+
+    // Samples the buckets handed out by getTraceSamplingState() once
+    // started; the profile can be collected at any time.
+    SamplingProfiler& samplingProfiler() { return m_samplingProfiler; }
+
+    // How long memoryUsageMB() may answer from its last reading.
+    void setMemoryUsageCacheInterval(base::TimeDelta);
+
+    // Backs allocateAndLockDiscardableMemory(); its budget defaults to an
+    // eighth of physical memory.
+    DiscardableMemoryAllocator* discardableMemory() { return m_discardableMemory.get(); }
+
+    enum MemoryPressure {
+        MemoryPressureNone,
+        MemoryPressureModerate,
+        MemoryPressureCritical
+    };
+
+    // Pressure reported by the embedder, e.g. from an OS notification. The
+    // effective pressure is the higher of this and what memoryUsageMB()
+    // measures against physicalMemoryMB().
+    void setMemoryPressure(MemoryPressure);
+    MemoryPressure memoryPressure();
+
+    // Caps the bytes one decoded image may use; 0 (the default) derives the
+    // cap from physicalMemoryMB(). maxDecodedImageBytes() halves it under
+    // moderate pressure and quarters it under critical pressure, when it
+    // also purges unlocked discardable memory.
+    void setMaxDecodedImageBytes(size_t);
+
+    // When on (the default), images larger than the cap are decoded at a
+    // reduced scale; when off they always decode at full resolution.
+    void setDownsampleLargeImages(bool);
+
     // May return null.
     virtual WebCookieJar* cookieJar();
 
@@ -508,13 +591,43 @@ public:
 
 private:
     WebThemeEngineImpl m_themeEngine;
+    WebMimeRegistryImpl m_mimeRegistry;
+
+    SamplingProfiler m_samplingProfiler;
+
+    // Declared first so they outlive the engine and loaders that use them.
+    scoped_ptr<DiskCache> m_diskCache;
+    scoped_ptr<WebCookieJarImpl> m_cookieJar;
+    scoped_ptr<WebBlobRegistryImpl> m_blobRegistry;
+    scoped_ptr<WebFileSystemImpl> m_fileSystem;
+    scoped_ptr<WebFileUtilitiesImpl> m_fileUtilities;
+    scoped_ptr<WebIDBFactoryImpl> m_idbFactory;
+    scoped_ptr<URLLoaderEngine> m_urlLoaderEngine;
+
+    scoped_ptr<WebCompositorSupportImpl> m_compositorSupport;
 
     base::MessageLoop* main_loop_;
+    void DoTimeout();
+
     base::OneShotTimer<PlatformImpl> shared_timer_;
     void(*shared_timer_func_)();
     double shared_timer_fire_time_;
     bool shared_timer_fire_time_was_set_while_suspended_;
     int shared_timer_suspended_;  // counter
+    base::TimeDelta shared_timer_slack_;
+
+    base::Lock m_memoryUsageLock;
+    size_t m_memoryUsageMB;
+    base::TimeTicks m_memoryUsageSampleTime;
+    base::TimeDelta m_memoryUsageCacheInterval;
+
+    scoped_refptr<DiscardableMemoryAllocator> m_discardableMemory;
+
+    base::Lock m_decodedImageLock;
+    size_t m_maxDecodedImageBytes;
+    bool m_downsampleLargeImages;
+    MemoryPressure m_reportedMemoryPressure;
+    MemoryPressure m_lastMemoryPressure;
 };
 
 
@@ -0,0 +1,110 @@
+
+#include "ProcessMemory.h"
+
+#include "build/build_config.h"
+
+#if defined(OS_LINUX)
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#else
+#include "base/memory/scoped_ptr.h"
+#include "base/process/process_handle.h"
+#include "base/process/process_metrics.h"
+#endif
+
+
+namespace
+{
+
+#if defined(OS_LINUX)
+
+    // /proc/self/statm: size resident shared text lib data dt, in pages.
+    bool readStatm(size_t* residentBytes, size_t* sharedBytes)
+    {
+        FILE* file = fopen("/proc/self/statm", "r");
+        if (!file)
+            return false;
+        unsigned long size, resident, shared;
+        int fields = fscanf(file, "%lu %lu %lu", &size, &resident, &shared);
+        fclose(file);
+        if (fields != 3)
+            return false;
+        static const size_t pageSize = sysconf(_SC_PAGESIZE);
+        *residentBytes = resident * pageSize;
+        *sharedBytes = shared * pageSize;
+        return true;
+    }
+
+    // Sums the Private_* and Shared_* lines of /proc/self/smaps, in kB.
+    bool readSmaps(size_t* privateBytes, size_t* sharedBytes)
+    {
+        FILE* file = fopen("/proc/self/smaps", "r");
+        if (!file)
+            return false;
+        size_t privateKB = 0;
+        size_t sharedKB = 0;
+        char line[256];
+        while (fgets(line, sizeof(line), file)) {
+            char key[64];
+            unsigned long kb;
+            if (sscanf(line, "%63s %lu kB", key, &kb) != 2)
+                continue;
+            std::string field(key);
+            if (field == "Private_Clean:" || field == "Private_Dirty:")
+                privateKB += kb;
+            else if (field == "Shared_Clean:" || field == "Shared_Dirty:")
+                sharedKB += kb;
+        }
+        fclose(file);
+        *privateBytes = privateKB * 1024;
+        *sharedBytes = sharedKB * 1024;
+        return true;
+    }
+
+#else
+
+    base::ProcessMetrics* currentProcessMetrics()
+    {
+        static base::ProcessMetrics* metrics =
+            base::ProcessMetrics::CreateProcessMetrics(base::GetCurrentProcessHandle());
+        return metrics;
+    }
+
+#endif
+
+}
+
+namespace ProcessMemory {
+
+    size_t committedBytes()
+    {
+#if defined(OS_LINUX)
+        size_t resident, shared;
+        if (!readStatm(&resident, &shared))
+            return 0;
+        return resident > shared ? resident - shared : 0;
+#else
+        // Committed (pagefile-backed) bytes on Windows.
+        return currentProcessMetrics()->GetPagefileUsage();
+#endif
+    }
+
+    bool sizes(bool detailed, size_t* privateBytes, size_t* sharedBytes)
+    {
+#if defined(OS_LINUX)
+        if (detailed && readSmaps(privateBytes, sharedBytes))
+            return true;
+        size_t resident, shared;
+        if (!readStatm(&resident, &shared))
+            return false;
+        *privateBytes = resident > shared ? resident - shared : 0;
+        *sharedBytes = shared;
+        return true;
+#else
+        return currentProcessMetrics()->GetMemoryBytes(privateBytes, sharedBytes);
+#endif
+    }
+
+}
@@ -0,0 +1,28 @@
+#ifndef ProcessMemory_h
+#define ProcessMemory_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <stddef.h>
+
+// Memory figures for the current process. On Linux they come from /proc;
+// elsewhere from base::ProcessMetrics.
+namespace ProcessMemory {
+
+    // Memory the process has committed and can't share, in bytes. Cheap
+    // enough to call every few milliseconds: one read of /proc/self/statm.
+    // On Linux this is private resident memory rather than virtual size,
+    // which V8 and PartitionAlloc reservations make meaningless.
+    size_t committedBytes();
+
+    // Private and shared resident bytes. With |detailed| set, Linux sums
+    // /proc/self/smaps, which is exact but walks every mapping; otherwise
+    // the statm approximation is used.
+    bool sizes(bool detailed, size_t* privateBytes, size_t* sharedBytes);
+
+}
+
+
+#endif // ProcessMemory_h
@@ -0,0 +1,161 @@
+
+#include "SamplingProfiler.h"
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/strings/string_util.h"
+
+
+namespace
+{
+
+    // A sampling state is a pointer to "category\0name".
+    void splitState(intptr_t state, std::string* category, std::string* name)
+    {
+        if (!state) {
+            category->clear();
+            name->clear();
+            return;
+        }
+        const char* combined = reinterpret_cast<const char*>(state);
+        *category = combined;
+        *name = combined + category->size() + 1;
+    }
+
+    bool contains(const std::string& haystack, const char* needle)
+    {
+        return haystack.find(needle) != std::string::npos;
+    }
+
+    SamplingProfiler::Phase classify(const std::string& category, const std::string& name)
+    {
+        if (category.empty() && name.empty())
+            return SamplingProfiler::PhaseIdle;
+        std::string state = StringToLowerASCII(category + " " + name);
+        if (contains(state, "parse"))
+            return SamplingProfiler::PhaseParse;
+        if (contains(state, "style"))
+            return SamplingProfiler::PhaseStyle;
+        if (contains(state, "layout"))
+            return SamplingProfiler::PhaseLayout;
+        if (contains(state, "paint") || contains(state, "raster"))
+            return SamplingProfiler::PhasePaint;
+        if (contains(state, "v8") || contains(state, "script") || contains(state, "gc"))
+            return SamplingProfiler::PhaseScript;
+        if (contains(state, "idle"))
+            return SamplingProfiler::PhaseIdle;
+        return SamplingProfiler::PhaseOther;
+    }
+
+    bool moreFrequent(const SamplingProfiler::Sample& a, const SamplingProfiler::Sample& b)
+    {
+        return a.count > b.count;
+    }
+
+}
+
+SamplingProfiler::SamplingProfiler()
+    : m_thread("SamplingProfiler")
+    , m_ticks(0)
+{
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+    stop();
+}
+
+void SamplingProfiler::start(base::TimeDelta interval)
+{
+    DCHECK(!isRunning());
+    m_thread.Start();
+    m_thread.message_loop()->PostTask(FROM_HERE,
+        base::Bind(&SamplingProfiler::startTimer, base::Unretained(this), interval));
+}
+
+void SamplingProfiler::stop()
+{
+    if (!isRunning())
+        return;
+    m_thread.message_loop()->PostTask(FROM_HERE,
+        base::Bind(&SamplingProfiler::stopTimer, base::Unretained(this)));
+    m_thread.Stop();
+}
+
+void SamplingProfiler::collect(std::vector<Sample>* samples) const
+{
+    size_t first = samples->size();
+    {
+        base::AutoLock locker(m_lock);
+        for (std::map<std::pair<int, intptr_t>, int64>::const_iterator it = m_counts.begin(); it != m_counts.end(); ++it) {
+            Sample sample;
+            sample.bucket = it->first.first;
+            splitState(it->first.second, &sample.category, &sample.name);
+            sample.phase = classify(sample.category, sample.name);
+            sample.count = it->second;
+            samples->push_back(sample);
+        }
+    }
+    std::stable_sort(samples->begin() + first, samples->end(), moreFrequent);
+}
+
+int64 SamplingProfiler::tickCount() const
+{
+    base::AutoLock locker(m_lock);
+    return m_ticks;
+}
+
+void SamplingProfiler::reset()
+{
+    base::AutoLock locker(m_lock);
+    m_counts.clear();
+    m_ticks = 0;
+}
+
+const char* SamplingProfiler::phaseName(Phase phase)
+{
+    switch (phase) {
+    case PhaseIdle:
+        return "idle";
+    case PhaseParse:
+        return "parse";
+    case PhaseStyle:
+        return "style";
+    case PhaseLayout:
+        return "layout";
+    case PhasePaint:
+        return "paint";
+    case PhaseScript:
+        return "script";
+    case PhaseOther:
+    case PhaseCount:
+        break;
+    }
+    return "other";
+}
+
+void SamplingProfiler::startTimer(base::TimeDelta interval)
+{
+    m_timer.reset(new base::RepeatingTimer<SamplingProfiler>);
+    m_timer->Start(FROM_HERE, interval, this, &SamplingProfiler::sample);
+}
+
+void SamplingProfiler::stopTimer()
+{
+    m_timer.reset();
+}
+
+void SamplingProfiler::sample()
+{
+    intptr_t states[bucketCount];
+    for (int i = 0; i < bucketCount; ++i)
+        states[i] = static_cast<intptr_t>(base::subtle::NoBarrier_Load(&TRACE_EVENT_API_THREAD_BUCKET(i)));
+
+    base::AutoLock locker(m_lock);
+    for (int i = 0; i < bucketCount; ++i)
+        ++m_counts[std::make_pair(i, states[i])];
+    ++m_ticks;
+}
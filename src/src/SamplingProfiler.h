@@ -0,0 +1,87 @@
+#ifndef SamplingProfiler_h
+#define SamplingProfiler_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+// Flat profile of what Blink is doing, built without the tracer.
+//
+// Blink publishes its current phase into the three sampling buckets that
+// PlatformImpl::getTraceSamplingState() hands out (bucket 0 belongs to the
+// main thread). A background thread reads the buckets at a fixed interval
+// and counts how often each (bucket, category, name) state was seen, so hot
+// phases show up in long-running UIs at the cost of a few loads per tick.
+class SamplingProfiler
+{
+public:
+    enum { bucketCount = 3 };
+
+    // Coarse grouping of sampling states.
+    enum Phase {
+        PhaseIdle,
+        PhaseParse,
+        PhaseStyle,
+        PhaseLayout,
+        PhasePaint,
+        PhaseScript,
+        PhaseOther,
+        PhaseCount
+    };
+
+    struct Sample {
+        int bucket;
+        std::string category;
+        std::string name;
+        Phase phase;
+        int64 count;
+    };
+
+    SamplingProfiler();
+    ~SamplingProfiler();
+
+    void start(base::TimeDelta interval);
+    void stop();
+    bool isRunning() const { return m_thread.IsRunning(); }
+
+    // Any thread. Appends one entry per state seen, most frequent first.
+    void collect(std::vector<Sample>*) const;
+
+    // Any thread. Number of ticks taken since start() or reset().
+    int64 tickCount() const;
+
+    void reset();
+
+    static const char* phaseName(Phase);
+
+private:
+    // Sampler thread.
+    void startTimer(base::TimeDelta interval);
+    void stopTimer();
+    void sample();
+
+    base::Thread m_thread;
+    scoped_ptr<base::RepeatingTimer<SamplingProfiler> > m_timer;
+
+    mutable base::Lock m_lock;
+    // Keyed by bucket and the state word, which points at a string literal.
+    std::map<std::pair<int, intptr_t>, int64> m_counts;
+    int64 m_ticks;
+
+    DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+
+#endif // SamplingProfiler_h
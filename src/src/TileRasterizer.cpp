@@ -0,0 +1,122 @@
+
+#include "TileRasterizer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkPicture.h"
+#include "third_party/skia/include/core/SkRegion.h"
+
+class TileRasterizer::Job
+{
+public:
+    Job(const std::vector<SkIRect>& tiles, int originX, int originY, SkBitmap* bitmap, int workers)
+        : m_tiles(tiles)
+        , m_originX(originX)
+        , m_originY(originY)
+        , m_bitmap(bitmap)
+        , m_nextTile(0)
+        , m_pendingWorkers(workers)
+        , m_done(false, false)
+    {
+    }
+
+    // Takes tiles until there are none left.
+    void run(SkPicture* picture)
+    {
+        TRACE_EVENT0("webui", "TileRasterizer::run");
+        SkCanvas canvas(*m_bitmap);
+        for (;;) {
+            int index = base::subtle::NoBarrier_AtomicIncrement(&m_nextTile, 1) - 1;
+            if (index >= static_cast<int>(m_tiles.size()))
+                return;
+            canvas.save();
+            canvas.clipRect(SkRect::Make(m_tiles[index]));
+            canvas.translate(SkIntToScalar(m_originX), SkIntToScalar(m_originY));
+            picture->draw(&canvas);
+            canvas.restore();
+        }
+    }
+
+    void runOnWorker(SkPicture* picture)
+    {
+        run(picture);
+        if (!base::subtle::Barrier_AtomicIncrement(&m_pendingWorkers, -1))
+            m_done.Signal();
+    }
+
+    // Always waits: the last worker still touches |m_done| after the count
+    // reaches 0, so the count alone doesn't say the job may be destroyed.
+    void waitForWorkers()
+    {
+        m_done.Wait();
+    }
+
+private:
+    const std::vector<SkIRect>& m_tiles;
+    int m_originX;
+    int m_originY;
+    SkBitmap* m_bitmap;
+    base::subtle::Atomic32 m_nextTile;
+    base::subtle::Atomic32 m_pendingWorkers;
+    base::WaitableEvent m_done;
+};
+
+TileRasterizer::TileRasterizer(int threads)
+{
+    for (int i = 1; i < threads; ++i) {
+        base::Thread* thread = new base::Thread(base::StringPrintf("Raster%d", i));
+        if (!thread->Start()) {
+            delete thread;
+            break;
+        }
+        m_workers.push_back(thread);
+    }
+}
+
+TileRasterizer::~TileRasterizer()
+{
+}
+
+void TileRasterizer::rasterize(SkPicture* picture, int originX, int originY,
+                               const SkRegion& region, SkBitmap* bitmap)
+{
+    TRACE_EVENT0("webui", "TileRasterizer::rasterize");
+    std::vector<SkIRect> tiles;
+    for (SkRegion::Iterator it(region); !it.done(); it.next()) {
+        const SkIRect& rect = it.rect();
+        for (int y = rect.top(); y < rect.bottom(); y += tileSize) {
+            for (int x = rect.left(); x < rect.right(); x += tileSize) {
+                SkIRect tile = SkIRect::MakeLTRB(x, y, std::min(x + tileSize, rect.right()),
+                                                 std::min(y + tileSize, rect.bottom()));
+                tiles.push_back(tile);
+            }
+        }
+    }
+
+    // No more workers than there are tiles to share.
+    int workers = std::max(0, std::min<int>(m_workers.size(), static_cast<int>(tiles.size()) - 1));
+    Job job(tiles, originX, originY, bitmap, workers);
+    if (!workers) {
+        job.run(picture);
+        return;
+    }
+
+    scoped_ptr<SkPicture[]> clones(new SkPicture[workers]);
+    picture->clone(clones.get(), workers);
+    for (int i = 0; i < workers; ++i) {
+        m_workers[i]->message_loop()->PostTask(FROM_HERE,
+            base::Bind(&Job::runOnWorker, base::Unretained(&job), &clones[i]));
+    }
+    job.run(picture);
+    job.waitForWorkers();
+}
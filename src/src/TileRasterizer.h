@@ -0,0 +1,53 @@
+#ifndef TileRasterizer_h
+#define TileRasterizer_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_vector.h"
+
+class SkBitmap;
+class SkPicture;
+class SkRegion;
+
+namespace base {
+    class Thread;
+}
+
+// Plays an SkPicture back into a bitmap on several threads.
+//
+// The region is cut into fixed-size tiles which the calling thread and the
+// workers take from a shared counter, each through its own clone of the
+// picture (SkPicture playback isn't thread-safe) and its own canvas. Tiles
+// don't overlap and every tile is clipped exactly as a single-threaded
+// playback clipped to the same region would be, so the result is the same
+// pixels.
+class TileRasterizer
+{
+public:
+    // Runs |threads| - 1 workers next to the calling thread.
+    explicit TileRasterizer(int threads);
+    ~TileRasterizer();
+
+    int threadCount() const { return m_workers.size() + 1; }
+
+    // Draws |picture|, recorded with its origin at |originX|, |originY| of
+    // |bitmap|, into the part of |bitmap| inside |region|. Blocks until
+    // every tile is done.
+    void rasterize(SkPicture* picture, int originX, int originY,
+                   const SkRegion& region, SkBitmap* bitmap);
+
+    static const int tileSize = 256;
+
+private:
+    class Job;
+
+    ScopedVector<base::Thread> m_workers;
+
+    DISALLOW_COPY_AND_ASSIGN(TileRasterizer);
+};
+
+
+#endif // TileRasterizer_h
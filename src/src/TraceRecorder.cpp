@@ -0,0 +1,87 @@
+
+#include "TraceRecorder.h"
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/environment.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/run_loop.h"
+
+
+namespace
+{
+
+    const char categoriesVariable[] = "WEBUI_TRACE_CATEGORIES";
+    const char fileVariable[] = "WEBUI_TRACE_FILE";
+    const char defaultFile[] = "webui_trace.json";
+
+    void collectFragment(base::debug::TraceResultBuffer* buffer, const base::Closure& done,
+                         const scoped_refptr<base::RefCountedString>& events, bool hasMoreEvents)
+    {
+        buffer->AddFragment(events->data());
+        if (!hasMoreEvents)
+            done.Run();
+    }
+
+}
+
+void TraceRecorder::start(const std::string& categories)
+{
+    // Continuous recording keeps the newest events once the buffer is full,
+    // so long sessions can be stopped at the interesting moment.
+    base::debug::TraceLog::GetInstance()->SetEnabled(
+        base::debug::CategoryFilter(categories),
+        base::debug::TraceLog::RECORD_CONTINUOUSLY);
+}
+
+bool TraceRecorder::startFromEnvironment()
+{
+    scoped_ptr<base::Environment> environment(base::Environment::Create());
+    std::string categories;
+    if (!environment->GetVar(categoriesVariable, &categories) || categories.empty())
+        return false;
+    start(categories);
+    return true;
+}
+
+bool TraceRecorder::isRecording()
+{
+    return base::debug::TraceLog::GetInstance()->IsEnabled();
+}
+
+bool TraceRecorder::stop(const base::FilePath& path)
+{
+    base::debug::TraceLog* traceLog = base::debug::TraceLog::GetInstance();
+    if (!traceLog->IsEnabled())
+        return false;
+    traceLog->SetDisabled();
+
+    base::debug::TraceResultBuffer::SimpleOutput output;
+    base::debug::TraceResultBuffer buffer;
+    buffer.SetOutputCallback(output.GetCallback());
+    buffer.Start();
+    base::RunLoop runLoop;
+    traceLog->Flush(base::Bind(&collectFragment, &buffer, runLoop.QuitClosure()));
+    runLoop.Run();
+    buffer.Finish();
+
+    std::string json = "{\"traceEvents\":" + output.json_output + "}";
+    if (file_util::WriteFile(path, json.data(), static_cast<int>(json.size())) != static_cast<int>(json.size())) {
+        LOG(ERROR) << "Could not write trace to " << path.value();
+        return false;
+    }
+    return true;
+}
+
+base::FilePath TraceRecorder::fileFromEnvironment()
+{
+    scoped_ptr<base::Environment> environment(base::Environment::Create());
+    std::string file;
+    if (!environment->GetVar(fileVariable, &file) || file.empty())
+        file = defaultFile;
+    return base::FilePath::FromUTF8Unsafe(file);
+}
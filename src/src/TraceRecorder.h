@@ -0,0 +1,50 @@
+#ifndef TraceRecorder_h
+#define TraceRecorder_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+
+// Turns Blink's trace events on and off and writes them out in Chrome's JSON
+// trace format, for loading into about:tracing.
+//
+// Events are recorded by base::debug::TraceLog, which PlatformImpl already
+// forwards addTraceEvent() to: threads with a message loop append to their
+// own event buffer without taking a lock, and full buffers are handed to a
+// process-wide ring that keeps the newest events. Categories that are off
+// cost one byte load per trace macro.
+//
+// Recording can be started from the environment:
+//   WEBUI_TRACE_CATEGORIES  category filter, e.g. "blink,webkit" or "*,-v8"
+//   WEBUI_TRACE_FILE        where stop() writes the trace (webui_trace.json)
+class TraceRecorder
+{
+public:
+    // |categories| is a comma-separated TraceLog category filter; "*" records
+    // everything and a leading '-' excludes a category.
+    static void start(const std::string& categories);
+
+    // Starts recording if WEBUI_TRACE_CATEGORIES is set.
+    static bool startFromEnvironment();
+
+    static bool isRecording();
+
+    // Stops recording and writes the trace to |path|. Must be called on a
+    // thread with a message loop, which is run until every thread's buffer
+    // has been collected.
+    static bool stop(const base::FilePath& path);
+
+    // WEBUI_TRACE_FILE, or webui_trace.json in the current directory.
+    static base::FilePath fileFromEnvironment();
+
+private:
+    DISALLOW_IMPLICIT_CONSTRUCTORS(TraceRecorder);
+};
+
+
+#endif // TraceRecorder_h
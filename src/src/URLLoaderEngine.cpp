@@ -0,0 +1,755 @@
+
+#include "URLLoaderEngine.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "base/strings/string_util.h"
+#include "base/time/time.h"
+#include "net/base/data_url.h"
+#include "net/base/mime_util.h"
+#include "net/base/net_errors.h"
+#include "net/base/net_util.h"
+
+#include "DiskCache.h"
+
+
+namespace
+{
+
+    // Bodies are handed to the client in slices of at most this many bytes so
+    // that a large file doesn't arrive as one didReceiveData call.
+    const size_t sliceSize = 64 * 1024;
+
+    // Slices posted to the main thread but not yet consumed, per request.
+    const int maxSlicesInFlight = 16;
+
+    // Same clock as PlatformImpl::monotonicallyIncreasingTime().
+    double monotonicNow()
+    {
+        return base::TimeTicks::Now().ToInternalValue() /
+               static_cast<double>(base::Time::kMicrosecondsPerSecond);
+    }
+
+    std::string poolKey(const GURL& url)
+    {
+        if (!url.IsStandard())
+            return url.scheme() + ":";
+        return url.scheme() + "://" + url.host() + ":" + url.port();
+    }
+
+    class MappedFileBody : public URLResponseBody
+    {
+    public:
+        bool initialize(const base::FilePath& path)
+        {
+            return m_file.Initialize(path);
+        }
+
+        virtual const char* data() const
+        {
+            return reinterpret_cast<const char*>(m_file.data());
+        }
+
+        virtual size_t size() const
+        {
+            return m_file.length();
+        }
+
+    private:
+        virtual ~MappedFileBody() { }
+
+        base::MemoryMappedFile m_file;
+    };
+
+    // Base for the built-in connections: requests are answered in order from
+    // local data, so any number of them can be pipelined.
+    class LocalConnection : public URLConnection
+    {
+    public:
+        virtual bool supportsPipelining() const
+        {
+            return true;
+        }
+
+        // A missing file fails its own request, not those queued behind it.
+        virtual bool isolatesRequestErrors() const
+        {
+            return true;
+        }
+
+        virtual void sendRequest(const URLRequestInfo& request)
+        {
+            m_requests.push_back(request);
+        }
+
+        virtual int readResponseHead(URLResponseHead* head)
+        {
+            DCHECK(!m_requests.empty());
+            URLRequestInfo request = m_requests.front();
+            m_requests.pop_front();
+            m_body = NULL;
+            int rv = respond(request, head, &m_body);
+            if (rv != net::OK)
+                m_body = NULL;
+            return rv;
+        }
+
+        virtual int readResponseBody(scoped_refptr<URLResponseBody>* body)
+        {
+            // The whole body is produced by respond(); hand it out once.
+            *body = m_body;
+            m_body = NULL;
+            return net::OK;
+        }
+
+    protected:
+        virtual int respond(const URLRequestInfo&, URLResponseHead*, scoped_refptr<URLResponseBody>*) = 0;
+
+    private:
+        std::deque<URLRequestInfo> m_requests;
+        scoped_refptr<URLResponseBody> m_body;
+    };
+
+    class FileConnection : public LocalConnection
+    {
+    protected:
+        virtual int respond(const URLRequestInfo& request, URLResponseHead* head, scoped_refptr<URLResponseBody>* body)
+        {
+            base::FilePath path;
+            if (!net::FileURLToFilePath(request.url, &path))
+                return net::ERR_INVALID_URL;
+
+            base::PlatformFileInfo info;
+            if (!base::GetFileInfo(path, &info) || info.is_directory)
+                return net::ERR_FILE_NOT_FOUND;
+
+            if (!net::GetMimeTypeFromFile(path, &head->mimeType))
+                head->mimeType = "text/plain";
+            head->httpStatusCode = 200;
+            head->httpStatusText = "OK";
+            head->expectedContentLength = info.size;
+
+            // Empty files can't be mapped and don't need to be.
+            if (!info.size)
+                return net::OK;
+
+            scoped_refptr<MappedFileBody> mapped = new MappedFileBody;
+            if (!mapped->initialize(path))
+                return net::ERR_ACCESS_DENIED;
+            *body = mapped;
+            return net::OK;
+        }
+    };
+
+    class DataConnection : public LocalConnection
+    {
+    protected:
+        virtual int respond(const URLRequestInfo& request, URLResponseHead* head, scoped_refptr<URLResponseBody>* body)
+        {
+            std::string data;
+            if (!net::DataURL::Parse(request.url, &head->mimeType, &head->charset, &data))
+                return net::ERR_INVALID_URL;
+
+            head->httpStatusCode = 200;
+            head->httpStatusText = "OK";
+            head->expectedContentLength = data.size();
+            *body = new StringResponseBody(&data);
+            return net::OK;
+        }
+    };
+
+    // Replays one response from the disk cache.
+    class CachedResponseConnection : public URLConnection
+    {
+    public:
+        CachedResponseConnection(const URLResponseHead& head, scoped_refptr<URLResponseBody> body)
+            : m_head(head)
+            , m_body(body)
+        {
+        }
+
+        virtual void sendRequest(const URLRequestInfo&) { }
+
+        virtual int readResponseHead(URLResponseHead* head)
+        {
+            *head = m_head;
+            return net::OK;
+        }
+
+        virtual int readResponseBody(scoped_refptr<URLResponseBody>* body)
+        {
+            *body = m_body;
+            m_body = NULL;
+            return net::OK;
+        }
+
+    private:
+        URLResponseHead m_head;
+        scoped_refptr<URLResponseBody> m_body;
+    };
+
+    class FileSchemeHandler : public URLSchemeHandler
+    {
+    public:
+        virtual URLConnection* openConnection(const GURL&)
+        {
+            return new FileConnection;
+        }
+    };
+
+    class DataSchemeHandler : public URLSchemeHandler
+    {
+    public:
+        virtual URLConnection* openConnection(const GURL&)
+        {
+            return new DataConnection;
+        }
+    };
+
+}
+
+URLResponseHead::URLResponseHead()
+    : httpStatusCode(0)
+    , expectedContentLength(-1)
+    , responseTime(0)
+    , wasCached(false)
+{
+}
+
+URLResponseHead::~URLResponseHead()
+{
+}
+
+std::string URLResponseHead::header(const char* name) const
+{
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (LowerCaseEqualsASCII(headers[i].first, name))
+            return headers[i].second;
+    }
+    return std::string();
+}
+
+URLLoadTimingInfo::URLLoadTimingInfo()
+    : requestTime(0)
+    , connectStart(0)
+    , connectEnd(0)
+    , sendStart(0)
+    , sendEnd(0)
+    , receiveHeadersEnd(0)
+    , responseEnd(0)
+    , connectionReused(false)
+    , receivedBodyBytes(0)
+{
+}
+
+StringResponseBody::StringResponseBody(std::string* data)
+{
+    m_data.swap(*data);
+}
+
+StringResponseBody::~StringResponseBody()
+{
+}
+
+const char* StringResponseBody::data() const
+{
+    return m_data.data();
+}
+
+size_t StringResponseBody::size() const
+{
+    return m_data.size();
+}
+
+// Loader-thread state of one pooled connection.
+struct URLLoaderEngine::Connection {
+    Connection(HostPool* pool, URLConnection* connection)
+        : pool(pool)
+        , connection(connection)
+        , served(0)
+        , oneShot(false)
+        , pumpScheduled(false)
+        , waitingForSlices(false)
+    {
+    }
+
+    HostPool* pool;
+    scoped_ptr<URLConnection> connection;
+    // Requests sent on this connection whose responses aren't finished, in
+    // send order. The front one is the one being read.
+    std::deque<scoped_refptr<Job> > outstanding;
+    int served;
+    // Closed as soon as its single request is done.
+    bool oneShot;
+    bool pumpScheduled;
+    bool waitingForSlices;
+};
+
+struct URLLoaderEngine::HostPool {
+    HostPool(const GURL& origin, URLSchemeHandler* handler)
+        : origin(origin)
+        , handler(handler)
+    {
+    }
+
+    ~HostPool()
+    {
+        STLDeleteElements(&connections);
+    }
+
+    GURL origin;
+    URLSchemeHandler* handler;
+    std::deque<scoped_refptr<Job> > pending;
+    std::vector<Connection*> connections;
+};
+
+URLLoaderEngine::Job::Job(URLLoaderEngine* engine, const URLRequestInfo& request, URLLoaderJobClient* client)
+    : m_engine(engine)
+    , m_request(request)
+    , m_client(client)
+    , m_deferred(false)
+    , m_connection(0)
+    , m_headRead(false)
+    , m_bodyOffset(0)
+    , m_slicesInFlight(0)
+    , m_validating(false)
+    , m_storeInCache(false)
+{
+}
+
+URLLoaderEngine::Job::~Job()
+{
+}
+
+void URLLoaderEngine::Job::cancel()
+{
+    if (m_cancelled.IsSet())
+        return;
+    m_cancelled.Set();
+    m_client = 0;
+    m_deferredNotifications.clear();
+    m_engine->postToLoaderThread(base::Bind(&URLLoaderEngine::didCancelJob, base::Unretained(m_engine), make_scoped_refptr(this)));
+}
+
+void URLLoaderEngine::Job::setDefersLoading(bool defers)
+{
+    m_deferred = defers;
+    if (defers)
+        return;
+
+    std::vector<base::Closure> notifications;
+    notifications.swap(m_deferredNotifications);
+    for (size_t i = 0; i < notifications.size(); ++i)
+        notifications[i].Run();
+}
+
+void URLLoaderEngine::Job::deliverResponseHead(const URLResponseHead& head, const URLLoadTimingInfo& timing)
+{
+    if (!m_client)
+        return;
+    if (m_deferred) {
+        m_deferredNotifications.push_back(base::Bind(&Job::deliverResponseHead, this, head, timing));
+        return;
+    }
+    m_client->didReceiveResponseHead(head, timing);
+}
+
+void URLLoaderEngine::Job::deliverBodyData(scoped_refptr<URLResponseBody> body, size_t offset, size_t length)
+{
+    if (!m_client)
+        return;
+    if (m_deferred) {
+        m_deferredNotifications.push_back(base::Bind(&Job::deliverBodyData, this, body, offset, length));
+        return;
+    }
+    m_client->didReceiveBodyData(body->data() + offset, static_cast<int>(length));
+    m_engine->postToLoaderThread(base::Bind(&URLLoaderEngine::didConsumeSlice, base::Unretained(m_engine), make_scoped_refptr(this)));
+}
+
+void URLLoaderEngine::Job::deliverFinish(int error, const URLLoadTimingInfo& timing)
+{
+    if (!m_client)
+        return;
+    if (m_deferred) {
+        m_deferredNotifications.push_back(base::Bind(&Job::deliverFinish, this, error, timing));
+        return;
+    }
+    URLLoaderJobClient* client = m_client;
+    m_client = 0;
+    client->didFinishLoading(error, timing);
+}
+
+URLLoaderEngine::URLLoaderEngine()
+    : m_mainLoop(base::MessageLoopProxy::current())
+    , m_thread("URLLoader")
+    , m_diskCache(0)
+    , m_cachePool(new HostPool(GURL(), 0))
+    , m_shutDown(false)
+{
+    m_handlers["file"] = new FileSchemeHandler;
+    m_handlers["data"] = new DataSchemeHandler;
+
+    base::Thread::Options options;
+    options.message_loop_type = base::MessageLoop::TYPE_IO;
+    m_thread.StartWithOptions(options);
+}
+
+URLLoaderEngine::~URLLoaderEngine()
+{
+    postToLoaderThread(base::Bind(&URLLoaderEngine::shutdownOnLoaderThread, base::Unretained(this)));
+    m_thread.Stop();
+    STLDeleteValues(&m_handlers);
+}
+
+void URLLoaderEngine::registerSchemeHandler(const std::string& scheme, URLSchemeHandler* handler)
+{
+    base::AutoLock locker(m_handlersLock);
+    DCHECK(!m_handlers.count(scheme));
+    m_handlers[scheme] = handler;
+}
+
+scoped_refptr<URLLoaderEngine::Job> URLLoaderEngine::start(const URLRequestInfo& request, URLLoaderJobClient* client)
+{
+    scoped_refptr<Job> job = new Job(this, request, client);
+    job->m_timing.requestTime = monotonicNow();
+    postToLoaderThread(base::Bind(&URLLoaderEngine::enqueueJob, base::Unretained(this), job));
+    return job;
+}
+
+int URLLoaderEngine::loadSynchronously(const URLRequestInfo& request, URLResponseHead* head, std::string* data, URLLoadTimingInfo* timing)
+{
+    timing->requestTime = monotonicNow();
+    URLSchemeHandler* handler = handlerForScheme(request.url.scheme());
+    if (!handler)
+        return net::ERR_UNKNOWN_URL_SCHEME;
+
+    timing->connectStart = monotonicNow();
+    scoped_ptr<URLConnection> connection(handler->openConnection(request.url.GetOrigin()));
+    if (!connection)
+        return net::ERR_CONNECTION_REFUSED;
+    timing->connectEnd = timing->sendStart = monotonicNow();
+    connection->sendRequest(request);
+    timing->sendEnd = monotonicNow();
+
+    int rv = connection->readResponseHead(head);
+    timing->receiveHeadersEnd = monotonicNow();
+    while (rv == net::OK) {
+        scoped_refptr<URLResponseBody> body;
+        rv = connection->readResponseBody(&body);
+        if (rv != net::OK || !body)
+            break;
+        data->append(body->data(), body->size());
+    }
+    timing->receivedBodyBytes = data->size();
+    timing->responseEnd = monotonicNow();
+    return rv;
+}
+
+URLSchemeHandler* URLLoaderEngine::handlerForScheme(const std::string& scheme)
+{
+    base::AutoLock locker(m_handlersLock);
+    std::map<std::string, URLSchemeHandler*>::const_iterator it = m_handlers.find(scheme);
+    return it == m_handlers.end() ? 0 : it->second;
+}
+
+void URLLoaderEngine::postToLoaderThread(const base::Closure& task)
+{
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE, task);
+}
+
+void URLLoaderEngine::enqueueJob(scoped_refptr<Job> job)
+{
+    const GURL& url = job->m_request.url;
+    std::string key = poolKey(url);
+
+    std::map<std::string, HostPool*>::iterator it = m_pools.find(key);
+    URLSchemeHandler* handler = it != m_pools.end() ? it->second->handler : handlerForScheme(url.scheme());
+    if (!handler) {
+        job->m_timing.responseEnd = monotonicNow();
+        m_mainLoop->PostTask(FROM_HERE, base::Bind(&Job::deliverFinish, job, net::ERR_UNKNOWN_URL_SCHEME, job->m_timing));
+        return;
+    }
+
+    if (m_diskCache && handler->isCacheable() && job->m_request.method == "GET") {
+        URLResponseHead head;
+        scoped_refptr<URLResponseBody> body;
+        bool fresh;
+        if (m_diskCache->lookup(url, &head, &body, &fresh)) {
+            if (fresh) {
+                serveFromCache(job, head, body);
+                return;
+            }
+            // Stale: ask the connection whether it still holds.
+            job->m_validating = true;
+            job->m_cachedHead = head;
+            job->m_cachedBody = body;
+        }
+    }
+
+    HostPool*& pool = m_pools[key];
+    if (!pool)
+        pool = new HostPool(url.IsStandard() ? url.GetOrigin() : GURL(url.scheme() + ":"), handler);
+    pool->pending.push_back(job);
+    dispatchPending(pool);
+}
+
+// Cache hits bypass the host queues and connection limits: each one gets a
+// one-shot connection that replays the stored response through the usual
+// pump, so deferral and slicing work the same as for a network load.
+void URLLoaderEngine::serveFromCache(scoped_refptr<Job> job, const URLResponseHead& head, scoped_refptr<URLResponseBody> body)
+{
+    Connection* connection = new Connection(m_cachePool.get(), new CachedResponseConnection(head, body));
+    connection->oneShot = true;
+    m_cachePool->connections.push_back(connection);
+
+    URLLoadTimingInfo& timing = job->m_timing;
+    timing.connectStart = timing.connectEnd = timing.sendStart = timing.sendEnd = monotonicNow();
+    job->m_connection = connection;
+    connection->outstanding.push_back(job);
+    schedulePump(connection);
+}
+
+void URLLoaderEngine::dispatchPending(HostPool* pool)
+{
+    while (!pool->pending.empty()) {
+        scoped_refptr<Job> job = pool->pending.front();
+        if (job->m_cancelled.IsSet()) {
+            pool->pending.pop_front();
+            continue;
+        }
+
+        // Prefer an idle connection, then a new one, and only pipeline behind
+        // other requests once the host is at its connection limit.
+        Connection* connection = 0;
+        for (size_t i = 0; i < pool->connections.size(); ++i) {
+            Connection* candidate = pool->connections[i];
+            size_t depth = candidate->connection->supportsPipelining() ? maxPipelineDepth : 1;
+            if (candidate->outstanding.size() >= depth)
+                continue;
+            if (!connection || candidate->outstanding.size() < connection->outstanding.size())
+                connection = candidate;
+        }
+
+        double connectStart = monotonicNow();
+        if ((!connection || !connection->outstanding.empty()) && pool->connections.size() < maxConnectionsPerHost) {
+            URLConnection* opened = pool->handler->openConnection(pool->origin);
+            if (opened) {
+                connection = new Connection(pool, opened);
+                pool->connections.push_back(connection);
+            } else if (!connection) {
+                pool->pending.pop_front();
+                job->m_timing.responseEnd = monotonicNow();
+                m_mainLoop->PostTask(FROM_HERE, base::Bind(&Job::deliverFinish, job, net::ERR_CONNECTION_REFUSED, job->m_timing));
+                continue;
+            }
+        }
+        if (!connection)
+            return;
+
+        pool->pending.pop_front();
+        URLLoadTimingInfo& timing = job->m_timing;
+        timing.connectStart = connectStart;
+        timing.connectEnd = monotonicNow();
+        timing.connectionReused = connection->served > 0 || !connection->outstanding.empty();
+        timing.sendStart = monotonicNow();
+        if (job->m_validating) {
+            URLRequestInfo request = job->m_request;
+            request.ifModifiedSince = job->m_cachedHead.header("last-modified");
+            request.ifNoneMatch = job->m_cachedHead.header("etag");
+            connection->connection->sendRequest(request);
+        } else {
+            connection->connection->sendRequest(job->m_request);
+        }
+        timing.sendEnd = monotonicNow();
+
+        job->m_connection = connection;
+        connection->outstanding.push_back(job);
+        schedulePump(connection);
+    }
+}
+
+void URLLoaderEngine::schedulePump(Connection* connection)
+{
+    if (connection->pumpScheduled)
+        return;
+    connection->pumpScheduled = true;
+    base::MessageLoop::current()->PostTask(FROM_HERE, base::Bind(&URLLoaderEngine::pump, base::Unretained(this), connection));
+}
+
+// Advances the front request of |connection| by one step (head, next body
+// piece or one slice) and reposts itself, so connections interleave fairly
+// on the loader thread.
+void URLLoaderEngine::pump(Connection* connection)
+{
+    if (m_shutDown)
+        return;
+    connection->pumpScheduled = false;
+    if (connection->outstanding.empty()) {
+        if (connection->oneShot) {
+            HostPool* pool = connection->pool;
+            pool->connections.erase(std::find(pool->connections.begin(), pool->connections.end(), connection));
+            delete connection;
+            return;
+        }
+        dispatchPending(connection->pool);
+        return;
+    }
+
+    Job* job = connection->outstanding.front().get();
+    bool cancelled = job->m_cancelled.IsSet();
+
+    if (!job->m_headRead) {
+        URLResponseHead head;
+        int rv = connection->connection->readResponseHead(&head);
+        if (rv != net::OK) {
+            failRead(connection, rv);
+            return;
+        }
+        job->m_headRead = true;
+        job->m_timing.receiveHeadersEnd = monotonicNow();
+        if (job->m_validating) {
+            if (head.httpStatusCode == 304) {
+                // Still current: replay the cached response. It keeps its
+                // response time, so its metadata still applies.
+                m_diskCache->refresh(job->m_request.url, head);
+                head = job->m_cachedHead;
+                job->m_body = job->m_cachedBody;
+                job->m_bodyOffset = 0;
+                if (job->m_body)
+                    job->m_timing.receivedBodyBytes += job->m_body->size();
+            }
+            job->m_validating = false;
+            job->m_cachedHead = URLResponseHead();
+            job->m_cachedBody = NULL;
+        }
+        if (!head.wasCached) {
+            head.responseTime = base::Time::Now().ToDoubleT();
+            URLSchemeHandler* handler = connection->pool->handler;
+            if (m_diskCache && handler && handler->isCacheable() && job->m_request.method == "GET") {
+                job->m_storeInCache = true;
+                job->m_head = head;
+            }
+        }
+        if (!cancelled)
+            m_mainLoop->PostTask(FROM_HERE, base::Bind(&Job::deliverResponseHead, job, head, job->m_timing));
+        schedulePump(connection);
+        return;
+    }
+
+    if (!job->m_body || job->m_bodyOffset == job->m_body->size()) {
+        scoped_refptr<URLResponseBody> body;
+        int rv = connection->connection->readResponseBody(&body);
+        if (rv != net::OK) {
+            failRead(connection, rv);
+            return;
+        }
+        if (!body) {
+            finishJob(connection, net::OK);
+            schedulePump(connection);
+            return;
+        }
+        job->m_body = body;
+        job->m_bodyOffset = 0;
+        job->m_timing.receivedBodyBytes += body->size();
+        if (job->m_storeInCache)
+            job->m_cacheBody.push_back(body);
+    }
+
+    if (cancelled) {
+        // Still drain the response so later pipelined ones stay in sync.
+        job->m_bodyOffset = job->m_body->size();
+    } else {
+        if (job->m_slicesInFlight >= maxSlicesInFlight) {
+            connection->waitingForSlices = true;
+            return;
+        }
+        size_t length = std::min(sliceSize, job->m_body->size() - job->m_bodyOffset);
+        ++job->m_slicesInFlight;
+        m_mainLoop->PostTask(FROM_HERE, base::Bind(&Job::deliverBodyData, job, job->m_body, job->m_bodyOffset, length));
+        job->m_bodyOffset += length;
+    }
+    schedulePump(connection);
+}
+
+void URLLoaderEngine::finishJob(Connection* connection, int error)
+{
+    scoped_refptr<Job> job = connection->outstanding.front();
+    connection->outstanding.pop_front();
+    ++connection->served;
+
+    job->m_connection = 0;
+    job->m_body = NULL;
+    job->m_timing.responseEnd = monotonicNow();
+    if (job->m_storeInCache && error == net::OK)
+        m_diskCache->store(job->m_request.url, job->m_head, job->m_cacheBody);
+    job->m_storeInCache = false;
+    job->m_cacheBody.clear();
+    if (!job->m_cancelled.IsSet())
+        m_mainLoop->PostTask(FROM_HERE, base::Bind(&Job::deliverFinish, job, error, job->m_timing));
+}
+
+// Fails the front request of |connection|, and the others behind it unless
+// the connection keeps their responses apart.
+void URLLoaderEngine::failRead(Connection* connection, int error)
+{
+    if (!connection->connection->isolatesRequestErrors()) {
+        failConnection(connection, error);
+        return;
+    }
+    finishJob(connection, error);
+    schedulePump(connection);
+}
+
+// A read error leaves the connection's framing unknown, so every request
+// still outstanding on it fails and the connection is dropped from the pool.
+void URLLoaderEngine::failConnection(Connection* connection, int error)
+{
+    DCHECK(!connection->pumpScheduled);
+    while (!connection->outstanding.empty())
+        finishJob(connection, error);
+
+    HostPool* pool = connection->pool;
+    pool->connections.erase(std::find(pool->connections.begin(), pool->connections.end(), connection));
+    delete connection;
+    dispatchPending(pool);
+}
+
+void URLLoaderEngine::didConsumeSlice(scoped_refptr<Job> job)
+{
+    if (m_shutDown)
+        return;
+    --job->m_slicesInFlight;
+    Connection* connection = job->m_connection;
+    if (connection && connection->waitingForSlices) {
+        connection->waitingForSlices = false;
+        schedulePump(connection);
+    }
+}
+
+void URLLoaderEngine::didCancelJob(scoped_refptr<Job> job)
+{
+    if (m_shutDown)
+        return;
+    // A cancelled request no longer waits for the client; let its connection
+    // drain it.
+    Connection* connection = job->m_connection;
+    if (connection && connection->waitingForSlices) {
+        connection->waitingForSlices = false;
+        schedulePump(connection);
+    }
+}
+
+// Tasks bound to connections may still be queued behind this one; they
+// check m_shutDown before touching a connection.
+void URLLoaderEngine::shutdownOnLoaderThread()
+{
+    m_shutDown = true;
+    STLDeleteValues(&m_pools);
+    m_cachePool.reset();
+}
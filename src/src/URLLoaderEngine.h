@@ -0,0 +1,290 @@
+#ifndef URLLoaderEngine_h
+#define URLLoaderEngine_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/synchronization/cancellation_flag.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+#include "url/gurl.h"
+
+class DiskCache;
+
+// The parts of a WebURLRequest the loader thread needs, copied out on the
+// main thread.
+struct URLRequestInfo {
+    GURL url;
+    std::string method;
+    // The Cookie header value, empty if the request sends no cookies.
+    std::string cookies;
+    // Validators of a stale cached response, set by the engine when it asks
+    // the connection whether that response is still current; empty
+    // otherwise.
+    std::string ifModifiedSince;
+    std::string ifNoneMatch;
+};
+
+// Immutable response bytes shared between the loader thread and the main
+// thread. Connections hand out bodies that wrap memory they already own (a
+// file mapping, a decoded string) so the data reaches
+// WebURLLoaderClient::didReceiveData without being copied.
+class URLResponseBody : public base::RefCountedThreadSafe<URLResponseBody>
+{
+public:
+    virtual const char* data() const = 0;
+    virtual size_t size() const = 0;
+
+protected:
+    friend class base::RefCountedThreadSafe<URLResponseBody>;
+    virtual ~URLResponseBody() { }
+};
+
+// Takes the contents of a string without copying them.
+class StringResponseBody : public URLResponseBody
+{
+public:
+    explicit StringResponseBody(std::string* data);
+
+    virtual const char* data() const;
+    virtual size_t size() const;
+
+private:
+    virtual ~StringResponseBody();
+
+    std::string m_data;
+};
+
+struct URLResponseHead {
+    URLResponseHead();
+    ~URLResponseHead();
+
+    // The value of the first header called |name|, compared without regard
+    // to case; empty if there is none.
+    std::string header(const char* name) const;
+
+    int httpStatusCode;
+    std::string httpStatusText;
+    std::string mimeType;
+    std::string charset;
+    int64 expectedContentLength;
+    std::vector<std::pair<std::string, std::string> > headers;
+
+    // Wall-clock seconds at which the response was first received; kept
+    // across cache hits so cached metadata can be matched to its body.
+    double responseTime;
+    bool wasCached;
+    // Metadata stored by PlatformImpl::cacheMetadata() for this response.
+    scoped_refptr<URLResponseBody> cachedMetadata;
+};
+
+// Per-request timing in seconds on the monotonicallyIncreasingTime() clock.
+// Fields that do not apply to a request are left at 0.
+struct URLLoadTimingInfo {
+    URLLoadTimingInfo();
+
+    double requestTime;       // The request was handed to the engine.
+    double connectStart;      // The request left its host queue.
+    double connectEnd;        // A connection was opened or picked from the pool.
+    double sendStart;
+    double sendEnd;
+    double receiveHeadersEnd;
+    double responseEnd;
+    bool connectionReused;
+    int64 receivedBodyBytes;
+};
+
+// A connection to one origin. All calls happen on the loader thread, in
+// request order, and must not block for long: they share the thread with
+// every other connection.
+class URLConnection
+{
+public:
+    virtual ~URLConnection() { }
+
+    // Connections that return true may be sent further requests before the
+    // response to the first one has been read.
+    virtual bool supportsPipelining() const { return false; }
+
+    // Connections that answer each request on its own, such as local ones,
+    // return true: an error reading one response fails only that request,
+    // and the connection drops what is left of it and goes on to the next.
+    // Otherwise an error fails every request outstanding on the connection.
+    virtual bool isolatesRequestErrors() const { return false; }
+
+    virtual void sendRequest(const URLRequestInfo&) = 0;
+
+    // Reads the head of the oldest response not read yet. Returns a net error
+    // code.
+    virtual int readResponseHead(URLResponseHead*) = 0;
+
+    // Returns the next piece of that response's body in |body|, or leaves it
+    // null once the body is complete. Returns a net error code.
+    virtual int readResponseBody(scoped_refptr<URLResponseBody>* body) = 0;
+};
+
+// Serves one URL scheme. file: and data: are built in; embedders register
+// further local-origin schemes with URLLoaderEngine::registerSchemeHandler().
+class URLSchemeHandler
+{
+public:
+    virtual ~URLSchemeHandler() { }
+
+    // Returns a new connection to |origin|, or null to fail the requests
+    // waiting for it with net::ERR_CONNECTION_REFUSED.
+    virtual URLConnection* openConnection(const GURL& origin) = 0;
+
+    // Responses from cacheable schemes are stored in, and served from, the
+    // engine's DiskCache. Their connections answer a request whose
+    // validators still match with a 304 and no body.
+    virtual bool isCacheable() const { return false; }
+};
+
+// Receives the progress of one request on the main thread.
+class URLLoaderJobClient
+{
+public:
+    // |head.cachedMetadata| is set when the response came from the cache.
+    virtual void didReceiveResponseHead(const URLResponseHead&, const URLLoadTimingInfo&) = 0;
+    virtual void didReceiveBodyData(const char* data, int length) = 0;
+    virtual void didFinishLoading(int error, const URLLoadTimingInfo&) = 0;
+
+protected:
+    virtual ~URLLoaderJobClient() { }
+};
+
+// Runs requests on a dedicated loader thread. Requests are queued per origin
+// and spread over at most maxConnectionsPerHost pooled connections; a
+// connection that supports pipelining takes up to maxPipelineDepth requests at
+// once. Bodies are delivered to the main thread in slices of the buffers the
+// connection produced, with a bounded number of slices in flight per request.
+//
+// GET requests for cacheable schemes are answered from the DiskCache while
+// its response is fresh. A stale one is revalidated with a conditional
+// request and replayed if the connection answers 304; complete responses
+// are written back to the cache.
+class URLLoaderEngine
+{
+private:
+    struct Connection;
+    struct HostPool;
+
+public:
+    static const size_t maxConnectionsPerHost = 6;
+    static const size_t maxPipelineDepth = 4;
+
+    class Job : public base::RefCountedThreadSafe<Job>
+    {
+    public:
+        // Main thread. After cancel() the client gets no further calls.
+        void cancel();
+        void setDefersLoading(bool);
+
+    private:
+        friend class base::RefCountedThreadSafe<Job>;
+        friend class URLLoaderEngine;
+
+        Job(URLLoaderEngine*, const URLRequestInfo&, URLLoaderJobClient*);
+        ~Job();
+
+        // Main thread. While loading is deferred these queue themselves and
+        // run again, in order, once it resumes.
+        void deliverResponseHead(const URLResponseHead&, const URLLoadTimingInfo&);
+        void deliverBodyData(scoped_refptr<URLResponseBody>, size_t offset, size_t length);
+        void deliverFinish(int error, const URLLoadTimingInfo&);
+
+        URLLoaderEngine* m_engine;
+        const URLRequestInfo m_request;
+        URLLoaderJobClient* m_client;
+        bool m_deferred;
+        std::vector<base::Closure> m_deferredNotifications;
+        base::CancellationFlag m_cancelled;
+
+        // Loader thread.
+        Connection* m_connection;
+        URLLoadTimingInfo m_timing;
+        bool m_headRead;
+        scoped_refptr<URLResponseBody> m_body;
+        size_t m_bodyOffset;
+        int m_slicesInFlight;
+
+        // Loader thread, set while a stale cached response is being
+        // revalidated.
+        bool m_validating;
+        URLResponseHead m_cachedHead;
+        scoped_refptr<URLResponseBody> m_cachedBody;
+
+        // Loader thread, set while the response is being recorded for the
+        // disk cache.
+        bool m_storeInCache;
+        URLResponseHead m_head;
+        std::vector<scoped_refptr<URLResponseBody> > m_cacheBody;
+    };
+
+    URLLoaderEngine();
+    ~URLLoaderEngine();
+
+    // Takes ownership of |handler|. Must be called before the first request
+    // for |scheme| is started.
+    void registerSchemeHandler(const std::string& scheme, URLSchemeHandler* handler);
+
+    // |cache| must outlive the engine. Call before the first request.
+    void setDiskCache(DiskCache* cache) { m_diskCache = cache; }
+
+    // Main thread.
+    scoped_refptr<Job> start(const URLRequestInfo&, URLLoaderJobClient*);
+
+    // Runs |request| to completion on the calling thread on a private
+    // connection. Returns a net error code.
+    int loadSynchronously(const URLRequestInfo&, URLResponseHead*, std::string* data, URLLoadTimingInfo*);
+
+private:
+    URLSchemeHandler* handlerForScheme(const std::string& scheme);
+    void postToLoaderThread(const base::Closure&);
+
+    // Loader thread.
+    void enqueueJob(scoped_refptr<Job>);
+    void serveFromCache(scoped_refptr<Job>, const URLResponseHead&, scoped_refptr<URLResponseBody>);
+    void dispatchPending(HostPool*);
+    void schedulePump(Connection*);
+    void pump(Connection*);
+    void finishJob(Connection*, int error);
+    void failRead(Connection*, int error);
+    void failConnection(Connection*, int error);
+    void didConsumeSlice(scoped_refptr<Job>);
+    void didCancelJob(scoped_refptr<Job>);
+    void shutdownOnLoaderThread();
+
+    scoped_refptr<base::MessageLoopProxy> m_mainLoop;
+    base::Thread m_thread;
+
+    base::Lock m_handlersLock;
+    std::map<std::string, URLSchemeHandler*> m_handlers;
+
+    DiskCache* m_diskCache;
+
+    // Loader thread.
+    std::map<std::string, HostPool*> m_pools;
+    // Holds the one-shot connections that replay cache hits.
+    scoped_ptr<HostPool> m_cachePool;
+    // Set once the pools are gone: pumps and slice acknowledgements still
+    // queued for their connections then do nothing.
+    bool m_shutDown;
+
+    DISALLOW_COPY_AND_ASSIGN(URLLoaderEngine);
+};
+
+
+#endif // URLLoaderEngine_h
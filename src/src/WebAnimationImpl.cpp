@@ -0,0 +1,180 @@
+#include "WebAnimationImpl.h"
+
+
+namespace
+{
+
+    int nextAnimationId = 1;
+
+}
+
+WebAnimationImpl::WebAnimationImpl(TargetProperty targetProperty, int animationId)
+    : m_id(animationId ? animationId : nextAnimationId++)
+    , m_targetProperty(targetProperty)
+    , m_iterations(1)
+    , m_startTime(0)
+    , m_timeOffset(0)
+    , m_alternatesDirection(false)
+{
+}
+
+WebAnimationImpl::~WebAnimationImpl()
+{
+}
+
+int WebAnimationImpl::id()
+{
+    return m_id;
+}
+
+WebAnimation::TargetProperty WebAnimationImpl::targetProperty() const
+{
+    return m_targetProperty;
+}
+
+int WebAnimationImpl::iterations() const
+{
+    return m_iterations;
+}
+
+void WebAnimationImpl::setIterations(int iterations)
+{
+    m_iterations = iterations;
+}
+
+double WebAnimationImpl::startTime() const
+{
+    return m_startTime;
+}
+
+void WebAnimationImpl::setStartTime(double monotonicTime)
+{
+    m_startTime = monotonicTime;
+}
+
+double WebAnimationImpl::timeOffset() const
+{
+    return m_timeOffset;
+}
+
+void WebAnimationImpl::setTimeOffset(double monotonicTime)
+{
+    m_timeOffset = monotonicTime;
+}
+
+bool WebAnimationImpl::alternatesDirection() const
+{
+    return m_alternatesDirection;
+}
+
+void WebAnimationImpl::setAlternatesDirection(bool alternates)
+{
+    m_alternatesDirection = alternates;
+}
+
+WebFloatAnimationCurveImpl::WebFloatAnimationCurveImpl()
+{
+}
+
+WebFloatAnimationCurveImpl::~WebFloatAnimationCurveImpl()
+{
+}
+
+WebAnimationCurve::AnimationCurveType WebFloatAnimationCurveImpl::type() const
+{
+    return AnimationCurveTypeFloat;
+}
+
+void WebFloatAnimationCurveImpl::add(const WebFloatKeyframe&) { }
+void WebFloatAnimationCurveImpl::add(const WebFloatKeyframe&, TimingFunctionType) { }
+void WebFloatAnimationCurveImpl::add(const WebFloatKeyframe&, double, double, double, double) { }
+
+float WebFloatAnimationCurveImpl::getValue(double) const
+{
+    return 0;
+}
+
+WebTransformAnimationCurveImpl::WebTransformAnimationCurveImpl()
+{
+}
+
+WebTransformAnimationCurveImpl::~WebTransformAnimationCurveImpl()
+{
+}
+
+WebAnimationCurve::AnimationCurveType WebTransformAnimationCurveImpl::type() const
+{
+    return AnimationCurveTypeTransform;
+}
+
+void WebTransformAnimationCurveImpl::add(const WebTransformKeyframe&) { }
+void WebTransformAnimationCurveImpl::add(const WebTransformKeyframe&, TimingFunctionType) { }
+void WebTransformAnimationCurveImpl::add(const WebTransformKeyframe&, double, double, double, double) { }
+
+WebFilterOperationsImpl::WebFilterOperationsImpl()
+    : m_count(0)
+{
+}
+
+WebFilterOperationsImpl::~WebFilterOperationsImpl()
+{
+}
+
+void WebFilterOperationsImpl::appendGrayscaleFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendSepiaFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendSaturateFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendHueRotateFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendInvertFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendBrightnessFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendContrastFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendOpacityFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendBlurFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendDropShadowFilter(WebPoint, float, WebColor) { ++m_count; }
+void WebFilterOperationsImpl::appendColorMatrixFilter(SkScalar[20]) { ++m_count; }
+void WebFilterOperationsImpl::appendZoomFilter(float, int) { ++m_count; }
+void WebFilterOperationsImpl::appendSaturatingBrightnessFilter(float) { ++m_count; }
+void WebFilterOperationsImpl::appendReferenceFilter(SkImageFilter*) { ++m_count; }
+
+void WebFilterOperationsImpl::clear()
+{
+    m_count = 0;
+}
+
+bool WebFilterOperationsImpl::isEmpty() const
+{
+    return !m_count;
+}
+
+WebTransformOperationsImpl::WebTransformOperationsImpl()
+    : m_isIdentity(true)
+{
+}
+
+WebTransformOperationsImpl::~WebTransformOperationsImpl()
+{
+}
+
+// Nothing is interpolated here.
+bool WebTransformOperationsImpl::canBlendWith(const WebTransformOperations&) const
+{
+    return false;
+}
+
+void WebTransformOperationsImpl::appendTranslate(double, double, double) { m_isIdentity = false; }
+void WebTransformOperationsImpl::appendRotate(double, double, double, double) { m_isIdentity = false; }
+void WebTransformOperationsImpl::appendScale(double, double, double) { m_isIdentity = false; }
+void WebTransformOperationsImpl::appendSkew(double, double) { m_isIdentity = false; }
+void WebTransformOperationsImpl::appendPerspective(double) { m_isIdentity = false; }
+
+void WebTransformOperationsImpl::appendMatrix(const SkMatrix44& matrix)
+{
+    if (!matrix.isIdentity())
+        m_isIdentity = false;
+}
+
+void WebTransformOperationsImpl::appendIdentity() { }
+
+bool WebTransformOperationsImpl::isIdentity() const
+{
+    return m_isIdentity;
+}
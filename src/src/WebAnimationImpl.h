@@ -0,0 +1,150 @@
+#ifndef WebAnimationImpl_h
+#define WebAnimationImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+
+#include "../../platform/WebAnimation.h"
+#include "../../platform/WebAnimationCurve.h"
+#include "../../platform/WebFilterOperations.h"
+#include "../../platform/WebFloatAnimationCurve.h"
+#include "../../platform/WebTransformAnimationCurve.h"
+#include "../../platform/WebTransformOperations.h"
+
+using namespace blink;
+
+// The animation objects of WebCompositorSupportImpl.
+//
+// The software compositor doesn't run animations: WebLayerImpl::addAnimation
+// refuses every one, and Blink then animates on the main thread. These only
+// exist so that Blink can build an animation before offering it, so curves
+// drop their keyframes and operation lists only remember what a caller may
+// ask back.
+class WebAnimationImpl : public blink::WebAnimation
+{
+public:
+    WebAnimationImpl(TargetProperty, int animationId);
+    virtual ~WebAnimationImpl();
+
+    // WebAnimation methods:
+    virtual int id();
+    virtual TargetProperty targetProperty() const;
+    virtual int iterations() const;
+    virtual void setIterations(int);
+    virtual double startTime() const;
+    virtual void setStartTime(double monotonicTime);
+    virtual double timeOffset() const;
+    virtual void setTimeOffset(double monotonicTime);
+    virtual bool alternatesDirection() const;
+    virtual void setAlternatesDirection(bool);
+
+private:
+    int m_id;
+    TargetProperty m_targetProperty;
+    int m_iterations;
+    double m_startTime;
+    double m_timeOffset;
+    bool m_alternatesDirection;
+
+    DISALLOW_COPY_AND_ASSIGN(WebAnimationImpl);
+};
+
+class WebFloatAnimationCurveImpl : public blink::WebFloatAnimationCurve
+{
+public:
+    WebFloatAnimationCurveImpl();
+    virtual ~WebFloatAnimationCurveImpl();
+
+    // WebAnimationCurve methods:
+    virtual AnimationCurveType type() const;
+
+    // WebFloatAnimationCurve methods:
+    virtual void add(const WebFloatKeyframe&);
+    virtual void add(const WebFloatKeyframe&, TimingFunctionType);
+    virtual void add(const WebFloatKeyframe&, double x1, double y1, double x2, double y2);
+    virtual float getValue(double time) const;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WebFloatAnimationCurveImpl);
+};
+
+class WebTransformAnimationCurveImpl : public blink::WebTransformAnimationCurve
+{
+public:
+    WebTransformAnimationCurveImpl();
+    virtual ~WebTransformAnimationCurveImpl();
+
+    // WebAnimationCurve methods:
+    virtual AnimationCurveType type() const;
+
+    // WebTransformAnimationCurve methods:
+    virtual void add(const WebTransformKeyframe&);
+    virtual void add(const WebTransformKeyframe&, TimingFunctionType);
+    virtual void add(const WebTransformKeyframe&, double x1, double y1, double x2, double y2);
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(WebTransformAnimationCurveImpl);
+};
+
+// Layers ignore filters (see WebLayerImpl::setFilters); this only counts
+// them.
+class WebFilterOperationsImpl : public blink::WebFilterOperations
+{
+public:
+    WebFilterOperationsImpl();
+    virtual ~WebFilterOperationsImpl();
+
+    // WebFilterOperations methods:
+    virtual void appendGrayscaleFilter(float amount);
+    virtual void appendSepiaFilter(float amount);
+    virtual void appendSaturateFilter(float amount);
+    virtual void appendHueRotateFilter(float amount);
+    virtual void appendInvertFilter(float amount);
+    virtual void appendBrightnessFilter(float amount);
+    virtual void appendContrastFilter(float amount);
+    virtual void appendOpacityFilter(float amount);
+    virtual void appendBlurFilter(float amount);
+    virtual void appendDropShadowFilter(WebPoint offset, float stdDeviation, WebColor);
+    virtual void appendColorMatrixFilter(SkScalar matrix[20]);
+    virtual void appendZoomFilter(float amount, int inset);
+    virtual void appendSaturatingBrightnessFilter(float amount);
+    virtual void appendReferenceFilter(SkImageFilter*);
+    virtual void clear();
+    virtual bool isEmpty() const;
+
+private:
+    size_t m_count;
+
+    DISALLOW_COPY_AND_ASSIGN(WebFilterOperationsImpl);
+};
+
+// Only backs transform keyframes, which are never animated here; it
+// remembers whether the list is the identity.
+class WebTransformOperationsImpl : public blink::WebTransformOperations
+{
+public:
+    WebTransformOperationsImpl();
+    virtual ~WebTransformOperationsImpl();
+
+    // WebTransformOperations methods:
+    virtual bool canBlendWith(const WebTransformOperations&) const;
+    virtual void appendTranslate(double x, double y, double z);
+    virtual void appendRotate(double x, double y, double z, double degrees);
+    virtual void appendScale(double x, double y, double z);
+    virtual void appendSkew(double x, double y);
+    virtual void appendPerspective(double depth);
+    virtual void appendMatrix(const SkMatrix44&);
+    virtual void appendIdentity();
+    virtual bool isIdentity() const;
+
+private:
+    bool m_isIdentity;
+
+    DISALLOW_COPY_AND_ASSIGN(WebTransformOperationsImpl);
+};
+
+
+#endif // WebAnimationImpl_h
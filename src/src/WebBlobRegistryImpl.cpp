@@ -0,0 +1,851 @@
+#include "WebBlobRegistryImpl.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/platform_file.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_util.h"
+
+#include "../../platform/WebBlobData.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebThreadSafeData.h"
+#include "../../platform/WebURL.h"
+
+#include "WebFileSystemImpl.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+    // Spill files are kept to this size so that mapping one never needs
+    // much contiguous address space; a single larger slice gets a file of
+    // its own.
+    const int64 maxSpillFileSize = 64 * 1024 * 1024;
+
+    // Largest write handed to the platform at once.
+    const size_t maxWriteSize = 16 * 1024 * 1024;
+
+    // Keeps the buffer of a data item that Blink handed over.
+    class ThreadSafeDataSegment : public URLResponseBody
+    {
+    public:
+        explicit ThreadSafeDataSegment(const WebThreadSafeData& data)
+            : m_data(data)
+        {
+        }
+
+        virtual const char* data() const
+        {
+            return m_data.data();
+        }
+
+        virtual size_t size() const
+        {
+            return m_data.size();
+        }
+
+    private:
+        virtual ~ThreadSafeDataSegment() { }
+
+        WebThreadSafeData m_data;
+    };
+
+    class MappedFileSegment : public URLResponseBody
+    {
+    public:
+        MappedFileSegment()
+            : m_file(new base::MemoryMappedFile)
+        {
+        }
+
+        // A temporary file is deleted once the segment no longer needs it.
+        bool initialize(const base::FilePath& path, bool temporary)
+        {
+            if (!m_file->Initialize(path))
+                return false;
+            if (temporary) {
+#if defined(OS_POSIX)
+                // The mapping keeps the pages; the name isn't needed any more.
+                base::DeleteFile(path, false);
+#else
+                // Windows can't delete a file that is mapped.
+                m_temporaryPath = path;
+#endif
+            }
+            return true;
+        }
+
+        virtual const char* data() const
+        {
+            return reinterpret_cast<const char*>(m_file->data());
+        }
+
+        virtual size_t size() const
+        {
+            return m_file->length();
+        }
+
+    private:
+        virtual ~MappedFileSegment()
+        {
+            m_file.reset();
+            if (!m_temporaryPath.empty())
+                base::DeleteFile(m_temporaryPath, false);
+        }
+
+        scoped_ptr<base::MemoryMappedFile> m_file;
+        base::FilePath m_temporaryPath;
+    };
+
+    // A read-only mapping of part of a file. The view starts at the
+    // allocation boundary at or before the part, so only the pages that
+    // hold it are mapped.
+    class MappedFileRange : public URLResponseBody
+    {
+    public:
+        MappedFileRange()
+            : m_view(0)
+            , m_viewSize(0)
+            , m_offsetInView(0)
+            , m_length(0)
+        {
+        }
+
+        bool initialize(base::PlatformFile file, int64 offset, size_t length)
+        {
+#if defined(OS_WIN)
+            SYSTEM_INFO system;
+            GetSystemInfo(&system);
+            int64 granularity = system.dwAllocationGranularity;
+#else
+            int64 granularity = sysconf(_SC_PAGESIZE);
+#endif
+            int64 start = offset - offset % granularity;
+            m_offsetInView = static_cast<size_t>(offset - start);
+            m_viewSize = m_offsetInView + length;
+            m_length = length;
+#if defined(OS_WIN)
+            HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!mapping)
+                return false;
+            m_view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), m_viewSize);
+            // The view keeps the mapping object alive.
+            CloseHandle(mapping);
+#else
+            void* view = mmap(0, m_viewSize, PROT_READ, MAP_SHARED, file, start);
+            m_view = view == MAP_FAILED ? 0 : view;
+#endif
+            return m_view != 0;
+        }
+
+        virtual const char* data() const
+        {
+            return static_cast<const char*>(m_view) + m_offsetInView;
+        }
+
+        virtual size_t size() const
+        {
+            return m_length;
+        }
+
+    private:
+        virtual ~MappedFileRange()
+        {
+            if (!m_view)
+                return;
+#if defined(OS_WIN)
+            UnmapViewOfFile(m_view);
+#else
+            munmap(m_view, m_viewSize);
+#endif
+        }
+
+        void* m_view;
+        size_t m_viewSize;
+        size_t m_offsetInView;
+        size_t m_length;
+    };
+
+    // Part of another segment.
+    class SliceBody : public URLResponseBody
+    {
+    public:
+        SliceBody(scoped_refptr<URLResponseBody> segment, size_t offset, size_t length)
+            : m_segment(segment)
+            , m_offset(offset)
+            , m_length(length)
+        {
+        }
+
+        virtual const char* data() const
+        {
+            return m_segment->data() + m_offset;
+        }
+
+        virtual size_t size() const
+        {
+            return m_length;
+        }
+
+    private:
+        virtual ~SliceBody() { }
+
+        scoped_refptr<URLResponseBody> m_segment;
+        size_t m_offset;
+        size_t m_length;
+    };
+
+    // Answers blob: requests, in order, with the slices of the blob.
+    class BlobConnection : public URLConnection
+    {
+    public:
+        explicit BlobConnection(WebBlobRegistryImpl* registry)
+            : m_registry(registry)
+            , m_nextSlice(0)
+        {
+        }
+
+        virtual bool supportsPipelining() const
+        {
+            return true;
+        }
+
+        // A revoked URL fails only its own request.
+        virtual bool isolatesRequestErrors() const
+        {
+            return true;
+        }
+
+        virtual void sendRequest(const URLRequestInfo& request)
+        {
+            m_requests.push_back(request.url);
+        }
+
+        virtual int readResponseHead(URLResponseHead* head)
+        {
+            DCHECK(!m_requests.empty());
+            GURL url = m_requests.front();
+            m_requests.pop_front();
+            m_nextSlice = 0;
+            m_contents = m_registry->contentsForURL(url);
+            if (!m_contents || m_contents->broken) {
+                m_contents = NULL;
+                return net::ERR_FILE_NOT_FOUND;
+            }
+
+            bool hadCharset = false;
+            net::HttpUtil::ParseContentType(m_contents->contentType, &head->mimeType, &head->charset, &hadCharset, NULL);
+            head->httpStatusCode = 200;
+            head->httpStatusText = "OK";
+            head->expectedContentLength = m_contents->size;
+            return net::OK;
+        }
+
+        virtual int readResponseBody(scoped_refptr<URLResponseBody>* body)
+        {
+            *body = NULL;
+            if (!m_contents)
+                return net::OK;
+            if (m_nextSlice == m_contents->slices.size()) {
+                m_contents = NULL;
+                return net::OK;
+            }
+
+            int rv = WebBlobRegistryImpl::openSlice(m_contents->slices[m_nextSlice++], body);
+            if (rv != net::OK) {
+                *body = NULL;
+                m_contents = NULL;
+            }
+            return rv;
+        }
+
+    private:
+        WebBlobRegistryImpl* m_registry;
+        std::deque<GURL> m_requests;
+        scoped_refptr<WebBlobRegistryImpl::Contents> m_contents;
+        size_t m_nextSlice;
+    };
+
+    class BlobSchemeHandler : public URLSchemeHandler
+    {
+    public:
+        explicit BlobSchemeHandler(WebBlobRegistryImpl* registry)
+            : m_registry(registry)
+        {
+        }
+
+        virtual URLConnection* openConnection(const GURL&)
+        {
+            return new BlobConnection(m_registry);
+        }
+
+    private:
+        WebBlobRegistryImpl* m_registry;
+    };
+
+    // Public URLs are matched without their fragment.
+    std::string publicURLKey(const GURL& url)
+    {
+        GURL::Replacements replacements;
+        replacements.ClearRef();
+        return url.ReplaceComponents(replacements).spec();
+    }
+
+    // The part of [0, size) that an item's offset and length (-1 for "to
+    // the end") select. False if the offset is past the end.
+    bool clampRange(int64 size, int64 offset, int64 length, int64* start, int64* end)
+    {
+        if (offset < 0 || offset > size)
+            return false;
+        *start = offset;
+        *end = length < 0 ? size : std::min(size, offset + length);
+        return true;
+    }
+
+    // Records the range of the file at |path|, statted as |info|, that
+    // |item| selects. Nothing is read until the slice is.
+    bool appendFile(const base::FilePath& path, const base::PlatformFileInfo& info, const WebBlobRegistryImpl::Item& item,
+                    WebBlobRegistryImpl::Contents* contents)
+    {
+        if (info.is_directory)
+            return false;
+        // A file changed since the page picked it can't be read, as in
+        // Chrome.
+        if (item.expectedModificationTime
+                && base::Time::FromDoubleT(item.expectedModificationTime).ToTimeT() != info.last_modified.ToTimeT())
+            return false;
+
+        int64 start, end;
+        if (!clampRange(info.size, item.offset, item.length, &start, &end))
+            return false;
+        if (start == end)
+            return true;
+
+        WebBlobRegistryImpl::Slice slice;
+        slice.offset = static_cast<size_t>(start);
+        slice.length = static_cast<size_t>(end - start);
+        slice.storage = WebBlobRegistryImpl::FileStorage;
+        slice.path = path;
+        slice.modificationTime = info.last_modified;
+        contents->append(slice);
+        return true;
+    }
+
+    bool writeAll(base::PlatformFile file, const char* data, size_t length)
+    {
+        while (length) {
+            int chunk = static_cast<int>(std::min(length, maxWriteSize));
+            if (base::WritePlatformFileAtCurrentPos(file, data, chunk) != chunk)
+                return false;
+            data += chunk;
+            length -= chunk;
+        }
+        return true;
+    }
+
+    // Closes and maps a finished spill file, and points the slices written
+    // to it, |pending| in |slices|, at the mapping.
+    bool finishSpillFile(base::PlatformFile file, const base::FilePath& path,
+                         std::vector<size_t>* pending, std::vector<WebBlobRegistryImpl::Slice>* slices)
+    {
+        bool closed = base::ClosePlatformFile(file);
+        scoped_refptr<MappedFileSegment> segment = new MappedFileSegment;
+        if (!closed || !segment->initialize(path, true)) {
+            base::DeleteFile(path, false);
+            return false;
+        }
+        for (size_t i = 0; i < pending->size(); ++i) {
+            WebBlobRegistryImpl::Slice& slice = (*slices)[(*pending)[i]];
+            slice.segment = segment;
+            slice.storage = WebBlobRegistryImpl::SpillStorage;
+        }
+        pending->clear();
+        return true;
+    }
+
+}
+
+struct WebBlobRegistryImpl::Item {
+    WebBlobData::Item::Type type;
+    WebThreadSafeData data;
+    base::FilePath filePath;
+    GURL fileSystemURL;
+    std::string blobUUID;
+    int64 offset;
+    int64 length;
+    double expectedModificationTime;
+};
+
+WebBlobRegistryImpl::Contents::Contents()
+    : size(0)
+    , memoryBytes(0)
+    , spilledBytes(0)
+    , broken(false)
+{
+}
+
+WebBlobRegistryImpl::Contents::~Contents()
+{
+}
+
+void WebBlobRegistryImpl::Contents::append(const Slice& slice)
+{
+    DCHECK(slice.length);
+    slices.push_back(slice);
+    size += slice.length;
+    if (slice.storage == MemoryStorage)
+        memoryBytes += slice.length;
+    else if (slice.storage == SpillStorage)
+        spilledBytes += slice.length;
+}
+
+WebBlobRegistryImpl::Entry::Entry()
+    : refs(0)
+    , pending(false)
+{
+}
+
+WebBlobRegistryImpl::WebBlobRegistryImpl(int64 spillThreshold)
+    : m_resolved(&m_lock)
+    , m_spillThreshold(spillThreshold)
+    , m_memoryBytes(0)
+    , m_spilledBytes(0)
+    , m_fileSystem(0)
+    , m_spillFiles(0)
+    , m_thread("BlobRegistry")
+{
+    m_thread.Start();
+}
+
+WebBlobRegistryImpl::~WebBlobRegistryImpl()
+{
+    m_thread.Stop();
+    // Unmap the spill files before their directory goes.
+    m_publicURLs.clear();
+    m_blobs.clear();
+    if (!m_spillDirectory.empty())
+        base::DeleteFile(m_spillDirectory, true);
+}
+
+void WebBlobRegistryImpl::setSpillThreshold(int64 bytes)
+{
+    base::AutoLock locker(m_lock);
+    m_spillThreshold = bytes;
+}
+
+URLSchemeHandler* WebBlobRegistryImpl::createSchemeHandler()
+{
+    return new BlobSchemeHandler(this);
+}
+
+void WebBlobRegistryImpl::setFileSystem(WebFileSystemImpl* fileSystem)
+{
+    base::AutoLock locker(m_lock);
+    m_fileSystem = fileSystem;
+}
+
+int WebBlobRegistryImpl::openSlice(const Slice& slice, scoped_refptr<URLResponseBody>* segment)
+{
+    if (slice.storage != FileStorage) {
+        if (!slice.offset && slice.length == slice.segment->size())
+            *segment = slice.segment;
+        else
+            *segment = new SliceBody(slice.segment, slice.offset, slice.length);
+        return net::OK;
+    }
+
+    // Statted through the handle it is mapped from, so that the check and
+    // the mapping see the same file.
+    base::PlatformFile file = base::CreatePlatformFile(slice.path, base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ, NULL, NULL);
+    if (file == base::kInvalidPlatformFileValue)
+        return net::ERR_FILE_NOT_FOUND;
+    int rv = net::OK;
+    base::PlatformFileInfo info;
+    scoped_refptr<MappedFileRange> mapped = new MappedFileRange;
+    if (!base::GetPlatformFileInfo(file, &info) || info.is_directory) {
+        rv = net::ERR_FILE_NOT_FOUND;
+    } else if (info.last_modified != slice.modificationTime
+               || info.size < static_cast<int64>(slice.offset + slice.length)) {
+        // The size catches a truncation within the resolution of the
+        // modification time.
+        rv = net::ERR_UPLOAD_FILE_CHANGED;
+    } else if (!mapped->initialize(file, slice.offset, slice.length)) {
+        LOG(WARNING) << "can't map " << slice.path.value();
+        rv = net::ERR_ACCESS_DENIED;
+    }
+    base::ClosePlatformFile(file);
+    if (rv == net::OK)
+        *segment = mapped;
+    return rv;
+}
+
+int64 WebBlobRegistryImpl::memoryBytes()
+{
+    base::AutoLock locker(m_lock);
+    return m_memoryBytes;
+}
+
+int64 WebBlobRegistryImpl::spilledBytes()
+{
+    base::AutoLock locker(m_lock);
+    return m_spilledBytes;
+}
+
+scoped_refptr<WebBlobRegistryImpl::Contents> WebBlobRegistryImpl::contentsForURL(const GURL& url)
+{
+    base::AutoLock locker(m_lock);
+    std::map<std::string, std::string>::const_iterator publicURL = m_publicURLs.find(publicURLKey(url));
+    if (publicURL == m_publicURLs.end())
+        return NULL;
+    // Copied: waiting releases the lock, and the URL may be revoked.
+    std::string uuid = publicURL->second;
+    Entry* entry = findResolved(uuid);
+    return entry ? entry->contents : NULL;
+}
+
+scoped_refptr<WebBlobRegistryImpl::Contents> WebBlobRegistryImpl::contentsForUUID(const std::string& uuid)
+{
+    base::AutoLock locker(m_lock);
+    Entry* entry = findResolved(uuid);
+    return entry ? entry->contents : NULL;
+}
+
+void WebBlobRegistryImpl::registerBlobData(const WebString& uuid, const WebBlobData& data)
+{
+    TRACE_EVENT0("webui", "WebBlobRegistryImpl::registerBlobData");
+    std::vector<Item> items(data.itemCount());
+    bool hasFiles = false;
+    bool hasBlobs = false;
+    for (size_t i = 0; i < data.itemCount(); ++i) {
+        WebBlobData::Item item;
+        data.itemAt(i, item);
+        items[i].type = item.type;
+        items[i].data = item.data;
+        items[i].filePath = base::FilePath::FromUTF16Unsafe(item.filePath);
+        items[i].fileSystemURL = item.fileSystemURL;
+        items[i].blobUUID = item.blobUUID.utf8();
+        items[i].offset = item.offset;
+        items[i].length = item.length;
+        items[i].expectedModificationTime = item.expectedModificationTime;
+        hasFiles = hasFiles || item.type == WebBlobData::Item::TypeFile || item.type == WebBlobData::Item::TypeFileSystemURL;
+        hasBlobs = hasBlobs || item.type == WebBlobData::Item::TypeBlob;
+    }
+    std::string id = uuid.utf8();
+    std::string contentType = data.contentType().utf8();
+
+    {
+        base::AutoLock locker(m_lock);
+        Entry& entry = m_blobs[id];
+        DCHECK(!entry.contents && !entry.pending);
+        entry.refs = 1;
+        // A blob built from a pending one queues behind it on the registry
+        // thread, which handles both in order.
+        bool fromPending = false;
+        for (size_t i = 0; hasBlobs && i < items.size(); ++i) {
+            if (items[i].type != WebBlobData::Item::TypeBlob)
+                continue;
+            std::map<std::string, Entry>::const_iterator blob = m_blobs.find(items[i].blobUUID);
+            fromPending = fromPending || (blob != m_blobs.end() && blob->second.pending);
+        }
+        if (hasFiles || fromPending) {
+            entry.pending = true;
+            m_thread.message_loop_proxy()->PostTask(FROM_HERE,
+                base::Bind(&WebBlobRegistryImpl::resolve, base::Unretained(this), id, contentType, items));
+            return;
+        }
+    }
+
+    scoped_refptr<Contents> contents = buildContents(contentType, items);
+    base::AutoLock locker(m_lock);
+    install(id, contents);
+}
+
+// Main thread, or the registry thread for a blob with files.
+scoped_refptr<WebBlobRegistryImpl::Contents> WebBlobRegistryImpl::buildContents(const std::string& contentType, const std::vector<Item>& items)
+{
+    scoped_refptr<Contents> contents = new Contents;
+    contents->contentType = contentType;
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Item& item = items[i];
+        switch (item.type) {
+        case WebBlobData::Item::TypeData:
+            if (item.data.size()) {
+                Slice slice;
+                slice.segment = new ThreadSafeDataSegment(item.data);
+                slice.offset = 0;
+                slice.length = item.data.size();
+                slice.storage = MemoryStorage;
+                contents->append(slice);
+            }
+            break;
+        case WebBlobData::Item::TypeFile: {
+            base::PlatformFileInfo info;
+            if (!base::GetFileInfo(item.filePath, &info) || !appendFile(item.filePath, info, item, contents.get()))
+                contents->broken = true;
+            break;
+        }
+        case WebBlobData::Item::TypeFileSystemURL: {
+            // Resolved, and statted from its metadata cache, by the file
+            // system the URL names. The lock keeps the file system from
+            // going away meanwhile; it never calls back in holding its own.
+            base::FilePath path;
+            base::PlatformFileInfo info;
+            base::AutoLock locker(m_lock);
+            if (!m_fileSystem || !m_fileSystem->pathForURL(item.fileSystemURL, &path)
+                    || !m_fileSystem->fileInfo(path, &info) || !appendFile(path, info, item, contents.get()))
+                contents->broken = true;
+            break;
+        }
+        case WebBlobData::Item::TypeBlob: {
+            base::AutoLock locker(m_lock);
+            appendBlob(item.blobUUID, item.offset, item.length, contents.get());
+            break;
+        }
+        default:
+            // An item type this registry doesn't know.
+            contents->broken = true;
+            break;
+        }
+    }
+
+    return contents;
+}
+
+void WebBlobRegistryImpl::resolve(const std::string& uuid, const std::string& contentType, const std::vector<Item>& items)
+{
+    TRACE_EVENT0("webui", "WebBlobRegistryImpl::resolve");
+    scoped_refptr<Contents> contents = buildContents(contentType, items);
+    base::AutoLock locker(m_lock);
+    install(uuid, contents);
+}
+
+void WebBlobRegistryImpl::install(const std::string& uuid, scoped_refptr<Contents> contents)
+{
+    m_lock.AssertAcquired();
+    std::map<std::string, Entry>::iterator blob = m_blobs.find(uuid);
+    // Released while it was pending.
+    if (blob == m_blobs.end())
+        return;
+    Entry& entry = blob->second;
+    bool wasPending = entry.pending;
+    entry.contents = contents;
+    entry.pending = false;
+    addTotals(contents.get(), 1);
+    if (wasPending)
+        m_resolved.Broadcast();
+
+    if (m_spillThreshold > 0 && contents->memoryBytes > m_spillThreshold) {
+        m_thread.message_loop_proxy()->PostTask(FROM_HERE,
+            base::Bind(&WebBlobRegistryImpl::spill, base::Unretained(this), uuid));
+    }
+}
+
+WebBlobRegistryImpl::Entry* WebBlobRegistryImpl::findResolved(const std::string& uuid)
+{
+    m_lock.AssertAcquired();
+    while (true) {
+        std::map<std::string, Entry>::iterator blob = m_blobs.find(uuid);
+        if (blob == m_blobs.end())
+            return 0;
+        if (!blob->second.pending)
+            return &blob->second;
+        // Never on the registry thread, which is the one that would wake us.
+        m_resolved.Wait();
+    }
+}
+
+void WebBlobRegistryImpl::addBlobDataRef(const WebString& uuid)
+{
+    base::AutoLock locker(m_lock);
+    std::map<std::string, Entry>::iterator blob = m_blobs.find(uuid.utf8());
+    if (blob != m_blobs.end())
+        ++blob->second.refs;
+}
+
+void WebBlobRegistryImpl::removeBlobDataRef(const WebString& uuid)
+{
+    base::AutoLock locker(m_lock);
+    release(uuid.utf8());
+}
+
+void WebBlobRegistryImpl::registerPublicBlobURL(const WebURL& url, const WebString& uuid)
+{
+    base::AutoLock locker(m_lock);
+    std::string key = publicURLKey(url);
+    std::map<std::string, Entry>::iterator blob = m_blobs.find(uuid.utf8());
+    if (blob == m_blobs.end() || m_publicURLs.count(key))
+        return;
+    // The URL keeps the blob alive until it is revoked.
+    ++blob->second.refs;
+    m_publicURLs[key] = blob->first;
+}
+
+void WebBlobRegistryImpl::revokePublicBlobURL(const WebURL& url)
+{
+    base::AutoLock locker(m_lock);
+    std::map<std::string, std::string>::iterator publicURL = m_publicURLs.find(publicURLKey(url));
+    if (publicURL == m_publicURLs.end())
+        return;
+    std::string uuid = publicURL->second;
+    m_publicURLs.erase(publicURL);
+    release(uuid);
+}
+
+void WebBlobRegistryImpl::appendBlob(const std::string& uuid, int64 offset, int64 length, Contents* contents)
+{
+    m_lock.AssertAcquired();
+    std::map<std::string, Entry>::const_iterator blob = m_blobs.find(uuid);
+    int64 start, end;
+    // A pending source was resolved first on the registry thread, and the
+    // main thread sends a blob built from one there.
+    if (blob == m_blobs.end() || blob->second.pending || blob->second.contents->broken
+            || !clampRange(blob->second.contents->size, offset, length, &start, &end)) {
+        contents->broken = true;
+        return;
+    }
+
+    // Copy the slices that overlap [start, end), trimmed to it.
+    const std::vector<Slice>& slices = blob->second.contents->slices;
+    int64 sliceStart = 0;
+    for (size_t i = 0; i < slices.size() && sliceStart < end; ++i) {
+        int64 sliceEnd = sliceStart + slices[i].length;
+        if (sliceEnd > start) {
+            Slice slice = slices[i];
+            int64 from = std::max(start, sliceStart);
+            int64 to = std::min(end, sliceEnd);
+            slice.offset += static_cast<size_t>(from - sliceStart);
+            slice.length = static_cast<size_t>(to - from);
+            contents->append(slice);
+        }
+        sliceStart = sliceEnd;
+    }
+}
+
+void WebBlobRegistryImpl::release(const std::string& uuid)
+{
+    m_lock.AssertAcquired();
+    std::map<std::string, Entry>::iterator blob = m_blobs.find(uuid);
+    if (blob == m_blobs.end() || --blob->second.refs > 0)
+        return;
+    if (blob->second.contents)
+        addTotals(blob->second.contents.get(), -1);
+    m_blobs.erase(blob);
+}
+
+void WebBlobRegistryImpl::addTotals(const Contents* contents, int sign)
+{
+    m_lock.AssertAcquired();
+    m_memoryBytes += sign * contents->memoryBytes;
+    m_spilledBytes += sign * contents->spilledBytes;
+}
+
+void WebBlobRegistryImpl::spill(const std::string& uuid)
+{
+    TRACE_EVENT0("webui", "WebBlobRegistryImpl::spill");
+    scoped_refptr<Contents> contents;
+    {
+        base::AutoLock locker(m_lock);
+        std::map<std::string, Entry>::const_iterator blob = m_blobs.find(uuid);
+        if (blob == m_blobs.end())
+            return;
+        contents = blob->second.contents;
+    }
+
+    base::FilePath directory = spillDirectory();
+    if (directory.empty())
+        return;
+
+    // Write the in-memory slices, in order, to as many files as it takes.
+    // Each slice is pointed at its file's mapping once the file is done.
+    std::vector<Slice> slices = contents->slices;
+    std::vector<size_t> pending;
+    base::PlatformFile file = base::kInvalidPlatformFileValue;
+    base::FilePath path;
+    int64 fileSize = 0;
+    bool failed = false;
+    for (size_t i = 0; i < slices.size() && !failed; ++i) {
+        Slice& slice = slices[i];
+        if (slice.storage != MemoryStorage)
+            continue;
+
+        if (file != base::kInvalidPlatformFileValue && fileSize + static_cast<int64>(slice.length) > maxSpillFileSize) {
+            failed = !finishSpillFile(file, path, &pending, &slices);
+            file = base::kInvalidPlatformFileValue;
+            if (failed)
+                break;
+        }
+        if (file == base::kInvalidPlatformFileValue) {
+            path = directory.AppendASCII(base::StringPrintf("blob-%d", m_spillFiles++));
+            file = base::CreatePlatformFile(path, base::PLATFORM_FILE_CREATE_ALWAYS | base::PLATFORM_FILE_WRITE, NULL, NULL);
+            fileSize = 0;
+            if (file == base::kInvalidPlatformFileValue) {
+                failed = true;
+                break;
+            }
+        }
+
+        if (!writeAll(file, slice.segment->data() + slice.offset, slice.length)) {
+            failed = true;
+            break;
+        }
+        slice.offset = static_cast<size_t>(fileSize);
+        fileSize += slice.length;
+        pending.push_back(i);
+    }
+    if (file != base::kInvalidPlatformFileValue) {
+        if (failed) {
+            base::ClosePlatformFile(file);
+            base::DeleteFile(path, false);
+        } else {
+            failed = !finishSpillFile(file, path, &pending, &slices);
+        }
+    }
+    if (failed) {
+        // The blob stays in memory; files already mapped go with |slices|.
+        LOG(WARNING) << "can't spill blob " << uuid << " to " << directory.value();
+        return;
+    }
+
+    scoped_refptr<Contents> spilled = new Contents;
+    spilled->contentType = contents->contentType;
+    spilled->broken = contents->broken;
+    for (size_t i = 0; i < slices.size(); ++i)
+        spilled->append(slices[i]);
+
+    base::AutoLock locker(m_lock);
+    std::map<std::string, Entry>::iterator blob = m_blobs.find(uuid);
+    // Released, or registered again, while it was being written.
+    if (blob == m_blobs.end() || blob->second.contents != contents)
+        return;
+    addTotals(contents.get(), -1);
+    blob->second.contents = spilled;
+    addTotals(spilled.get(), 1);
+}
+
+base::FilePath WebBlobRegistryImpl::spillDirectory()
+{
+    // One directory per process, since several may share a temp directory.
+    if (m_spillDirectory.empty() && !base::CreateNewTempDirectory(FILE_PATH_LITERAL("webUIBlobs"), &m_spillDirectory)) {
+        LOG(WARNING) << "can't create a directory for blob spill files";
+        m_spillDirectory.clear();
+    }
+    return m_spillDirectory;
+}
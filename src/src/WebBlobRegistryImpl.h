@@ -0,0 +1,181 @@
+#ifndef WebBlobRegistryImpl_h
+#define WebBlobRegistryImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+
+#include "../../platform/WebBlobRegistry.h"
+
+#include "URLLoaderEngine.h"
+
+using namespace blink;
+
+class WebFileSystemImpl;
+
+// Blob contents for Blink, and the blob: URLs that read them.
+//
+// A blob is a list of slices of immutable, refcounted segments (the same
+// URLResponseBody the loader hands to the main thread). Data items keep
+// Blink's own buffers, and a blob built from other blobs, as Blob.slice()
+// and the Blob constructor do, only copies their slice lists, so no
+// operation copies bytes. A blob: request is answered with the slices
+// themselves.
+//
+// Files, including those of the sandboxed file systems, are only statted
+// when they are registered, and then on the registry thread: a blob with
+// file items, or built from such a blob, is pending until that thread has
+// built its contents, and readers of it wait. A file slice records the
+// path, range and modification time, and whoever reads it (the loader
+// thread, or a file writer) maps just that range; a file modified since
+// fails the read.
+//
+// Once a blob holds more than the spill threshold in memory, the registry
+// thread writes those bytes to temporary files, maps them, and swaps the
+// blob's slices for ones over the mappings. The kernel can then drop the
+// pages, and readers still holding the old slices keep them alive until
+// they are done.
+//
+// All methods may be called on any thread.
+class WebBlobRegistryImpl : public blink::WebBlobRegistry
+{
+public:
+    static const int64 defaultSpillThreshold = 16 * 1024 * 1024;
+
+    explicit WebBlobRegistryImpl(int64 spillThreshold = defaultSpillThreshold);
+    virtual ~WebBlobRegistryImpl();
+
+    // Blobs registered later spill once their in-memory bytes exceed
+    // |bytes|; 0 keeps every blob in memory.
+    void setSpillThreshold(int64 bytes);
+
+    // A handler for the blob: scheme, for URLLoaderEngine. The registry must
+    // outlive it.
+    URLSchemeHandler* createSchemeHandler();
+
+    // filesystem: items are resolved through |fileSystem|, or break the
+    // blob while there is none. WebFileSystemImpl sets and clears itself.
+    void setFileSystem(WebFileSystemImpl* fileSystem);
+
+    // Bytes held in memory and in spill files by all blobs, counting shared
+    // slices once per blob.
+    int64 memoryBytes();
+    int64 spilledBytes();
+
+    // WebBlobRegistry methods:
+    virtual void registerBlobData(const WebString& uuid, const WebBlobData&);
+    virtual void addBlobDataRef(const WebString& uuid);
+    virtual void removeBlobDataRef(const WebString& uuid);
+    virtual void registerPublicBlobURL(const WebURL&, const WebString& uuid);
+    virtual void revokePublicBlobURL(const WebURL&);
+
+    enum Storage {
+        MemoryStorage,
+        FileStorage,   // A file the page chose, read when it is served.
+        SpillStorage   // A mapping of a spill file.
+    };
+
+    struct Slice {
+        // Null for FileStorage, whose |offset| is into the file at |path|.
+        scoped_refptr<URLResponseBody> segment;
+        size_t offset;
+        size_t length;
+        Storage storage;
+        base::FilePath path;
+        base::Time modificationTime;
+    };
+
+    // Off the main thread. Sets |segment| to the bytes of |slice|: part of
+    // its own segment, or a mapping of its range of the file. Returns a net
+    // error code, net::ERR_UPLOAD_FILE_CHANGED if the file was modified
+    // after the blob was registered.
+    static int openSlice(const Slice&, scoped_refptr<URLResponseBody>* segment);
+
+    // An item of a WebBlobData, copied into types any thread may use.
+    struct Item;
+
+    // A blob's bytes. Immutable once registered; spilling replaces it.
+    class Contents : public base::RefCountedThreadSafe<Contents>
+    {
+    public:
+        Contents();
+
+        void append(const Slice&);
+
+        std::string contentType;
+        std::vector<Slice> slices;
+        int64 size;
+        int64 memoryBytes;
+        int64 spilledBytes;
+        // A file or blob it was built from could not be read.
+        bool broken;
+
+    private:
+        friend class base::RefCountedThreadSafe<Contents>;
+        ~Contents();
+    };
+
+    // Off the main thread; both wait for a pending blob. The contents a
+    // blob: URL refers to, or null.
+    scoped_refptr<Contents> contentsForURL(const GURL&);
+    // The contents of the blob |uuid|, or null.
+    scoped_refptr<Contents> contentsForUUID(const std::string& uuid);
+
+private:
+    struct Entry {
+        Entry();
+
+        // Null while pending.
+        scoped_refptr<Contents> contents;
+        int refs;
+        bool pending;
+    };
+
+    scoped_refptr<Contents> buildContents(const std::string& contentType, const std::vector<Item>&);
+
+    // Called with m_lock held.
+    void appendBlob(const std::string& uuid, int64 offset, int64 length, Contents*);
+    void install(const std::string& uuid, scoped_refptr<Contents>);
+    Entry* findResolved(const std::string& uuid);
+    void release(const std::string& uuid);
+    void addTotals(const Contents*, int sign);
+
+    // Registry thread.
+    void resolve(const std::string& uuid, const std::string& contentType, const std::vector<Item>&);
+    void spill(const std::string& uuid);
+    base::FilePath spillDirectory();
+
+    base::Lock m_lock;
+    // Signalled, with |m_lock|, when a pending blob gets its contents.
+    base::ConditionVariable m_resolved;
+    std::map<std::string, Entry> m_blobs;
+    // Public URL spec to uuid.
+    std::map<std::string, std::string> m_publicURLs;
+    int64 m_spillThreshold;
+    int64 m_memoryBytes;
+    int64 m_spilledBytes;
+    WebFileSystemImpl* m_fileSystem;
+
+    // Registry thread.
+    base::FilePath m_spillDirectory;
+    int m_spillFiles;
+
+    base::Thread m_thread;
+
+    DISALLOW_COPY_AND_ASSIGN(WebBlobRegistryImpl);
+};
+
+
+#endif // WebBlobRegistryImpl_h
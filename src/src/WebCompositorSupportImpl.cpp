@@ -0,0 +1,85 @@
+
+#include "WebCompositorSupportImpl.h"
+
+#include "base/message_loop/message_loop_proxy.h"
+
+#include "WebAnimationImpl.h"
+#include "WebLayerImpl.h"
+
+
+WebCompositorSupportImpl::WebCompositorSupportImpl()
+    : m_thread("Compositor")
+{
+    m_thread.Start();
+}
+
+WebCompositorSupportImpl::~WebCompositorSupportImpl()
+{
+}
+
+scoped_refptr<base::MessageLoopProxy> WebCompositorSupportImpl::compositorLoop() const
+{
+    return m_thread.message_loop_proxy();
+}
+
+bool WebCompositorSupportImpl::isThreadingEnabled()
+{
+    return true;
+}
+
+WebLayer* WebCompositorSupportImpl::createLayer()
+{
+    return new WebLayerImpl;
+}
+
+WebContentLayer* WebCompositorSupportImpl::createContentLayer(WebContentLayerClient* client)
+{
+    return new WebContentLayerImpl(client);
+}
+
+WebImageLayer* WebCompositorSupportImpl::createImageLayer()
+{
+    return new WebImageLayerImpl;
+}
+
+WebSolidColorLayer* WebCompositorSupportImpl::createSolidColorLayer()
+{
+    return new WebSolidColorLayerImpl;
+}
+
+WebScrollbarLayer* WebCompositorSupportImpl::createScrollbarLayer(WebScrollbar* scrollbar, WebScrollbarThemePainter painter,
+                                                                  WebScrollbarThemeGeometry* geometry)
+{
+    return new WebScrollbarLayerImpl(scrollbar, painter, geometry);
+}
+
+WebScrollbarLayer* WebCompositorSupportImpl::createSolidColorScrollbarLayer(WebScrollbar::Orientation, int, bool)
+{
+    return new WebScrollbarLayerImpl(0, WebScrollbarThemePainter(), 0);
+}
+
+WebAnimation* WebCompositorSupportImpl::createAnimation(const WebAnimationCurve&, WebAnimation::TargetProperty targetProperty,
+                                                        int animationId)
+{
+    return new WebAnimationImpl(targetProperty, animationId);
+}
+
+WebFloatAnimationCurve* WebCompositorSupportImpl::createFloatAnimationCurve()
+{
+    return new WebFloatAnimationCurveImpl;
+}
+
+WebTransformAnimationCurve* WebCompositorSupportImpl::createTransformAnimationCurve()
+{
+    return new WebTransformAnimationCurveImpl;
+}
+
+WebFilterOperations* WebCompositorSupportImpl::createFilterOperations()
+{
+    return new WebFilterOperationsImpl;
+}
+
+WebTransformOperations* WebCompositorSupportImpl::createTransformOperations()
+{
+    return new WebTransformOperationsImpl;
+}
@@ -0,0 +1,52 @@
+#ifndef WebCompositorSupportImpl_h
+#define WebCompositorSupportImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/memory/ref_counted.h"
+#include "base/threading/thread.h"
+
+#include "../../platform/WebCompositorSupport.h"
+
+using namespace blink;
+
+namespace base {
+    class MessageLoopProxy;
+}
+
+// Hands Blink the layers of the software compositor (see
+// WebLayerTreeViewImpl) and owns the thread it composites on. Scrollbar
+// layers are painted like content layers, and the animation objects only
+// let Blink offer animations that the layers then refuse (see
+// WebAnimationImpl), so those run on the main thread.
+class WebCompositorSupportImpl : public blink::WebCompositorSupport
+{
+public:
+    WebCompositorSupportImpl();
+    virtual ~WebCompositorSupportImpl();
+
+    scoped_refptr<base::MessageLoopProxy> compositorLoop() const;
+
+    // WebCompositorSupport methods:
+    virtual bool isThreadingEnabled();
+    virtual WebLayer* createLayer();
+    virtual WebContentLayer* createContentLayer(WebContentLayerClient*);
+    virtual WebImageLayer* createImageLayer();
+    virtual WebSolidColorLayer* createSolidColorLayer();
+    virtual WebScrollbarLayer* createScrollbarLayer(WebScrollbar*, WebScrollbarThemePainter, WebScrollbarThemeGeometry*);
+    virtual WebScrollbarLayer* createSolidColorScrollbarLayer(WebScrollbar::Orientation, int thumbThickness,
+                                                              bool isLeftSideVerticalScrollbar);
+    virtual WebAnimation* createAnimation(const WebAnimationCurve&, WebAnimation::TargetProperty, int animationId);
+    virtual WebFloatAnimationCurve* createFloatAnimationCurve();
+    virtual WebTransformAnimationCurve* createTransformAnimationCurve();
+    virtual WebFilterOperations* createFilterOperations();
+    virtual WebTransformOperations* createTransformOperations();
+
+private:
+    base::Thread m_thread;
+};
+
+
+#endif // WebCompositorSupportImpl_h
@@ -0,0 +1,471 @@
+
+#include "WebCookieJarImpl.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/pickle.h"
+#include "base/time/time.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "net/cookies/cookie_options.h"
+
+#include "../../platform/WebCookie.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebURL.h"
+#include "../../platform/WebVector.h"
+
+
+namespace
+{
+
+    const char logMagic[] = "WUCK0001";
+    const size_t logMagicLength = sizeof(logMagic) - 1;
+
+    enum RecordType {
+        SetRecord = 1,
+        DeleteRecord = 2
+    };
+
+    // Browsers keep about this many per site; the oldest goes first.
+    const size_t maxCookiesPerDomain = 180;
+
+    // Small logs are never compacted.
+    const int64 minCompactionRecords = 256;
+
+    // Cookies are grouped by the registrable domain of their domain, so
+    // that every cookie a host can see is in one group.
+    std::string domainKey(const std::string& domain)
+    {
+        std::string host = domain;
+        if (!host.empty() && host[0] == '.')
+            host.erase(0, 1);
+        std::string key = net::registry_controlled_domains::GetDomainAndRegistry(
+            host, net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+        // IP addresses, localhost and the like are their own group.
+        return key.empty() ? host : key;
+    }
+
+    // The order of the Cookie header: longer paths first, then older.
+    bool headerOrder(const net::CanonicalCookie& a, const net::CanonicalCookie& b)
+    {
+        if (a.Path().length() != b.Path().length())
+            return a.Path().length() > b.Path().length();
+        return a.CreationDate() < b.CreationDate();
+    }
+
+    bool olderThan(const net::CanonicalCookie& a, const net::CanonicalCookie& b)
+    {
+        return a.CreationDate() < b.CreationDate();
+    }
+
+    void appendCookie(const net::CanonicalCookie& cookie, std::string* line)
+    {
+        if (!line->empty())
+            line->append("; ");
+        // A cookie set as "value" alone has an empty name and is sent bare.
+        if (!cookie.Name().empty()) {
+            line->append(cookie.Name());
+            line->push_back('=');
+        }
+        line->append(cookie.Value());
+    }
+
+    net::CookieOptions cookieOptions(bool includeHttpOnly)
+    {
+        net::CookieOptions options;
+        if (includeHttpOnly)
+            options.set_include_httponly();
+        return options;
+    }
+
+    void writeSetRecord(const net::CanonicalCookie& cookie, Pickle* record)
+    {
+        record->WriteInt(SetRecord);
+        record->WriteString(cookie.Name());
+        record->WriteString(cookie.Value());
+        record->WriteString(cookie.Domain());
+        record->WriteString(cookie.Path());
+        record->WriteInt64(cookie.CreationDate().ToInternalValue());
+        record->WriteInt64(cookie.ExpiryDate().ToInternalValue());
+        record->WriteBool(cookie.IsSecure());
+        record->WriteBool(cookie.IsHttpOnly());
+        record->WriteInt(cookie.Priority());
+    }
+
+    bool writeFileAtomically(const base::FilePath& path, const std::string& data)
+    {
+        base::FilePath temp = path.AddExtension(FILE_PATH_LITERAL("tmp"));
+        if (file_util::WriteFile(temp, data.data(), static_cast<int>(data.size())) != static_cast<int>(data.size())) {
+            base::DeleteFile(temp, false);
+            return false;
+        }
+        return base::Move(temp, path);
+    }
+
+}
+
+WebCookieJarImpl::WebCookieJarImpl(const base::FilePath& logPath)
+    : m_logPath(logPath)
+    , m_replaying(false)
+    , m_logRecords(0)
+    , m_writeScheduled(false)
+    , m_compactionThreshold(minCompactionRecords)
+    , m_thread("CookieJar")
+{
+    if (m_logPath.empty())
+        return;
+    load();
+    m_thread.Start();
+    base::AutoLock locker(m_logLock);
+    if (!m_pendingRecords.empty())
+        scheduleWrite();
+}
+
+WebCookieJarImpl::~WebCookieJarImpl()
+{
+    // Writes whatever is still queued.
+    m_thread.Stop();
+}
+
+WebCookieJarImpl::Shard& WebCookieJarImpl::shardFor(const std::string& key)
+{
+    return m_shards[base::Hash(key) % shardCount];
+}
+
+void WebCookieJarImpl::setCookieFromResponse(const GURL& url, const std::string& cookieLine)
+{
+    scoped_ptr<net::CanonicalCookie> cookie(
+        net::CanonicalCookie::Create(url, cookieLine, base::Time::Now(), cookieOptions(true)));
+    if (cookie)
+        store(*cookie, false);
+}
+
+std::string WebCookieJarImpl::requestHeaderValue(const GURL& url)
+{
+    return cookieLine(url, true);
+}
+
+size_t WebCookieJarImpl::cookieCount()
+{
+    size_t count = 0;
+    for (size_t i = 0; i < shardCount; ++i) {
+        base::AutoLock locker(m_shards[i].lock);
+        std::map<std::string, CookieList>::const_iterator it = m_shards[i].domains.begin();
+        for (; it != m_shards[i].domains.end(); ++it)
+            count += it->second.size();
+    }
+    return count;
+}
+
+int64 WebCookieJarImpl::logRecordCount()
+{
+    base::AutoLock locker(m_logLock);
+    return m_logRecords;
+}
+
+void WebCookieJarImpl::setCookie(const WebURL& url, const WebURL&, const WebString& cookie)
+{
+    // Script can't set HttpOnly cookies.
+    scoped_ptr<net::CanonicalCookie> canonical(
+        net::CanonicalCookie::Create(url, cookie.utf8(), base::Time::Now(), cookieOptions(false)));
+    if (canonical)
+        store(*canonical, true);
+}
+
+WebString WebCookieJarImpl::cookies(const WebURL& url, const WebURL&)
+{
+    return WebString::fromUTF8(cookieLine(url, false));
+}
+
+WebString WebCookieJarImpl::cookieRequestHeaderFieldValue(const WebURL& url, const WebURL&)
+{
+    return WebString::fromUTF8(cookieLine(url, true));
+}
+
+void WebCookieJarImpl::rawCookies(const WebURL& url, const WebURL&, WebVector<WebCookie>& rawCookies)
+{
+    CookieList cookies;
+    matching(url, true, &cookies);
+    WebVector<WebCookie> result(cookies.size());
+    for (size_t i = 0; i < cookies.size(); ++i) {
+        const net::CanonicalCookie& cookie = cookies[i];
+        result[i] = WebCookie(WebString::fromUTF8(cookie.Name()), WebString::fromUTF8(cookie.Value()),
+                              WebString::fromUTF8(cookie.Domain()), WebString::fromUTF8(cookie.Path()),
+                              cookie.ExpiryDate().ToDoubleT() * 1000, cookie.IsHttpOnly(), cookie.IsSecure(),
+                              !cookie.IsPersistent());
+    }
+    rawCookies.swap(result);
+}
+
+void WebCookieJarImpl::deleteCookie(const WebURL& url, const WebString& cookieName)
+{
+    std::string name = cookieName.utf8();
+    CookieList cookies;
+    matching(url, true, &cookies);
+    for (size_t i = 0; i < cookies.size(); ++i) {
+        if (cookies[i].Name() != name)
+            continue;
+        // Storing an expired copy removes the cookie.
+        net::CanonicalCookie expired(GURL(), cookies[i].Name(), std::string(), cookies[i].Domain(),
+                                     cookies[i].Path(), cookies[i].CreationDate(), base::Time::UnixEpoch(),
+                                     cookies[i].CreationDate(), false, false, net::COOKIE_PRIORITY_DEFAULT);
+        store(expired, false);
+    }
+}
+
+bool WebCookieJarImpl::cookiesEnabled(const WebURL&, const WebURL&)
+{
+    return true;
+}
+
+void WebCookieJarImpl::store(const net::CanonicalCookie& cookie, bool fromScript)
+{
+    std::string key = domainKey(cookie.Domain());
+    Shard& shard = shardFor(key);
+    base::Time now = base::Time::Now();
+
+    base::AutoLock locker(shard.lock);
+    CookieList& cookies = shard.domains[key];
+    bool keep = !cookie.IsExpired(now);
+    for (size_t i = 0; i < cookies.size();) {
+        const net::CanonicalCookie& existing = cookies[i];
+        if (existing.IsEquivalent(cookie)) {
+            if (fromScript && existing.IsHttpOnly())
+                return;
+            // A persistent replacement overwrites the record on replay.
+            if (existing.IsPersistent() && !(keep && cookie.IsPersistent()))
+                logDelete(existing);
+        } else if (!existing.IsExpired(now)) {
+            ++i;
+            continue;
+        }
+        // Expired cookies are dropped on the way; replay skips them too.
+        cookies.erase(cookies.begin() + i);
+    }
+
+    if (keep) {
+        if (cookies.size() >= maxCookiesPerDomain) {
+            CookieList::iterator oldest = std::min_element(cookies.begin(), cookies.end(), olderThan);
+            if (oldest->IsPersistent())
+                logDelete(*oldest);
+            cookies.erase(oldest);
+        }
+        cookies.insert(std::upper_bound(cookies.begin(), cookies.end(), cookie, headerOrder), cookie);
+        if (cookie.IsPersistent())
+            logSet(cookie);
+    }
+    if (cookies.empty())
+        shard.domains.erase(key);
+}
+
+void WebCookieJarImpl::matching(const GURL& url, bool includeHttpOnly, CookieList* cookies)
+{
+    if (!url.is_valid() || !url.has_host())
+        return;
+    std::string key = domainKey(url.host());
+    Shard& shard = shardFor(key);
+    net::CookieOptions options = cookieOptions(includeHttpOnly);
+    base::Time now = base::Time::Now();
+
+    base::AutoLock locker(shard.lock);
+    std::map<std::string, CookieList>::const_iterator found = shard.domains.find(key);
+    if (found == shard.domains.end())
+        return;
+    const CookieList& candidates = found->second;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!candidates[i].IsExpired(now) && candidates[i].IncludeForRequestURL(url, options))
+            cookies->push_back(candidates[i]);
+    }
+}
+
+std::string WebCookieJarImpl::cookieLine(const GURL& url, bool includeHttpOnly)
+{
+    std::string line;
+    if (!url.is_valid() || !url.has_host())
+        return line;
+    std::string key = domainKey(url.host());
+    Shard& shard = shardFor(key);
+    net::CookieOptions options = cookieOptions(includeHttpOnly);
+    base::Time now = base::Time::Now();
+
+    base::AutoLock locker(shard.lock);
+    std::map<std::string, CookieList>::const_iterator found = shard.domains.find(key);
+    if (found == shard.domains.end())
+        return line;
+    const CookieList& candidates = found->second;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!candidates[i].IsExpired(now) && candidates[i].IncludeForRequestURL(url, options))
+            appendCookie(candidates[i], &line);
+    }
+    return line;
+}
+
+void WebCookieJarImpl::logSet(const net::CanonicalCookie& cookie)
+{
+    Pickle record;
+    writeSetRecord(cookie, &record);
+    queueRecord(record);
+}
+
+void WebCookieJarImpl::logDelete(const net::CanonicalCookie& cookie)
+{
+    Pickle record;
+    record.WriteInt(DeleteRecord);
+    record.WriteString(cookie.Name());
+    record.WriteString(cookie.Domain());
+    record.WriteString(cookie.Path());
+    queueRecord(record);
+}
+
+void WebCookieJarImpl::queueRecord(const Pickle& record)
+{
+    if (m_logPath.empty() || m_replaying)
+        return;
+    base::AutoLock locker(m_logLock);
+    m_pendingRecords.append(static_cast<const char*>(record.data()), record.size());
+    ++m_logRecords;
+    scheduleWrite();
+}
+
+void WebCookieJarImpl::scheduleWrite()
+{
+    // One write task drains everything queued until it runs.
+    if (m_writeScheduled || !m_thread.IsRunning())
+        return;
+    m_writeScheduled = true;
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE,
+        base::Bind(&WebCookieJarImpl::writePendingRecords, base::Unretained(this)));
+}
+
+void WebCookieJarImpl::load()
+{
+    TRACE_EVENT0("webui", "WebCookieJarImpl::load");
+    std::string data;
+    if (!base::ReadFileToString(m_logPath, &data) || data.compare(0, logMagicLength, logMagic, logMagicLength)) {
+        // Missing or not ours: start an empty log.
+        if (!base::CreateDirectory(m_logPath.DirName())
+                || !writeFileAtomically(m_logPath, std::string(logMagic, logMagicLength)))
+            LOG(WARNING) << "Cookie log at " << m_logPath.value() << " is unavailable";
+        return;
+    }
+
+    m_replaying = true;
+    base::Time now = base::Time::Now();
+    const char* end = data.data() + data.size();
+    const char* next = data.data() + logMagicLength;
+    while (next < end) {
+        const char* recordEnd = Pickle::FindNext(sizeof(Pickle::Header), next, end);
+        if (!recordEnd)
+            break;
+        Pickle record(next, static_cast<int>(recordEnd - next));
+        next = recordEnd;
+        ++m_logRecords;
+
+        PickleIterator iter(record);
+        int type;
+        std::string name, value, domain, path;
+        int64 creation = 0;
+        int64 expiry = base::Time::UnixEpoch().ToInternalValue();
+        bool secure = false;
+        bool httpOnly = false;
+        int priority = net::COOKIE_PRIORITY_DEFAULT;
+        if (!record.ReadInt(&iter, &type) || !record.ReadString(&iter, &name))
+            continue;
+        if (type == SetRecord) {
+            if (!record.ReadString(&iter, &value) || !record.ReadString(&iter, &domain)
+                    || !record.ReadString(&iter, &path) || !record.ReadInt64(&iter, &creation)
+                    || !record.ReadInt64(&iter, &expiry) || !record.ReadBool(&iter, &secure)
+                    || !record.ReadBool(&iter, &httpOnly) || !record.ReadInt(&iter, &priority))
+                continue;
+            if (priority < net::COOKIE_PRIORITY_LOW || priority > net::COOKIE_PRIORITY_HIGH)
+                priority = net::COOKIE_PRIORITY_DEFAULT;
+        } else if (type != DeleteRecord || !record.ReadString(&iter, &domain) || !record.ReadString(&iter, &path)) {
+            continue;
+        }
+        // A delete is replayed as an expired cookie.
+        base::Time created = base::Time::FromInternalValue(creation);
+        net::CanonicalCookie cookie(GURL(), name, value, domain, path, created,
+                                    base::Time::FromInternalValue(expiry), created, secure, httpOnly,
+                                    static_cast<net::CookiePriority>(priority));
+        if (type == SetRecord && cookie.IsExpired(now))
+            continue;
+        store(cookie, false);
+    }
+    m_replaying = false;
+
+    // A torn record at the end, left by a crash, must not have further
+    // records appended after it.
+    if (next != end || m_logRecords > m_compactionThreshold)
+        compact();
+}
+
+void WebCookieJarImpl::writePendingRecords()
+{
+    std::string records;
+    int64 logRecords;
+    {
+        base::AutoLock locker(m_logLock);
+        records.swap(m_pendingRecords);
+        logRecords = m_logRecords;
+        m_writeScheduled = false;
+    }
+    if (records.empty())
+        return;
+
+    TRACE_EVENT1("webui", "WebCookieJarImpl::writePendingRecords", "bytes", records.size());
+    int size = static_cast<int>(records.size());
+    if (file_util::AppendToFile(m_logPath, records.data(), size) != size)
+        LOG(WARNING) << "Failed to append to the cookie log at " << m_logPath.value();
+
+    if (logRecords > m_compactionThreshold)
+        compact();
+}
+
+// Rewrites the log as one set record per live persistent cookie. Records
+// queued while the shards are read describe changes the snapshot may
+// already hold; they stay queued, and replaying them again is harmless.
+void WebCookieJarImpl::compact()
+{
+    TRACE_EVENT0("webui", "WebCookieJarImpl::compact");
+    {
+        // Everything queued so far is in the shards already.
+        base::AutoLock locker(m_logLock);
+        m_pendingRecords.clear();
+        m_logRecords = 0;
+    }
+
+    std::string data(logMagic, logMagicLength);
+    int64 records = 0;
+    base::Time now = base::Time::Now();
+    for (size_t i = 0; i < shardCount; ++i) {
+        base::AutoLock locker(m_shards[i].lock);
+        std::map<std::string, CookieList>::const_iterator it = m_shards[i].domains.begin();
+        for (; it != m_shards[i].domains.end(); ++it) {
+            for (size_t j = 0; j < it->second.size(); ++j) {
+                const net::CanonicalCookie& cookie = it->second[j];
+                if (!cookie.IsPersistent() || cookie.IsExpired(now))
+                    continue;
+                Pickle record;
+                writeSetRecord(cookie, &record);
+                data.append(static_cast<const char*>(record.data()), record.size());
+                ++records;
+            }
+        }
+    }
+
+    bool compacted = writeFileAtomically(m_logPath, data);
+    base::AutoLock locker(m_logLock);
+    m_logRecords += records;
+    m_compactionThreshold = std::max(minCompactionRecords, m_logRecords * 2);
+    if (!compacted) {
+        // The old log is still in place; append the snapshot to it instead.
+        LOG(WARNING) << "Failed to compact the cookie log at " << m_logPath.value();
+        m_pendingRecords.insert(0, data, logMagicLength, std::string::npos);
+        scheduleWrite();
+    }
+}
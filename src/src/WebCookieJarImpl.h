@@ -0,0 +1,119 @@
+#ifndef WebCookieJarImpl_h
+#define WebCookieJarImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+#include "net/cookies/canonical_cookie.h"
+#include "url/gurl.h"
+
+#include "../../platform/WebCookieJar.h"
+
+using namespace blink;
+
+class Pickle;
+
+// Cookies for every frame, shared by Blink and the URL loader.
+//
+// The store is split into shards by registrable domain ("example.co.uk" for
+// "a.b.example.co.uk"), each behind its own lock, so lookups for different
+// sites never contend. Within a shard each registrable domain keeps its
+// cookies in one vector, already in Cookie header order (longer paths
+// first, then older), so cookies() is a single locked scan of the cookies
+// that can possibly match.
+//
+// Persistent cookies are kept in an append-only log: every change is queued
+// as a record and written by the jar thread, many records per write, and
+// the log is rewritten from the live cookies once it has grown to twice
+// their number. The log is read once by the constructor; after that reads
+// never touch the disk. Session cookies are never written.
+class WebCookieJarImpl : public blink::WebCookieJar
+{
+public:
+    // |logPath| may be empty for a jar that keeps nothing across runs.
+    explicit WebCookieJarImpl(const base::FilePath& logPath);
+    virtual ~WebCookieJarImpl();
+
+    // Any thread. |cookieLine| is the value of one Set-Cookie header.
+    void setCookieFromResponse(const GURL&, const std::string& cookieLine);
+
+    // Any thread. The Cookie header value for a request to the URL.
+    std::string requestHeaderValue(const GURL&);
+
+    // Number of cookies held, and of records in the log.
+    size_t cookieCount();
+    int64 logRecordCount();
+
+    // WebCookieJar methods:
+    virtual void setCookie(const WebURL&, const WebURL& firstPartyForCookies, const WebString& cookie);
+    virtual WebString cookies(const WebURL&, const WebURL& firstPartyForCookies);
+    virtual WebString cookieRequestHeaderFieldValue(const WebURL&, const WebURL& firstPartyForCookies);
+    virtual void rawCookies(const WebURL&, const WebURL& firstPartyForCookies, WebVector<WebCookie>&);
+    virtual void deleteCookie(const WebURL&, const WebString& cookieName);
+    virtual bool cookiesEnabled(const WebURL&, const WebURL& firstPartyForCookies);
+
+private:
+    static const size_t shardCount = 16;
+
+    typedef std::vector<net::CanonicalCookie> CookieList;
+
+    struct Shard {
+        base::Lock lock;
+        // By registrable domain.
+        std::map<std::string, CookieList> domains;
+    };
+
+    Shard& shardFor(const std::string& key);
+
+    // Adds |cookie|, replacing the cookie with the same name, domain and
+    // path; an expired |cookie| only removes that one. Script may not
+    // replace an HttpOnly cookie.
+    void store(const net::CanonicalCookie&, bool fromScript);
+    // The cookies a request to |url| would send, in header order, and the
+    // same as a Cookie header value.
+    void matching(const GURL& url, bool includeHttpOnly, CookieList* cookies);
+    std::string cookieLine(const GURL& url, bool includeHttpOnly);
+
+    // Called with the shard's lock held. Queue a log record for the jar
+    // thread.
+    void logSet(const net::CanonicalCookie&);
+    void logDelete(const net::CanonicalCookie&);
+    void queueRecord(const Pickle&);
+    // Called with m_logLock held.
+    void scheduleWrite();
+
+    // Replays the log into the shards. Constructor only.
+    void load();
+    // Jar thread.
+    void writePendingRecords();
+    void compact();
+
+    const base::FilePath m_logPath;
+    Shard m_shards[shardCount];
+
+    // Set while load() replays the log, which must not log again.
+    bool m_replaying;
+
+    base::Lock m_logLock;
+    std::string m_pendingRecords;
+    int64 m_logRecords;
+    bool m_writeScheduled;
+    // Records the log may hold before the next compaction.
+    int64 m_compactionThreshold;
+
+    base::Thread m_thread;
+
+    DISALLOW_COPY_AND_ASSIGN(WebCookieJarImpl);
+};
+
+
+#endif // WebCookieJarImpl_h
@@ -0,0 +1,828 @@
+#include "WebFileSystemImpl.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_enumerator.h"
+#include "base/logging.h"
+#include "base/strings/string_util.h"
+#include "net/base/escape.h"
+#include "net/base/net_errors.h"
+
+#include "../../platform/WebFileInfo.h"
+#include "../../platform/WebFileSystemEntry.h"
+#include "../../platform/WebFileWriter.h"
+#include "../../platform/WebFileWriterClient.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebURL.h"
+#include "../../platform/WebVector.h"
+
+#include "WebBlobRegistryImpl.h"
+
+
+namespace
+{
+
+    // Writes are split into pieces of this size, between which a cancel
+    // takes effect.
+    const size_t writeChunkSize = 1024 * 1024;
+
+    // Progress is reported to the writer's client at most this often.
+    const int64 writeProgressInterval = 4 * 1024 * 1024;
+
+    const char* typeDirectory(WebFileSystemType type)
+    {
+        return type == WebFileSystemTypeTemporary ? "Temporary" : "Persistent";
+    }
+
+    // "http_example.com_8080", safe as a file name on every platform.
+    std::string originIdentifier(const GURL& origin)
+    {
+        std::string identifier = origin.scheme() + "_" + origin.host() + "_" + (origin.has_port() ? origin.port() : "0");
+        for (size_t i = 0; i < identifier.size(); ++i) {
+            char c = identifier[i];
+            if (!IsAsciiAlpha(c) && !IsAsciiDigit(c) && c != '.' && c != '-')
+                identifier[i] = '_';
+        }
+        return identifier;
+    }
+
+    WebFileInfo toWebFileInfo(const base::PlatformFileInfo& info, const base::FilePath& platformPath)
+    {
+        WebFileInfo result;
+        result.modificationTime = info.last_modified.ToDoubleT();
+        result.length = info.size;
+        result.type = info.is_directory ? WebFileInfo::TypeDirectory : WebFileInfo::TypeFile;
+        result.platformPath = platformPath.AsUTF16Unsafe();
+        return result;
+    }
+
+    bool isDirectoryEmpty(const base::FilePath& path)
+    {
+        base::FileEnumerator enumerator(path, false, base::FileEnumerator::FILES | base::FileEnumerator::DIRECTORIES);
+        return enumerator.Next().empty();
+    }
+
+}
+
+// Runs its operations in order on one pool thread and reports back on the
+// thread that created it.
+class WebFileSystemImpl::Writer : public WebFileWriter
+{
+public:
+    Writer(WebFileSystemImpl* fileSystem, const base::FilePath& path, WebFileWriterClient* client)
+        : m_fileSystem(fileSystem)
+        , m_state(new State(path, client))
+        , m_sequence(fileSystem->m_pool.newSequence())
+    {
+    }
+
+    virtual ~Writer()
+    {
+        // Results still on their way are dropped.
+        m_state->client = 0;
+        m_state->cancel();
+    }
+
+    virtual void truncate(long long length)
+    {
+        m_state->start();
+        m_fileSystem->m_pool.postInSequence(m_sequence, "Truncate",
+            base::Bind(&Writer::doTruncate, m_fileSystem, m_state, base::MessageLoopProxy::current(), length));
+    }
+
+    virtual void write(long long position, const WebString& id)
+    {
+        m_state->start();
+        m_fileSystem->m_pool.postInSequence(m_sequence, "Write",
+            base::Bind(&Writer::doWrite, m_fileSystem, m_state, base::MessageLoopProxy::current(),
+                       position, id.utf8()));
+    }
+
+    virtual void cancel()
+    {
+        m_state->cancel();
+    }
+
+private:
+    // Shared with the pool thread running the writer's operations.
+    class State : public base::RefCountedThreadSafe<State>
+    {
+    public:
+        State(const base::FilePath& path, WebFileWriterClient* client)
+            : path(path)
+            , client(client)
+            , m_cancelled(false)
+        {
+        }
+
+        void start()
+        {
+            base::AutoLock locker(m_lock);
+            m_cancelled = false;
+        }
+
+        void cancel()
+        {
+            base::AutoLock locker(m_lock);
+            m_cancelled = true;
+        }
+
+        bool isCancelled()
+        {
+            base::AutoLock locker(m_lock);
+            return m_cancelled;
+        }
+
+        const base::FilePath path;
+        // The writer's thread; null once the writer is gone.
+        WebFileWriterClient* client;
+
+    private:
+        friend class base::RefCountedThreadSafe<State>;
+        ~State() { }
+
+        base::Lock m_lock;
+        bool m_cancelled;
+    };
+
+    // Pool thread. Looks the blob up here, since a blob whose files are
+    // still being statted makes the lookup wait.
+    static void doWrite(WebFileSystemImpl* fileSystem, scoped_refptr<State> state, scoped_refptr<base::MessageLoopProxy> loop,
+                        int64 position, const std::string& uuid)
+    {
+        scoped_refptr<WebBlobRegistryImpl::Contents> contents;
+        if (fileSystem->m_blobs)
+            contents = fileSystem->m_blobs->contentsForUUID(uuid);
+        if (!contents || contents->broken) {
+            loop->PostTask(FROM_HERE, base::Bind(&Writer::didFail, state, WebFileErrorNotReadable));
+            return;
+        }
+
+        int error = 0;
+        base::PlatformFile file = base::CreatePlatformFile(state->path, base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_WRITE, NULL, NULL);
+        if (file == base::kInvalidPlatformFileValue)
+            error = WebFileErrorNotFound;
+
+        // Each slice is written where it belongs in the file, straight from
+        // the blob's segment, or from a mapping of the range it names.
+        int64 offset = position;
+        int64 unreported = 0;
+        for (size_t i = 0; !error && i < contents->slices.size(); ++i) {
+            const WebBlobRegistryImpl::Slice& slice = contents->slices[i];
+            scoped_refptr<URLResponseBody> segment;
+            if (WebBlobRegistryImpl::openSlice(slice, &segment) != net::OK) {
+                error = WebFileErrorNotReadable;
+                break;
+            }
+            const char* data = segment->data();
+            size_t remaining = slice.length;
+            while (remaining) {
+                if (state->isCancelled()) {
+                    error = WebFileErrorAbort;
+                    break;
+                }
+                int chunk = static_cast<int>(std::min(remaining, writeChunkSize));
+                int written = base::WritePlatformFile(file, offset, data, chunk);
+                if (written <= 0) {
+                    error = WebFileErrorInvalidState;
+                    break;
+                }
+                data += written;
+                remaining -= written;
+                offset += written;
+                unreported += written;
+                if (unreported >= writeProgressInterval) {
+                    loop->PostTask(FROM_HERE, base::Bind(&Writer::didWrite, state, unreported, false));
+                    unreported = 0;
+                }
+            }
+        }
+        if (file != base::kInvalidPlatformFileValue)
+            base::ClosePlatformFile(file);
+        fileSystem->invalidate(state->path, false);
+
+        if (error)
+            loop->PostTask(FROM_HERE, base::Bind(&Writer::didFail, state, static_cast<WebFileError>(error)));
+        else
+            loop->PostTask(FROM_HERE, base::Bind(&Writer::didWrite, state, unreported, true));
+    }
+
+    static void doTruncate(WebFileSystemImpl* fileSystem, scoped_refptr<State> state, scoped_refptr<base::MessageLoopProxy> loop, int64 length)
+    {
+        base::PlatformFile file = base::CreatePlatformFile(state->path, base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_WRITE, NULL, NULL);
+        if (file == base::kInvalidPlatformFileValue) {
+            loop->PostTask(FROM_HERE, base::Bind(&Writer::didFail, state, WebFileErrorNotFound));
+            return;
+        }
+        bool truncated = base::TruncatePlatformFile(file, length);
+        base::ClosePlatformFile(file);
+        fileSystem->invalidate(state->path, false);
+
+        if (truncated)
+            loop->PostTask(FROM_HERE, base::Bind(&Writer::didTruncate, state));
+        else
+            loop->PostTask(FROM_HERE, base::Bind(&Writer::didFail, state, WebFileErrorInvalidState));
+    }
+
+    // Writer's thread.
+    static void didWrite(scoped_refptr<State> state, int64 bytes, bool complete)
+    {
+        if (state->client)
+            state->client->didWrite(bytes, complete);
+    }
+
+    static void didTruncate(scoped_refptr<State> state)
+    {
+        if (state->client)
+            state->client->didTruncate();
+    }
+
+    static void didFail(scoped_refptr<State> state, WebFileError error)
+    {
+        if (state->client)
+            state->client->didFail(error);
+    }
+
+    WebFileSystemImpl* m_fileSystem;
+    scoped_refptr<State> m_state;
+    size_t m_sequence;
+
+    DISALLOW_COPY_AND_ASSIGN(Writer);
+};
+
+WebFileSystemImpl::Location::Location()
+    : type(WebFileSystemTypeTemporary)
+{
+}
+
+WebFileSystemImpl::Result::Result()
+    : error(0)
+    , type(SucceedReply)
+    , hasMore(false)
+{
+}
+
+WebFileSystemImpl::Pending::Pending()
+    : writerClient(0)
+{
+}
+
+WebFileSystemImpl::WebFileSystemImpl(const base::FilePath& root, WebBlobRegistryImpl* blobs, blink::Platform* platform)
+    : m_root(root)
+    , m_blobs(blobs)
+    , m_nextPendingId(0)
+    , m_metadataGeneration(0)
+    , m_pool("FileSystem", FileIOPool::defaultThreadCount, FileIOPool::defaultSequenceThreadCount, platform)
+{
+    if (m_blobs)
+        m_blobs->setFileSystem(this);
+}
+
+WebFileSystemImpl::~WebFileSystemImpl()
+{
+    if (m_blobs)
+        m_blobs->setFileSystem(0);
+}
+
+bool WebFileSystemImpl::fileInfo(const base::FilePath& path, base::PlatformFileInfo* info)
+{
+    if (!m_root.empty() && m_root.IsParent(path))
+        return statFile(path, info);
+    return base::GetFileInfo(path, info);
+}
+
+bool WebFileSystemImpl::pathForURL(const GURL& url, base::FilePath* path)
+{
+    Location location;
+    if (!resolve(url, &location))
+        return false;
+    *path = location.path;
+    return true;
+}
+
+void WebFileSystemImpl::openFileSystem(const WebURL& storagePartition, const WebFileSystemType type, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = locateFileSystem(GURL(storagePartition).GetOrigin(), type, &location);
+    start("OpenFileSystem", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doOpenFileSystem, base::Unretained(this)));
+}
+
+void WebFileSystemImpl::resolveURL(const WebURL& fileSystemURL, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(fileSystemURL, &location);
+    start("ResolveURL", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doResolveURL, base::Unretained(this)));
+}
+
+void WebFileSystemImpl::deleteFileSystem(const WebURL& storagePartition, const WebFileSystemType type, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = locateFileSystem(GURL(storagePartition).GetOrigin(), type, &location);
+    start("DeleteFileSystem", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doDeleteFileSystem, base::Unretained(this)));
+}
+
+void WebFileSystemImpl::move(const WebURL& srcPath, const WebURL& destPath, WebFileSystemCallbacks callbacks)
+{
+    Location source, dest;
+    bool resolved = resolve(srcPath, &source) && resolve(destPath, &dest);
+    start("Move", resolved, dest, callbacks,
+          base::Bind(&WebFileSystemImpl::doMove, base::Unretained(this), source, false));
+}
+
+void WebFileSystemImpl::copy(const WebURL& srcPath, const WebURL& destPath, WebFileSystemCallbacks callbacks)
+{
+    Location source, dest;
+    bool resolved = resolve(srcPath, &source) && resolve(destPath, &dest);
+    start("Copy", resolved, dest, callbacks,
+          base::Bind(&WebFileSystemImpl::doMove, base::Unretained(this), source, true));
+}
+
+void WebFileSystemImpl::remove(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("Remove", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doRemove, base::Unretained(this), false));
+}
+
+void WebFileSystemImpl::removeRecursively(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("RemoveRecursively", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doRemove, base::Unretained(this), true));
+}
+
+void WebFileSystemImpl::readMetadata(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    if (resolved && replyFromCache(location, MetadataReply, callbacks))
+        return;
+    start("ReadMetadata", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doReadMetadata, base::Unretained(this), MetadataReply));
+}
+
+void WebFileSystemImpl::createFile(const WebURL& path, bool exclusive, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("CreateFile", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doCreate, base::Unretained(this), false, exclusive));
+}
+
+void WebFileSystemImpl::createDirectory(const WebURL& path, bool exclusive, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("CreateDirectory", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doCreate, base::Unretained(this), true, exclusive));
+}
+
+void WebFileSystemImpl::fileExists(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("FileExists", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doExists, base::Unretained(this), false));
+}
+
+void WebFileSystemImpl::directoryExists(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("DirectoryExists", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doExists, base::Unretained(this), true));
+}
+
+void WebFileSystemImpl::readDirectory(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("ReadDirectory", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doReadDirectory, base::Unretained(this)));
+}
+
+WebFileWriter* WebFileSystemImpl::createFileWriter(const WebURL& path, WebFileWriterClient* client)
+{
+    Location location;
+    if (!resolve(path, &location))
+        return 0;
+    return new Writer(this, location.path, client);
+}
+
+void WebFileSystemImpl::createFileWriter(const WebURL& path, WebFileWriterClient* client, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    start("CreateFileWriter", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doReadMetadata, base::Unretained(this), WriterReply), client);
+}
+
+void WebFileSystemImpl::createSnapshotFileAndReadMetadata(const WebURL& path, WebFileSystemCallbacks callbacks)
+{
+    Location location;
+    bool resolved = resolve(path, &location);
+    if (resolved && replyFromCache(location, SnapshotReply, callbacks))
+        return;
+    start("CreateSnapshotFile", resolved, location, callbacks,
+          base::Bind(&WebFileSystemImpl::doReadMetadata, base::Unretained(this), SnapshotReply));
+}
+
+bool WebFileSystemImpl::resolve(const GURL& url, Location* location)
+{
+    if (!url.is_valid() || !url.SchemeIsFileSystem() || !url.inner_url())
+        return false;
+
+    // The inner URL is the origin and the type: "http://example.com/temporary".
+    WebFileSystemType type;
+    const std::string& typePath = url.inner_url()->path();
+    if (typePath == "/temporary")
+        type = WebFileSystemTypeTemporary;
+    else if (typePath == "/persistent")
+        type = WebFileSystemTypePersistent;
+    else
+        return false;
+    if (!locateFileSystem(url.inner_url()->GetOrigin(), type, location))
+        return false;
+
+    std::string path = net::UnescapeURLComponent(url.path(),
+        net::UnescapeRule::SPACES | net::UnescapeRule::URL_SPECIAL_CHARS);
+    location->virtualPath.clear();
+    size_t begin = 0;
+    while (begin < path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos)
+            end = path.size();
+        std::string component = path.substr(begin, end - begin);
+        begin = end + 1;
+        if (component.empty())
+            continue;
+        // Nothing may name a file outside the file system.
+        if (component == "." || component == ".." || component.find_first_of(std::string("\\\0", 2)) != std::string::npos)
+            return false;
+        location->path = location->path.Append(base::FilePath::FromUTF8Unsafe(component));
+        location->virtualPath += "/" + component;
+    }
+    if (location->virtualPath.empty())
+        location->virtualPath = "/";
+    return true;
+}
+
+bool WebFileSystemImpl::locateFileSystem(const GURL& origin, WebFileSystemType type, Location* location)
+{
+    // Isolated and external file systems need a browser to grant them.
+    if (m_root.empty() || !origin.is_valid()
+            || (type != WebFileSystemTypeTemporary && type != WebFileSystemTypePersistent))
+        return false;
+
+    std::string identifier = originIdentifier(origin);
+    location->type = type;
+    location->root = m_root.AppendASCII(identifier).AppendASCII(typeDirectory(type));
+    location->path = location->root;
+    location->rootURL = GURL("filesystem:" + origin.spec() + (type == WebFileSystemTypeTemporary ? "temporary/" : "persistent/"));
+    location->name = identifier + ":" + typeDirectory(type);
+    location->virtualPath = "/";
+    return true;
+}
+
+void WebFileSystemImpl::start(const char* name, bool resolved, const Location& location,
+                              const WebFileSystemCallbacks& callbacks, const Operation& operation, WebFileWriterClient* writerClient)
+{
+    if (!resolved) {
+        WebFileSystemCallbacks failed = callbacks;
+        failed.didFail(WebFileErrorSecurity);
+        return;
+    }
+
+    int id = addPending(callbacks, writerClient);
+    // Synchronous calls, and threads without a message loop to reply on,
+    // run the operation inline.
+    scoped_refptr<base::MessageLoopProxy> loop;
+    if (!callbacks.shouldBlockUntilCompletion())
+        loop = base::MessageLoopProxy::current();
+    if (!loop) {
+        operation.Run(location, NULL, id);
+        return;
+    }
+    m_pool.post(name, base::Bind(operation, location, loop, id));
+}
+
+int WebFileSystemImpl::addPending(const WebFileSystemCallbacks& callbacks, WebFileWriterClient* writerClient)
+{
+    base::AutoLock locker(m_pendingLock);
+    int id = m_nextPendingId++;
+    Pending& pending = m_pending[id];
+    pending.callbacks = callbacks;
+    pending.writerClient = writerClient;
+    return id;
+}
+
+void WebFileSystemImpl::complete(int id, const Result& result)
+{
+    Pending pending;
+    {
+        base::AutoLock locker(m_pendingLock);
+        std::map<int, Pending>::iterator it = m_pending.find(id);
+        if (it == m_pending.end())
+            return;
+        pending = it->second;
+        // A directory listing keeps its callbacks until the last batch.
+        if (result.error || result.type != DirectoryReply || !result.hasMore)
+            m_pending.erase(it);
+    }
+
+    WebFileSystemCallbacks& callbacks = pending.callbacks;
+    if (result.error) {
+        callbacks.didFail(static_cast<WebFileError>(result.error));
+        return;
+    }
+
+    switch (result.type) {
+    case SucceedReply:
+        callbacks.didSucceed();
+        break;
+    case MetadataReply:
+        callbacks.didReadMetadata(toWebFileInfo(result.info, base::FilePath()));
+        break;
+    case SnapshotReply:
+        callbacks.didCreateSnapshotFile(toWebFileInfo(result.info, result.location.path));
+        break;
+    case DirectoryReply: {
+        WebVector<WebFileSystemEntry> entries(result.entries.size());
+        for (size_t i = 0; i < result.entries.size(); ++i) {
+            entries[i].name = base::FilePath(result.entries[i].first).AsUTF16Unsafe();
+            entries[i].isDirectory = result.entries[i].second;
+        }
+        callbacks.didReadDirectory(entries, result.hasMore);
+        break;
+    }
+    case OpenReply:
+        callbacks.didOpenFileSystem(WebString::fromUTF8(result.location.name), result.location.rootURL);
+        break;
+    case ResolveReply:
+        callbacks.didResolveURL(WebString::fromUTF8(result.location.name), result.location.rootURL, result.location.type,
+                                WebString::fromUTF8(result.location.virtualPath), result.info.is_directory);
+        break;
+    case WriterReply:
+        callbacks.didCreateFileWriter(new Writer(this, result.location.path, pending.writerClient), result.info.size);
+        break;
+    }
+}
+
+void WebFileSystemImpl::reply(scoped_refptr<base::MessageLoopProxy> loop, int id, const Result& result)
+{
+    if (!loop) {
+        complete(id, result);
+        return;
+    }
+    loop->PostTask(FROM_HERE, base::Bind(&WebFileSystemImpl::complete, base::Unretained(this), id, result));
+}
+
+bool WebFileSystemImpl::replyFromCache(const Location& location, ReplyType type, const WebFileSystemCallbacks& callbacks)
+{
+    Result result;
+    if (!cachedInfo(location.path, &result.info))
+        return false;
+    // Snapshots are only taken of files.
+    if (type == SnapshotReply && result.info.is_directory)
+        return false;
+
+    result.type = type;
+    result.location = location;
+    scoped_refptr<base::MessageLoopProxy> loop;
+    if (!callbacks.shouldBlockUntilCompletion())
+        loop = base::MessageLoopProxy::current();
+    reply(loop, addPending(callbacks, 0), result);
+    return true;
+}
+
+void WebFileSystemImpl::doOpenFileSystem(const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    result.type = OpenReply;
+    result.location = location;
+    if (!base::CreateDirectory(location.root)) {
+        LOG(WARNING) << "can't create " << location.root.value();
+        result.error = WebFileErrorInvalidState;
+    }
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doDeleteFileSystem(const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    if (!base::PathExists(location.root))
+        result.error = WebFileErrorNotFound;
+    else if (!base::DeleteFile(location.root, true))
+        result.error = WebFileErrorInvalidModification;
+    invalidate(location.root, true);
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doResolveURL(const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    result.type = ResolveReply;
+    result.location = location;
+    if (!statFile(location.path, &result.info))
+        result.error = WebFileErrorNotFound;
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doMove(const Location& source, bool copy, const Location& dest, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    base::PlatformFileInfo sourceInfo, destInfo, parentInfo;
+    bool destExists = statFile(dest.path, &destInfo);
+    if (!statFile(source.path, &sourceInfo) || !statFile(dest.path.DirName(), &parentInfo) || !parentInfo.is_directory) {
+        result.error = WebFileErrorNotFound;
+    } else if (source.path == source.root || source.path == dest.path
+               || (sourceInfo.is_directory && source.path.IsParent(dest.path))) {
+        // Roots can't move, and nothing can move into itself.
+        result.error = WebFileErrorInvalidModification;
+    } else if (destExists && (destInfo.is_directory != sourceInfo.is_directory
+                              || (destInfo.is_directory && !isDirectoryEmpty(dest.path)))) {
+        // Only a file can replace a file, and only an empty directory a
+        // directory.
+        result.error = WebFileErrorInvalidModification;
+    } else {
+        if (destExists && destInfo.is_directory)
+            base::DeleteFile(dest.path, false);
+        bool done;
+        if (!copy)
+            done = base::Move(source.path, dest.path);
+        else if (sourceInfo.is_directory)
+            done = base::CopyDirectory(source.path, dest.path, true);
+        else
+            done = base::CopyFile(source.path, dest.path);
+        if (!done)
+            result.error = WebFileErrorInvalidModification;
+    }
+    if (!copy)
+        invalidate(source.path, true);
+    invalidate(dest.path, true);
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doRemove(bool recursive, const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    base::PlatformFileInfo info;
+    if (!statFile(location.path, &info))
+        result.error = WebFileErrorNotFound;
+    else if (location.path == location.root || (!recursive && info.is_directory && !isDirectoryEmpty(location.path)))
+        result.error = WebFileErrorInvalidModification;
+    else if (!base::DeleteFile(location.path, recursive))
+        result.error = WebFileErrorInvalidModification;
+    invalidate(location.path, true);
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doReadMetadata(ReplyType type, const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    result.type = type;
+    result.location = location;
+    if (!statFile(location.path, &result.info))
+        result.error = WebFileErrorNotFound;
+    else if (type != MetadataReply && result.info.is_directory)
+        result.error = WebFileErrorTypeMismatch;
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doCreate(bool directory, bool exclusive, const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    base::PlatformFileInfo info;
+    if (statFile(location.path, &info)) {
+        if (exclusive)
+            result.error = WebFileErrorPathExists;
+        else if (info.is_directory != directory)
+            result.error = WebFileErrorTypeMismatch;
+        reply(loop, id, result);
+        return;
+    }
+
+    if (!statFile(location.path.DirName(), &info) || !info.is_directory) {
+        result.error = WebFileErrorNotFound;
+    } else if (directory) {
+        if (!base::CreateDirectory(location.path))
+            result.error = WebFileErrorInvalidModification;
+    } else {
+        base::PlatformFile file = base::CreatePlatformFile(location.path, base::PLATFORM_FILE_CREATE | base::PLATFORM_FILE_WRITE, NULL, NULL);
+        if (file == base::kInvalidPlatformFileValue)
+            result.error = WebFileErrorInvalidModification;
+        else
+            base::ClosePlatformFile(file);
+    }
+    invalidate(location.path, false);
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doExists(bool directory, const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    base::PlatformFileInfo info;
+    if (!statFile(location.path, &info))
+        result.error = WebFileErrorNotFound;
+    else if (info.is_directory != directory)
+        result.error = WebFileErrorTypeMismatch;
+    reply(loop, id, result);
+}
+
+void WebFileSystemImpl::doReadDirectory(const Location& location, scoped_refptr<base::MessageLoopProxy> loop, int id)
+{
+    Result result;
+    result.type = DirectoryReply;
+    base::PlatformFileInfo info;
+    if (!statFile(location.path, &info))
+        result.error = WebFileErrorNotFound;
+    else if (!info.is_directory)
+        result.error = WebFileErrorTypeMismatch;
+    if (result.error) {
+        reply(loop, id, result);
+        return;
+    }
+
+    // Batches go out as they fill. The metadata the enumeration returns
+    // for free warms the cache for the stats that usually follow.
+    int64 generation = metadataGeneration();
+    base::FileEnumerator enumerator(location.path, false, base::FileEnumerator::FILES | base::FileEnumerator::DIRECTORIES);
+    for (base::FilePath path = enumerator.Next(); !path.empty(); path = enumerator.Next()) {
+        base::FileEnumerator::FileInfo found = enumerator.GetInfo();
+        base::PlatformFileInfo entryInfo;
+        entryInfo.size = found.GetSize();
+        entryInfo.is_directory = found.IsDirectory();
+        entryInfo.last_modified = found.GetLastModifiedTime();
+        cacheInfo(path, entryInfo, generation);
+
+        result.entries.push_back(std::make_pair(path.BaseName().value(), found.IsDirectory()));
+        if (result.entries.size() == readDirectoryBatchSize) {
+            result.hasMore = true;
+            reply(loop, id, result);
+            result.entries.clear();
+        }
+    }
+    result.hasMore = false;
+    reply(loop, id, result);
+}
+
+bool WebFileSystemImpl::cachedInfo(const base::FilePath& path, base::PlatformFileInfo* info)
+{
+    base::AutoLock locker(m_cacheLock);
+    std::map<base::FilePath, base::PlatformFileInfo>::const_iterator it = m_metadata.find(path);
+    if (it == m_metadata.end())
+        return false;
+    *info = it->second;
+    return true;
+}
+
+int64 WebFileSystemImpl::metadataGeneration()
+{
+    base::AutoLock locker(m_cacheLock);
+    return m_metadataGeneration;
+}
+
+void WebFileSystemImpl::cacheInfo(const base::FilePath& path, const base::PlatformFileInfo& info, int64 generation)
+{
+    base::AutoLock locker(m_cacheLock);
+    if (generation != m_metadataGeneration)
+        return;
+    if (m_metadata.size() >= maxCachedMetadata)
+        m_metadata.clear();
+    m_metadata[path] = info;
+}
+
+void WebFileSystemImpl::invalidate(const base::FilePath& path, bool recursive)
+{
+    base::AutoLock locker(m_cacheLock);
+    ++m_metadataGeneration;
+    m_metadata.erase(path);
+    m_metadata.erase(path.DirName());
+    if (!recursive)
+        return;
+
+    // Everything below |path| sorts together, right after "|path|/".
+    base::FilePath::StringType prefix = path.value() + base::FilePath::kSeparators[0];
+    std::map<base::FilePath, base::PlatformFileInfo>::iterator it = m_metadata.lower_bound(base::FilePath(prefix));
+    while (it != m_metadata.end() && !it->first.value().compare(0, prefix.size(), prefix))
+        m_metadata.erase(it++);
+}
+
+bool WebFileSystemImpl::statFile(const base::FilePath& path, base::PlatformFileInfo* info)
+{
+    if (cachedInfo(path, info))
+        return true;
+
+    int64 generation = metadataGeneration();
+    if (!base::GetFileInfo(path, info))
+        return false;
+    cacheInfo(path, *info, generation);
+    return true;
+}
@@ -0,0 +1,192 @@
+#ifndef WebFileSystemImpl_h
+#define WebFileSystemImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/platform_file.h"
+#include "base/synchronization/lock.h"
+#include "url/gurl.h"
+
+#include "../../platform/WebFileSystem.h"
+#include "../../platform/WebFileSystemCallbacks.h"
+
+#include "FileIOPool.h"
+
+using namespace blink;
+
+class WebBlobRegistryImpl;
+
+// The sandboxed FileSystem API. Each origin's temporary and persistent file
+// systems are plain directories under the root, named after the origin.
+//
+// Every operation runs on a FileIOPool, and its callbacks are run on the
+// thread that started it (the main thread or a worker); the callbacks
+// themselves never leave that thread. Synchronous (worker) calls run
+// inline. A directory is listed in batches of readDirectoryBatchSize, each
+// handed to Blink as soon as it has been read.
+//
+// File metadata is cached: stats of files in the file systems are answered
+// without I/O until an operation through this object changes the file.
+// File writers write blob data at its position straight from the blob's
+// segments, on a pool thread of their own so their operations stay in
+// order.
+class WebFileSystemImpl : public blink::WebFileSystem
+{
+public:
+    static const size_t readDirectoryBatchSize = 100;
+    static const size_t maxCachedMetadata = 4096;
+
+    // File systems live under |root|; writers read blob data from |blobs|,
+    // which must outlive this and resolves its filesystem: items through
+    // it. |platform| receives the pool's histograms.
+    WebFileSystemImpl(const base::FilePath& root, WebBlobRegistryImpl* blobs, blink::Platform* platform);
+    virtual ~WebFileSystemImpl();
+
+    // Any thread. Stats |path|, from the metadata cache when it is inside
+    // the root.
+    bool fileInfo(const base::FilePath& path, base::PlatformFileInfo*);
+
+    // Caller thread. The file a filesystem: URL names, or false if it is not
+    // a path in a sandboxed file system.
+    bool pathForURL(const GURL& url, base::FilePath* path);
+
+    // WebFileSystem methods:
+    virtual void openFileSystem(const WebURL& storagePartition, const WebFileSystemType, WebFileSystemCallbacks);
+    virtual void resolveURL(const WebURL& fileSystemURL, WebFileSystemCallbacks);
+    virtual void deleteFileSystem(const WebURL& storagePartition, const WebFileSystemType, WebFileSystemCallbacks);
+    virtual void move(const WebURL& srcPath, const WebURL& destPath, WebFileSystemCallbacks);
+    virtual void copy(const WebURL& srcPath, const WebURL& destPath, WebFileSystemCallbacks);
+    virtual void remove(const WebURL& path, WebFileSystemCallbacks);
+    virtual void removeRecursively(const WebURL& path, WebFileSystemCallbacks);
+    virtual void readMetadata(const WebURL& path, WebFileSystemCallbacks);
+    virtual void createFile(const WebURL& path, bool exclusive, WebFileSystemCallbacks);
+    virtual void createDirectory(const WebURL& path, bool exclusive, WebFileSystemCallbacks);
+    virtual void fileExists(const WebURL& path, WebFileSystemCallbacks);
+    virtual void directoryExists(const WebURL& path, WebFileSystemCallbacks);
+    virtual void readDirectory(const WebURL& path, WebFileSystemCallbacks);
+    virtual WebFileWriter* createFileWriter(const WebURL& path, WebFileWriterClient*);
+    virtual void createFileWriter(const WebURL& path, WebFileWriterClient*, WebFileSystemCallbacks);
+    virtual void createSnapshotFileAndReadMetadata(const WebURL& path, WebFileSystemCallbacks);
+
+private:
+    class Writer;
+    friend class Writer;
+
+    // A file system path resolved to the disk.
+    struct Location {
+        Location();
+
+        base::FilePath path;
+        // The root of its file system.
+        base::FilePath root;
+        WebFileSystemType type;
+        GURL rootURL;
+        std::string name;
+        // The path within the file system, "/" for the root.
+        std::string virtualPath;
+    };
+
+    enum ReplyType {
+        SucceedReply,
+        MetadataReply,
+        SnapshotReply,
+        DirectoryReply,
+        OpenReply,
+        ResolveReply,
+        WriterReply
+    };
+
+    // What an operation hands back to the thread that started it.
+    struct Result {
+        Result();
+
+        // A WebFileError, or 0.
+        int error;
+        ReplyType type;
+        base::PlatformFileInfo info;
+        Location location;
+        std::vector<std::pair<base::FilePath::StringType, bool> > entries;
+        bool hasMore;
+    };
+
+    // Callbacks waiting for their operation, kept on their own thread.
+    struct Pending {
+        Pending();
+
+        WebFileSystemCallbacks callbacks;
+        WebFileWriterClient* writerClient;
+    };
+
+    typedef base::Callback<void(const Location&, scoped_refptr<base::MessageLoopProxy>, int id)> Operation;
+
+    // Caller thread. Returns false if |url| is not a path in a sandboxed
+    // file system.
+    bool resolve(const GURL& url, Location*);
+    bool locateFileSystem(const GURL& origin, WebFileSystemType, Location*);
+
+    // Caller thread. Runs |operation| on the pool for |location|, or fails
+    // |callbacks| if |location| didn't resolve.
+    void start(const char* name, bool resolved, const Location&, const WebFileSystemCallbacks&, const Operation&, WebFileWriterClient* = 0);
+    int addPending(const WebFileSystemCallbacks&, WebFileWriterClient*);
+    // Caller thread, or inline for synchronous calls.
+    void complete(int id, const Result&);
+    // Any thread. Delivers |result| on |loop|, or inline when |loop| is null.
+    void reply(scoped_refptr<base::MessageLoopProxy> loop, int id, const Result&);
+    // Answers a metadata request from the cache. Caller thread.
+    bool replyFromCache(const Location&, ReplyType, const WebFileSystemCallbacks&);
+
+    // Pool threads.
+    void doOpenFileSystem(const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doDeleteFileSystem(const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doResolveURL(const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doMove(const Location& source, bool copy, const Location& dest, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doRemove(bool recursive, const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doReadMetadata(ReplyType, const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doCreate(bool directory, bool exclusive, const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doExists(bool directory, const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+    void doReadDirectory(const Location&, scoped_refptr<base::MessageLoopProxy>, int id);
+
+    // Any thread.
+    bool cachedInfo(const base::FilePath&, base::PlatformFileInfo*);
+    // Read before looking at the file system; cacheInfo() drops metadata
+    // read under an older generation, since it may predate a change.
+    int64 metadataGeneration();
+    void cacheInfo(const base::FilePath&, const base::PlatformFileInfo&, int64 generation);
+    // Forgets |path| and its parent, whose modification time changes too,
+    // and with |recursive| everything below |path|.
+    void invalidate(const base::FilePath&, bool recursive);
+    // Stats a path inside the root through the cache.
+    bool statFile(const base::FilePath&, base::PlatformFileInfo*);
+
+    const base::FilePath m_root;
+    WebBlobRegistryImpl* m_blobs;
+
+    base::Lock m_pendingLock;
+    std::map<int, Pending> m_pending;
+    int m_nextPendingId;
+
+    base::Lock m_cacheLock;
+    std::map<base::FilePath, base::PlatformFileInfo> m_metadata;
+    // Bumped by invalidate(), so that a stat that raced with a change isn't
+    // cached.
+    int64 m_metadataGeneration;
+
+    // Declared last so its threads stop before the rest goes.
+    FileIOPool m_pool;
+
+    DISALLOW_COPY_AND_ASSIGN(WebFileSystemImpl);
+};
+
+
+#endif // WebFileSystemImpl_h
@@ -0,0 +1,58 @@
+#include "WebFileUtilitiesImpl.h"
+
+#include "base/files/file_path.h"
+#include "base/platform_file.h"
+#include "net/base/net_util.h"
+
+#include "../../platform/WebFileInfo.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebURL.h"
+
+#include "WebFileSystemImpl.h"
+
+
+namespace
+{
+
+    base::FilePath toFilePath(const WebString& path)
+    {
+        return base::FilePath::FromUTF16Unsafe(path);
+    }
+
+}
+
+WebFileUtilitiesImpl::WebFileUtilitiesImpl(WebFileSystemImpl* fileSystem)
+    : m_fileSystem(fileSystem)
+{
+}
+
+WebFileUtilitiesImpl::~WebFileUtilitiesImpl()
+{
+}
+
+bool WebFileUtilitiesImpl::getFileInfo(const WebString& path, WebFileInfo& result)
+{
+    base::PlatformFileInfo info;
+    if (!m_fileSystem->fileInfo(toFilePath(path), &info))
+        return false;
+    result.modificationTime = info.last_modified.ToDoubleT();
+    result.length = info.size;
+    result.type = info.is_directory ? WebFileInfo::TypeDirectory : WebFileInfo::TypeFile;
+    result.platformPath = path;
+    return true;
+}
+
+WebString WebFileUtilitiesImpl::directoryName(const WebString& path)
+{
+    return toFilePath(path).DirName().AsUTF16Unsafe();
+}
+
+WebString WebFileUtilitiesImpl::baseName(const WebString& path)
+{
+    return toFilePath(path).BaseName().AsUTF16Unsafe();
+}
+
+WebURL WebFileUtilitiesImpl::filePathToURL(const WebString& path)
+{
+    return net::FilePathToFileURL(toFilePath(path));
+}
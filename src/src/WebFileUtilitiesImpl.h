@@ -0,0 +1,38 @@
+#ifndef WebFileUtilitiesImpl_h
+#define WebFileUtilitiesImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+
+#include "../../platform/WebFileUtilities.h"
+
+using namespace blink;
+
+class WebFileSystemImpl;
+
+// File helpers for Blink's File objects. Stats of files in the sandboxed
+// file systems come from WebFileSystemImpl's metadata cache.
+class WebFileUtilitiesImpl : public blink::WebFileUtilities
+{
+public:
+    // |fileSystem| must outlive this.
+    explicit WebFileUtilitiesImpl(WebFileSystemImpl* fileSystem);
+    ~WebFileUtilitiesImpl();
+
+    // WebFileUtilities methods:
+    virtual bool getFileInfo(const WebString& path, WebFileInfo&);
+    virtual WebString directoryName(const WebString& path);
+    virtual WebString baseName(const WebString& path);
+    virtual WebURL filePathToURL(const WebString& path);
+
+private:
+    WebFileSystemImpl* m_fileSystem;
+
+    DISALLOW_COPY_AND_ASSIGN(WebFileUtilitiesImpl);
+};
+
+
+#endif // WebFileUtilitiesImpl_h
@@ -1,6 +1,8 @@
 
 #include "WebFrameClientImpl.h"
 
+#include "../../platform/Platform.h"
+
 // May return null.
 WebPlugin* WebFrameClientImpl::createPlugin(WebFrame*, const WebPluginParams&)
 {
@@ -38,7 +40,8 @@ WebWorkerPermissionClientProxy* WebFrameClientImpl::createWorkerPermissionClient
 // WebKitPlatformSupport::cookieJar() will be called to access cookies.
 WebCookieJar* WebFrameClientImpl::cookieJar(WebFrame*)
 {
-    return 0;
+    // All frames share the platform's jar.
+    return Platform::current()->cookieJar();
 }
 
 
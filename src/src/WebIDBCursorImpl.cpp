@@ -0,0 +1,37 @@
+#include "WebIDBCursorImpl.h"
+
+#include <string>
+
+#include "base/bind.h"
+
+WebIDBCursorImpl::WebIDBCursorImpl(scoped_refptr<IDBDatabaseBackend> backend, int64 cursorId)
+    : m_backend(backend)
+    , m_cursorId(cursorId)
+    , m_loop(base::MessageLoopProxy::current())
+{
+}
+
+WebIDBCursorImpl::~WebIDBCursorImpl()
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::closeCursor, m_backend, m_cursorId));
+}
+
+void WebIDBCursorImpl::advance(unsigned long count, WebIDBCallbacks* callbacks)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::continueCursor, m_backend, m_cursorId,
+                                                                std::string(), count, IDBDatabaseBackend::Reply(callbacks, m_loop)));
+}
+
+void WebIDBCursorImpl::continueFunction(const WebIDBKey& key, WebIDBCallbacks* callbacks)
+{
+    std::string target;
+    if (!IDBDatabaseBackend::encodeKey(key, &target))
+        target.clear();
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::continueCursor, m_backend, m_cursorId,
+                                                                target, 1ul, IDBDatabaseBackend::Reply(callbacks, m_loop)));
+}
+
+// Entries aren't prefetched, so there is nothing to reset.
+void WebIDBCursorImpl::postSuccessHandlerCallback()
+{
+}
@@ -0,0 +1,43 @@
+#ifndef WebIDBCursorImpl_h
+#define WebIDBCursorImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop_proxy.h"
+
+#include "../../platform/WebIDBCallbacks.h"
+#include "../../platform/WebIDBCursor.h"
+#include "../../platform/WebIDBKey.h"
+
+#include "IDBDatabaseBackend.h"
+
+using namespace blink;
+
+// Blink's handle on a cursor of an IDBDatabaseBackend. Each move is posted
+// to the database thread, which reads just the entries it steps over; the
+// cursor's position stays there, and is dropped when Blink lets go of this.
+class WebIDBCursorImpl : public blink::WebIDBCursor
+{
+public:
+    WebIDBCursorImpl(scoped_refptr<IDBDatabaseBackend>, int64 cursorId);
+    virtual ~WebIDBCursorImpl();
+
+    // WebIDBCursor methods:
+    virtual void advance(unsigned long count, WebIDBCallbacks*);
+    virtual void continueFunction(const WebIDBKey&, WebIDBCallbacks*);
+    virtual void postSuccessHandlerCallback();
+
+private:
+    scoped_refptr<IDBDatabaseBackend> m_backend;
+    const int64 m_cursorId;
+    scoped_refptr<base::MessageLoopProxy> m_loop;
+
+    DISALLOW_COPY_AND_ASSIGN(WebIDBCursorImpl);
+};
+
+
+#endif // WebIDBCursorImpl_h
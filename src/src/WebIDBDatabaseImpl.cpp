@@ -0,0 +1,185 @@
+#include "WebIDBDatabaseImpl.h"
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/strings/string16.h"
+
+#include "../../platform/WebIDBCursor.h"
+
+
+WebIDBDatabaseImpl::WebIDBDatabaseImpl(scoped_refptr<IDBDatabaseBackend> backend, int64 connectionId)
+    : m_backend(backend)
+    , m_connectionId(connectionId)
+    , m_loop(base::MessageLoopProxy::current())
+    , m_closed(false)
+{
+}
+
+WebIDBDatabaseImpl::~WebIDBDatabaseImpl()
+{
+    close();
+}
+
+IDBDatabaseBackend::Reply WebIDBDatabaseImpl::reply(WebIDBCallbacks* callbacks) const
+{
+    return IDBDatabaseBackend::Reply(callbacks, m_loop);
+}
+
+void WebIDBDatabaseImpl::createObjectStore(long long transactionId, long long objectStoreId, const WebString& name,
+                                           const WebIDBKeyPath& keyPath, bool autoIncrement)
+{
+    IDBObjectStoreInfo info;
+    info.id = objectStoreId;
+    info.name = name;
+    info.keyPath = IDBDatabaseBackend::encodeKeyPath(keyPath);
+    info.autoIncrement = autoIncrement;
+    info.maxIndexId = minimumIndexId;
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::createObjectStore, m_backend,
+                                                                static_cast<int64>(transactionId), info));
+}
+
+void WebIDBDatabaseImpl::deleteObjectStore(long long transactionId, long long objectStoreId)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::deleteObjectStore, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId)));
+}
+
+// Transactions run one at a time, whatever their scope and mode; the
+// callbacks are the connection's, which it already has.
+void WebIDBDatabaseImpl::createTransaction(long long id, WebIDBDatabaseCallbacks*, const WebVector<long long>&, unsigned short)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::createTransaction, m_backend,
+                                                                m_connectionId, static_cast<int64>(id)));
+}
+
+void WebIDBDatabaseImpl::close()
+{
+    if (m_closed)
+        return;
+    m_closed = true;
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::close, m_backend, m_connectionId));
+}
+
+void WebIDBDatabaseImpl::forceClose()
+{
+    if (m_closed)
+        return;
+    m_closed = true;
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::forceClose, m_backend, m_connectionId));
+}
+
+void WebIDBDatabaseImpl::abort(long long transactionId)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::abort, m_backend,
+                                                                static_cast<int64>(transactionId)));
+}
+
+void WebIDBDatabaseImpl::commit(long long transactionId)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::commit, m_backend,
+                                                                static_cast<int64>(transactionId)));
+}
+
+void WebIDBDatabaseImpl::createIndex(long long transactionId, long long objectStoreId, long long indexId, const WebString& name,
+                                     const WebIDBKeyPath& keyPath, bool unique, bool multiEntry)
+{
+    IDBIndexInfo info;
+    info.id = indexId;
+    info.name = name;
+    info.keyPath = IDBDatabaseBackend::encodeKeyPath(keyPath);
+    info.unique = unique;
+    info.multiEntry = multiEntry;
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::createIndex, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId), info));
+}
+
+void WebIDBDatabaseImpl::deleteIndex(long long transactionId, long long objectStoreId, long long indexId)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::deleteIndex, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId),
+                                                                static_cast<int64>(indexId)));
+}
+
+void WebIDBDatabaseImpl::get(long long transactionId, long long objectStoreId, long long indexId, const WebIDBKeyRange& range,
+                             bool keyOnly, WebIDBCallbacks* callbacks)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::get, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId),
+                                                                static_cast<int64>(indexId), IDBDatabaseBackend::encodeKeyRange(range),
+                                                                keyOnly, reply(callbacks)));
+}
+
+// Cursor updates are plain puts; an invalid key has one generated.
+void WebIDBDatabaseImpl::put(long long transactionId, long long objectStoreId, const WebData& value, const WebIDBKey& key,
+                             PutMode mode, WebIDBCallbacks* callbacks, const WebVector<long long>& indexIds,
+                             const WebVector<WebIndexKeys>& indexKeys)
+{
+    IDBDatabaseBackend::Write write;
+    write.objectStoreId = objectStoreId;
+    if (!IDBDatabaseBackend::encodeKey(key, &write.key))
+        write.key.clear();
+    write.value = new base::RefCountedString;
+    write.value->data().assign(value.data(), value.size());
+    write.addOnly = mode == AddOnly;
+    IDBDatabaseBackend::encodeIndexKeys(indexIds, indexKeys, &write.indexKeys);
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::put, m_backend,
+                                                                static_cast<int64>(transactionId), write, reply(callbacks)));
+}
+
+void WebIDBDatabaseImpl::setIndexKeys(long long transactionId, long long objectStoreId, const WebIDBKey& primaryKey,
+                                      const WebVector<long long>& indexIds, const WebVector<WebIndexKeys>& indexKeys)
+{
+    std::string key;
+    if (!IDBDatabaseBackend::encodeKey(primaryKey, &key))
+        return;
+    IDBBackingStore::IndexKeys keys;
+    IDBDatabaseBackend::encodeIndexKeys(indexIds, indexKeys, &keys);
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::setIndexKeys, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId),
+                                                                key, keys));
+}
+
+// Index keys are set in the order they come, so an index is ready once
+// the calls before this have run.
+void WebIDBDatabaseImpl::setIndexesReady(long long, long long, const WebVector<long long>&)
+{
+}
+
+void WebIDBDatabaseImpl::openCursor(long long transactionId, long long objectStoreId, long long indexId, const WebIDBKeyRange& range,
+                                    unsigned short direction, bool keyOnly, TaskType, WebIDBCallbacks* callbacks)
+{
+    IDBBackingStore::Cursor cursor;
+    cursor.objectStoreId = objectStoreId;
+    cursor.indexId = indexId;
+    cursor.range = IDBDatabaseBackend::encodeKeyRange(range);
+    cursor.reverse = direction == WebIDBCursor::Prev || direction == WebIDBCursor::PrevNoDuplicate;
+    cursor.unique = direction == WebIDBCursor::NextNoDuplicate || direction == WebIDBCursor::PrevNoDuplicate;
+    cursor.keyOnly = keyOnly;
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::openCursor, m_backend,
+                                                                static_cast<int64>(transactionId), cursor, reply(callbacks)));
+}
+
+void WebIDBDatabaseImpl::count(long long transactionId, long long objectStoreId, long long indexId, const WebIDBKeyRange& range,
+                               WebIDBCallbacks* callbacks)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::count, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId),
+                                                                static_cast<int64>(indexId), IDBDatabaseBackend::encodeKeyRange(range),
+                                                                reply(callbacks)));
+}
+
+void WebIDBDatabaseImpl::deleteRange(long long transactionId, long long objectStoreId, const WebIDBKeyRange& range,
+                                     WebIDBCallbacks* callbacks)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::deleteRange, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId),
+                                                                IDBDatabaseBackend::encodeKeyRange(range), reply(callbacks)));
+}
+
+void WebIDBDatabaseImpl::clear(long long transactionId, long long objectStoreId, WebIDBCallbacks* callbacks)
+{
+    m_backend->databaseThread()->PostTask(FROM_HERE, base::Bind(&IDBDatabaseBackend::clear, m_backend,
+                                                                static_cast<int64>(transactionId), static_cast<int64>(objectStoreId),
+                                                                reply(callbacks)));
+}
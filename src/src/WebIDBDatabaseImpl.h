@@ -0,0 +1,73 @@
+#ifndef WebIDBDatabaseImpl_h
+#define WebIDBDatabaseImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop_proxy.h"
+
+#include "../../platform/WebData.h"
+#include "../../platform/WebIDBCallbacks.h"
+#include "../../platform/WebIDBDatabase.h"
+#include "../../platform/WebIDBDatabaseCallbacks.h"
+#include "../../platform/WebIDBKey.h"
+#include "../../platform/WebIDBKeyPath.h"
+#include "../../platform/WebIDBKeyRange.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebVector.h"
+
+#include "IDBDatabaseBackend.h"
+
+using namespace blink;
+
+// One connection to an IDBDatabaseBackend. Arguments are turned into the
+// backing store's encodings here, on the thread Blink calls from, and the
+// work is posted to the database thread; answers come back to this thread.
+// The connection closes when Blink closes it or lets go of it.
+class WebIDBDatabaseImpl : public blink::WebIDBDatabase
+{
+public:
+    WebIDBDatabaseImpl(scoped_refptr<IDBDatabaseBackend>, int64 connectionId);
+    virtual ~WebIDBDatabaseImpl();
+
+    // WebIDBDatabase methods:
+    virtual void createObjectStore(long long transactionId, long long objectStoreId, const WebString& name, const WebIDBKeyPath&,
+                                   bool autoIncrement);
+    virtual void deleteObjectStore(long long transactionId, long long objectStoreId);
+    virtual void createTransaction(long long id, WebIDBDatabaseCallbacks*, const WebVector<long long>& scope, unsigned short mode);
+    virtual void close();
+    virtual void forceClose();
+    virtual void abort(long long transactionId);
+    virtual void commit(long long transactionId);
+    virtual void createIndex(long long transactionId, long long objectStoreId, long long indexId, const WebString& name,
+                             const WebIDBKeyPath&, bool unique, bool multiEntry);
+    virtual void deleteIndex(long long transactionId, long long objectStoreId, long long indexId);
+    virtual void get(long long transactionId, long long objectStoreId, long long indexId, const WebIDBKeyRange&, bool keyOnly,
+                     WebIDBCallbacks*);
+    virtual void put(long long transactionId, long long objectStoreId, const WebData& value, const WebIDBKey&, PutMode,
+                     WebIDBCallbacks*, const WebVector<long long>& indexIds, const WebVector<WebIndexKeys>&);
+    virtual void setIndexKeys(long long transactionId, long long objectStoreId, const WebIDBKey&,
+                              const WebVector<long long>& indexIds, const WebVector<WebIndexKeys>&);
+    virtual void setIndexesReady(long long transactionId, long long objectStoreId, const WebVector<long long>& indexIds);
+    virtual void openCursor(long long transactionId, long long objectStoreId, long long indexId, const WebIDBKeyRange&,
+                            unsigned short direction, bool keyOnly, TaskType, WebIDBCallbacks*);
+    virtual void count(long long transactionId, long long objectStoreId, long long indexId, const WebIDBKeyRange&, WebIDBCallbacks*);
+    virtual void deleteRange(long long transactionId, long long objectStoreId, const WebIDBKeyRange&, WebIDBCallbacks*);
+    virtual void clear(long long transactionId, long long objectStoreId, WebIDBCallbacks*);
+
+private:
+    IDBDatabaseBackend::Reply reply(WebIDBCallbacks*) const;
+
+    scoped_refptr<IDBDatabaseBackend> m_backend;
+    const int64 m_connectionId;
+    scoped_refptr<base::MessageLoopProxy> m_loop;
+    bool m_closed;
+
+    DISALLOW_COPY_AND_ASSIGN(WebIDBDatabaseImpl);
+};
+
+
+#endif // WebIDBDatabaseImpl_h
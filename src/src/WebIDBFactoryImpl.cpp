@@ -0,0 +1,160 @@
+#include "WebIDBFactoryImpl.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_enumerator.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+
+#include "../../platform/WebIDBDatabaseError.h"
+#include "../../platform/WebIDBDatabaseException.h"
+#include "../../platform/WebVector.h"
+
+
+namespace
+{
+
+    const char nameExtension[] = ".idb";
+
+    // Names are hex so that any of them, even "", is a valid file name.
+    std::string encodeName(const base::string16& name)
+    {
+        std::string utf8 = WebString(name).utf8();
+        return (utf8.empty() ? std::string() : base::HexEncode(utf8.data(), utf8.size())) + nameExtension;
+    }
+
+    bool decodeName(const base::FilePath& directory, base::string16* name)
+    {
+        std::string hex = directory.BaseName().MaybeAsASCII();
+        if (!EndsWith(hex, nameExtension, true))
+            return false;
+        hex.resize(hex.size() - strlen(nameExtension));
+        if (hex.empty()) {
+            name->clear();
+            return true;
+        }
+        std::vector<uint8> utf8;
+        if (!base::HexStringToBytes(hex, &utf8))
+            return false;
+        *name = WebString::fromUTF8(reinterpret_cast<const char*>(&utf8[0]), utf8.size());
+        return true;
+    }
+
+    void deliverNames(WebIDBCallbacks* callbacks, const std::vector<base::string16>& names)
+    {
+        WebVector<WebString> result(names.size());
+        for (size_t i = 0; i < names.size(); ++i)
+            result[i] = WebString(names[i]);
+        callbacks->onSuccess(result);
+        delete callbacks;
+    }
+
+    void deliverOpenError(WebIDBCallbacks* callbacks, WebIDBDatabaseCallbacks* databaseCallbacks, const std::string& message)
+    {
+        callbacks->onError(WebIDBDatabaseError(WebIDBDatabaseExceptionUnknownError, WebString::fromUTF8(message)));
+        delete callbacks;
+        delete databaseCallbacks;
+    }
+
+}
+
+WebIDBFactoryImpl::WebIDBFactoryImpl(const base::FilePath& root)
+    : m_root(root)
+    , m_nextDatabaseId(1)
+    , m_compactionThread("IndexedDBCompaction")
+    , m_thread("IndexedDB")
+{
+    m_compactionThread.Start();
+    m_thread.Start();
+}
+
+WebIDBFactoryImpl::~WebIDBFactoryImpl()
+{
+    m_thread.Stop();
+    m_compactionThread.Stop();
+}
+
+// "http_example.com_0", as Blink identifies an origin, made safe as a file
+// name.
+base::FilePath WebIDBFactoryImpl::originDirectory(const WebString& databaseIdentifier) const
+{
+    std::string identifier = databaseIdentifier.utf8();
+    if (m_root.empty() || identifier.empty())
+        return base::FilePath();
+    for (size_t i = 0; i < identifier.size(); ++i) {
+        char c = identifier[i];
+        if (!IsAsciiAlpha(c) && !IsAsciiDigit(c) && c != '.' && c != '-')
+            identifier[i] = '_';
+    }
+    return m_root.AppendASCII(identifier);
+}
+
+void WebIDBFactoryImpl::getDatabaseNames(WebIDBCallbacks* callbacks, const WebString& databaseIdentifier)
+{
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE, base::Bind(&WebIDBFactoryImpl::getDatabaseNamesOnThread, base::Unretained(this),
+        originDirectory(databaseIdentifier), IDBDatabaseBackend::Reply(callbacks, base::MessageLoopProxy::current())));
+}
+
+void WebIDBFactoryImpl::open(const WebString& name, long long version, long long transactionId, WebIDBCallbacks* callbacks,
+                             WebIDBDatabaseCallbacks* databaseCallbacks, const WebString& databaseIdentifier)
+{
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE, base::Bind(&WebIDBFactoryImpl::openOnThread, base::Unretained(this),
+        static_cast<base::string16>(name), originDirectory(databaseIdentifier), static_cast<int64>(version),
+        static_cast<int64>(transactionId), IDBDatabaseBackend::Reply(callbacks, base::MessageLoopProxy::current()), databaseCallbacks));
+}
+
+void WebIDBFactoryImpl::deleteDatabase(const WebString& name, WebIDBCallbacks* callbacks, const WebString& databaseIdentifier)
+{
+    m_thread.message_loop_proxy()->PostTask(FROM_HERE, base::Bind(&WebIDBFactoryImpl::deleteDatabaseOnThread, base::Unretained(this),
+        static_cast<base::string16>(name), originDirectory(databaseIdentifier),
+        IDBDatabaseBackend::Reply(callbacks, base::MessageLoopProxy::current())));
+}
+
+IDBDatabaseBackend* WebIDBFactoryImpl::backend(const base::string16& name, const base::FilePath& directory)
+{
+    scoped_refptr<IDBDatabaseBackend>& backend = m_backends[directory];
+    if (!backend)
+        backend = new IDBDatabaseBackend(name, m_nextDatabaseId++, directory, m_thread.message_loop_proxy(),
+                                         m_compactionThread.message_loop_proxy());
+    return backend.get();
+}
+
+void WebIDBFactoryImpl::getDatabaseNamesOnThread(const base::FilePath& origin, const IDBDatabaseBackend::Reply& reply)
+{
+    std::vector<base::string16> names;
+    if (!origin.empty()) {
+        base::FileEnumerator enumerator(origin, false, base::FileEnumerator::DIRECTORIES);
+        for (base::FilePath directory = enumerator.Next(); !directory.empty(); directory = enumerator.Next()) {
+            base::string16 name;
+            if (decodeName(directory, &name))
+                names.push_back(name);
+        }
+    }
+    reply.loop->PostTask(FROM_HERE, base::Bind(&deliverNames, reply.callbacks, names));
+}
+
+void WebIDBFactoryImpl::openOnThread(const base::string16& name, const base::FilePath& origin, int64 version, int64 transactionId,
+                                     const IDBDatabaseBackend::Reply& reply, WebIDBDatabaseCallbacks* databaseCallbacks)
+{
+    if (origin.empty()) {
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverOpenError, reply.callbacks, databaseCallbacks,
+                                                   std::string("IndexedDB is not available for this origin.")));
+        return;
+    }
+    backend(name, origin.AppendASCII(encodeName(name)))->open(version, transactionId, reply, databaseCallbacks);
+}
+
+void WebIDBFactoryImpl::deleteDatabaseOnThread(const base::string16& name, const base::FilePath& origin,
+                                               const IDBDatabaseBackend::Reply& reply)
+{
+    if (origin.empty()) {
+        reply.loop->PostTask(FROM_HERE, base::Bind(&deliverOpenError, reply.callbacks, static_cast<WebIDBDatabaseCallbacks*>(0),
+                                                   std::string("IndexedDB is not available for this origin.")));
+        return;
+    }
+    backend(name, origin.AppendASCII(encodeName(name)))->deleteDatabase(reply);
+}
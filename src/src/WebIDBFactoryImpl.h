@@ -0,0 +1,69 @@
+#ifndef WebIDBFactoryImpl_h
+#define WebIDBFactoryImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/strings/string16.h"
+#include "base/threading/thread.h"
+
+#include "../../platform/WebIDBCallbacks.h"
+#include "../../platform/WebIDBDatabaseCallbacks.h"
+#include "../../platform/WebIDBFactory.h"
+#include "../../platform/WebString.h"
+
+#include "IDBDatabaseBackend.h"
+
+using namespace blink;
+
+// IndexedDB on embedded log-structured stores. Each database is a store in
+// its own directory, root/<origin>/<name in hex>.idb: a write-ahead log, the
+// memtable it fills, and sorted tables that a background thread flushes
+// and merges.
+//
+// Databases are run on the "IndexedDB" thread and flushed and compacted on
+// "IndexedDBCompaction", so neither an fsync nor a merge stalls the thread
+// Blink calls from. A database, once opened, stays open for the factory's
+// lifetime.
+class WebIDBFactoryImpl : public blink::WebIDBFactory
+{
+public:
+    explicit WebIDBFactoryImpl(const base::FilePath& root);
+    virtual ~WebIDBFactoryImpl();
+
+    // WebIDBFactory methods:
+    virtual void getDatabaseNames(WebIDBCallbacks*, const WebString& databaseIdentifier);
+    virtual void open(const WebString& name, long long version, long long transactionId, WebIDBCallbacks*,
+                      WebIDBDatabaseCallbacks*, const WebString& databaseIdentifier);
+    virtual void deleteDatabase(const WebString& name, WebIDBCallbacks*, const WebString& databaseIdentifier);
+
+private:
+    base::FilePath originDirectory(const WebString& databaseIdentifier) const;
+
+    // On the database thread.
+    IDBDatabaseBackend* backend(const base::string16& name, const base::FilePath& directory);
+    void getDatabaseNamesOnThread(const base::FilePath& origin, const IDBDatabaseBackend::Reply&);
+    void openOnThread(const base::string16& name, const base::FilePath& origin, int64 version, int64 transactionId,
+                      const IDBDatabaseBackend::Reply&, WebIDBDatabaseCallbacks*);
+    void deleteDatabaseOnThread(const base::string16& name, const base::FilePath& origin, const IDBDatabaseBackend::Reply&);
+
+    const base::FilePath m_root;
+    // By directory.
+    std::map<base::FilePath, scoped_refptr<IDBDatabaseBackend> > m_backends;
+    int64 m_nextDatabaseId;
+
+    base::Thread m_compactionThread;
+    // Stopped first: its databases flush on the compaction thread.
+    base::Thread m_thread;
+
+    DISALLOW_COPY_AND_ASSIGN(WebIDBFactoryImpl);
+};
+
+
+#endif // WebIDBFactoryImpl_h
@@ -33,6 +33,7 @@
 #include "../../web/webviewclient.h"
 #include "../../web/WebFrameClient.h"
 #include "../../web/WebRuntimeFeatures.h"
+#include "../../web/WebSettings.h"
 
 #include "../../platform/win/WebThemeEngine.h"
 #include "../../platform/WebNonCopyable.h"
@@ -0,0 +1,648 @@
+
+#include "WebLayerImpl.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "base/logging.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+
+#include "../../platform/WebFloatRect.h"
+#include "../../platform/WebLayerScrollClient.h"
+
+#include "TileRasterizer.h"
+#include "WebLayerTreeViewImpl.h"
+#include "WebThemeBatch.h"
+
+
+namespace
+{
+
+    int nextLayerId = 1;
+
+    // The smallest rect covering |rect| times |scale|.
+    SkIRect scaleOut(const SkIRect& rect, float scale)
+    {
+        if (scale == 1)
+            return rect;
+        SkRect scaled = SkRect::MakeLTRB(rect.left() * scale, rect.top() * scale, rect.right() * scale, rect.bottom() * scale);
+        SkIRect covering;
+        scaled.roundOut(&covering);
+        return covering;
+    }
+
+}
+
+WebLayerImpl::WebLayerImpl()
+    : m_id(nextLayerId++)
+    , m_parent(0)
+    , m_treeView(0)
+    , m_anchorPoint(0.5f, 0.5f)
+    , m_anchorPointZ(0)
+    , m_masksToBounds(false)
+    , m_opacity(1)
+    , m_opaque(false)
+    , m_sublayerTransform(SkMatrix44::kIdentity_Constructor)
+    , m_transform(SkMatrix44::kIdentity_Constructor)
+    , m_drawsContent(false)
+    , m_backgroundColor(0)
+    , m_scrollable(false)
+    , m_userScrollableHorizontal(true)
+    , m_userScrollableVertical(true)
+    , m_haveWheelEventHandlers(false)
+    , m_shouldScrollOnMainThread(false)
+    , m_isContainerForFixedPositionLayers(false)
+    , m_scrollClient(0)
+    , m_contentClient(0)
+    , m_contentsScale(1)
+{
+}
+
+WebLayerImpl::~WebLayerImpl()
+{
+    removeAllChildren();
+    removeFromParent();
+}
+
+int WebLayerImpl::id() const
+{
+    return m_id;
+}
+
+void WebLayerImpl::invalidateRect(const WebFloatRect& rect)
+{
+    SkRect scaled = SkRect::MakeXYWH(rect.x * m_contentsScale, rect.y * m_contentsScale,
+                                     rect.width * m_contentsScale, rect.height * m_contentsScale);
+    SkIRect dirty;
+    scaled.roundOut(&dirty);
+    if (!dirty.intersect(contentBounds()))
+        return;
+    m_invalidation.op(dirty, SkRegion::kUnion_Op);
+    setNeedsCommit();
+}
+
+void WebLayerImpl::invalidate()
+{
+    m_invalidation.setRect(contentBounds());
+    setNeedsCommit();
+}
+
+void WebLayerImpl::addChild(WebLayer* child)
+{
+    insertChild(child, m_children.size());
+}
+
+void WebLayerImpl::insertChild(WebLayer* child, size_t index)
+{
+    WebLayerImpl* layer = static_cast<WebLayerImpl*>(child);
+    layer->removeFromParent();
+    layer->m_parent = this;
+    m_children.insert(m_children.begin() + std::min(index, m_children.size()), layer);
+    setNeedsCommit();
+}
+
+void WebLayerImpl::replaceChild(WebLayer* reference, WebLayer* newLayer)
+{
+    std::vector<WebLayerImpl*>::iterator it =
+        std::find(m_children.begin(), m_children.end(), static_cast<WebLayerImpl*>(reference));
+    if (it == m_children.end())
+        return;
+    size_t index = it - m_children.begin();
+    removeChild(*it);
+    if (newLayer)
+        insertChild(newLayer, index);
+}
+
+void WebLayerImpl::removeFromParent()
+{
+    if (m_parent)
+        m_parent->removeChild(this);
+}
+
+void WebLayerImpl::removeAllChildren()
+{
+    while (!m_children.empty())
+        removeChild(m_children.back());
+}
+
+void WebLayerImpl::removeChild(WebLayerImpl* child)
+{
+    std::vector<WebLayerImpl*>::iterator it = std::find(m_children.begin(), m_children.end(), child);
+    DCHECK(it != m_children.end());
+    m_children.erase(it);
+    child->m_parent = 0;
+    setNeedsCommit();
+}
+
+void WebLayerImpl::setAnchorPoint(const WebFloatPoint& anchorPoint)
+{
+    m_anchorPoint = anchorPoint;
+    setNeedsCommit();
+}
+
+WebFloatPoint WebLayerImpl::anchorPoint() const
+{
+    return m_anchorPoint;
+}
+
+void WebLayerImpl::setAnchorPointZ(float anchorPointZ)
+{
+    m_anchorPointZ = anchorPointZ;
+}
+
+float WebLayerImpl::anchorPointZ() const
+{
+    return m_anchorPointZ;
+}
+
+void WebLayerImpl::setBounds(const WebSize& bounds)
+{
+    if (bounds == m_bounds)
+        return;
+    m_bounds = bounds;
+    // The cached bitmap has the old size; repaint all of it.
+    if (m_contentClient)
+        invalidate();
+    setNeedsCommit();
+}
+
+WebSize WebLayerImpl::bounds() const
+{
+    return m_bounds;
+}
+
+void WebLayerImpl::setMasksToBounds(bool masksToBounds)
+{
+    m_masksToBounds = masksToBounds;
+    setNeedsCommit();
+}
+
+bool WebLayerImpl::masksToBounds() const
+{
+    return m_masksToBounds;
+}
+
+// Masks and replicas (reflections) are not composited.
+void WebLayerImpl::setMaskLayer(WebLayer*) { }
+void WebLayerImpl::setReplicaLayer(WebLayer*) { }
+
+void WebLayerImpl::setOpacity(float opacity)
+{
+    m_opacity = opacity;
+    setNeedsCommit();
+}
+
+float WebLayerImpl::opacity() const
+{
+    return m_opacity;
+}
+
+void WebLayerImpl::setOpaque(bool opaque)
+{
+    m_opaque = opaque;
+}
+
+bool WebLayerImpl::opaque() const
+{
+    return m_opaque;
+}
+
+void WebLayerImpl::setPosition(const WebFloatPoint& position)
+{
+    m_position = position;
+    setNeedsCommit();
+}
+
+WebFloatPoint WebLayerImpl::position() const
+{
+    return m_position;
+}
+
+void WebLayerImpl::setSublayerTransform(const SkMatrix44& transform)
+{
+    m_sublayerTransform = transform;
+    setNeedsCommit();
+}
+
+SkMatrix44 WebLayerImpl::sublayerTransform() const
+{
+    return m_sublayerTransform;
+}
+
+void WebLayerImpl::setTransform(const SkMatrix44& transform)
+{
+    m_transform = transform;
+    setNeedsCommit();
+}
+
+SkMatrix44 WebLayerImpl::transform() const
+{
+    return m_transform;
+}
+
+void WebLayerImpl::setDrawsContent(bool drawsContent)
+{
+    m_drawsContent = drawsContent;
+    if (!drawsContent)
+        m_tiles.clear();
+    else if (m_contentClient)
+        invalidate();
+    setNeedsCommit();
+}
+
+bool WebLayerImpl::drawsContent() const
+{
+    return m_drawsContent;
+}
+
+// Layers are flattened to 2D and always drawn double-sided.
+void WebLayerImpl::setPreserves3D(bool) { }
+void WebLayerImpl::setUseParentBackfaceVisibility(bool) { }
+
+void WebLayerImpl::setBackgroundColor(WebColor color)
+{
+    m_backgroundColor = color;
+    setNeedsCommit();
+}
+
+WebColor WebLayerImpl::backgroundColor() const
+{
+    return m_backgroundColor;
+}
+
+// Filters are not composited.
+void WebLayerImpl::setFilters(const WebFilterOperations&) { }
+void WebLayerImpl::setBackgroundFilters(const WebFilterOperations&) { }
+void WebLayerImpl::setCompositingReasons(WebCompositingReasons) { }
+
+// Refusing animations makes Blink run them on the main thread, where each
+// tick only changes layer properties and therefore costs a composite, not a
+// raster.
+void WebLayerImpl::setAnimationDelegate(WebAnimationDelegate*) { }
+
+bool WebLayerImpl::addAnimation(WebAnimation* animation)
+{
+    // Ours whether or not it is accepted.
+    delete animation;
+    return false;
+}
+
+void WebLayerImpl::removeAnimation(int) { }
+void WebLayerImpl::removeAnimation(int, WebAnimation::TargetProperty) { }
+void WebLayerImpl::pauseAnimation(int, double) { }
+
+bool WebLayerImpl::hasActiveAnimation()
+{
+    return false;
+}
+
+void WebLayerImpl::setForceRenderSurface(bool) { }
+
+void WebLayerImpl::setScrollPosition(WebPoint position)
+{
+    m_scrollPosition = position;
+    setNeedsCommit();
+}
+
+WebPoint WebLayerImpl::scrollPosition() const
+{
+    return m_scrollPosition;
+}
+
+void WebLayerImpl::setMaxScrollPosition(WebSize maxScrollPosition)
+{
+    m_maxScrollPosition = maxScrollPosition;
+}
+
+WebSize WebLayerImpl::maxScrollPosition() const
+{
+    return m_maxScrollPosition;
+}
+
+void WebLayerImpl::setScrollable(bool scrollable)
+{
+    m_scrollable = scrollable;
+}
+
+bool WebLayerImpl::scrollable() const
+{
+    return m_scrollable;
+}
+
+void WebLayerImpl::setUserScrollable(bool horizontal, bool vertical)
+{
+    m_userScrollableHorizontal = horizontal;
+    m_userScrollableVertical = vertical;
+}
+
+bool WebLayerImpl::userScrollableHorizontal() const
+{
+    return m_userScrollableHorizontal;
+}
+
+bool WebLayerImpl::userScrollableVertical() const
+{
+    return m_userScrollableVertical;
+}
+
+void WebLayerImpl::setHaveWheelEventHandlers(bool haveWheelEventHandlers)
+{
+    m_haveWheelEventHandlers = haveWheelEventHandlers;
+}
+
+bool WebLayerImpl::haveWheelEventHandlers() const
+{
+    return m_haveWheelEventHandlers;
+}
+
+void WebLayerImpl::setShouldScrollOnMainThread(bool shouldScrollOnMainThread)
+{
+    m_shouldScrollOnMainThread = shouldScrollOnMainThread;
+}
+
+bool WebLayerImpl::shouldScrollOnMainThread() const
+{
+    return m_shouldScrollOnMainThread;
+}
+
+void WebLayerImpl::setNonFastScrollableRegion(const WebVector<WebRect>& region)
+{
+    m_nonFastScrollableRegion = region;
+}
+
+WebVector<WebRect> WebLayerImpl::nonFastScrollableRegion() const
+{
+    return m_nonFastScrollableRegion;
+}
+
+void WebLayerImpl::setTouchEventHandlerRegion(const WebVector<WebRect>& region)
+{
+    m_touchEventHandlerRegion = region;
+}
+
+WebVector<WebRect> WebLayerImpl::touchEventHandlerRegion() const
+{
+    return m_touchEventHandlerRegion;
+}
+
+void WebLayerImpl::setIsContainerForFixedPositionLayers(bool container)
+{
+    m_isContainerForFixedPositionLayers = container;
+}
+
+bool WebLayerImpl::isContainerForFixedPositionLayers() const
+{
+    return m_isContainerForFixedPositionLayers;
+}
+
+void WebLayerImpl::setPositionConstraint(const WebLayerPositionConstraint& constraint)
+{
+    m_positionConstraint = constraint;
+}
+
+WebLayerPositionConstraint WebLayerImpl::positionConstraint() const
+{
+    return m_positionConstraint;
+}
+
+void WebLayerImpl::setScrollClient(WebLayerScrollClient* client)
+{
+    m_scrollClient = client;
+}
+
+bool WebLayerImpl::isOrphaned() const
+{
+    return !m_parent && !m_treeView;
+}
+
+void WebLayerImpl::setWebLayerClient(WebLayerClient*) { }
+
+void WebLayerImpl::setImage(const SkBitmap& bitmap)
+{
+    Tile tile;
+    tile.origin.set(0, 0);
+    tile.bitmap = bitmap;
+    m_tiles.assign(1, tile);
+    m_contentsScale = 1;
+    setNeedsCommit();
+}
+
+int64 WebLayerImpl::updateContents(const SkIRect& layerInterest, float scale)
+{
+    if (!m_contentClient || !m_drawsContent)
+        return 0;
+
+    if (scale != m_contentsScale) {
+        // Every tile has to be rastered again at the new scale.
+        m_contentsScale = scale;
+        m_tileBounds = WebSize();
+    }
+    const int tileSize = TileRasterizer::tileSize;
+    SkIRect bounds = contentBounds();
+    int columns = (bounds.width() + tileSize - 1) / tileSize;
+    int rows = (bounds.height() + tileSize - 1) / tileSize;
+    SkIRect interest = scaleOut(layerInterest, scale);
+    if (m_tileBounds != m_bounds || m_tiles.size() != static_cast<size_t>(columns * rows)) {
+        // Edge tiles change size with the bounds; cut the layer again.
+        m_tiles.clear();
+        m_tiles.resize(columns * rows);
+        for (int i = 0; i < columns * rows; ++i)
+            m_tiles[i].origin.set(i % columns * tileSize, i / columns * tileSize);
+        m_tileBounds = m_bounds;
+        m_invalidation.setRect(bounds);
+    }
+
+    int64 painted = 0;
+    for (size_t i = 0; i < m_tiles.size(); ++i) {
+        Tile& tile = m_tiles[i];
+        SkIRect rect = SkIRect::MakeXYWH(tile.origin.x(), tile.origin.y(), tileSize, tileSize);
+        rect.intersect(bounds);
+        if (!SkIRect::Intersects(rect, interest)) {
+            // Painted again if it comes back into view.
+            if (!tile.bitmap.isNull()) {
+                tile.bitmap.reset();
+                m_invalidation.op(rect, SkRegion::kUnion_Op);
+            }
+            continue;
+        }
+        SkRegion dirty(rect);
+        if (!tile.bitmap.isNull() && !dirty.op(m_invalidation, SkRegion::kIntersect_Op))
+            continue;
+        painted += paintTile(&tile, rect, dirty);
+        m_invalidation.op(rect, SkRegion::kDifference_Op);
+    }
+    return painted;
+}
+
+int64 WebLayerImpl::paintTile(Tile* tile, const SkIRect& rect, const SkRegion& dirty)
+{
+    SkBitmap bitmap;
+    const SkRegion* area = &dirty;
+    SkRegion all(rect);
+    if (!tile->bitmap.isNull() && !(dirty.isRect() && dirty.getBounds() == rect)) {
+        // The compositor may be drawing the current bitmap; start from a copy.
+        tile->bitmap.copyTo(&bitmap, SkBitmap::kARGB_8888_Config);
+    }
+    if (bitmap.isNull()) {
+        bitmap.setConfig(SkBitmap::kARGB_8888_Config, rect.width(), rect.height());
+        bitmap.allocPixels();
+        area = &all;
+    }
+    tile->bitmap.reset();
+    if (bitmap.isNull())
+        return 0;
+
+    SkCanvas canvas(bitmap);
+    canvas.translate(-SkIntToScalar(rect.x()), -SkIntToScalar(rect.y()));
+    int64 painted = 0;
+    for (SkRegion::Iterator it(*area); !it.done(); it.next()) {
+        const SkIRect& dirtyRect = it.rect();
+        canvas.save();
+        canvas.clipRect(SkRect::Make(dirtyRect));
+        canvas.drawColor(SK_ColorTRANSPARENT, SkXfermode::kClear_Mode);
+        canvas.scale(SkFloatToScalar(m_contentsScale), SkFloatToScalar(m_contentsScale));
+        SkIRect layerRect = scaleOut(dirtyRect, 1 / m_contentsScale);
+        WebFloatRect opaque;
+        {
+            WebThemeBatchCanvas batching(&canvas);
+            m_contentClient->paintContents(&batching, WebRect(layerRect.x(), layerRect.y(), layerRect.width(), layerRect.height()),
+                                           m_opaque, opaque);
+        }
+        canvas.restore();
+        painted += static_cast<int64>(dirtyRect.width()) * dirtyRect.height();
+    }
+    bitmap.setImmutable();
+    tile->bitmap = bitmap;
+    return painted;
+}
+
+SkIRect WebLayerImpl::contentBounds() const
+{
+    return SkIRect::MakeWH(static_cast<int>(ceilf(m_bounds.width * m_contentsScale)),
+                           static_cast<int>(ceilf(m_bounds.height * m_contentsScale)));
+}
+
+void WebLayerImpl::didScrollOnCompositor(const WebPoint& position)
+{
+    // Already at this offset in the compositor; no commit needed.
+    m_scrollPosition = position;
+    if (m_scrollClient)
+        m_scrollClient->didScroll();
+}
+
+void WebLayerImpl::setNeedsCommit()
+{
+    WebLayerImpl* root = this;
+    while (root->m_parent)
+        root = root->m_parent;
+    if (root->m_treeView)
+        root->m_treeView->setNeedsCommit();
+}
+
+WebContentLayerImpl::WebContentLayerImpl(WebContentLayerClient* client)
+{
+    m_layer.setContentClient(client);
+}
+
+WebContentLayerImpl::~WebContentLayerImpl()
+{
+}
+
+WebLayer* WebContentLayerImpl::layer()
+{
+    return &m_layer;
+}
+
+void WebContentLayerImpl::setDoubleSided(bool) { }
+void WebContentLayerImpl::setDrawCheckerboardForMissingTiles(bool) { }
+void WebContentLayerImpl::setUseLCDText(bool) { }
+
+WebSolidColorLayerImpl::WebSolidColorLayerImpl()
+{
+}
+
+WebSolidColorLayerImpl::~WebSolidColorLayerImpl()
+{
+}
+
+WebLayer* WebSolidColorLayerImpl::layer()
+{
+    return &m_layer;
+}
+
+void WebSolidColorLayerImpl::setBackgroundColor(WebColor color)
+{
+    m_layer.setBackgroundColor(color);
+}
+
+WebImageLayerImpl::WebImageLayerImpl()
+{
+}
+
+WebImageLayerImpl::~WebImageLayerImpl()
+{
+}
+
+WebLayer* WebImageLayerImpl::layer()
+{
+    return &m_layer;
+}
+
+void WebImageLayerImpl::setBitmap(SkBitmap bitmap)
+{
+    m_layer.setDrawsContent(true);
+    m_layer.setImage(bitmap);
+}
+
+WebScrollbarLayerImpl::WebScrollbarLayerImpl(WebScrollbar* scrollbar, const WebScrollbarThemePainter& painter,
+                                             WebScrollbarThemeGeometry* geometry)
+    : m_scrollbar(scrollbar)
+    , m_painter(painter)
+    , m_geometry(geometry)
+{
+    if (m_scrollbar) {
+        m_layer.setContentClient(this);
+        m_layer.setDrawsContent(true);
+    }
+}
+
+WebScrollbarLayerImpl::~WebScrollbarLayerImpl()
+{
+}
+
+WebLayer* WebScrollbarLayerImpl::layer()
+{
+    return &m_layer;
+}
+
+// The thumb is positioned by Blink when it repaints, not from the scroll
+// layer.
+void WebScrollbarLayerImpl::setScrollLayer(WebLayer*) { }
+void WebScrollbarLayerImpl::setClipLayer(WebLayer*) { }
+
+// What ScrollbarThemeComposite::paint does, in layer space.
+void WebScrollbarLayerImpl::paintContents(WebCanvas* canvas, const WebRect&, bool, WebFloatRect&)
+{
+    WebScrollbar* scrollbar = m_scrollbar.get();
+    WebSize bounds = m_layer.bounds();
+    m_painter.paintScrollbarBackground(canvas, WebRect(0, 0, bounds.width, bounds.height));
+    if (m_geometry->hasButtons(scrollbar)) {
+        m_painter.paintBackButtonStart(canvas, m_geometry->backButtonStartRect(scrollbar));
+        m_painter.paintBackButtonEnd(canvas, m_geometry->backButtonEndRect(scrollbar));
+        m_painter.paintForwardButtonStart(canvas, m_geometry->forwardButtonStartRect(scrollbar));
+        m_painter.paintForwardButtonEnd(canvas, m_geometry->forwardButtonEndRect(scrollbar));
+    }
+    WebRect track = m_geometry->trackRect(scrollbar);
+    m_painter.paintTrackBackground(canvas, track);
+    WebRect startTrack, thumb, endTrack;
+    bool hasThumb = m_geometry->hasThumb(scrollbar);
+    if (hasThumb) {
+        m_geometry->splitTrack(scrollbar, track, startTrack, thumb, endTrack);
+        m_painter.paintBackTrackPart(canvas, startTrack);
+        m_painter.paintForwardTrackPart(canvas, endTrack);
+    }
+    m_painter.paintTickmarks(canvas, track);
+    m_painter.paintTrackForeground(canvas, track);
+    if (hasThumb)
+        m_painter.paintThumb(canvas, thumb);
+}
@@ -0,0 +1,277 @@
+#ifndef WebLayerImpl_h
+#define WebLayerImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkRegion.h"
+#include "third_party/skia/include/utils/SkMatrix44.h"
+
+#include "../../platform/WebContentLayer.h"
+#include "../../platform/WebContentLayerClient.h"
+#include "../../platform/WebFloatPoint.h"
+#include "../../platform/WebImageLayer.h"
+#include "../../platform/WebLayer.h"
+#include "../../platform/WebLayerPositionConstraint.h"
+#include "../../platform/WebPoint.h"
+#include "../../platform/WebScrollbar.h"
+#include "../../platform/WebScrollbarLayer.h"
+#include "../../platform/WebScrollbarThemeGeometry.h"
+#include "../../platform/WebScrollbarThemePainter.h"
+#include "../../platform/WebSize.h"
+#include "../../platform/WebSolidColorLayer.h"
+
+using namespace blink;
+
+class WebLayerTreeViewImpl;
+
+// A Blink layer for the software compositor.
+//
+// Blink sets properties and invalidates on the main thread; nothing here is
+// touched by the compositor thread. At commit WebLayerTreeViewImpl repaints
+// the invalidated tiles of each content layer near the viewport and hands
+// the compositor a snapshot of the properties and tiles, so a change of
+// transform, opacity or scroll offset is composited again from the cache
+// without rastering anything.
+class WebLayerImpl : public blink::WebLayer
+{
+public:
+    WebLayerImpl();
+    virtual ~WebLayerImpl();
+
+    // WebLayer methods:
+    virtual int id() const;
+    virtual void invalidateRect(const WebFloatRect&);
+    virtual void invalidate();
+    virtual void addChild(WebLayer*);
+    virtual void insertChild(WebLayer*, size_t index);
+    virtual void replaceChild(WebLayer* reference, WebLayer* newLayer);
+    virtual void removeFromParent();
+    virtual void removeAllChildren();
+    virtual void setAnchorPoint(const WebFloatPoint&);
+    virtual WebFloatPoint anchorPoint() const;
+    virtual void setAnchorPointZ(float);
+    virtual float anchorPointZ() const;
+    virtual void setBounds(const WebSize&);
+    virtual WebSize bounds() const;
+    virtual void setMasksToBounds(bool);
+    virtual bool masksToBounds() const;
+    virtual void setMaskLayer(WebLayer*);
+    virtual void setReplicaLayer(WebLayer*);
+    virtual void setOpacity(float);
+    virtual float opacity() const;
+    virtual void setOpaque(bool);
+    virtual bool opaque() const;
+    virtual void setPosition(const WebFloatPoint&);
+    virtual WebFloatPoint position() const;
+    virtual void setSublayerTransform(const SkMatrix44&);
+    virtual SkMatrix44 sublayerTransform() const;
+    virtual void setTransform(const SkMatrix44&);
+    virtual SkMatrix44 transform() const;
+    virtual void setDrawsContent(bool);
+    virtual bool drawsContent() const;
+    virtual void setPreserves3D(bool);
+    virtual void setUseParentBackfaceVisibility(bool);
+    virtual void setBackgroundColor(WebColor);
+    virtual WebColor backgroundColor() const;
+    virtual void setFilters(const WebFilterOperations&);
+    virtual void setBackgroundFilters(const WebFilterOperations&);
+    virtual void setCompositingReasons(WebCompositingReasons);
+    virtual void setAnimationDelegate(WebAnimationDelegate*);
+    virtual bool addAnimation(WebAnimation*);
+    virtual void removeAnimation(int animationId);
+    virtual void removeAnimation(int animationId, WebAnimation::TargetProperty);
+    virtual void pauseAnimation(int animationId, double timeOffset);
+    virtual bool hasActiveAnimation();
+    virtual void setForceRenderSurface(bool);
+    virtual void setScrollPosition(WebPoint);
+    virtual WebPoint scrollPosition() const;
+    virtual void setMaxScrollPosition(WebSize);
+    virtual WebSize maxScrollPosition() const;
+    virtual void setScrollable(bool);
+    virtual bool scrollable() const;
+    virtual void setUserScrollable(bool horizontal, bool vertical);
+    virtual bool userScrollableHorizontal() const;
+    virtual bool userScrollableVertical() const;
+    virtual void setHaveWheelEventHandlers(bool);
+    virtual bool haveWheelEventHandlers() const;
+    virtual void setShouldScrollOnMainThread(bool);
+    virtual bool shouldScrollOnMainThread() const;
+    virtual void setNonFastScrollableRegion(const WebVector<WebRect>&);
+    virtual WebVector<WebRect> nonFastScrollableRegion() const;
+    virtual void setTouchEventHandlerRegion(const WebVector<WebRect>&);
+    virtual WebVector<WebRect> touchEventHandlerRegion() const;
+    virtual void setIsContainerForFixedPositionLayers(bool);
+    virtual bool isContainerForFixedPositionLayers() const;
+    virtual void setPositionConstraint(const WebLayerPositionConstraint&);
+    virtual WebLayerPositionConstraint positionConstraint() const;
+    virtual void setScrollClient(WebLayerScrollClient*);
+    virtual bool isOrphaned() const;
+    virtual void setWebLayerClient(WebLayerClient*);
+
+    WebLayerImpl* parent() const { return m_parent; }
+    const std::vector<WebLayerImpl*>& children() const { return m_children; }
+
+    // Set on the root layer while it is the root of |treeView|.
+    void setTreeView(WebLayerTreeViewImpl* treeView) { m_treeView = treeView; }
+
+    // Content layers paint through |client|; image layers get a bitmap.
+    void setContentClient(WebContentLayerClient* client) { m_contentClient = client; }
+    void setImage(const SkBitmap&);
+
+    // A piece of the cached contents, at |origin| in content pixels, which
+    // are contentsScale() per layer pixel. Content layers are cut into
+    // TileRasterizer::tileSize squares; an image layer is one tile at
+    // scale 1.
+    struct Tile {
+        SkIPoint origin;
+        // Null until painted. Immutable once handed out: updateContents()
+        // paints a dirty tile into a new bitmap, since the compositor might
+        // still be reading the old one.
+        SkBitmap bitmap;
+    };
+
+    // Brings the tiles inside |interest| (layer space) up to date with the
+    // invalidations, rastered at |scale| content pixels per layer pixel,
+    // drops the tiles outside it, and returns the number of pixels
+    // repainted. Main thread, at commit.
+    int64 updateContents(const SkIRect& interest, float scale);
+    const std::vector<Tile>& tiles() const { return m_tiles; }
+    float contentsScale() const { return m_contentsScale; }
+
+    // Moves the scroll position after the compositor scrolled this layer,
+    // and tells Blink.
+    void didScrollOnCompositor(const WebPoint&);
+
+private:
+    // Asks the tree this layer is in, if any, for a commit.
+    void setNeedsCommit();
+    void removeChild(WebLayerImpl*);
+    SkIRect contentBounds() const;
+    // Repaints |dirty|, which lies within |rect|, the tile's area, in
+    // content pixels, and returns the number of pixels painted.
+    int64 paintTile(Tile*, const SkIRect& rect, const SkRegion& dirty);
+
+    int m_id;
+    WebLayerImpl* m_parent;
+    std::vector<WebLayerImpl*> m_children;
+    WebLayerTreeViewImpl* m_treeView;
+
+    WebFloatPoint m_anchorPoint;
+    float m_anchorPointZ;
+    WebSize m_bounds;
+    bool m_masksToBounds;
+    float m_opacity;
+    bool m_opaque;
+    WebFloatPoint m_position;
+    SkMatrix44 m_sublayerTransform;
+    SkMatrix44 m_transform;
+    bool m_drawsContent;
+    WebColor m_backgroundColor;
+
+    WebPoint m_scrollPosition;
+    WebSize m_maxScrollPosition;
+    bool m_scrollable;
+    bool m_userScrollableHorizontal;
+    bool m_userScrollableVertical;
+    bool m_haveWheelEventHandlers;
+    bool m_shouldScrollOnMainThread;
+    WebVector<WebRect> m_nonFastScrollableRegion;
+    WebVector<WebRect> m_touchEventHandlerRegion;
+    bool m_isContainerForFixedPositionLayers;
+    WebLayerPositionConstraint m_positionConstraint;
+    WebLayerScrollClient* m_scrollClient;
+
+    WebContentLayerClient* m_contentClient;
+    std::vector<Tile> m_tiles;
+    float m_contentsScale;
+    // The bounds |m_tiles| was cut for.
+    WebSize m_tileBounds;
+    // In content pixels.
+    SkRegion m_invalidation;
+
+    DISALLOW_COPY_AND_ASSIGN(WebLayerImpl);
+};
+
+class WebContentLayerImpl : public blink::WebContentLayer
+{
+public:
+    explicit WebContentLayerImpl(WebContentLayerClient*);
+    virtual ~WebContentLayerImpl();
+
+    // WebContentLayer methods:
+    virtual WebLayer* layer();
+    virtual void setDoubleSided(bool);
+    virtual void setDrawCheckerboardForMissingTiles(bool);
+    virtual void setUseLCDText(bool);
+
+private:
+    WebLayerImpl m_layer;
+};
+
+class WebSolidColorLayerImpl : public blink::WebSolidColorLayer
+{
+public:
+    WebSolidColorLayerImpl();
+    virtual ~WebSolidColorLayerImpl();
+
+    // WebSolidColorLayer methods:
+    virtual WebLayer* layer();
+    virtual void setBackgroundColor(WebColor);
+
+private:
+    WebLayerImpl m_layer;
+};
+
+class WebImageLayerImpl : public blink::WebImageLayer
+{
+public:
+    WebImageLayerImpl();
+    virtual ~WebImageLayerImpl();
+
+    // WebImageLayer methods:
+    virtual WebLayer* layer();
+    virtual void setBitmap(SkBitmap);
+
+private:
+    WebLayerImpl m_layer;
+};
+
+// A scrollbar Blink moved to its own layer. It is a content layer that
+// paints the whole scrollbar through Blink's theme painter, so a scroll
+// repaints it when Blink invalidates it; the thumb doesn't follow scrolls
+// done on the compositor thread until then.
+class WebScrollbarLayerImpl : public blink::WebScrollbarLayer, public blink::WebContentLayerClient
+{
+public:
+    // Takes |scrollbar| and |geometry|. Without a scrollbar, as for the
+    // solid color scrollbars of touch screens, the layer is left empty.
+    WebScrollbarLayerImpl(WebScrollbar* scrollbar, const WebScrollbarThemePainter& painter,
+                          WebScrollbarThemeGeometry* geometry);
+    virtual ~WebScrollbarLayerImpl();
+
+    // WebScrollbarLayer methods:
+    virtual WebLayer* layer();
+    virtual void setScrollLayer(WebLayer*);
+    virtual void setClipLayer(WebLayer*);
+
+    // WebContentLayerClient methods:
+    virtual void paintContents(WebCanvas*, const WebRect& clip, bool canPaintLCDText, WebFloatRect& opaque);
+
+private:
+    WebLayerImpl m_layer;
+    scoped_ptr<WebScrollbar> m_scrollbar;
+    WebScrollbarThemePainter m_painter;
+    scoped_ptr<WebScrollbarThemeGeometry> m_geometry;
+
+    DISALLOW_COPY_AND_ASSIGN(WebScrollbarLayerImpl);
+};
+
+
+#endif // WebLayerImpl_h
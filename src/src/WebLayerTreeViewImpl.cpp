@@ -0,0 +1,497 @@
+
+#include "WebLayerTreeViewImpl.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkMatrix.h"
+
+#include "../../platform/WebFloatPoint.h"
+#include "../../platform/WebPoint.h"
+#include "../../platform/WebRect.h"
+
+#include "WebLayerImpl.h"
+
+
+namespace
+{
+
+    // What the compositor thread knows about a layer: its properties at the
+    // last commit and its cached tiles.
+    struct CompositorLayer {
+        int id;
+        // Layer space to parent space, and the sublayer transform around
+        // the anchor point; both flattened to 2D.
+        SkMatrix toParent;
+        SkMatrix sublayer;
+        float opacity;
+        bool masksToBounds;
+        SkISize bounds;
+        SkColor backgroundColor;
+        std::vector<WebLayerImpl::Tile> tiles;
+        SkScalar contentsScale;
+        bool scrollable;
+        SkIPoint scrollPosition;
+        SkISize maxScrollPosition;
+        ScopedVector<CompositorLayer> children;
+    };
+
+    // Wraps |transform| so that it applies around the anchor point.
+    SkMatrix aroundAnchor(const SkMatrix44& transform, const WebFloatPoint& anchor, const WebSize& bounds)
+    {
+        SkScalar x = SkFloatToScalar(anchor.x * bounds.width);
+        SkScalar y = SkFloatToScalar(anchor.y * bounds.height);
+        SkMatrix matrix;
+        matrix.setTranslate(x, y);
+        matrix.preConcat(SkMatrix(transform));
+        matrix.preTranslate(-x, -y);
+        return matrix;
+    }
+
+    // The part of a layer, in layer space, worth keeping rastered: what it
+    // shows of the viewport grown by a screen each way, so that scrolls on
+    // the compositor thread find their tiles until the next commit.
+    SkIRect interestRect(const SkMatrix& toViewport, const SkIRect& viewport, const WebSize& bounds)
+    {
+        SkMatrix toLayer;
+        if (!toViewport.invert(&toLayer))
+            return SkIRect::MakeEmpty();
+        SkRect area = SkRect::Make(viewport);
+        area.outset(SkIntToScalar(viewport.width()), SkIntToScalar(viewport.height()));
+        toLayer.mapRect(&area);
+        SkIRect interest;
+        area.roundOut(&interest);
+        if (!interest.intersect(SkIRect::MakeWH(bounds.width, bounds.height)))
+            return SkIRect::MakeEmpty();
+        return interest;
+    }
+
+    // |parentToViewport| maps the parent's space, scroll offset included, to
+    // the viewport. Contents are rastered at |scale|, the device scale.
+    scoped_ptr<CompositorLayer> snapshot(WebLayerImpl* layer, const SkMatrix& parentToViewport, const SkIRect& viewport,
+                                         float scale, int64* rasteredPixels)
+    {
+        scoped_ptr<CompositorLayer> copy(new CompositorLayer);
+
+        WebSize bounds = layer->bounds();
+        WebFloatPoint position = layer->position();
+        copy->id = layer->id();
+        copy->toParent = aroundAnchor(layer->transform(), layer->anchorPoint(), bounds);
+        copy->toParent.postTranslate(SkFloatToScalar(position.x), SkFloatToScalar(position.y));
+        SkMatrix toViewport = parentToViewport;
+        toViewport.preConcat(copy->toParent);
+        *rasteredPixels += layer->updateContents(interestRect(toViewport, viewport, bounds), scale);
+
+        copy->sublayer = aroundAnchor(layer->sublayerTransform(), layer->anchorPoint(), bounds);
+        copy->opacity = layer->opacity();
+        copy->masksToBounds = layer->masksToBounds();
+        copy->bounds = SkISize::Make(bounds.width, bounds.height);
+        copy->backgroundColor = layer->backgroundColor();
+        if (layer->drawsContent()) {
+            const std::vector<WebLayerImpl::Tile>& tiles = layer->tiles();
+            for (size_t i = 0; i < tiles.size(); ++i) {
+                if (!tiles[i].bitmap.isNull())
+                    copy->tiles.push_back(tiles[i]);
+            }
+        }
+        copy->contentsScale = SkFloatToScalar(layer->contentsScale());
+        copy->scrollable = layer->scrollable();
+        copy->scrollPosition = SkIPoint::Make(layer->scrollPosition().x, layer->scrollPosition().y);
+        copy->maxScrollPosition = SkISize::Make(layer->maxScrollPosition().width, layer->maxScrollPosition().height);
+
+        toViewport.preConcat(copy->sublayer);
+        toViewport.preTranslate(-SkIntToScalar(copy->scrollPosition.x()), -SkIntToScalar(copy->scrollPosition.y()));
+        const std::vector<WebLayerImpl*>& children = layer->children();
+        for (size_t i = 0; i < children.size(); ++i)
+            copy->children.push_back(snapshot(children[i], toViewport, viewport, scale, rasteredPixels).release());
+        return copy.Pass();
+    }
+
+    void drawLayer(SkCanvas* canvas, const CompositorLayer& layer)
+    {
+        if (layer.opacity <= 0)
+            return;
+        int saveCount = canvas->save();
+        canvas->concat(layer.toParent);
+        if (layer.opacity < 1)
+            canvas->saveLayerAlpha(0, static_cast<U8CPU>(layer.opacity * 255 + 0.5f));
+
+        SkRect bounds = SkRect::MakeWH(SkIntToScalar(layer.bounds.width()), SkIntToScalar(layer.bounds.height()));
+        if (SkColorGetA(layer.backgroundColor)) {
+            SkPaint paint;
+            paint.setColor(layer.backgroundColor);
+            canvas->drawRect(bounds, paint);
+        }
+        if (!layer.tiles.empty()) {
+            canvas->save();
+            canvas->scale(SK_Scalar1 / layer.contentsScale, SK_Scalar1 / layer.contentsScale);
+            for (size_t i = 0; i < layer.tiles.size(); ++i) {
+                const WebLayerImpl::Tile& tile = layer.tiles[i];
+                canvas->drawBitmap(tile.bitmap, SkIntToScalar(tile.origin.x()), SkIntToScalar(tile.origin.y()));
+            }
+            canvas->restore();
+        }
+
+        if (layer.masksToBounds)
+            canvas->clipRect(bounds);
+        canvas->concat(layer.sublayer);
+        canvas->translate(-SkIntToScalar(layer.scrollPosition.x()), -SkIntToScalar(layer.scrollPosition.y()));
+        for (size_t i = 0; i < layer.children.size(); ++i)
+            drawLayer(canvas, *layer.children[i]);
+        canvas->restoreToCount(saveCount);
+    }
+
+    CompositorLayer* outermostScrollable(CompositorLayer* layer)
+    {
+        if (layer->scrollable && (layer->maxScrollPosition.width() > 0 || layer->maxScrollPosition.height() > 0))
+            return layer;
+        for (size_t i = 0; i < layer->children.size(); ++i) {
+            if (CompositorLayer* found = outermostScrollable(layer->children[i]))
+                return found;
+        }
+        return 0;
+    }
+
+}
+
+// The compositor-thread half. Owns the last snapshot and the output buffers.
+class WebLayerTreeViewImpl::Compositor : public base::RefCountedThreadSafe<Compositor>
+{
+public:
+    struct Frame {
+        scoped_ptr<CompositorLayer> root;
+        WebSize viewportSize;
+        float scale;
+        SkColor backgroundColor;
+    };
+
+    Compositor(const scoped_refptr<base::MessageLoopProxy>& mainLoop,
+               const base::WeakPtr<WebLayerTreeViewImpl>& owner)
+        : m_mainLoop(mainLoop)
+        , m_owner(owner)
+        , m_scale(1)
+        , m_backgroundColor(SK_ColorWHITE)
+        , m_compositedFrames(0)
+    {
+    }
+
+    void commit(scoped_ptr<Frame> frame)
+    {
+        m_root = frame->root.Pass();
+        m_viewportSize = frame->viewportSize;
+        m_scale = frame->scale;
+        m_backgroundColor = frame->backgroundColor;
+        composite();
+    }
+
+    void scrollBy(const WebSize& delta)
+    {
+        CompositorLayer* layer = m_root ? outermostScrollable(m_root.get()) : 0;
+        if (!layer)
+            return;
+        SkIPoint position = SkIPoint::Make(
+            std::max(0, std::min(layer->scrollPosition.x() + delta.width, layer->maxScrollPosition.width())),
+            std::max(0, std::min(layer->scrollPosition.y() + delta.height, layer->maxScrollPosition.height())));
+        if (position == layer->scrollPosition)
+            return;
+        layer->scrollPosition = position;
+        composite();
+        m_mainLoop->PostTask(FROM_HERE, base::Bind(&WebLayerTreeViewImpl::didScroll, m_owner,
+                                                   layer->id, WebPoint(position.x(), position.y())));
+    }
+
+    void signal(base::WaitableEvent* event)
+    {
+        event->Signal();
+    }
+
+    base::Lock& outputLock() { return m_outputLock; }
+    const SkBitmap& output() const { return m_front; }
+    int64 compositedFrames()
+    {
+        base::AutoLock locker(m_outputLock);
+        return m_compositedFrames;
+    }
+
+private:
+    friend class base::RefCountedThreadSafe<Compositor>;
+    ~Compositor() { }
+
+    void composite()
+    {
+        TRACE_EVENT0("webui", "WebLayerTreeViewImpl::composite");
+        if (m_back.width() != m_viewportSize.width || m_back.height() != m_viewportSize.height) {
+            m_back.setConfig(SkBitmap::kARGB_8888_Config, m_viewportSize.width, m_viewportSize.height);
+            m_back.allocPixels();
+        }
+        if (m_back.isNull())
+            return;
+        SkCanvas canvas(m_back);
+        canvas.drawColor(m_backgroundColor, SkXfermode::kSrc_Mode);
+        canvas.scale(SkFloatToScalar(m_scale), SkFloatToScalar(m_scale));
+        if (m_root)
+            drawLayer(&canvas, *m_root);
+        {
+            base::AutoLock locker(m_outputLock);
+            m_front.swap(m_back);
+            ++m_compositedFrames;
+        }
+        m_mainLoop->PostTask(FROM_HERE, base::Bind(&WebLayerTreeViewImpl::didComposite, m_owner));
+    }
+
+    scoped_refptr<base::MessageLoopProxy> m_mainLoop;
+    // Only dereferenced on the main thread.
+    base::WeakPtr<WebLayerTreeViewImpl> m_owner;
+
+    scoped_ptr<CompositorLayer> m_root;
+    WebSize m_viewportSize;
+    float m_scale;
+    SkColor m_backgroundColor;
+
+    base::Lock m_outputLock;
+    SkBitmap m_front;
+    SkBitmap m_back;
+    int64 m_compositedFrames;
+};
+
+WebLayerTreeViewImpl::WebLayerTreeViewImpl(const scoped_refptr<base::MessageLoopProxy>& compositorLoop,
+                                           const base::Closure& needsFrame)
+    : m_compositorLoop(compositorLoop)
+    , m_needsFrame(needsFrame)
+    , m_rootLayer(0)
+    , m_deviceScaleFactor(1)
+    , m_pageScaleFactor(1)
+    , m_backgroundColor(SK_ColorWHITE)
+    , m_hasTransparentBackground(false)
+    , m_visible(true)
+    , m_needsCommit(false)
+    , m_deferCommits(false)
+    , m_rasteredPixels(0)
+    , m_weakFactory(this)
+{
+    m_compositor = new Compositor(base::MessageLoopProxy::current(), m_weakFactory.GetWeakPtr());
+}
+
+WebLayerTreeViewImpl::~WebLayerTreeViewImpl()
+{
+    m_needsFrame.Reset();
+    clearRootLayer();
+}
+
+void WebLayerTreeViewImpl::setPresentCallback(const base::Closure& callback)
+{
+    m_presentCallback = callback;
+}
+
+void WebLayerTreeViewImpl::setNeedsCommit()
+{
+    if (m_needsCommit)
+        return;
+    m_needsCommit = true;
+    if (!m_deferCommits && !m_needsFrame.is_null())
+        m_needsFrame.Run();
+}
+
+void WebLayerTreeViewImpl::commit()
+{
+    if (!m_needsCommit || m_deferCommits || !m_visible)
+        return;
+    TRACE_EVENT0("webui", "WebLayerTreeViewImpl::commit");
+    m_needsCommit = false;
+
+    scoped_ptr<Compositor::Frame> frame(new Compositor::Frame);
+    if (m_rootLayer) {
+        SkMatrix toViewport;
+        toViewport.setScale(SkFloatToScalar(m_deviceScaleFactor), SkFloatToScalar(m_deviceScaleFactor));
+        SkIRect viewport = SkIRect::MakeWH(m_deviceViewportSize.width, m_deviceViewportSize.height);
+        frame->root = snapshot(m_rootLayer, toViewport, viewport, m_deviceScaleFactor, &m_rasteredPixels);
+    }
+    frame->viewportSize = m_deviceViewportSize;
+    frame->scale = m_deviceScaleFactor;
+    frame->backgroundColor = m_hasTransparentBackground ? SK_ColorTRANSPARENT : m_backgroundColor;
+    m_compositorLoop->PostTask(FROM_HERE,
+        base::Bind(&Compositor::commit, m_compositor, base::Passed(&frame)));
+}
+
+void WebLayerTreeViewImpl::scrollBy(const WebSize& delta)
+{
+    m_compositorLoop->PostTask(FROM_HERE, base::Bind(&Compositor::scrollBy, m_compositor, delta));
+}
+
+base::Lock& WebLayerTreeViewImpl::outputLock()
+{
+    return m_compositor->outputLock();
+}
+
+const SkBitmap& WebLayerTreeViewImpl::output() const
+{
+    return m_compositor->output();
+}
+
+int64 WebLayerTreeViewImpl::compositedFrames() const
+{
+    return m_compositor->compositedFrames();
+}
+
+void WebLayerTreeViewImpl::didComposite()
+{
+    if (!m_presentCallback.is_null())
+        m_presentCallback.Run();
+}
+
+void WebLayerTreeViewImpl::didScroll(int layerId, const WebPoint& position)
+{
+    std::vector<WebLayerImpl*> pending;
+    if (m_rootLayer)
+        pending.push_back(m_rootLayer);
+    while (!pending.empty()) {
+        WebLayerImpl* layer = pending.back();
+        pending.pop_back();
+        if (layer->id() == layerId) {
+            layer->didScrollOnCompositor(position);
+            return;
+        }
+        pending.insert(pending.end(), layer->children().begin(), layer->children().end());
+    }
+}
+
+void WebLayerTreeViewImpl::setSurfaceReady()
+{
+}
+
+void WebLayerTreeViewImpl::setRootLayer(const WebLayer& layer)
+{
+    clearRootLayer();
+    m_rootLayer = static_cast<WebLayerImpl*>(const_cast<WebLayer*>(&layer));
+    m_rootLayer->setTreeView(this);
+    setNeedsCommit();
+}
+
+void WebLayerTreeViewImpl::clearRootLayer()
+{
+    if (!m_rootLayer)
+        return;
+    m_rootLayer->setTreeView(0);
+    m_rootLayer = 0;
+    setNeedsCommit();
+}
+
+void WebLayerTreeViewImpl::setViewportSize(const WebSize& layoutViewportSize, const WebSize& deviceViewportSize)
+{
+    m_layoutViewportSize = layoutViewportSize;
+    m_deviceViewportSize = deviceViewportSize;
+    setNeedsCommit();
+}
+
+WebSize WebLayerTreeViewImpl::layoutViewportSize() const
+{
+    return m_layoutViewportSize;
+}
+
+WebSize WebLayerTreeViewImpl::deviceViewportSize() const
+{
+    return m_deviceViewportSize;
+}
+
+WebFloatPoint WebLayerTreeViewImpl::adjustEventPointForPinchZoom(const WebFloatPoint& point) const
+{
+    return point;
+}
+
+void WebLayerTreeViewImpl::setDeviceScaleFactor(float scale)
+{
+    m_deviceScaleFactor = scale;
+    setNeedsCommit();
+}
+
+float WebLayerTreeViewImpl::deviceScaleFactor() const
+{
+    return m_deviceScaleFactor;
+}
+
+void WebLayerTreeViewImpl::setBackgroundColor(WebColor color)
+{
+    m_backgroundColor = color;
+    setNeedsCommit();
+}
+
+void WebLayerTreeViewImpl::setHasTransparentBackground(bool transparent)
+{
+    m_hasTransparentBackground = transparent;
+    setNeedsCommit();
+}
+
+void WebLayerTreeViewImpl::setVisible(bool visible)
+{
+    m_visible = visible;
+    if (visible)
+        setNeedsCommit();
+}
+
+// Blink applies the page scale to the layers it builds; there is no pinch
+// zoom to animate here.
+void WebLayerTreeViewImpl::setPageScaleFactorAndLimits(float pageScaleFactor, float, float)
+{
+    m_pageScaleFactor = pageScaleFactor;
+}
+
+void WebLayerTreeViewImpl::startPageScaleAnimation(const WebPoint&, bool, float, double)
+{
+}
+
+void WebLayerTreeViewImpl::setNeedsAnimate()
+{
+    if (!m_needsFrame.is_null())
+        m_needsFrame.Run();
+}
+
+bool WebLayerTreeViewImpl::commitRequested() const
+{
+    return m_needsCommit;
+}
+
+bool WebLayerTreeViewImpl::compositeAndReadback(void* pixels, const WebRect& rect)
+{
+    m_needsCommit = true;
+    commit();
+    finishAllRendering();
+
+    base::AutoLock locker(outputLock());
+    const SkBitmap& bitmap = output();
+    SkIRect source = SkIRect::MakeXYWH(rect.x, rect.y, rect.width, rect.height);
+    if (bitmap.isNull() || !SkIRect::MakeWH(bitmap.width(), bitmap.height()).contains(source))
+        return false;
+    SkAutoLockPixels lock(bitmap);
+    size_t rowBytes = rect.width * bitmap.bytesPerPixel();
+    for (int y = 0; y < rect.height; ++y) {
+        memcpy(static_cast<char*>(pixels) + y * rowBytes,
+               static_cast<const char*>(bitmap.getAddr(rect.x, rect.y + y)), rowBytes);
+    }
+    return true;
+}
+
+void WebLayerTreeViewImpl::finishAllRendering()
+{
+    // Tasks run in order, so once this one has run every earlier commit and
+    // scroll has been composited.
+    base::WaitableEvent done(false, false);
+    m_compositorLoop->PostTask(FROM_HERE,
+        base::Bind(&Compositor::signal, m_compositor, base::Unretained(&done)));
+    done.Wait();
+}
+
+void WebLayerTreeViewImpl::setDeferCommits(bool deferCommits)
+{
+    m_deferCommits = deferCommits;
+    if (!deferCommits && m_needsCommit && !m_needsFrame.is_null())
+        m_needsFrame.Run();
+}
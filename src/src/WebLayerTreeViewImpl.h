@@ -0,0 +1,120 @@
+#ifndef WebLayerTreeViewImpl_h
+#define WebLayerTreeViewImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+
+#include "../../platform/WebLayerTreeView.h"
+#include "../../platform/WebSize.h"
+
+using namespace blink;
+
+namespace base {
+    class Lock;
+    class MessageLoopProxy;
+}
+
+class WebLayerImpl;
+
+// CPU-only layer compositor behind WebViewClient::layerTreeView().
+//
+// The host calls commit() once per frame, after animate and layout. It
+// repaints the invalidated tiles of the content layers within a screen of
+// the viewport (see WebLayerImpl) and posts a snapshot of the tree to the
+// compositor thread, which draws the cached tiles with each layer's
+// transform, opacity, clip and scroll offset into an output bitmap and runs
+// the present callback on the main thread. A frame that only moves or fades
+// layers therefore rasters nothing.
+//
+// scrollBy() scrolls on the compositor thread against the last snapshot and
+// only tells the main thread afterwards, so it doesn't wait for script.
+//
+// Layers are flattened to 2D; masks, replicas and filters are ignored.
+class WebLayerTreeViewImpl : public blink::WebLayerTreeView
+{
+public:
+    // |needsFrame| asks the host for a frame, on the main thread.
+    WebLayerTreeViewImpl(const scoped_refptr<base::MessageLoopProxy>& compositorLoop,
+                         const base::Closure& needsFrame);
+    virtual ~WebLayerTreeViewImpl();
+
+    // Run on the main thread after every composite.
+    void setPresentCallback(const base::Closure&);
+
+    // Called by layers when they change.
+    void setNeedsCommit();
+
+    // Repaints invalidated layer contents and sends the tree to the
+    // compositor thread. Main thread, after layout.
+    void commit();
+
+    // Scrolls the outermost scrollable layer by |delta| on the compositor
+    // thread.
+    void scrollBy(const WebSize& delta);
+
+    // The last composited frame. Hold outputLock() while reading it.
+    base::Lock& outputLock();
+    const SkBitmap& output() const;
+
+    // Layer pixels repainted at commit, and frames composited.
+    int64 rasteredPixels() const { return m_rasteredPixels; }
+    int64 compositedFrames() const;
+
+    // WebLayerTreeView methods:
+    virtual void setSurfaceReady();
+    virtual void setRootLayer(const WebLayer&);
+    virtual void clearRootLayer();
+    virtual void setViewportSize(const WebSize& layoutViewportSize, const WebSize& deviceViewportSize);
+    virtual WebSize layoutViewportSize() const;
+    virtual WebSize deviceViewportSize() const;
+    virtual WebFloatPoint adjustEventPointForPinchZoom(const WebFloatPoint&) const;
+    virtual void setDeviceScaleFactor(float);
+    virtual float deviceScaleFactor() const;
+    virtual void setBackgroundColor(WebColor);
+    virtual void setHasTransparentBackground(bool);
+    virtual void setVisible(bool);
+    virtual void setPageScaleFactorAndLimits(float pageScaleFactor, float minimum, float maximum);
+    virtual void startPageScaleAnimation(const WebPoint& destination, bool useAnchor, float newPageScale, double durationSec);
+    virtual void setNeedsAnimate();
+    virtual bool commitRequested() const;
+    virtual bool compositeAndReadback(void* pixels, const WebRect&);
+    virtual void finishAllRendering();
+    virtual void setDeferCommits(bool);
+
+private:
+    class Compositor;
+
+    void didComposite();
+    void didScroll(int layerId, const WebPoint& position);
+
+    scoped_refptr<base::MessageLoopProxy> m_compositorLoop;
+    scoped_refptr<Compositor> m_compositor;
+    base::Closure m_needsFrame;
+    base::Closure m_presentCallback;
+
+    WebLayerImpl* m_rootLayer;
+    WebSize m_layoutViewportSize;
+    WebSize m_deviceViewportSize;
+    float m_deviceScaleFactor;
+    float m_pageScaleFactor;
+    WebColor m_backgroundColor;
+    bool m_hasTransparentBackground;
+    bool m_visible;
+    bool m_needsCommit;
+    bool m_deferCommits;
+    int64 m_rasteredPixels;
+
+    base::WeakPtrFactory<WebLayerTreeViewImpl> m_weakFactory;
+
+    DISALLOW_COPY_AND_ASSIGN(WebLayerTreeViewImpl);
+};
+
+
+#endif // WebLayerTreeViewImpl_h
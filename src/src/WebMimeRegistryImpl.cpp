@@ -0,0 +1,506 @@
+
+#include "WebMimeRegistryImpl.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "build/build_config.h"
+#include "net/base/mime_util.h"
+
+#include "../../platform/WebString.h"
+
+
+namespace
+{
+
+    // The tables below mirror net/base/mime_util.cc; debug builds check
+    // them against it at startup.
+
+    const char* const supportedImageTypes[] = {
+        "image/jpeg",
+        "image/pjpeg",
+        "image/jpg",
+        "image/webp",
+        "image/png",
+        "image/gif",
+        "image/bmp",
+        "image/vnd.microsoft.icon",
+        "image/x-icon",
+        "image/x-xbitmap",
+    };
+
+    const char* const supportedJavaScriptTypes[] = {
+        "text/javascript",
+        "text/ecmascript",
+        "application/javascript",
+        "application/ecmascript",
+        "application/x-javascript",
+        "text/javascript1.1",
+        "text/javascript1.2",
+        "text/javascript1.3",
+        "text/jscript",
+        "text/livescript",
+    };
+
+    // Besides these, the certificate and media types and the JavaScript
+    // types, every text/ type not listed in unsupportedTextTypes and every
+    // application/*+json type is supported.
+    const char* const supportedNonImageTypes[] = {
+        "image/svg+xml",
+        "application/xml",
+        "application/atom+xml",
+        "application/rss+xml",
+        "application/xhtml+xml",
+        "application/json",
+        "multipart/related",
+        "multipart/x-mixed-replace",
+    };
+
+    const char* const supportedCertificateTypes[] = {
+        "application/x-x509-user-cert",
+#if defined(OS_ANDROID)
+        "application/x-x509-ca-cert",
+        "application/x-pkcs12",
+#endif
+    };
+
+    // Supported as non-image types whether or not a media player could
+    // play them.
+    const char* const commonMediaTypes[] = {
+        "audio/ogg",
+        "application/ogg",
+#if !defined(OS_ANDROID)
+        "video/ogg",
+#endif
+        "video/webm",
+        "audio/webm",
+        "audio/wav",
+        "audio/x-wav",
+#if defined(OS_ANDROID)
+        "application/vnd.apple.mpegurl",
+        "application/x-mpegurl",
+#endif
+    };
+
+#if defined(USE_PROPRIETARY_CODECS)
+    const char* const proprietaryMediaTypes[] = {
+        "video/mp4",
+        "video/x-m4v",
+        "audio/mp4",
+        "audio/x-m4a",
+        "audio/mp3",
+        "audio/x-mp3",
+        "audio/mpeg",
+    };
+#endif
+
+    const char* const unsupportedTextTypes[] = {
+        "text/calendar",
+        "text/x-calendar",
+        "text/x-vcalendar",
+        "text/vcalendar",
+        "text/vcard",
+        "text/x-vcard",
+        "text/directory",
+        "text/ldif",
+        "text/qif",
+        "text/x-qif",
+        "text/x-csv",
+        "text/x-vcf",
+        "text/rtf",
+        "text/comma-separated-values",
+        "text/csv",
+        "text/tab-separated-values",
+        "text/tsv",
+        "text/ofx",
+        "text/vnd.sun.j2me.app-descriptor",
+    };
+
+    struct ExtensionMapping {
+        const char* extension;
+        const char* mimeType;
+        // Primary mappings win over the platform's, secondary ones only
+        // apply when the platform has none.
+        bool primary;
+    };
+
+    // One entry per extension, the one net would pick first.
+    const ExtensionMapping extensionMappings[] = {
+        { "html", "text/html", true },
+        { "htm", "text/html", true },
+        { "shtml", "text/html", true },
+        { "shtm", "text/html", true },
+        { "css", "text/css", true },
+        { "xml", "text/xml", true },
+        { "gif", "image/gif", true },
+        { "jpeg", "image/jpeg", true },
+        { "jpg", "image/jpeg", true },
+        { "webp", "image/webp", true },
+        { "png", "image/png", true },
+        { "mp4", "video/mp4", true },
+        { "m4v", "video/mp4", true },
+        { "m4a", "audio/x-m4a", true },
+        { "mp3", "audio/mp3", true },
+        { "ogv", "video/ogg", true },
+        { "ogm", "video/ogg", true },
+        { "ogg", "audio/ogg", true },
+        { "oga", "audio/ogg", true },
+        { "opus", "audio/ogg", true },
+        { "webm", "video/webm", true },
+        { "wav", "audio/wav", true },
+        { "xhtml", "application/xhtml+xml", true },
+        { "xht", "application/xhtml+xml", true },
+        { "xhtm", "application/xhtml+xml", true },
+        { "crx", "application/x-chrome-extension", true },
+        { "mhtml", "multipart/related", true },
+        { "mht", "multipart/related", true },
+
+        { "exe", "application/octet-stream", false },
+        { "com", "application/octet-stream", false },
+        { "bin", "application/octet-stream", false },
+        { "gz", "application/gzip", false },
+        { "pdf", "application/pdf", false },
+        { "ps", "application/postscript", false },
+        { "eps", "application/postscript", false },
+        { "ai", "application/postscript", false },
+        { "js", "application/javascript", false },
+        { "woff", "application/font-woff", false },
+        { "bmp", "image/bmp", false },
+        { "ico", "image/x-icon", false },
+        { "jfif", "image/jpeg", false },
+        { "pjpeg", "image/jpeg", false },
+        { "pjp", "image/jpeg", false },
+        { "tiff", "image/tiff", false },
+        { "tif", "image/tiff", false },
+        { "xbm", "image/x-xbitmap", false },
+        { "svg", "image/svg+xml", false },
+        { "svgz", "image/svg+xml", false },
+        { "eml", "message/rfc822", false },
+        { "txt", "text/plain", false },
+        { "text", "text/plain", false },
+        { "ehtml", "text/html", false },
+        { "rss", "application/rss+xml", false },
+        { "rdf", "application/rdf+xml", false },
+        { "xsl", "text/xml", false },
+        { "xbl", "text/xml", false },
+        { "xslt", "text/xml", false },
+        { "xul", "application/vnd.mozilla.xul+xml", false },
+        { "swf", "application/x-shockwave-flash", false },
+        { "swl", "application/x-shockwave-flash", false },
+        { "p7m", "application/pkcs7-mime", false },
+        { "p7c", "application/pkcs7-mime", false },
+        { "p7z", "application/pkcs7-mime", false },
+        { "p7s", "application/pkcs7-signature", false },
+    };
+
+    template <size_t N>
+    std::vector<const char*> keyList(const char* const (&keys)[N])
+    {
+        return std::vector<const char*>(keys, keys + N);
+    }
+
+    template <size_t N>
+    void appendKeys(std::vector<const char*>* list, const char* const (&keys)[N])
+    {
+        list->insert(list->end(), keys, keys + N);
+    }
+
+    // Every type net's non-image map holds, apart from the JavaScript
+    // types, which have a table of their own.
+    std::vector<const char*> nonImageKeyList()
+    {
+        std::vector<const char*> keys = keyList(supportedNonImageTypes);
+        appendKeys(&keys, supportedCertificateTypes);
+        appendKeys(&keys, commonMediaTypes);
+#if defined(USE_PROPRIETARY_CODECS)
+        appendKeys(&keys, proprietaryMediaTypes);
+#endif
+        return keys;
+    }
+
+    uint32 hashKey(const char* key, size_t length, uint32 seed)
+    {
+        // FNV-1a, seeded, with a final mix so the low bits used for the
+        // bucket and slot depend on every byte.
+        uint32 hash = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 16777619u;
+        }
+        hash ^= hash >> 15;
+        hash *= 0x2c1b3c6du;
+        hash ^= hash >> 12;
+        return hash;
+    }
+
+    // Lowercases |length| ASCII characters into |buffer|. False for text the
+    // tables can't hold.
+    template <typename Char>
+    bool toLowerASCII(const Char* chars, size_t length, char* buffer)
+    {
+        if (length > WebMimeRegistryImpl::maxKeyLength)
+            return false;
+        for (size_t i = 0; i < length; ++i) {
+            Char c = chars[i];
+            if (c <= 0 || c >= 0x80)
+                return false;
+            buffer[i] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        }
+        return true;
+    }
+
+    bool startsWith(const char* text, size_t length, const char* prefix)
+    {
+        size_t prefixLength = strlen(prefix);
+        return length >= prefixLength && !memcmp(text, prefix, prefixLength);
+    }
+
+    bool endsWith(const char* text, size_t length, const char* suffix)
+    {
+        size_t suffixLength = strlen(suffix);
+        return length >= suffixLength && !memcmp(text + length - suffixLength, suffix, suffixLength);
+    }
+
+    WebMimeRegistry::SupportsType supportsType(bool supported)
+    {
+        return supported ? WebMimeRegistry::IsSupported : WebMimeRegistry::IsNotSupported;
+    }
+
+    base::FilePath::StringType toFilePathString(const WebString& string)
+    {
+        return base::FilePath::FromUTF8Unsafe(string.utf8()).value();
+    }
+
+}
+
+WebMimeRegistryImpl::PerfectHash::PerfectHash()
+    : m_mask(0)
+{
+}
+
+WebMimeRegistryImpl::PerfectHash::~PerfectHash()
+{
+}
+
+void WebMimeRegistryImpl::PerfectHash::build(const std::vector<const char*>& keys)
+{
+    m_keys = keys;
+    m_lengths.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        m_lengths[i] = strlen(keys[i]);
+        DCHECK_LE(m_lengths[i], maxKeyLength);
+    }
+
+    // As many buckets as slots, a power of two at least the key count.
+    size_t size = 1;
+    while (size < keys.size())
+        size <<= 1;
+    m_mask = static_cast<uint32>(size - 1);
+    m_seeds.assign(size, 0);
+    m_slots.assign(size, -1);
+
+    std::vector<std::vector<int> > buckets(size);
+    for (size_t i = 0; i < keys.size(); ++i)
+        buckets[hashKey(keys[i], m_lengths[i], 0) & m_mask].push_back(static_cast<int>(i));
+
+    // Place the fullest buckets first, while most slots are still free.
+    std::vector<std::pair<size_t, size_t> > order;
+    for (size_t i = 0; i < size; ++i) {
+        if (!buckets[i].empty())
+            order.push_back(std::make_pair(buckets[i].size(), i));
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    std::vector<uint32> placed;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const std::vector<int>& bucket = buckets[order[i].second];
+        uint32 seed = 1;
+        for (; seed <= kuint16max; ++seed) {
+            placed.clear();
+            for (size_t j = 0; j < bucket.size(); ++j) {
+                uint32 slot = hashKey(keys[bucket[j]], m_lengths[bucket[j]], seed) & m_mask;
+                if (m_slots[slot] >= 0 || std::find(placed.begin(), placed.end(), slot) != placed.end())
+                    break;
+                placed.push_back(slot);
+            }
+            if (placed.size() == bucket.size())
+                break;
+        }
+        CHECK_LE(seed, kuint16max);
+        m_seeds[order[i].second] = static_cast<uint16>(seed);
+        for (size_t j = 0; j < bucket.size(); ++j)
+            m_slots[placed[j]] = static_cast<int16>(bucket[j]);
+    }
+}
+
+int WebMimeRegistryImpl::PerfectHash::find(const char* key, size_t length) const
+{
+    if (m_seeds.empty())
+        return -1;
+    uint16 seed = m_seeds[hashKey(key, length, 0) & m_mask];
+    if (!seed)
+        return -1;
+    int index = m_slots[hashKey(key, length, seed) & m_mask];
+    if (index < 0 || m_lengths[index] != length || memcmp(m_keys[index], key, length))
+        return -1;
+    return index;
+}
+
+WebMimeRegistryImpl::WebMimeRegistryImpl()
+{
+    m_imageTypes.build(keyList(supportedImageTypes));
+    m_javaScriptTypes.build(keyList(supportedJavaScriptTypes));
+    std::vector<const char*> nonImageTypes = nonImageKeyList();
+    m_nonImageTypes.build(nonImageTypes);
+    m_unsupportedTextTypes.build(keyList(unsupportedTextTypes));
+
+    std::vector<const char*> extensions;
+    for (size_t i = 0; i < arraysize(extensionMappings); ++i)
+        extensions.push_back(extensionMappings[i].extension);
+    m_extensions.build(extensions);
+
+#ifndef NDEBUG
+    for (size_t i = 0; i < arraysize(supportedImageTypes); ++i)
+        DCHECK(net::IsSupportedImageMimeType(supportedImageTypes[i])) << supportedImageTypes[i];
+    for (size_t i = 0; i < arraysize(supportedJavaScriptTypes); ++i)
+        DCHECK(net::IsSupportedJavascriptMimeType(supportedJavaScriptTypes[i])) << supportedJavaScriptTypes[i];
+    for (size_t i = 0; i < nonImageTypes.size(); ++i)
+        DCHECK(net::IsSupportedNonImageMimeType(nonImageTypes[i])) << nonImageTypes[i];
+    for (size_t i = 0; i < arraysize(unsupportedTextTypes); ++i)
+        DCHECK(!net::IsSupportedNonImageMimeType(unsupportedTextTypes[i])) << unsupportedTextTypes[i];
+    for (size_t i = 0; i < arraysize(extensionMappings); ++i) {
+        std::string mimeType;
+        net::GetWellKnownMimeTypeFromExtension(base::FilePath::FromUTF8Unsafe(extensionMappings[i].extension).value(), &mimeType);
+        DCHECK_EQ(mimeType, extensionMappings[i].mimeType) << extensionMappings[i].extension;
+    }
+#endif
+}
+
+WebMimeRegistryImpl::~WebMimeRegistryImpl()
+{
+}
+
+bool WebMimeRegistryImpl::isSupportedImageMimeType(const std::string& mimeType) const
+{
+    char key[maxKeyLength];
+    return toLowerASCII(mimeType.data(), mimeType.size(), key) && m_imageTypes.find(key, mimeType.size()) >= 0;
+}
+
+bool WebMimeRegistryImpl::isSupportedJavaScriptMimeType(const std::string& mimeType) const
+{
+    char key[maxKeyLength];
+    return toLowerASCII(mimeType.data(), mimeType.size(), key) && m_javaScriptTypes.find(key, mimeType.size()) >= 0;
+}
+
+bool WebMimeRegistryImpl::isSupportedNonImageMimeType(const std::string& mimeType) const
+{
+    char key[maxKeyLength];
+    return toLowerASCII(mimeType.data(), mimeType.size(), key) && isSupportedNonImageMimeType(key, mimeType.size());
+}
+
+bool WebMimeRegistryImpl::isSupportedMimeType(const std::string& mimeType) const
+{
+    char key[maxKeyLength];
+    if (!toLowerASCII(mimeType.data(), mimeType.size(), key))
+        return false;
+    return m_imageTypes.find(key, mimeType.size()) >= 0 || isSupportedNonImageMimeType(key, mimeType.size());
+}
+
+bool WebMimeRegistryImpl::isSupportedNonImageMimeType(const char* type, size_t length) const
+{
+    if (m_nonImageTypes.find(type, length) >= 0 || m_javaScriptTypes.find(type, length) >= 0)
+        return true;
+    if (startsWith(type, length, "text/"))
+        return m_unsupportedTextTypes.find(type, length) < 0;
+    return startsWith(type, length, "application/") && endsWith(type, length, "+json");
+}
+
+WebMimeRegistry::SupportsType WebMimeRegistryImpl::supportsMIMEType(const WebString& mimeType)
+{
+    char key[maxKeyLength];
+    if (!toLowerASCII(mimeType.data(), mimeType.length(), key))
+        return IsNotSupported;
+    return supportsType(m_imageTypes.find(key, mimeType.length()) >= 0 || isSupportedNonImageMimeType(key, mimeType.length()));
+}
+
+WebMimeRegistry::SupportsType WebMimeRegistryImpl::supportsImageMIMEType(const WebString& mimeType)
+{
+    char key[maxKeyLength];
+    return supportsType(toLowerASCII(mimeType.data(), mimeType.length(), key) && m_imageTypes.find(key, mimeType.length()) >= 0);
+}
+
+WebMimeRegistry::SupportsType WebMimeRegistryImpl::supportsJavaScriptMIMEType(const WebString& mimeType)
+{
+    char key[maxKeyLength];
+    return supportsType(toLowerASCII(mimeType.data(), mimeType.length(), key) && m_javaScriptTypes.find(key, mimeType.length()) >= 0);
+}
+
+// There is no media player (see WebFrameClientImpl::createMediaPlayer()).
+WebMimeRegistry::SupportsType WebMimeRegistryImpl::supportsMediaMIMEType(const WebString&, const WebString&, const WebString&)
+{
+    return IsNotSupported;
+}
+
+bool WebMimeRegistryImpl::supportsMediaSourceMIMEType(const WebString&, const WebString&)
+{
+    return false;
+}
+
+WebMimeRegistry::SupportsType WebMimeRegistryImpl::supportsNonImageMIMEType(const WebString& mimeType)
+{
+    char key[maxKeyLength];
+    return supportsType(toLowerASCII(mimeType.data(), mimeType.length(), key) && isSupportedNonImageMimeType(key, mimeType.length()));
+}
+
+int WebMimeRegistryImpl::findExtension(const WebString& extension, bool wellKnown) const
+{
+    char key[maxKeyLength];
+    if (!toLowerASCII(extension.data(), extension.length(), key))
+        return -1;
+    int index = m_extensions.find(key, extension.length());
+    if (index < 0 || (!wellKnown && !extensionMappings[index].primary))
+        return -1;
+    return index;
+}
+
+WebString WebMimeRegistryImpl::mimeTypeForExtension(const WebString& extension)
+{
+    int index = findExtension(extension, false);
+    if (index >= 0)
+        return WebString::fromUTF8(extensionMappings[index].mimeType);
+    // The platform's mapping comes before the secondary ones.
+    std::string mimeType;
+    net::GetMimeTypeFromExtension(toFilePathString(extension), &mimeType);
+    return WebString::fromUTF8(mimeType);
+}
+
+WebString WebMimeRegistryImpl::wellKnownMimeTypeForExtension(const WebString& extension)
+{
+    int index = findExtension(extension, true);
+    if (index >= 0)
+        return WebString::fromUTF8(extensionMappings[index].mimeType);
+    std::string mimeType;
+    net::GetWellKnownMimeTypeFromExtension(toFilePathString(extension), &mimeType);
+    return WebString::fromUTF8(mimeType);
+}
+
+WebString WebMimeRegistryImpl::mimeTypeFromFile(const WebString& filePath)
+{
+    // The extension is what follows the last dot of the last component.
+    const WebUChar* chars = filePath.data();
+    size_t length = filePath.length();
+    size_t dot = length;
+    for (size_t i = length; i-- > 0;) {
+        if (chars[i] == '/' || chars[i] == '\\')
+            break;
+        if (chars[i] == '.') {
+            dot = i;
+            break;
+        }
+    }
+    if (dot == length)
+        return WebString();
+    return mimeTypeForExtension(WebString(chars + dot + 1, length - dot - 1));
+}
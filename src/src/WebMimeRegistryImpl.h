@@ -0,0 +1,94 @@
+#ifndef WebMimeRegistryImpl_h
+#define WebMimeRegistryImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+
+#include "../../platform/WebMimeRegistry.h"
+
+using namespace blink;
+
+// WebMimeRegistry answering from static tables that mirror
+// net/base/mime_util.cc.
+//
+// The constructor indexes each table with a perfect hash (hash and
+// displace: a key's first hash picks a bucket, and the bucket's
+// displacement, chosen so that no two keys share a slot, seeds the second
+// hash that picks the slot). A lookup lowercases the key into a stack
+// buffer, hashes it twice and compares it with the one key in that slot,
+// so the type checks Blink makes for every resource neither allocate nor
+// take a lock. Extensions the tables don't know fall back to net, which
+// also asks the platform.
+//
+// Immutable after construction; the std::string methods may be used on any
+// thread.
+class WebMimeRegistryImpl : public blink::WebMimeRegistry
+{
+public:
+    WebMimeRegistryImpl();
+    virtual ~WebMimeRegistryImpl();
+
+    // The same answers as net::IsSupported*MimeType() for lowercase types.
+    bool isSupportedImageMimeType(const std::string&) const;
+    bool isSupportedJavaScriptMimeType(const std::string&) const;
+    bool isSupportedNonImageMimeType(const std::string&) const;
+    bool isSupportedMimeType(const std::string&) const;
+
+    // WebMimeRegistry methods:
+    virtual SupportsType supportsMIMEType(const WebString&);
+    virtual SupportsType supportsImageMIMEType(const WebString&);
+    virtual SupportsType supportsJavaScriptMIMEType(const WebString&);
+    virtual SupportsType supportsMediaMIMEType(const WebString&, const WebString& codecs, const WebString& keySystem);
+    virtual bool supportsMediaSourceMIMEType(const WebString&, const WebString& codecs);
+    virtual SupportsType supportsNonImageMIMEType(const WebString&);
+    virtual WebString mimeTypeForExtension(const WebString&);
+    virtual WebString wellKnownMimeTypeForExtension(const WebString&);
+    virtual WebString mimeTypeFromFile(const WebString&);
+
+    // Longest key the tables hold; longer keys miss without hashing.
+    static const size_t maxKeyLength = 64;
+
+private:
+    class PerfectHash
+    {
+    public:
+        PerfectHash();
+        ~PerfectHash();
+
+        // |keys| must be distinct, lowercase and outlive the table.
+        void build(const std::vector<const char*>& keys);
+
+        // The index of |key| in the keys given to build(), or -1.
+        int find(const char* key, size_t length) const;
+
+    private:
+        std::vector<const char*> m_keys;
+        std::vector<size_t> m_lengths;
+        // Per bucket, the seed of the second hash; 0 for an empty bucket.
+        std::vector<uint16> m_seeds;
+        // Per slot, an index into m_keys or -1.
+        std::vector<int16> m_slots;
+        uint32 m_mask;
+    };
+
+    bool isSupportedNonImageMimeType(const char* type, size_t length) const;
+    // Indexes into the extension table, or -1.
+    int findExtension(const WebString&, bool wellKnown) const;
+
+    PerfectHash m_imageTypes;
+    PerfectHash m_javaScriptTypes;
+    PerfectHash m_nonImageTypes;
+    PerfectHash m_unsupportedTextTypes;
+    PerfectHash m_extensions;
+
+    DISALLOW_COPY_AND_ASSIGN(WebMimeRegistryImpl);
+};
+
+
+#endif // WebMimeRegistryImpl_h
@@ -0,0 +1,336 @@
+
+#include "WebThemeBatch.h"
+
+#include "base/debug/trace_event.h"
+#include "base/logging.h"
+
+
+namespace
+{
+
+    // How many runs addPath() looks back through for one to join.
+    const size_t maxLookback = 32;
+
+    WebThemeBatchCanvas* innermostCanvas = 0;
+
+}
+
+bool WebThemeBatch::Run::canMerge(const SkPaint& other, const SkRect& otherBounds) const
+{
+    if (!bitmap.isNull())
+        return false;
+    if (paint.getColor() != other.getColor() || SkColorGetA(other.getColor()) != 0xFF
+        || paint.getStyle() != other.getStyle() || paint.getStrokeWidth() != other.getStrokeWidth()
+        || paint.isAntiAlias() != other.isAntiAlias())
+        return false;
+    if (other.getStyle() != SkPaint::kFill_Style)
+        return true;
+    for (size_t i = 0; i < shapeBounds.size(); ++i) {
+        if (shapeBounds[i].intersects(otherBounds))
+            return false;
+    }
+    return true;
+}
+
+WebThemeBatch::WebThemeBatch(SkCanvas* target)
+    : m_target(target)
+    , m_shapeCount(0)
+    , m_drawCount(0)
+{
+}
+
+WebThemeBatch::~WebThemeBatch()
+{
+    DCHECK(m_runs.empty());
+}
+
+void WebThemeBatch::addPath(const SkPath& path, const SkPaint& paint)
+{
+    ++m_shapeCount;
+    // Hairlines and partly covered pixels reach past the path's bounds.
+    SkRect bounds = path.getBounds();
+    bounds.outset(SK_Scalar1, SK_Scalar1);
+
+    size_t lookback = 0;
+    for (size_t i = m_runs.size(); i-- > 0 && lookback++ < maxLookback;) {
+        Run& run = m_runs[i];
+        if (run.canMerge(paint, bounds)) {
+            run.path.addPath(path);
+            run.bounds.join(bounds);
+            run.shapeBounds.push_back(bounds);
+            return;
+        }
+        if (run.bounds.intersects(bounds))
+            break;
+    }
+
+    m_runs.push_back(Run());
+    Run& run = m_runs.back();
+    run.paint = paint;
+    run.path = path;
+    run.bounds = bounds;
+    run.shapeBounds.push_back(bounds);
+}
+
+void WebThemeBatch::addBitmap(const SkBitmap& bitmap, SkScalar left, SkScalar top, SkScalar scale)
+{
+    ++m_shapeCount;
+    m_runs.push_back(Run());
+    Run& run = m_runs.back();
+    run.bounds = SkRect::MakeXYWH(left, top, SkIntToScalar(bitmap.width()) / scale, SkIntToScalar(bitmap.height()) / scale);
+    run.shapeBounds.push_back(run.bounds);
+    run.bitmap = bitmap;
+    run.bitmapScale = scale;
+}
+
+void WebThemeBatch::flush()
+{
+    if (m_runs.empty())
+        return;
+    TRACE_EVENT1("webui", "WebThemeBatch::flush", "runs", m_runs.size());
+    for (size_t i = 0; i < m_runs.size(); ++i) {
+        const Run& run = m_runs[i];
+        if (run.bitmap.isNull()) {
+            m_target->drawPath(run.path, run.paint);
+            continue;
+        }
+        m_target->save();
+        m_target->translate(run.bounds.fLeft, run.bounds.fTop);
+        m_target->scale(SK_Scalar1 / run.bitmapScale, SK_Scalar1 / run.bitmapScale);
+        m_target->drawBitmap(run.bitmap, 0, 0);
+        m_target->restore();
+    }
+    m_drawCount += m_runs.size();
+    m_runs.clear();
+}
+
+WebThemeBatchCanvas::WebThemeBatchCanvas(SkCanvas* target)
+    : INHERITED(target->getDeviceSize().width(), target->getDeviceSize().height())
+    , m_batch(target)
+    , m_outer(innermostCanvas)
+{
+    // Blink reads the matrix and clip back from the canvas it paints on, so
+    // start from the target's. Nothing is forwarded before addCanvas().
+    SkIRect clip;
+    if (target->getClipDeviceBounds(&clip))
+        INHERITED::clipRect(SkRect::Make(clip), SkRegion::kIntersect_Op, false);
+    else
+        INHERITED::clipRect(SkRect::MakeEmpty(), SkRegion::kIntersect_Op, false);
+    INHERITED::setMatrix(target->getTotalMatrix());
+    addCanvas(target);
+    innermostCanvas = this;
+}
+
+WebThemeBatchCanvas::~WebThemeBatchCanvas()
+{
+    m_batch.flush();
+    TRACE_COUNTER2("webui", "WebThemeBatch", "shapes", m_batch.shapeCount(), "draws", m_batch.drawCount());
+    DCHECK_EQ(innermostCanvas, this);
+    innermostCanvas = m_outer;
+}
+
+WebThemeBatch* WebThemeBatchCanvas::batchFor(SkCanvas* canvas)
+{
+    for (WebThemeBatchCanvas* batchCanvas = innermostCanvas; batchCanvas; batchCanvas = batchCanvas->m_outer) {
+        if (batchCanvas == canvas)
+            return &batchCanvas->m_batch;
+    }
+    return 0;
+}
+
+int WebThemeBatchCanvas::save(SaveFlags flags)
+{
+    m_batch.flush();
+    return INHERITED::save(flags);
+}
+
+int WebThemeBatchCanvas::saveLayer(const SkRect* bounds, const SkPaint* paint, SaveFlags flags)
+{
+    m_batch.flush();
+    return INHERITED::saveLayer(bounds, paint, flags);
+}
+
+void WebThemeBatchCanvas::restore()
+{
+    m_batch.flush();
+    INHERITED::restore();
+}
+
+bool WebThemeBatchCanvas::translate(SkScalar dx, SkScalar dy)
+{
+    m_batch.flush();
+    return INHERITED::translate(dx, dy);
+}
+
+bool WebThemeBatchCanvas::scale(SkScalar sx, SkScalar sy)
+{
+    m_batch.flush();
+    return INHERITED::scale(sx, sy);
+}
+
+bool WebThemeBatchCanvas::rotate(SkScalar degrees)
+{
+    m_batch.flush();
+    return INHERITED::rotate(degrees);
+}
+
+bool WebThemeBatchCanvas::skew(SkScalar sx, SkScalar sy)
+{
+    m_batch.flush();
+    return INHERITED::skew(sx, sy);
+}
+
+bool WebThemeBatchCanvas::concat(const SkMatrix& matrix)
+{
+    m_batch.flush();
+    return INHERITED::concat(matrix);
+}
+
+void WebThemeBatchCanvas::setMatrix(const SkMatrix& matrix)
+{
+    m_batch.flush();
+    INHERITED::setMatrix(matrix);
+}
+
+bool WebThemeBatchCanvas::clipRect(const SkRect& rect, SkRegion::Op op, bool doAntiAlias)
+{
+    m_batch.flush();
+    return INHERITED::clipRect(rect, op, doAntiAlias);
+}
+
+bool WebThemeBatchCanvas::clipRRect(const SkRRect& rrect, SkRegion::Op op, bool doAntiAlias)
+{
+    m_batch.flush();
+    return INHERITED::clipRRect(rrect, op, doAntiAlias);
+}
+
+bool WebThemeBatchCanvas::clipPath(const SkPath& path, SkRegion::Op op, bool doAntiAlias)
+{
+    m_batch.flush();
+    return INHERITED::clipPath(path, op, doAntiAlias);
+}
+
+bool WebThemeBatchCanvas::clipRegion(const SkRegion& deviceRegion, SkRegion::Op op)
+{
+    m_batch.flush();
+    return INHERITED::clipRegion(deviceRegion, op);
+}
+
+void WebThemeBatchCanvas::clear(SkColor color)
+{
+    m_batch.flush();
+    INHERITED::clear(color);
+}
+
+void WebThemeBatchCanvas::drawPaint(const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawPaint(paint);
+}
+
+void WebThemeBatchCanvas::drawPoints(PointMode mode, size_t count, const SkPoint pts[], const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawPoints(mode, count, pts, paint);
+}
+
+void WebThemeBatchCanvas::drawOval(const SkRect& rect, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawOval(rect, paint);
+}
+
+void WebThemeBatchCanvas::drawRect(const SkRect& rect, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawRect(rect, paint);
+}
+
+void WebThemeBatchCanvas::drawRRect(const SkRRect& rrect, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawRRect(rrect, paint);
+}
+
+void WebThemeBatchCanvas::drawPath(const SkPath& path, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawPath(path, paint);
+}
+
+void WebThemeBatchCanvas::drawBitmap(const SkBitmap& bitmap, SkScalar left, SkScalar top, const SkPaint* paint)
+{
+    m_batch.flush();
+    INHERITED::drawBitmap(bitmap, left, top, paint);
+}
+
+void WebThemeBatchCanvas::drawBitmapRectToRect(const SkBitmap& bitmap, const SkRect* src, const SkRect& dst,
+                                               const SkPaint* paint, DrawBitmapRectFlags flags)
+{
+    m_batch.flush();
+    INHERITED::drawBitmapRectToRect(bitmap, src, dst, paint, flags);
+}
+
+void WebThemeBatchCanvas::drawBitmapMatrix(const SkBitmap& bitmap, const SkMatrix& matrix, const SkPaint* paint)
+{
+    m_batch.flush();
+    INHERITED::drawBitmapMatrix(bitmap, matrix, paint);
+}
+
+void WebThemeBatchCanvas::drawBitmapNine(const SkBitmap& bitmap, const SkIRect& center, const SkRect& dst, const SkPaint* paint)
+{
+    m_batch.flush();
+    INHERITED::drawBitmapNine(bitmap, center, dst, paint);
+}
+
+void WebThemeBatchCanvas::drawSprite(const SkBitmap& bitmap, int left, int top, const SkPaint* paint)
+{
+    m_batch.flush();
+    INHERITED::drawSprite(bitmap, left, top, paint);
+}
+
+void WebThemeBatchCanvas::drawText(const void* text, size_t byteLength, SkScalar x, SkScalar y, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawText(text, byteLength, x, y, paint);
+}
+
+void WebThemeBatchCanvas::drawPosText(const void* text, size_t byteLength, const SkPoint pos[], const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawPosText(text, byteLength, pos, paint);
+}
+
+void WebThemeBatchCanvas::drawPosTextH(const void* text, size_t byteLength, const SkScalar xpos[],
+                                       SkScalar constY, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawPosTextH(text, byteLength, xpos, constY, paint);
+}
+
+void WebThemeBatchCanvas::drawTextOnPath(const void* text, size_t byteLength, const SkPath& path,
+                                         const SkMatrix* matrix, const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawTextOnPath(text, byteLength, path, matrix, paint);
+}
+
+void WebThemeBatchCanvas::drawPicture(SkPicture& picture)
+{
+    m_batch.flush();
+    INHERITED::drawPicture(picture);
+}
+
+void WebThemeBatchCanvas::drawVertices(VertexMode mode, int vertexCount, const SkPoint vertices[], const SkPoint texs[],
+                                       const SkColor colors[], SkXfermode* xfermode, const uint16_t indices[], int indexCount,
+                                       const SkPaint& paint)
+{
+    m_batch.flush();
+    INHERITED::drawVertices(mode, vertexCount, vertices, texs, colors, xfermode, indices, indexCount, paint);
+}
+
+void WebThemeBatchCanvas::drawData(const void* data, size_t length)
+{
+    m_batch.flush();
+    INHERITED::drawData(data, length);
+}
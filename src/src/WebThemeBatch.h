@@ -0,0 +1,143 @@
+#ifndef WebThemeBatch_h
+#define WebThemeBatch_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkPaint.h"
+#include "third_party/skia/include/core/SkPath.h"
+#include "third_party/skia/include/core/SkRect.h"
+#include "third_party/skia/include/utils/SkNWayCanvas.h"
+
+// Theme control shapes queued for one canvas, drawn with as few Skia calls
+// as their paints allow.
+//
+// addPath() files each shape into a run of shapes sharing its color and
+// style, looking back past earlier runs as long as the shape doesn't
+// overlap them, so the queue draws the same pixels as drawing every shape
+// in order would. flush() draws each run as one path. The parts of a
+// scrollbar, for instance, come down to one fill and one edge draw per
+// color instead of two draws per box.
+//
+// Only opaque paints are merged, and fills only with shapes they don't
+// overlap, since overlapping contours of a path can cancel out.
+//
+// Controls served from WebThemeControlCache are queued as bitmaps, which
+// keep their place among the shapes but never merge.
+class WebThemeBatch
+{
+public:
+    explicit WebThemeBatch(SkCanvas* target);
+    ~WebThemeBatch();
+
+    void addPath(const SkPath&, const SkPaint&);
+    // Queues |bitmap|, |scale| pixels to the unit, with its top left corner
+    // at (left, top).
+    void addBitmap(const SkBitmap&, SkScalar left, SkScalar top, SkScalar scale);
+
+    // Draws the queued runs on the target canvas.
+    void flush();
+    bool isEmpty() const { return m_runs.empty(); }
+
+    // Shapes and bitmaps queued, and draws flush() issued for them, since
+    // construction.
+    int64 shapeCount() const { return m_shapeCount; }
+    int64 drawCount() const { return m_drawCount; }
+
+private:
+    struct Run {
+        SkPaint paint;
+        SkPath path;
+        SkRect bounds;
+        std::vector<SkRect> shapeBounds;
+        // Drawn instead of the path if set, at bounds' top left corner.
+        SkBitmap bitmap;
+        SkScalar bitmapScale;
+
+        bool canMerge(const SkPaint&, const SkRect& bounds) const;
+    };
+
+    SkCanvas* m_target;
+    std::vector<Run> m_runs;
+    int64 m_shapeCount;
+    int64 m_drawCount;
+
+    DISALLOW_COPY_AND_ASSIGN(WebThemeBatch);
+};
+
+// The canvas a host hands Blink to paint with theme batching.
+//
+// It forwards everything to |target|, except that theme controls drawn on
+// it while it is alive are queued on its batch (see batchFor()). Any other
+// draw, and any change of matrix or clip, flushes the batch first, so
+// queued controls land under the state they were drawn with and before
+// whatever Blink draws next.
+class WebThemeBatchCanvas : public SkNWayCanvas
+{
+public:
+    // |target| must outlive this canvas, which flushes when destroyed.
+    explicit WebThemeBatchCanvas(SkCanvas* target);
+    virtual ~WebThemeBatchCanvas();
+
+    WebThemeBatch& batch() { return m_batch; }
+
+    // The batch of |canvas| if it is a live WebThemeBatchCanvas, else 0.
+    // Main thread only.
+    static WebThemeBatch* batchFor(SkCanvas* canvas);
+
+    // SkCanvas methods:
+    virtual int save(SaveFlags);
+    virtual int saveLayer(const SkRect* bounds, const SkPaint*, SaveFlags);
+    virtual void restore();
+    virtual bool translate(SkScalar dx, SkScalar dy);
+    virtual bool scale(SkScalar sx, SkScalar sy);
+    virtual bool rotate(SkScalar degrees);
+    virtual bool skew(SkScalar sx, SkScalar sy);
+    virtual bool concat(const SkMatrix&);
+    virtual void setMatrix(const SkMatrix&);
+    virtual bool clipRect(const SkRect&, SkRegion::Op, bool);
+    virtual bool clipRRect(const SkRRect&, SkRegion::Op, bool);
+    virtual bool clipPath(const SkPath&, SkRegion::Op, bool);
+    virtual bool clipRegion(const SkRegion&, SkRegion::Op);
+    virtual void clear(SkColor);
+    virtual void drawPaint(const SkPaint&);
+    virtual void drawPoints(PointMode, size_t count, const SkPoint pts[], const SkPaint&);
+    virtual void drawOval(const SkRect&, const SkPaint&);
+    virtual void drawRect(const SkRect&, const SkPaint&);
+    virtual void drawRRect(const SkRRect&, const SkPaint&);
+    virtual void drawPath(const SkPath&, const SkPaint&);
+    virtual void drawBitmap(const SkBitmap&, SkScalar left, SkScalar top, const SkPaint*);
+    virtual void drawBitmapRectToRect(const SkBitmap&, const SkRect* src, const SkRect& dst,
+                                      const SkPaint*, DrawBitmapRectFlags);
+    virtual void drawBitmapMatrix(const SkBitmap&, const SkMatrix&, const SkPaint*);
+    virtual void drawBitmapNine(const SkBitmap&, const SkIRect& center, const SkRect& dst, const SkPaint*);
+    virtual void drawSprite(const SkBitmap&, int left, int top, const SkPaint*);
+    virtual void drawText(const void* text, size_t byteLength, SkScalar x, SkScalar y, const SkPaint&);
+    virtual void drawPosText(const void* text, size_t byteLength, const SkPoint pos[], const SkPaint&);
+    virtual void drawPosTextH(const void* text, size_t byteLength, const SkScalar xpos[],
+                              SkScalar constY, const SkPaint&);
+    virtual void drawTextOnPath(const void* text, size_t byteLength, const SkPath&,
+                                const SkMatrix*, const SkPaint&);
+    virtual void drawPicture(SkPicture&);
+    virtual void drawVertices(VertexMode, int vertexCount, const SkPoint vertices[], const SkPoint texs[],
+                              const SkColor colors[], SkXfermode*, const uint16_t indices[], int indexCount,
+                              const SkPaint&);
+    virtual void drawData(const void* data, size_t length);
+
+private:
+    typedef SkNWayCanvas INHERITED;
+
+    WebThemeBatch m_batch;
+    // The canvas that was innermost when this one was created.
+    WebThemeBatchCanvas* m_outer;
+
+    DISALLOW_COPY_AND_ASSIGN(WebThemeBatchCanvas);
+};
+
+
+#endif // WebThemeBatch_h
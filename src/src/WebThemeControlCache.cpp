@@ -0,0 +1,161 @@
+
+#include "WebThemeControlCache.h"
+
+#include "base/debug/trace_event.h"
+#include "WebThemeBatch.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkMatrix.h"
+
+
+namespace
+{
+
+    // The device scale the canvas draws at, or 0 if it does more than
+    // scale uniformly and translate.
+    SkScalar uniformScale(SkCanvas* canvas)
+    {
+        const SkMatrix& matrix = canvas->getTotalMatrix();
+        if (matrix.getType() & ~(SkMatrix::kTranslate_Mask | SkMatrix::kScale_Mask))
+            return 0;
+        SkScalar scale = matrix.getScaleX();
+        if (scale <= 0 || scale != matrix.getScaleY())
+            return 0;
+        return scale;
+    }
+
+    // Controls draw up to and including their right and bottom edges, so
+    // leave a pixel of room past them.
+    int deviceExtent(int extent, SkScalar scale)
+    {
+        return SkScalarCeilToInt(SkIntToScalar(extent + 2) * scale);
+    }
+
+}
+
+bool WebThemeControlCache::Key::operator<(const Key& other) const
+{
+    if (type != other.type)
+        return type < other.type;
+    if (state != other.state)
+        return state < other.state;
+    if (width != other.width)
+        return width < other.width;
+    if (height != other.height)
+        return height < other.height;
+    if (controlScale != other.controlScale)
+        return controlScale < other.controlScale;
+    return scale < other.scale;
+}
+
+WebThemeControlCache::WebThemeControlCache(size_t maxBytes)
+    : m_maxBytes(maxBytes)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_bypasses(0)
+{
+}
+
+WebThemeControlCache::~WebThemeControlCache()
+{
+}
+
+void WebThemeControlCache::draw(SkCanvas* canvas, const SkIRect& irect,
+                                WebThemeControlImpl::Type ctype, WebThemeControlImpl::State cstate, SkScalar scale,
+                                WebThemeBatch* batch)
+{
+    Key key;
+    key.type = ctype;
+    key.state = cstate;
+    key.width = irect.width();
+    key.height = irect.height();
+    key.controlScale = scale;
+    key.scale = uniformScale(canvas);
+
+    size_t bytes = 0;
+    if (key.scale && key.width >= 0 && key.height >= 0)
+        bytes = static_cast<size_t>(deviceExtent(key.width, key.scale)) * deviceExtent(key.height, key.scale) * 4;
+    if (!bytes || bytes > m_maxBytes / 8) {
+        ++m_bypasses;
+        if (batch) {
+            WebThemeControlImpl control(batch, irect, ctype, cstate, scale);
+            control.draw();
+        } else {
+            WebThemeControlImpl control(canvas, irect, ctype, cstate, scale);
+            control.draw();
+        }
+        return;
+    }
+
+    EntryMap::iterator found = m_map.find(key);
+    if (found != m_map.end()) {
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+    } else {
+        ++m_misses;
+        evictFor(bytes);
+        Entry entry;
+        entry.key = key;
+        entry.bitmap = rasterize(key);
+        m_entries.push_front(entry);
+        m_map[key] = m_entries.begin();
+        m_bytes += entry.bitmap.getSize();
+        TRACE_COUNTER2("webui", "WebThemeControlCache", "bytes", m_bytes, "entries", m_entries.size());
+    }
+
+    if (batch) {
+        batch->addBitmap(m_entries.front().bitmap, SkIntToScalar(irect.fLeft), SkIntToScalar(irect.fTop), key.scale);
+        return;
+    }
+    canvas->save();
+    canvas->translate(SkIntToScalar(irect.fLeft), SkIntToScalar(irect.fTop));
+    canvas->scale(SK_Scalar1 / key.scale, SK_Scalar1 / key.scale);
+    canvas->drawBitmap(m_entries.front().bitmap, 0, 0);
+    canvas->restore();
+}
+
+void WebThemeControlCache::setMaxBytes(size_t maxBytes)
+{
+    m_maxBytes = maxBytes;
+    evictFor(0);
+}
+
+void WebThemeControlCache::clear()
+{
+    m_entries.clear();
+    m_map.clear();
+    m_bytes = 0;
+}
+
+void WebThemeControlCache::resetStats()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_bypasses = 0;
+}
+
+SkBitmap WebThemeControlCache::rasterize(const Key& key)
+{
+    TRACE_EVENT0("webui", "WebThemeControlCache::rasterize");
+    SkBitmap bitmap;
+    bitmap.setConfig(SkBitmap::kARGB_8888_Config, deviceExtent(key.width, key.scale), deviceExtent(key.height, key.scale));
+    bitmap.allocPixels();
+    bitmap.eraseARGB(0, 0, 0, 0);
+
+    SkCanvas canvas(bitmap);
+    canvas.scale(key.scale, key.scale);
+    WebThemeControlImpl control(&canvas, SkIRect::MakeWH(key.width, key.height), key.type, key.state, key.controlScale);
+    control.draw();
+
+    bitmap.setImmutable();
+    return bitmap;
+}
+
+void WebThemeControlCache::evictFor(size_t bytes)
+{
+    while (!m_entries.empty() && m_bytes + bytes > m_maxBytes) {
+        m_bytes -= m_entries.back().bitmap.getSize();
+        m_map.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+}
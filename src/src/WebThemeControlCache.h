@@ -0,0 +1,109 @@
+#ifndef WebThemeControlCache_h
+#define WebThemeControlCache_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <list>
+#include <map>
+
+#include "base/basictypes.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkRect.h"
+
+#include "WebThemeControlImpl.h"
+
+class SkCanvas;
+class WebThemeBatch;
+
+// Rasterized theme controls, reused across paints.
+//
+// A control's pixels depend only on its type, state, size and scale (and
+// the scale of the canvas it is drawn on), so each one is drawn by
+// WebThemeControlImpl once into a transparent bitmap and blitted from then
+// on. Bitmaps are rastered at the canvas's device resolution, and controls
+// at each device scale factor keep bitmaps of their own, so a 2x display
+// neither upscales 1x bitmaps nor re-rasters when a view moves back and
+// forth between displays. Bitmaps are evicted least recently used first
+// once they add up to more than the byte budget. Canvases with rotation,
+// skew or perspective, and controls bigger than an eighth of the budget,
+// are drawn directly.
+//
+// On a WebThemeBatchCanvas the bitmaps are queued on its batch, so they land
+// in order with the shapes of controls that are not cached.
+//
+// Main thread only. Cached bitmaps are immutable, so a picture or batch that
+// recorded one stays valid after it is evicted.
+class WebThemeControlCache
+{
+public:
+    static const size_t defaultMaxBytes = 4 * 1024 * 1024;
+
+    explicit WebThemeControlCache(size_t maxBytes = defaultMaxBytes);
+    ~WebThemeControlCache();
+
+    // Draws the control like WebThemeControlImpl(canvas, irect, ctype,
+    // cstate, scale).draw() would. With |batch|, the batch of |canvas|, the
+    // control is queued on it instead.
+    void draw(SkCanvas*, const SkIRect& irect, WebThemeControlImpl::Type, WebThemeControlImpl::State,
+              SkScalar scale = SK_Scalar1, WebThemeBatch* batch = 0);
+
+    void setMaxBytes(size_t);
+    size_t maxBytes() const { return m_maxBytes; }
+    size_t bytes() const { return m_bytes; }
+    size_t entryCount() const { return m_entries.size(); }
+
+    void clear();
+
+    // Paints served from a cached bitmap, paints that had to raster, and
+    // paints that bypassed the cache.
+    int64 hits() const { return m_hits; }
+    int64 misses() const { return m_misses; }
+    int64 bypasses() const { return m_bypasses; }
+    void resetStats();
+
+private:
+    struct Key {
+        WebThemeControlImpl::Type type;
+        WebThemeControlImpl::State state;
+        int width;
+        int height;
+        // The control's scale factor.
+        SkScalar controlScale;
+        // Device pixels per pixel of the canvas.
+        SkScalar scale;
+
+        bool operator<(const Key&) const;
+    };
+
+    struct Entry {
+        Key key;
+        SkBitmap bitmap;
+    };
+
+    typedef std::list<Entry> EntryList;
+    typedef std::map<Key, EntryList::iterator> EntryMap;
+
+    // Draws the control at the origin of a new bitmap, |scale| device pixels
+    // per pixel.
+    static SkBitmap rasterize(const Key&);
+
+    // Drops least recently used entries until |bytes| more fit.
+    void evictFor(size_t bytes);
+
+    size_t m_maxBytes;
+    size_t m_bytes;
+    // Most recently used first.
+    EntryList m_entries;
+    EntryMap m_map;
+
+    int64 m_hits;
+    int64 m_misses;
+    int64 m_bypasses;
+
+    DISALLOW_COPY_AND_ASSIGN(WebThemeControlCache);
+};
+
+
+#endif // WebThemeControlCache_h
@@ -2,7 +2,7 @@
 #include "WebThemeControlImpl.h"
 
 #include "../../platform/WebCommon.h"
-#include "skia/ext/skia_utils_win.h"
+#include "WebThemeBatch.h"
 #include "third_party/skia/include/core/SkCanvas.h"
 #include "third_party/skia/include/core/SkPaint.h"
 #include "third_party/skia/include/core/SkPath.h"
@@ -33,7 +33,7 @@ namespace
         SkColorSetRGB(0xcc, 0xcc, 0xcc) //  Indeterminate (not used)
     };
 
-    SkIRect validate(const SkIRect& rect, WebThemeControlImpl::Type ctype)
+    SkIRect validate(const SkIRect& rect, WebThemeControlImpl::Type ctype, SkScalar scale)
     {
         switch (ctype) {
         case WebThemeControlImpl::UncheckedBoxType:
@@ -42,9 +42,9 @@ namespace
         case WebThemeControlImpl::CheckedRadioType: {
             SkIRect retval = rect;
 
-            // The maximum width and height is 13.
+            // The maximum width and height is 13 at 1x.
             // Center the square in the passed rectangle.
-            const int maxControlSize = 13;
+            const int maxControlSize = SkScalarRoundToInt(13 * scale);
             int controlSize = std::min(rect.width(), rect.height());
             controlSize = std::min(controlSize, maxControlSize);
 
@@ -63,11 +63,32 @@ namespace
 
 }
 
-WebThemeControlImpl::WebThemeControlImpl(SkCanvas* canvas, const SkIRect& irect, Type ctype, State cstate)
+WebThemeControlImpl::WebThemeControlImpl(SkCanvas* canvas, const SkIRect& irect, Type ctype, State cstate, SkScalar scale)
     : m_canvas(canvas)
-    , m_irect(validate(irect, ctype))
+    , m_batch(0)
+    , m_irect(validate(irect, ctype, scale))
     , m_type(ctype)
     , m_state(cstate)
+    , m_scale(scale)
+    , m_left(m_irect.fLeft)
+    , m_right(m_irect.fRight)
+    , m_top(m_irect.fTop)
+    , m_bottom(m_irect.fBottom)
+    , m_height(m_irect.height())
+    , m_width(m_irect.width())
+    , m_edgeColor(edgeColor)
+    , m_bgColor(bgColors[cstate])
+    , m_fgColor(fgColor)
+{
+}
+
+WebThemeControlImpl::WebThemeControlImpl(WebThemeBatch* batch, const SkIRect& irect, Type ctype, State cstate, SkScalar scale)
+    : m_canvas(0)
+    , m_batch(batch)
+    , m_irect(validate(irect, ctype, scale))
+    , m_type(ctype)
+    , m_state(cstate)
+    , m_scale(scale)
     , m_left(m_irect.fLeft)
     , m_right(m_irect.fRight)
     , m_top(m_irect.fTop)
@@ -84,8 +105,33 @@ WebThemeControlImpl::~WebThemeControlImpl()
 {
 }
 
+int WebThemeControlImpl::scaled(int length) const
+{
+    return SkScalarRoundToInt(SkIntToScalar(length) * m_scale);
+}
+
+void WebThemeControlImpl::queueShape(const SkPath& path, SkColor fillColor)
+{
+    SkPaint paint;
+
+    paint.setStyle(SkPaint::kFill_Style);
+    paint.setColor(fillColor);
+    m_batch->addPath(path, paint);
+
+    paint.setColor(m_edgeColor);
+    paint.setStyle(SkPaint::kStroke_Style);
+    m_batch->addPath(path, paint);
+}
+
 void WebThemeControlImpl::box(const SkIRect& rect, SkColor fillColor)
 {
+    if (m_batch) {
+        SkPath path;
+        path.addRect(SkRect::Make(rect));
+        queueShape(path, fillColor);
+        return;
+    }
+
     SkPaint paint;
 
     paint.setStyle(SkPaint::kFill_Style);
@@ -101,6 +147,15 @@ void WebThemeControlImpl::line(int x0, int y0, int x1, int y1, SkColor color)
 {
     SkPaint paint;
     paint.setColor(color);
+    if (m_batch) {
+        // drawLine() strokes whatever the paint's style.
+        SkPath path;
+        path.moveTo(SkIntToScalar(x0), SkIntToScalar(y0));
+        path.lineTo(SkIntToScalar(x1), SkIntToScalar(y1));
+        paint.setStyle(SkPaint::kStroke_Style);
+        m_batch->addPath(path, paint);
+        return;
+    }
     m_canvas->drawLine(SkIntToScalar(x0), SkIntToScalar(y0), SkIntToScalar(x1), SkIntToScalar(y1), paint);
 }
 
@@ -116,6 +171,10 @@ void WebThemeControlImpl::triangle(int x0, int y0, int x1, int y1, int x2, int y
     path.lineTo(SkIntToScalar(x1), SkIntToScalar(y1));
     path.lineTo(SkIntToScalar(x2), SkIntToScalar(y2));
     path.close();
+    if (m_batch) {
+        queueShape(path, color);
+        return;
+    }
     m_canvas->drawPath(path, paint);
 
     paint.setColor(m_edgeColor);
@@ -126,10 +185,16 @@ void WebThemeControlImpl::triangle(int x0, int y0, int x1, int y1, int x2, int y
 void WebThemeControlImpl::roundRect(SkColor color)
 {
     SkRect rect;
-    SkScalar radius = SkIntToScalar(5);
+    SkScalar radius = SkIntToScalar(scaled(5));
     SkPaint paint;
 
     rect.set(m_irect);
+    if (m_batch) {
+        SkPath path;
+        path.addRoundRect(rect, radius, radius);
+        queueShape(path, color);
+        return;
+    }
     paint.setColor(color);
     paint.setStyle(SkPaint::kFill_Style);
     m_canvas->drawRoundRect(rect, radius, radius, paint);
@@ -145,6 +210,12 @@ void WebThemeControlImpl::oval(SkColor color)
     SkPaint paint;
 
     rect.set(m_irect);
+    if (m_batch) {
+        SkPath path;
+        path.addOval(rect);
+        queueShape(path, color);
+        return;
+    }
     paint.setColor(color);
     paint.setStyle(SkPaint::kFill_Style);
     m_canvas->drawOval(rect, paint);
@@ -160,6 +231,12 @@ void WebThemeControlImpl::circle(SkScalar radius, SkColor color)
     SkScalar cx = SkIntToScalar(m_left + m_width / 2);
     SkPaint paint;
 
+    if (m_batch) {
+        SkPath path;
+        path.addCircle(cx, cy, radius);
+        queueShape(path, color);
+        return;
+    }
     paint.setColor(color);
     paint.setStyle(SkPaint::kFill_Style);
     m_canvas->drawCircle(cx, cy, radius, paint);
@@ -180,10 +257,10 @@ void WebThemeControlImpl::nestedBoxes(int indentLeft, int indentTop, int indentR
 void WebThemeControlImpl::markState()
 {
     // The horizontal lines in a read only control are spaced by this amount.
-    const int readOnlyLineOffset = 5;
+    const int readOnlyLineOffset = scaled(5);
 
     // The length of a triangle side for the corner marks.
-    const int triangleSize = 5;
+    const int triangleSize = scaled(5);
 
     switch (m_state) {
     case UnknownState:
@@ -232,23 +309,23 @@ void WebThemeControlImpl::draw()
     int quarterHeight = m_height / 4;
 
     // Indent amounts for the check in a checkbox or radio button.
-    const int checkIndent = 3;
+    const int checkIndent = scaled(3);
 
     // Indent amounts for short and long sides of the scrollbar notches.
-    const int notchLongOffset = 1;
-    const int notchShortOffset = 4;
+    const int notchLongOffset = scaled(1);
+    const int notchShortOffset = scaled(4);
     const int noOffset = 0;
 
     // Indent amounts for the short and long sides of a scroll thumb box.
     const int thumbLongIndent = 0;
-    const int thumbShortIndent = 2;
+    const int thumbShortIndent = scaled(2);
 
     // Indents for the crosshatch on a scroll grip.
-    const int gripLongIndent = 3;
-    const int gripShortIndent = 5;
+    const int gripLongIndent = scaled(3);
+    const int gripShortIndent = scaled(5);
 
     // Indents for the the slider track.
-    const int sliderIndent = 2;
+    const int sliderIndent = scaled(2);
 
     switch (m_type) {
     case UnknownType:
@@ -420,16 +497,25 @@ void WebThemeControlImpl::draw()
 void WebThemeControlImpl::drawTextField(bool drawEdges, bool fillContentArea, SkColor color)
 {
     SkPaint paint;
+    SkPath path;
+    if (m_batch)
+        path.addRect(SkRect::Make(m_irect));
 
     if (fillContentArea) {
         paint.setColor(color);
         paint.setStyle(SkPaint::kFill_Style);
-        m_canvas->drawIRect(m_irect, paint);
+        if (m_batch)
+            m_batch->addPath(path, paint);
+        else
+            m_canvas->drawIRect(m_irect, paint);
     }
     if (drawEdges) {
         paint.setColor(m_edgeColor);
         paint.setStyle(SkPaint::kStroke_Style);
-        m_canvas->drawIRect(m_irect, paint);
+        if (m_batch)
+            m_batch->addPath(path, paint);
+        else
+            m_canvas->drawIRect(m_irect, paint);
     }
 
     markState();
@@ -441,14 +527,25 @@ void WebThemeControlImpl::drawProgressBar(const SkIRect& fillRect)
 
     paint.setColor(m_bgColor);
     paint.setStyle(SkPaint::kFill_Style);
-    m_canvas->drawIRect(m_irect, paint);
+    if (m_batch) {
+        SkPath path;
+        path.addRect(SkRect::Make(m_irect));
+        m_batch->addPath(path, paint);
+    } else
+        m_canvas->drawIRect(m_irect, paint);
 
     // Emulate clipping
     SkIRect tofill;
-    tofill.intersect(m_irect, fillRect);
-    paint.setColor(m_fgColor);
-    paint.setStyle(SkPaint::kFill_Style);
-    m_canvas->drawIRect(tofill, paint);
+    if (tofill.intersect(m_irect, fillRect)) {
+        paint.setColor(m_fgColor);
+        paint.setStyle(SkPaint::kFill_Style);
+        if (m_batch) {
+            SkPath path;
+            path.addRect(SkRect::Make(tofill));
+            m_batch->addPath(path, paint);
+        } else
+            m_canvas->drawIRect(tofill, paint);
+    }
 
     markState();
 }
@@ -15,6 +15,8 @@ using namespace blink;
 
 // Skia forward declarations
 class SkCanvas;
+class SkPath;
+class WebThemeBatch;
 
 
 class WebThemeControlImpl 
@@ -95,8 +97,13 @@ public:
     };
 
     // Constructs a control of the given size, type and state to draw
-    // on to the given canvas.
-    WebThemeControlImpl(SkCanvas*, const SkIRect&, Type, State);
+    // on to the given canvas. |scale| is the device scale factor the
+    // control's fixed sizes (the checkbox size, corner radius, indents and
+    // state marks) are multiplied by; the rect is in device pixels already.
+    WebThemeControlImpl(SkCanvas*, const SkIRect&, Type, State, SkScalar scale = SK_Scalar1);
+    // Constructs a control that queues its shapes on a batch instead of
+    // drawing them.
+    WebThemeControlImpl(WebThemeBatch*, const SkIRect&, Type, State, SkScalar scale = SK_Scalar1);
     ~WebThemeControlImpl();
 
     // Draws the control.
@@ -150,10 +157,19 @@ private:
     // color is which.
     void markState();
 
+    // Queues |path| on the batch filled with |fillColor| and edged in the
+    // default edge color.
+    void queueShape(const SkPath&, SkColor fillColor);
+
+    // |length| pixels at 1x, at the control's scale.
+    int scaled(int length) const;
+
     SkCanvas* m_canvas;
+    WebThemeBatch* m_batch;
     const SkIRect m_irect;
     const Type m_type;
     const State m_state;
+    const SkScalar m_scale;
     const SkColor m_edgeColor;
     const SkColor m_bgColor;
     const SkColor m_fgColor;
@@ -3,16 +3,23 @@
 #include "WebThemeEngineImpl.h"
 
 
+#include <math.h>
+
+#include "base/basictypes.h"
 #include "../../platform/WebCommon.h"
+#include "WebThemeBatch.h"
+#include "WebThemeControlCache.h"
 #include "WebThemeControlImpl.h"
 #include "third_party/skia/include/core/SkRect.h"
 #include "../../platform/WebRect.h"
 
+#if defined(OS_WIN)
 // Although all this code is generic, we include these headers
 // to pull in the Windows #defines for the parts and states of
 // the controls.
 #include <vsstyle.h>
 #include <windows.h>
+#endif
 
 using namespace blink;
 
@@ -20,9 +27,366 @@ using namespace blink;
 namespace
 {
 
+#if !defined(OS_WIN)
+// The values of the <vsstyle.h> and <winuser.h> constants the tables below
+// are indexed by, for platforms without the Windows headers.
+    enum {
+        BP_PUSHBUTTON = 1, BP_RADIOBUTTON, BP_CHECKBOX
+    };
+    enum {
+        PBS_NORMAL = 1, PBS_HOT, PBS_PRESSED, PBS_DISABLED, PBS_DEFAULTED
+    };
+    enum {
+        RBS_UNCHECKEDNORMAL = 1, RBS_UNCHECKEDHOT, RBS_UNCHECKEDPRESSED, RBS_UNCHECKEDDISABLED,
+        RBS_CHECKEDNORMAL, RBS_CHECKEDHOT, RBS_CHECKEDPRESSED, RBS_CHECKEDDISABLED
+    };
+    enum {
+        CBS_UNCHECKEDNORMAL = 1, CBS_UNCHECKEDHOT, CBS_UNCHECKEDPRESSED, CBS_UNCHECKEDDISABLED,
+        CBS_CHECKEDNORMAL, CBS_CHECKEDHOT, CBS_CHECKEDPRESSED, CBS_CHECKEDDISABLED,
+        CBS_MIXEDNORMAL, CBS_MIXEDHOT, CBS_MIXEDPRESSED, CBS_MIXEDDISABLED
+    };
+    enum {
+        CP_DROPDOWNBUTTON = 1
+    };
+    enum {
+        CBXS_NORMAL = 1, CBXS_HOT, CBXS_PRESSED, CBXS_DISABLED
+    };
+    enum {
+        SBP_ARROWBTN = 1, SBP_THUMBBTNHORZ, SBP_THUMBBTNVERT, SBP_LOWERTRACKHORZ, SBP_UPPERTRACKHORZ,
+        SBP_LOWERTRACKVERT, SBP_UPPERTRACKVERT, SBP_GRIPPERHORZ, SBP_GRIPPERVERT
+    };
+    enum {
+        ABS_UPNORMAL = 1, ABS_UPHOT, ABS_UPPRESSED, ABS_UPDISABLED,
+        ABS_DOWNNORMAL, ABS_DOWNHOT, ABS_DOWNPRESSED, ABS_DOWNDISABLED,
+        ABS_LEFTNORMAL, ABS_LEFTHOT, ABS_LEFTPRESSED, ABS_LEFTDISABLED,
+        ABS_RIGHTNORMAL, ABS_RIGHTHOT, ABS_RIGHTPRESSED, ABS_RIGHTDISABLED,
+        ABS_UPHOVER, ABS_DOWNHOVER, ABS_LEFTHOVER, ABS_RIGHTHOVER
+    };
+    enum {
+        SCRBS_NORMAL = 1, SCRBS_HOT, SCRBS_PRESSED, SCRBS_DISABLED, SCRBS_HOVER
+    };
+    enum {
+        SPNP_UP = 1, SPNP_DOWN
+    };
+    enum {
+        UPS_NORMAL = 1, UPS_HOT, UPS_PRESSED, UPS_DISABLED
+    };
+    enum {
+        DNS_NORMAL = 1, DNS_HOT, DNS_PRESSED, DNS_DISABLED
+    };
+    enum {
+        EP_EDITTEXT = 1
+    };
+    enum {
+        ETS_NORMAL = 1, ETS_HOT, ETS_SELECTED, ETS_DISABLED, ETS_FOCUSED, ETS_READONLY
+    };
+    enum {
+        TKP_TRACK = 1, TKP_TRACKVERT, TKP_THUMB, TKP_THUMBBOTTOM, TKP_THUMBTOP, TKP_THUMBVERT
+    };
+    enum {
+        TRS_NORMAL = 1
+    };
+    enum {
+        TRVS_NORMAL = 1
+    };
+    enum {
+        TUS_NORMAL = 1, TUS_HOT, TUS_PRESSED, TUS_FOCUSED, TUS_DISABLED
+    };
+    enum {
+        DFCS_BUTTONCHECK = 0x0000,
+        DFCS_BUTTONRADIO = 0x0004,
+        DFCS_BUTTONPUSH = 0x0010,
+        DFCS_MENUARROW = 0x0000,
+        DFCS_SCROLLUP = 0x0000,
+        DFCS_SCROLLDOWN = 0x0001,
+        DFCS_SCROLLLEFT = 0x0002,
+        DFCS_SCROLLRIGHT = 0x0003,
+        DFCS_INACTIVE = 0x0100,
+        DFCS_PUSHED = 0x0200,
+        DFCS_CHECKED = 0x0400,
+        DFCS_HOT = 0x1000,
+        DFCS_FLAT = 0x4000
+    };
+#endif
+
 // We define this for clarity, although there really should be a DFCS_NORMAL in winuser.h.
     const int dfcsNormal = 0x0000;
 
+    typedef WebThemeControlImpl Control;
+
+// What a theme (part, state) pair draws, and the classic theme state Blink
+// passes along with it. An UnknownType entry is a pair Blink never asks for.
+    struct ControlMapping {
+        int state;
+        Control::Type type;
+        Control::State state;
+        int classicState;
+    };
+
+// The states of one part, indexed by state code - 1.
+    struct PartMapping {
+        int part;
+        const ControlMapping* states;
+        int stateCount;
+    };
+
+#define PART_MAPPING(part, states) { part, states, arraysize(states) }
+#define NO_PART_MAPPING(part) { part, 0, 0 }
+#define NO_CONTROL_MAPPING(state) { state, Control::UnknownType, Control::UnknownState, dfcsNormal }
+
+// The tables are indexed by code - 1, and each row also names the code it
+// is for. The COMPILE_ASSERTs below pin down the sizes; checkMappings()
+// asserts that every row sits at the index of its code.
+
+    const ControlMapping pushButtonStates[] = {
+        { PBS_NORMAL, Control::PushButtonType, Control::NormalState, DFCS_BUTTONPUSH },
+        { PBS_HOT, Control::PushButtonType, Control::HotState, DFCS_BUTTONPUSH | DFCS_HOT },
+        { PBS_PRESSED, Control::PushButtonType, Control::PressedState, DFCS_BUTTONPUSH | DFCS_PUSHED },
+        { PBS_DISABLED, Control::PushButtonType, Control::DisabledState, DFCS_BUTTONPUSH | DFCS_INACTIVE },
+        { PBS_DEFAULTED, Control::PushButtonType, Control::FocusedState, DFCS_BUTTONPUSH },
+    };
+    COMPILE_ASSERT(arraysize(pushButtonStates) == PBS_DEFAULTED, pushButtonStates_covers_PBS);
+
+    const ControlMapping radioButtonStates[] = {
+        { RBS_UNCHECKEDNORMAL, Control::UncheckedRadioType, Control::NormalState, DFCS_BUTTONRADIO },
+        { RBS_UNCHECKEDHOT, Control::UncheckedRadioType, Control::HotState, DFCS_BUTTONRADIO | DFCS_HOT },
+        { RBS_UNCHECKEDPRESSED, Control::UncheckedRadioType, Control::PressedState, DFCS_BUTTONRADIO | DFCS_PUSHED },
+        { RBS_UNCHECKEDDISABLED, Control::UncheckedRadioType, Control::DisabledState, DFCS_BUTTONRADIO | DFCS_INACTIVE },
+        { RBS_CHECKEDNORMAL, Control::CheckedRadioType, Control::NormalState, DFCS_BUTTONRADIO | DFCS_CHECKED },
+        { RBS_CHECKEDHOT, Control::CheckedRadioType, Control::HotState, DFCS_BUTTONRADIO | DFCS_CHECKED | DFCS_HOT },
+        { RBS_CHECKEDPRESSED, Control::CheckedRadioType, Control::PressedState, DFCS_BUTTONRADIO | DFCS_CHECKED | DFCS_PUSHED },
+        { RBS_CHECKEDDISABLED, Control::CheckedRadioType, Control::DisabledState, DFCS_BUTTONRADIO | DFCS_CHECKED | DFCS_INACTIVE },
+    };
+    COMPILE_ASSERT(arraysize(radioButtonStates) == RBS_CHECKEDDISABLED, radioButtonStates_covers_RBS);
+
+    const ControlMapping checkboxStates[] = {
+        { CBS_UNCHECKEDNORMAL, Control::UncheckedBoxType, Control::NormalState, dfcsNormal },
+        { CBS_UNCHECKEDHOT, Control::UncheckedBoxType, Control::HotState, DFCS_BUTTONCHECK | DFCS_HOT },
+        { CBS_UNCHECKEDPRESSED, Control::UncheckedBoxType, Control::PressedState, DFCS_BUTTONCHECK | DFCS_PUSHED },
+        { CBS_UNCHECKEDDISABLED, Control::UncheckedBoxType, Control::DisabledState, DFCS_BUTTONCHECK | DFCS_INACTIVE },
+        { CBS_CHECKEDNORMAL, Control::CheckedBoxType, Control::NormalState, DFCS_BUTTONCHECK | DFCS_CHECKED },
+        { CBS_CHECKEDHOT, Control::CheckedBoxType, Control::HotState, DFCS_BUTTONCHECK | DFCS_CHECKED | DFCS_HOT },
+        { CBS_CHECKEDPRESSED, Control::CheckedBoxType, Control::PressedState, DFCS_BUTTONCHECK | DFCS_CHECKED | DFCS_PUSHED },
+        { CBS_CHECKEDDISABLED, Control::CheckedBoxType, Control::DisabledState, DFCS_BUTTONCHECK | DFCS_CHECKED | DFCS_INACTIVE },
+        // Classic theme can't represent mixed state checkbox. We assume
+        // it's equivalent to unchecked.
+        { CBS_MIXEDNORMAL, Control::IndeterminateCheckboxType, Control::NormalState, DFCS_BUTTONCHECK },
+        { CBS_MIXEDHOT, Control::IndeterminateCheckboxType, Control::HotState, DFCS_BUTTONCHECK | DFCS_HOT },
+        { CBS_MIXEDPRESSED, Control::IndeterminateCheckboxType, Control::PressedState, DFCS_BUTTONCHECK | DFCS_PUSHED },
+        { CBS_MIXEDDISABLED, Control::IndeterminateCheckboxType, Control::DisabledState, DFCS_BUTTONCHECK | DFCS_INACTIVE },
+    };
+    COMPILE_ASSERT(arraysize(checkboxStates) == CBS_MIXEDDISABLED, checkboxStates_covers_CBS);
+
+    const PartMapping buttonParts[] = {
+        PART_MAPPING(BP_PUSHBUTTON, pushButtonStates),
+        PART_MAPPING(BP_RADIOBUTTON, radioButtonStates),
+        PART_MAPPING(BP_CHECKBOX, checkboxStates),
+    };
+    COMPILE_ASSERT(arraysize(buttonParts) == BP_CHECKBOX, buttonParts_covers_BP);
+
+    const ControlMapping dropDownButtonStates[] = {
+        { CBXS_NORMAL, Control::DropDownButtonType, Control::NormalState, DFCS_MENUARROW },
+        { CBXS_HOT, Control::DropDownButtonType, Control::HoverState, DFCS_MENUARROW | DFCS_HOT },
+        { CBXS_PRESSED, Control::DropDownButtonType, Control::PressedState, DFCS_MENUARROW | DFCS_PUSHED },
+        { CBXS_DISABLED, Control::DropDownButtonType, Control::DisabledState, DFCS_MENUARROW | DFCS_INACTIVE },
+    };
+    COMPILE_ASSERT(arraysize(dropDownButtonStates) == CBXS_DISABLED, dropDownButtonStates_covers_CBXS);
+
+    const PartMapping menuListParts[] = {
+        PART_MAPPING(CP_DROPDOWNBUTTON, dropDownButtonStates),
+    };
+
+    const ControlMapping scrollbarArrowStates[] = {
+        { ABS_UPNORMAL, Control::UpArrowType, Control::NormalState, DFCS_SCROLLUP },
+        { ABS_UPHOT, Control::UpArrowType, Control::HotState, DFCS_SCROLLUP | DFCS_HOT },
+        { ABS_UPPRESSED, Control::UpArrowType, Control::PressedState, DFCS_SCROLLUP | DFCS_PUSHED | DFCS_FLAT },
+        { ABS_UPDISABLED, Control::UpArrowType, Control::DisabledState, DFCS_SCROLLUP | DFCS_INACTIVE },
+        { ABS_DOWNNORMAL, Control::DownArrowType, Control::NormalState, DFCS_SCROLLDOWN },
+        { ABS_DOWNHOT, Control::DownArrowType, Control::HotState, DFCS_SCROLLDOWN | DFCS_HOT },
+        { ABS_DOWNPRESSED, Control::DownArrowType, Control::PressedState, DFCS_SCROLLDOWN | DFCS_PUSHED | DFCS_FLAT },
+        { ABS_DOWNDISABLED, Control::DownArrowType, Control::DisabledState, DFCS_SCROLLDOWN | DFCS_INACTIVE },
+        { ABS_LEFTNORMAL, Control::LeftArrowType, Control::NormalState, DFCS_SCROLLLEFT },
+        { ABS_LEFTHOT, Control::LeftArrowType, Control::HotState, DFCS_SCROLLLEFT | DFCS_HOT },
+        { ABS_LEFTPRESSED, Control::LeftArrowType, Control::PressedState, DFCS_SCROLLLEFT | DFCS_PUSHED | DFCS_FLAT },
+        { ABS_LEFTDISABLED, Control::LeftArrowType, Control::DisabledState, DFCS_SCROLLLEFT | DFCS_INACTIVE },
+        { ABS_RIGHTNORMAL, Control::RightArrowType, Control::NormalState, DFCS_SCROLLRIGHT },
+        { ABS_RIGHTHOT, Control::RightArrowType, Control::HotState, DFCS_SCROLLRIGHT | DFCS_HOT },
+        { ABS_RIGHTPRESSED, Control::RightArrowType, Control::PressedState, DFCS_SCROLLRIGHT | DFCS_PUSHED | DFCS_FLAT },
+        { ABS_RIGHTDISABLED, Control::RightArrowType, Control::DisabledState, DFCS_SCROLLRIGHT | DFCS_INACTIVE },
+        { ABS_UPHOVER, Control::UpArrowType, Control::HoverState, DFCS_SCROLLUP },
+        { ABS_DOWNHOVER, Control::DownArrowType, Control::HoverState, DFCS_SCROLLDOWN },
+        { ABS_LEFTHOVER, Control::LeftArrowType, Control::HoverState, DFCS_SCROLLLEFT },
+        { ABS_RIGHTHOVER, Control::RightArrowType, Control::HoverState, DFCS_SCROLLRIGHT },
+    };
+    COMPILE_ASSERT(arraysize(scrollbarArrowStates) == ABS_RIGHTHOVER, scrollbarArrowStates_covers_ABS);
+
+    // Thumbs are never painted disabled, nor tracks hot or pressed.
+#define THUMB_STATES(type) { \
+        { SCRBS_NORMAL, Control::type, Control::NormalState, dfcsNormal }, \
+        { SCRBS_HOT, Control::type, Control::HotState, DFCS_HOT }, \
+        { SCRBS_PRESSED, Control::type, Control::PressedState, dfcsNormal }, \
+        NO_CONTROL_MAPPING(SCRBS_DISABLED), \
+        { SCRBS_HOVER, Control::type, Control::HoverState, dfcsNormal }, \
+    }
+#define TRACK_STATES(type) { \
+        { SCRBS_NORMAL, Control::type, Control::NormalState, dfcsNormal }, \
+        NO_CONTROL_MAPPING(SCRBS_HOT), \
+        NO_CONTROL_MAPPING(SCRBS_PRESSED), \
+        { SCRBS_DISABLED, Control::type, Control::DisabledState, DFCS_INACTIVE }, \
+        { SCRBS_HOVER, Control::type, Control::HoverState, dfcsNormal }, \
+    }
+
+    const ControlMapping horizontalThumbStates[] = THUMB_STATES(HorizontalScrollThumbType);
+    const ControlMapping verticalThumbStates[] = THUMB_STATES(VerticalScrollThumbType);
+    const ControlMapping horizontalGripStates[] = THUMB_STATES(HorizontalScrollGripType);
+    const ControlMapping verticalGripStates[] = THUMB_STATES(VerticalScrollGripType);
+    const ControlMapping horizontalTrackForwardStates[] = TRACK_STATES(HorizontalScrollTrackForwardType);
+    const ControlMapping horizontalTrackBackStates[] = TRACK_STATES(HorizontalScrollTrackBackType);
+    const ControlMapping verticalTrackForwardStates[] = TRACK_STATES(VerticalScrollTrackForwardType);
+    const ControlMapping verticalTrackBackStates[] = TRACK_STATES(VerticalScrollTrackBackType);
+    COMPILE_ASSERT(arraysize(horizontalThumbStates) == SCRBS_HOVER, thumbStates_covers_SCRBS);
+    COMPILE_ASSERT(arraysize(horizontalTrackBackStates) == SCRBS_HOVER, trackStates_covers_SCRBS);
+
+#undef THUMB_STATES
+#undef TRACK_STATES
+
+    const PartMapping scrollbarThumbParts[] = {
+        NO_PART_MAPPING(SBP_ARROWBTN),
+        PART_MAPPING(SBP_THUMBBTNHORZ, horizontalThumbStates),
+        PART_MAPPING(SBP_THUMBBTNVERT, verticalThumbStates),
+        NO_PART_MAPPING(SBP_LOWERTRACKHORZ),
+        NO_PART_MAPPING(SBP_UPPERTRACKHORZ),
+        NO_PART_MAPPING(SBP_LOWERTRACKVERT),
+        NO_PART_MAPPING(SBP_UPPERTRACKVERT),
+        PART_MAPPING(SBP_GRIPPERHORZ, horizontalGripStates),
+        PART_MAPPING(SBP_GRIPPERVERT, verticalGripStates),
+    };
+    COMPILE_ASSERT(arraysize(scrollbarThumbParts) == SBP_GRIPPERVERT, scrollbarThumbParts_covers_SBP);
+
+    const PartMapping scrollbarTrackParts[] = {
+        NO_PART_MAPPING(SBP_ARROWBTN),
+        NO_PART_MAPPING(SBP_THUMBBTNHORZ),
+        NO_PART_MAPPING(SBP_THUMBBTNVERT),
+        PART_MAPPING(SBP_LOWERTRACKHORZ, horizontalTrackForwardStates),
+        PART_MAPPING(SBP_UPPERTRACKHORZ, horizontalTrackBackStates),
+        PART_MAPPING(SBP_LOWERTRACKVERT, verticalTrackForwardStates),
+        PART_MAPPING(SBP_UPPERTRACKVERT, verticalTrackBackStates),
+    };
+    COMPILE_ASSERT(arraysize(scrollbarTrackParts) == SBP_UPPERTRACKVERT, scrollbarTrackParts_covers_SBP);
+
+    const ControlMapping spinUpStates[] = {
+        { UPS_NORMAL, Control::UpArrowType, Control::NormalState, DFCS_SCROLLUP },
+        { UPS_HOT, Control::UpArrowType, Control::HoverState, DFCS_SCROLLUP | DFCS_HOT },
+        { UPS_PRESSED, Control::UpArrowType, Control::PressedState, DFCS_SCROLLUP | DFCS_PUSHED },
+        { UPS_DISABLED, Control::UpArrowType, Control::DisabledState, DFCS_SCROLLUP | DFCS_INACTIVE },
+    };
+    COMPILE_ASSERT(arraysize(spinUpStates) == UPS_DISABLED, spinUpStates_covers_UPS);
+
+    const ControlMapping spinDownStates[] = {
+        { DNS_NORMAL, Control::DownArrowType, Control::NormalState, DFCS_SCROLLDOWN },
+        { DNS_HOT, Control::DownArrowType, Control::HoverState, DFCS_SCROLLDOWN | DFCS_HOT },
+        { DNS_PRESSED, Control::DownArrowType, Control::PressedState, DFCS_SCROLLDOWN | DFCS_PUSHED },
+        { DNS_DISABLED, Control::DownArrowType, Control::DisabledState, DFCS_SCROLLDOWN | DFCS_INACTIVE },
+    };
+    COMPILE_ASSERT(arraysize(spinDownStates) == DNS_DISABLED, spinDownStates_covers_DNS);
+
+    const PartMapping spinButtonParts[] = {
+        PART_MAPPING(SPNP_UP, spinUpStates),
+        PART_MAPPING(SPNP_DOWN, spinDownStates),
+    };
+    COMPILE_ASSERT(arraysize(spinButtonParts) == SPNP_DOWN, spinButtonParts_covers_SPNP);
+
+    const ControlMapping textFieldStates[] = {
+        { ETS_NORMAL, Control::TextFieldType, Control::NormalState, dfcsNormal },
+        { ETS_HOT, Control::TextFieldType, Control::HotState, DFCS_HOT },
+        { ETS_SELECTED, Control::TextFieldType, Control::PressedState, DFCS_PUSHED },
+        { ETS_DISABLED, Control::TextFieldType, Control::DisabledState, DFCS_INACTIVE },
+        { ETS_FOCUSED, Control::TextFieldType, Control::FocusedState, dfcsNormal },
+        { ETS_READONLY, Control::TextFieldType, Control::ReadOnlyState, dfcsNormal },
+    };
+    COMPILE_ASSERT(arraysize(textFieldStates) == ETS_READONLY, textFieldStates_covers_ETS);
+
+    const PartMapping textFieldParts[] = {
+        PART_MAPPING(EP_EDITTEXT, textFieldStates),
+    };
+
+    const ControlMapping horizontalSliderTrackStates[] = {
+        { TRS_NORMAL, Control::HorizontalSliderTrackType, Control::NormalState, dfcsNormal },
+    };
+    const ControlMapping verticalSliderTrackStates[] = {
+        { TRVS_NORMAL, Control::VerticalSliderTrackType, Control::NormalState, dfcsNormal },
+    };
+
+#define SLIDER_THUMB_STATES(type) { \
+        { TUS_NORMAL, Control::type, Control::NormalState, dfcsNormal }, \
+        { TUS_HOT, Control::type, Control::HotState, DFCS_HOT }, \
+        { TUS_PRESSED, Control::type, Control::PressedState, DFCS_PUSHED }, \
+        NO_CONTROL_MAPPING(TUS_FOCUSED), \
+        { TUS_DISABLED, Control::type, Control::DisabledState, DFCS_INACTIVE }, \
+    }
+
+    const ControlMapping horizontalSliderThumbStates[] = SLIDER_THUMB_STATES(HorizontalSliderThumbType);
+    const ControlMapping verticalSliderThumbStates[] = SLIDER_THUMB_STATES(VerticalSliderThumbType);
+    COMPILE_ASSERT(arraysize(horizontalSliderThumbStates) == TUS_DISABLED, sliderThumbStates_covers_TUS);
+
+#undef SLIDER_THUMB_STATES
+
+    const PartMapping trackbarParts[] = {
+        PART_MAPPING(TKP_TRACK, horizontalSliderTrackStates),
+        PART_MAPPING(TKP_TRACKVERT, verticalSliderTrackStates),
+        NO_PART_MAPPING(TKP_THUMB),
+        PART_MAPPING(TKP_THUMBBOTTOM, horizontalSliderThumbStates),
+        NO_PART_MAPPING(TKP_THUMBTOP),
+        PART_MAPPING(TKP_THUMBVERT, verticalSliderThumbStates),
+    };
+    COMPILE_ASSERT(arraysize(trackbarParts) == TKP_THUMBVERT, trackbarParts_covers_TKP);
+
+#undef PART_MAPPING
+#undef NO_PART_MAPPING
+#undef NO_CONTROL_MAPPING
+
+    // Returns what (part, state) draws, or 0 if Blink shouldn't ask for it.
+    const ControlMapping* lookup(const PartMapping* parts, size_t partCount, int part, int state)
+    {
+        if (part < 1 || static_cast<size_t>(part) > partCount)
+            return 0;
+        const PartMapping& mapping = parts[part - 1];
+        if (state < 1 || state > mapping.stateCount)
+            return 0;
+        const ControlMapping* control = &mapping.states[state - 1];
+        return control->type != Control::UnknownType ? control : 0;
+    }
+
+#define LOOKUP(parts, part, state) lookup(parts, arraysize(parts), part, state)
+
+#if !defined(NDEBUG)
+    void checkStates(const ControlMapping* states, int stateCount)
+    {
+        for (int i = 0; i < stateCount; ++i)
+            BLINK_ASSERT(states[i].state == i + 1);
+    }
+
+    void checkParts(const PartMapping* parts, size_t partCount)
+    {
+        for (size_t i = 0; i < partCount; ++i) {
+            BLINK_ASSERT(parts[i].part == static_cast<int>(i) + 1);
+            checkStates(parts[i].states, parts[i].stateCount);
+        }
+    }
+
+    void checkMappings()
+    {
+        checkParts(buttonParts, arraysize(buttonParts));
+        checkParts(menuListParts, arraysize(menuListParts));
+        checkStates(scrollbarArrowStates, arraysize(scrollbarArrowStates));
+        checkParts(scrollbarThumbParts, arraysize(scrollbarThumbParts));
+        checkParts(scrollbarTrackParts, arraysize(scrollbarTrackParts));
+        checkParts(spinButtonParts, arraysize(spinButtonParts));
+        checkParts(textFieldParts, arraysize(textFieldParts));
+        checkParts(trackbarParts, arraysize(trackbarParts));
+    }
+#endif
+
     SkIRect webRectToSkIRect(const WebRect& webRect)
     {
         SkIRect irect;
@@ -30,694 +394,312 @@ namespace
         return irect;
     }
 
-    void drawControl(WebCanvas* canvas, const WebRect& rect, WebThemeControlImpl::Type ctype, WebThemeControlImpl::State cstate)
+    void drawControl(WebThemeControlCache& cache, WebCanvas* canvas, const WebRect& rect, const ControlMapping* mapping)
     {
-        WebThemeControlImpl control(canvas, webRectToSkIRect(rect), ctype, cstate);
-        control.draw();
+        if (!mapping) {
+            BLINK_ASSERT_NOT_REACHED();
+            return;
+        }
+        // On a batching canvas the cached bitmap, or the shapes of a control
+        // too big to cache, queue in order with the other controls.
+        cache.draw(canvas, webRectToSkIRect(rect), mapping->type, mapping->state, SK_Scalar1,
+                   WebThemeBatchCanvas::batchFor(canvas));
     }
 
-    void drawTextField(WebCanvas* canvas, const WebRect& rect, WebThemeControlImpl::Type ctype, WebThemeControlImpl::State cstate, bool drawEdges, bool fillContentArea, WebColor color)
+    void drawTextField(WebCanvas* canvas, const WebRect& rect, const ControlMapping* mapping, bool drawEdges, bool fillContentArea, WebColor color)
     {
-        WebThemeControlImpl control(canvas, webRectToSkIRect(rect), ctype, cstate);
+        if (!mapping) {
+            BLINK_ASSERT_NOT_REACHED();
+            return;
+        }
+        if (WebThemeBatch* batch = WebThemeBatchCanvas::batchFor(canvas)) {
+            WebThemeControlImpl control(batch, webRectToSkIRect(rect), mapping->type, mapping->state);
+            control.drawTextField(drawEdges, fillContentArea, color);
+            return;
+        }
+        WebThemeControlImpl control(canvas, webRectToSkIRect(rect), mapping->type, mapping->state);
         control.drawTextField(drawEdges, fillContentArea, color);
     }
 
     void drawProgressBar(WebCanvas* canvas, WebThemeControlImpl::Type ctype, WebThemeControlImpl::State cstate, const WebRect& barRect, const WebRect& fillRect)
     {
+        if (WebThemeBatch* batch = WebThemeBatchCanvas::batchFor(canvas)) {
+            WebThemeControlImpl control(batch, webRectToSkIRect(barRect), ctype, cstate);
+            control.drawProgressBar(webRectToSkIRect(fillRect));
+            return;
+        }
         WebThemeControlImpl control(canvas, webRectToSkIRect(barRect), ctype, cstate);
         control.drawProgressBar(webRectToSkIRect(fillRect));
     }
 
+#if !defined(OS_WIN)
+    // The code of the first state, (Windows) normal, of a group laid out
+    // normal, hot, pressed, disabled, moved to Blink's |state|.
+    int groupState(int normalState, WebThemeEngine::State state)
+    {
+        static const int offsets[] = {
+            3, // StateDisabled
+            1, // StateHover
+            0, // StateNormal
+            2, // StatePressed
+        };
+        return normalState + offsets[state];
+    }
+#endif
+
+// Intrinsic part sizes in DIPs. WebSize has a constructor, which would
+// make the table a static initializer.
+    struct PartSize {
+        int width;
+        int height;
+    };
+
+#if defined(OS_WIN)
+// Indexed by scrollbar part - 1, the classic theme's metrics. getSize()
+// doesn't say which class its part belongs to, and Blink only asks about
+// scrollbars.
+    const PartSize partSizes[] = {
+        { 17, 17 }, // SBP_ARROWBTN
+        { 17, 17 }, // SBP_THUMBBTNHORZ, the shortest thumb
+        { 17, 17 }, // SBP_THUMBBTNVERT
+        { 0, 17 },  // SBP_LOWERTRACKHORZ
+        { 0, 17 },  // SBP_UPPERTRACKHORZ
+        { 17, 0 },  // SBP_LOWERTRACKVERT
+        { 17, 0 },  // SBP_UPPERTRACKVERT
+        { 8, 8 },   // SBP_GRIPPERHORZ
+        { 8, 8 },   // SBP_GRIPPERVERT
+    };
+    COMPILE_ASSERT(arraysize(partSizes) == SBP_GRIPPERVERT, partSizes_covers_SBP);
+#else
+// Indexed by WebThemeEngine::Part, the metrics of Chromium's default
+// theme. A zero extent is one the part takes from its box.
+    const PartSize partSizes[] = {
+        { 15, 14 }, // PartScrollbarDownArrow
+        { 14, 15 }, // PartScrollbarLeftArrow
+        { 14, 15 }, // PartScrollbarRightArrow
+        { 15, 14 }, // PartScrollbarUpArrow
+        { 30, 15 }, // PartScrollbarHorizontalThumb, the shortest thumb
+        { 15, 30 }, // PartScrollbarVerticalThumb
+        { 0, 15 },  // PartScrollbarHorizontalTrack
+        { 15, 0 },  // PartScrollbarVerticalTrack
+        { 15, 15 }, // PartScrollbarCorner
+        { 13, 13 }, // PartCheckbox
+        { 13, 13 }, // PartRadio
+        { 0, 0 },   // PartButton
+        { 0, 0 },   // PartTextField
+        { 0, 0 },   // PartMenuList
+        { 0, 0 },   // PartSliderTrack
+        { 11, 21 }, // PartSliderThumb
+        { 15, 0 },  // PartInnerSpinButton
+        { 0, 0 },   // PartProgressBar
+    };
+    COMPILE_ASSERT(arraysize(partSizes) == WebThemeEngine::PartProgressBar + 1, partSizes_covers_Part);
+#endif
+
 }
 WebThemeEngineImpl::WebThemeEngineImpl()
 {
-
+#if !defined(NDEBUG)
+    checkMappings();
+#endif
 }
 WebThemeEngineImpl::~WebThemeEngineImpl()
 {
 
 }
-void WebThemeEngineImpl::paintButton(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
-{
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    if (part == BP_CHECKBOX) {
-        switch (state) {
-        case CBS_UNCHECKEDNORMAL:
-            BLINK_ASSERT(classicState == dfcsNormal);
-            ctype = WebThemeControlImpl::UncheckedBoxType;
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case CBS_UNCHECKEDHOT:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_HOT));
-            ctype = WebThemeControlImpl::UncheckedBoxType;
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case CBS_UNCHECKEDPRESSED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_PUSHED));
-            ctype = WebThemeControlImpl::UncheckedBoxType;
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case CBS_UNCHECKEDDISABLED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_INACTIVE));
-            ctype = WebThemeControlImpl::UncheckedBoxType;
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        case CBS_CHECKEDNORMAL:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_CHECKED));
-            ctype = WebThemeControlImpl::CheckedBoxType;
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case CBS_CHECKEDHOT:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_CHECKED | DFCS_HOT));
-            ctype = WebThemeControlImpl::CheckedBoxType;
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case CBS_CHECKEDPRESSED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_CHECKED | DFCS_PUSHED));
-            ctype = WebThemeControlImpl::CheckedBoxType;
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case CBS_CHECKEDDISABLED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_CHECKED | DFCS_INACTIVE));
-            ctype = WebThemeControlImpl::CheckedBoxType;
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        case CBS_MIXEDNORMAL:
-            // Classic theme can't represent mixed state checkbox. We assume
-            // it's equivalent to unchecked.
-            BLINK_ASSERT(classicState == DFCS_BUTTONCHECK);
-            ctype = WebThemeControlImpl::IndeterminateCheckboxType;
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case CBS_MIXEDHOT:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_HOT));
-            ctype = WebThemeControlImpl::IndeterminateCheckboxType;
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case CBS_MIXEDPRESSED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_PUSHED));
-            ctype = WebThemeControlImpl::IndeterminateCheckboxType;
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case CBS_MIXEDDISABLED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONCHECK | DFCS_INACTIVE));
-            ctype = WebThemeControlImpl::IndeterminateCheckboxType;
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-            break;
-        }
-    } else if (BP_RADIOBUTTON == part) {
-        switch (state) {
-        case RBS_UNCHECKEDNORMAL:
-            BLINK_ASSERT(classicState == DFCS_BUTTONRADIO);
-            ctype = WebThemeControlImpl::UncheckedRadioType;
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case RBS_UNCHECKEDHOT:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_HOT));
-            ctype = WebThemeControlImpl::UncheckedRadioType;
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case RBS_UNCHECKEDPRESSED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_PUSHED));
-            ctype = WebThemeControlImpl::UncheckedRadioType;
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case RBS_UNCHECKEDDISABLED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_INACTIVE));
-            ctype = WebThemeControlImpl::UncheckedRadioType;
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        case RBS_CHECKEDNORMAL:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_CHECKED));
-            ctype = WebThemeControlImpl::CheckedRadioType;
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case RBS_CHECKEDHOT:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_CHECKED | DFCS_HOT));
-            ctype = WebThemeControlImpl::CheckedRadioType;
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case RBS_CHECKEDPRESSED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_CHECKED | DFCS_PUSHED));
-            ctype = WebThemeControlImpl::CheckedRadioType;
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case RBS_CHECKEDDISABLED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONRADIO | DFCS_CHECKED | DFCS_INACTIVE));
-            ctype = WebThemeControlImpl::CheckedRadioType;
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-            break;
-        }
-    } else if (BP_PUSHBUTTON == part) {
-        switch (state) {
-        case PBS_NORMAL:
-            BLINK_ASSERT(classicState == DFCS_BUTTONPUSH);
-            ctype = WebThemeControlImpl::PushButtonType;
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case PBS_HOT:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONPUSH | DFCS_HOT));
-            ctype = WebThemeControlImpl::PushButtonType;
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case PBS_PRESSED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONPUSH | DFCS_PUSHED));
-            ctype = WebThemeControlImpl::PushButtonType;
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case PBS_DISABLED:
-            BLINK_ASSERT(classicState == (DFCS_BUTTONPUSH | DFCS_INACTIVE));
-            ctype = WebThemeControlImpl::PushButtonType;
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        case PBS_DEFAULTED:
-            BLINK_ASSERT(classicState == DFCS_BUTTONPUSH);
-            ctype = WebThemeControlImpl::PushButtonType;
-            cstate = WebThemeControlImpl::FocusedState;
-            break;
-
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-            break;
-        }
-    } else if (BP_COMMANDLINKGLYPH == part){
 
-    } else
-        BLINK_ASSERT_NOT_REACHED();
+#if defined(OS_WIN)
 
-    drawControl(canvas, rect, ctype, cstate);
+void WebThemeEngineImpl::paintButton(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
+{
+    const ControlMapping* control = LOOKUP(buttonParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
 }
 
 void WebThemeEngineImpl::paintMenuList(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
 {
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    if (CP_DROPDOWNBUTTON == part) {
-        ctype = WebThemeControlImpl::DropDownButtonType;
-        switch (state) {
-        case CBXS_NORMAL:
-            BLINK_ASSERT(classicState == DFCS_MENUARROW);
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case CBXS_HOT:
-            BLINK_ASSERT(classicState == (DFCS_MENUARROW | DFCS_HOT));
-            cstate = WebThemeControlImpl::HoverState;
-            break;
-
-        case CBXS_PRESSED:
-            BLINK_ASSERT(classicState == (DFCS_MENUARROW | DFCS_PUSHED));
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        case CBXS_DISABLED:
-            BLINK_ASSERT(classicState == (DFCS_MENUARROW | DFCS_INACTIVE));
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-            break;
-        }
-    } else
-        BLINK_ASSERT_NOT_REACHED();
-
-    drawControl(canvas, rect, ctype, cstate);
+    const ControlMapping* control = LOOKUP(menuListParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
 }
 
 void WebThemeEngineImpl::paintScrollbarArrow(WebCanvas* canvas, int state, int classicState, const WebRect& rect)
 {
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    switch (state) {
-    case ABS_UPNORMAL:
-        BLINK_ASSERT(classicState == DFCS_SCROLLUP);
-        ctype = WebThemeControlImpl::UpArrowType;
-        cstate = WebThemeControlImpl::NormalState;
-        break;
-
-    case ABS_DOWNNORMAL:
-        BLINK_ASSERT(classicState == DFCS_SCROLLDOWN);
-        ctype = WebThemeControlImpl::DownArrowType;
-        cstate = WebThemeControlImpl::NormalState;
-        break;
-
-    case ABS_LEFTNORMAL:
-        BLINK_ASSERT(classicState == DFCS_SCROLLLEFT);
-        ctype = WebThemeControlImpl::LeftArrowType;
-        cstate = WebThemeControlImpl::NormalState;
-        break;
-
-    case ABS_RIGHTNORMAL:
-        BLINK_ASSERT(classicState == DFCS_SCROLLRIGHT);
-        ctype = WebThemeControlImpl::RightArrowType;
-        cstate = WebThemeControlImpl::NormalState;
-        break;
-
-    case ABS_UPHOT:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLUP | DFCS_HOT));
-        ctype = WebThemeControlImpl::UpArrowType;
-        cstate = WebThemeControlImpl::HotState;
-        break;
-
-    case ABS_DOWNHOT:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLDOWN | DFCS_HOT));
-        ctype = WebThemeControlImpl::DownArrowType;
-        cstate = WebThemeControlImpl::HotState;
-        break;
-
-    case ABS_LEFTHOT:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLLEFT | DFCS_HOT));
-        ctype = WebThemeControlImpl::LeftArrowType;
-        cstate = WebThemeControlImpl::HotState;
-        break;
-
-    case ABS_RIGHTHOT:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLRIGHT | DFCS_HOT));
-        ctype = WebThemeControlImpl::RightArrowType;
-        cstate = WebThemeControlImpl::HotState;
-        break;
-
-    case ABS_UPHOVER:
-        BLINK_ASSERT(classicState == DFCS_SCROLLUP);
-        ctype = WebThemeControlImpl::UpArrowType;
-        cstate = WebThemeControlImpl::HoverState;
-        break;
-
-    case ABS_DOWNHOVER:
-        BLINK_ASSERT(classicState == DFCS_SCROLLDOWN);
-        ctype = WebThemeControlImpl::DownArrowType;
-        cstate = WebThemeControlImpl::HoverState;
-        break;
-
-    case ABS_LEFTHOVER:
-        BLINK_ASSERT(classicState == DFCS_SCROLLLEFT);
-        ctype = WebThemeControlImpl::LeftArrowType;
-        cstate = WebThemeControlImpl::HoverState;
-        break;
-
-    case ABS_RIGHTHOVER:
-        BLINK_ASSERT(classicState == DFCS_SCROLLRIGHT);
-        ctype = WebThemeControlImpl::RightArrowType;
-        cstate = WebThemeControlImpl::HoverState;
-        break;
-
-    case ABS_UPPRESSED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLUP | DFCS_PUSHED | DFCS_FLAT));
-        ctype = WebThemeControlImpl::UpArrowType;
-        cstate = WebThemeControlImpl::PressedState;
-        break;
-
-    case ABS_DOWNPRESSED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLDOWN | DFCS_PUSHED | DFCS_FLAT));
-        ctype = WebThemeControlImpl::DownArrowType;
-        cstate = WebThemeControlImpl::PressedState;
-        break;
-
-    case ABS_LEFTPRESSED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLLEFT | DFCS_PUSHED | DFCS_FLAT));
-        ctype = WebThemeControlImpl::LeftArrowType;
-        cstate = WebThemeControlImpl::PressedState;
-        break;
-
-    case ABS_RIGHTPRESSED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLRIGHT | DFCS_PUSHED | DFCS_FLAT));
-        ctype = WebThemeControlImpl::RightArrowType;
-        cstate = WebThemeControlImpl::PressedState;
-        break;
-
-    case ABS_UPDISABLED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLUP | DFCS_INACTIVE));
-        ctype = WebThemeControlImpl::UpArrowType;
-        cstate = WebThemeControlImpl::DisabledState;
-        break;
-
-    case ABS_DOWNDISABLED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLDOWN | DFCS_INACTIVE));
-        ctype = WebThemeControlImpl::DownArrowType;
-        cstate = WebThemeControlImpl::DisabledState;
-        break;
-
-    case ABS_LEFTDISABLED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLLEFT | DFCS_INACTIVE));
-        ctype = WebThemeControlImpl::LeftArrowType;
-        cstate = WebThemeControlImpl::DisabledState;
-        break;
-
-    case ABS_RIGHTDISABLED:
-        BLINK_ASSERT(classicState == (DFCS_SCROLLRIGHT | DFCS_INACTIVE));
-        ctype = WebThemeControlImpl::RightArrowType;
-        cstate = WebThemeControlImpl::DisabledState;
-        break;
-
-    default:
-        BLINK_ASSERT_NOT_REACHED();
-        break;
-    }
-
-    drawControl(canvas, rect, ctype, cstate);
+    const ControlMapping* control = 0;
+    if (state >= 1 && state <= static_cast<int>(arraysize(scrollbarArrowStates)))
+        control = &scrollbarArrowStates[state - 1];
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
 }
 
 void WebThemeEngineImpl::paintScrollbarThumb(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
 {
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    switch (part) {
-    case SBP_THUMBBTNHORZ:
-        ctype = WebThemeControlImpl::HorizontalScrollThumbType;
-        break;
-
-    case SBP_THUMBBTNVERT:
-        ctype = WebThemeControlImpl::VerticalScrollThumbType;
-        break;
-
-    case SBP_GRIPPERHORZ:
-        ctype = WebThemeControlImpl::HorizontalScrollGripType;
-        break;
-
-    case SBP_GRIPPERVERT:
-        ctype = WebThemeControlImpl::VerticalScrollGripType;
-        break;
+    const ControlMapping* control = LOOKUP(scrollbarThumbParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
+}
 
-    default:
-        BLINK_ASSERT_NOT_REACHED();
-        break;
-    }
+void WebThemeEngineImpl::paintScrollbarTrack(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect, const WebRect& alignRect)
+{
+    const ControlMapping* control = LOOKUP(scrollbarTrackParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
+}
 
-    switch (state) {
-    case SCRBS_NORMAL:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::NormalState;
-        break;
+void WebThemeEngineImpl::paintSpinButton(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
+{
+    const ControlMapping* control = LOOKUP(spinButtonParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
+}
 
-    case SCRBS_HOT:
-        BLINK_ASSERT(classicState == DFCS_HOT);
-        cstate = WebThemeControlImpl::HotState;
-        break;
+void WebThemeEngineImpl::paintTextField(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect, WebColor color, bool fillContentArea, bool drawEdges)
+{
+    const ControlMapping* control = LOOKUP(textFieldParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawTextField(canvas, rect, control, drawEdges, fillContentArea, color);
+}
 
-    case SCRBS_HOVER:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::HoverState;
-        break;
+void WebThemeEngineImpl::paintTrackbar(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
+{
+    const ControlMapping* control = LOOKUP(trackbarParts, part, state);
+    BLINK_ASSERT(!control || control->classicState == classicState);
+    drawControl(m_controlCache, canvas, rect, control);
+}
 
-    case SCRBS_PRESSED:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::PressedState;
-        break;
+void WebThemeEngineImpl::paintProgressBar(blink::WebCanvas* canvas, const blink::WebRect& barRect, const blink::WebRect& valueRect, bool determinate, double)
+{
+    WebThemeControlImpl::Type ctype = WebThemeControlImpl::ProgressBarType;
+    WebThemeControlImpl::State cstate = determinate ? WebThemeControlImpl::NormalState : WebThemeControlImpl::IndeterminateState;
+    drawProgressBar(canvas, ctype, cstate, barRect, valueRect);
+}
 
-    case SCRBS_DISABLED:
-        BLINK_ASSERT_NOT_REACHED(); // This should never happen in practice.
-        break;
+blink::WebSize WebThemeEngineImpl::getSize(int part)
+{
+    if (part < 1 || static_cast<size_t>(part) > arraysize(partSizes))
+        return blink::WebSize();
+    return blink::WebSize(partSizes[part - 1].width, partSizes[part - 1].height);
+}
 
-    default:
-        BLINK_ASSERT_NOT_REACHED();
-        break;
-    }
+#else
 
-    drawControl(canvas, rect, ctype, cstate);
+blink::WebSize WebThemeEngineImpl::getSize(Part part)
+{
+    if (part < 0 || static_cast<size_t>(part) >= arraysize(partSizes))
+        return blink::WebSize();
+    return blink::WebSize(partSizes[part].width, partSizes[part].height);
 }
 
-void WebThemeEngineImpl::paintScrollbarTrack(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect, const WebRect& alignRect)
+void WebThemeEngineImpl::paint(WebCanvas* canvas, Part part, State state, const WebRect& rect, const ExtraParams* extra)
 {
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
     switch (part) {
-    case SBP_UPPERTRACKHORZ:
-        ctype = WebThemeControlImpl::HorizontalScrollTrackBackType;
+    case PartScrollbarUpArrow:
+        drawControl(m_controlCache, canvas, rect, &scrollbarArrowStates[groupState(ABS_UPNORMAL, state) - 1]);
         break;
-
-    case SBP_LOWERTRACKHORZ:
-        ctype = WebThemeControlImpl::HorizontalScrollTrackForwardType;
+    case PartScrollbarDownArrow:
+        drawControl(m_controlCache, canvas, rect, &scrollbarArrowStates[groupState(ABS_DOWNNORMAL, state) - 1]);
         break;
-
-    case SBP_UPPERTRACKVERT:
-        ctype = WebThemeControlImpl::VerticalScrollTrackBackType;
+    case PartScrollbarLeftArrow:
+        drawControl(m_controlCache, canvas, rect, &scrollbarArrowStates[groupState(ABS_LEFTNORMAL, state) - 1]);
         break;
-
-    case SBP_LOWERTRACKVERT:
-        ctype = WebThemeControlImpl::VerticalScrollTrackForwardType;
+    case PartScrollbarRightArrow:
+        drawControl(m_controlCache, canvas, rect, &scrollbarArrowStates[groupState(ABS_RIGHTNORMAL, state) - 1]);
         break;
 
-    default:
-        BLINK_ASSERT_NOT_REACHED();
+    case PartScrollbarHorizontalThumb:
+    case PartScrollbarVerticalThumb: {
+        static const int thumbStates[] = { SCRBS_NORMAL, SCRBS_HOT, SCRBS_NORMAL, SCRBS_PRESSED };
+        int thumbPart = part == PartScrollbarHorizontalThumb ? SBP_THUMBBTNHORZ : SBP_THUMBBTNVERT;
+        drawControl(m_controlCache, canvas, rect, LOOKUP(scrollbarThumbParts, thumbPart, thumbStates[state]));
         break;
     }
 
-    switch (state) {
-    case SCRBS_NORMAL:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::NormalState;
-        break;
-
-    case SCRBS_HOT:
-        BLINK_ASSERT_NOT_REACHED(); // This should never happen in practice.
+    case PartScrollbarHorizontalTrack:
+    case PartScrollbarVerticalTrack: {
+        static const int trackStates[] = { SCRBS_DISABLED, SCRBS_HOVER, SCRBS_NORMAL, SCRBS_HOVER };
+        int trackPart = part == PartScrollbarHorizontalTrack ? SBP_UPPERTRACKHORZ : SBP_UPPERTRACKVERT;
+        drawControl(m_controlCache, canvas, rect, LOOKUP(scrollbarTrackParts, trackPart, trackStates[state]));
         break;
+    }
 
-    case SCRBS_HOVER:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::HoverState;
+    case PartScrollbarCorner:
         break;
 
-    case SCRBS_PRESSED:
-        BLINK_ASSERT_NOT_REACHED(); // This should never happen in practice.
+    case PartCheckbox: {
+        int normalState = CBS_UNCHECKEDNORMAL;
+        if (extra->button.indeterminate)
+            normalState = CBS_MIXEDNORMAL;
+        else if (extra->button.checked)
+            normalState = CBS_CHECKEDNORMAL;
+        drawControl(m_controlCache, canvas, rect, LOOKUP(buttonParts, BP_CHECKBOX, groupState(normalState, state)));
         break;
+    }
 
-    case SCRBS_DISABLED:
-        BLINK_ASSERT(classicState == DFCS_INACTIVE);
-        cstate = WebThemeControlImpl::DisabledState;
+    case PartRadio: {
+        int normalState = extra->button.checked ? RBS_CHECKEDNORMAL : RBS_UNCHECKEDNORMAL;
+        drawControl(m_controlCache, canvas, rect, LOOKUP(buttonParts, BP_RADIOBUTTON, groupState(normalState, state)));
         break;
+    }
 
-    default:
-        BLINK_ASSERT_NOT_REACHED();
+    case PartButton: {
+        int buttonState = groupState(PBS_NORMAL, state);
+        if (buttonState == PBS_NORMAL && extra->button.isDefault)
+            buttonState = PBS_DEFAULTED;
+        drawControl(m_controlCache, canvas, rect, LOOKUP(buttonParts, BP_PUSHBUTTON, buttonState));
         break;
     }
 
-    drawControl(canvas, rect, ctype, cstate);
-}
-
-void WebThemeEngineImpl::paintSpinButton(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
-{
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    if (part == SPNP_UP) {
-        ctype = WebThemeControlImpl::UpArrowType;
-        switch (state) {
-        case UPS_NORMAL:
-            BLINK_ASSERT(classicState == DFCS_SCROLLUP);
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-        case UPS_DISABLED:
-            BLINK_ASSERT(classicState == (DFCS_SCROLLUP | DFCS_INACTIVE));
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-        case UPS_PRESSED:
-            BLINK_ASSERT(classicState == (DFCS_SCROLLUP | DFCS_PUSHED));
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-        case UPS_HOT:
-            BLINK_ASSERT(classicState == (DFCS_SCROLLUP | DFCS_HOT));
-            cstate = WebThemeControlImpl::HoverState;
-            break;
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-        }
-    } else if (part == SPNP_DOWN) {
-        ctype = WebThemeControlImpl::DownArrowType;
-        switch (state) {
-        case DNS_NORMAL:
-            BLINK_ASSERT(classicState == DFCS_SCROLLDOWN);
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-        case DNS_DISABLED:
-            BLINK_ASSERT(classicState == (DFCS_SCROLLDOWN | DFCS_INACTIVE));
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-        case DNS_PRESSED:
-            BLINK_ASSERT(classicState == (DFCS_SCROLLDOWN | DFCS_PUSHED));
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-        case DNS_HOT:
-            BLINK_ASSERT(classicState == (DFCS_SCROLLDOWN | DFCS_HOT));
-            cstate = WebThemeControlImpl::HoverState;
-            break;
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-        }
-    } else
-        BLINK_ASSERT_NOT_REACHED();
-    drawControl(canvas, rect, ctype, cstate);
-}
-
-void WebThemeEngineImpl::paintTextField(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect, WebColor color, bool fillContentArea, bool drawEdges)
-{
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    BLINK_ASSERT(EP_EDITTEXT == part);
-    ctype = WebThemeControlImpl::TextFieldType;
-
-    switch (state) {
-    case ETS_NORMAL:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::NormalState;
+    case PartTextField: {
+        static const int textFieldStates[] = { ETS_DISABLED, ETS_HOT, ETS_NORMAL, ETS_SELECTED };
+        drawTextField(canvas, rect, LOOKUP(textFieldParts, EP_EDITTEXT, textFieldStates[state]),
+                      true, true, extra->textField.backgroundColor);
         break;
+    }
 
-    case ETS_HOT:
-        BLINK_ASSERT(classicState == DFCS_HOT);
-        cstate = WebThemeControlImpl::HotState;
+    case PartMenuList:
+        drawControl(m_controlCache, canvas, rect, LOOKUP(menuListParts, CP_DROPDOWNBUTTON, groupState(CBXS_NORMAL, state)));
         break;
 
-    case ETS_DISABLED:
-        BLINK_ASSERT(classicState == DFCS_INACTIVE);
-        cstate = WebThemeControlImpl::DisabledState;
+    case PartSliderTrack:
+        drawControl(m_controlCache, canvas, rect, LOOKUP(trackbarParts, extra->slider.vertical ? TKP_TRACKVERT : TKP_TRACK, TRS_NORMAL));
         break;
 
-    case ETS_SELECTED:
-        BLINK_ASSERT(classicState == DFCS_PUSHED);
-        cstate = WebThemeControlImpl::PressedState;
+    case PartSliderThumb: {
+        static const int thumbStates[] = { TUS_DISABLED, TUS_HOT, TUS_NORMAL, TUS_PRESSED };
+        drawControl(m_controlCache, canvas, rect, LOOKUP(trackbarParts, extra->slider.vertical ? TKP_THUMBVERT : TKP_THUMBBOTTOM, thumbStates[state]));
         break;
+    }
 
-    case ETS_FOCUSED:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::FocusedState;
+    case PartInnerSpinButton: {
+        // Blink paints both halves at once; |state| belongs to the half
+        // named by spinUp.
+        State upState = state;
+        State downState = state;
+        if (state != StateDisabled) {
+            if (extra->innerSpin.spinUp)
+                downState = StateNormal;
+            else
+                upState = StateNormal;
+        }
+        WebRect upRect(rect.x, rect.y, rect.width, rect.height / 2);
+        WebRect downRect(rect.x, rect.y + upRect.height, rect.width, rect.height - upRect.height);
+        drawControl(m_controlCache, canvas, upRect, LOOKUP(spinButtonParts, SPNP_UP, groupState(UPS_NORMAL, upState)));
+        drawControl(m_controlCache, canvas, downRect, LOOKUP(spinButtonParts, SPNP_DOWN, groupState(DNS_NORMAL, downState)));
         break;
+    }
 
-    case ETS_READONLY:
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::ReadOnlyState;
+    case PartProgressBar: {
+        const ProgressBarExtraParams& progressBar = extra->progressBar;
+        WebRect valueRect(progressBar.valueRectX, progressBar.valueRectY, progressBar.valueRectWidth, progressBar.valueRectHeight);
+        WebThemeControlImpl::State cstate = progressBar.determinate ? WebThemeControlImpl::NormalState : WebThemeControlImpl::IndeterminateState;
+        drawProgressBar(canvas, WebThemeControlImpl::ProgressBarType, cstate, rect, valueRect);
         break;
+    }
 
     default:
         BLINK_ASSERT_NOT_REACHED();
-        break;
     }
-
-    drawTextField(canvas, rect, ctype, cstate, drawEdges, fillContentArea, color);
-}
-
-void WebThemeEngineImpl::paintTrackbar(WebCanvas* canvas, int part, int state, int classicState, const WebRect& rect)
-{
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::UnknownType;
-    WebThemeControlImpl::State cstate = WebThemeControlImpl::UnknownState;
-
-    if (TKP_THUMBBOTTOM == part) {
-        ctype = WebThemeControlImpl::HorizontalSliderThumbType;
-        switch (state) {
-        case TUS_NORMAL:
-            BLINK_ASSERT(classicState == dfcsNormal);
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case TUS_HOT:
-            BLINK_ASSERT(classicState == DFCS_HOT);
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case TUS_DISABLED:
-            BLINK_ASSERT(classicState == DFCS_INACTIVE);
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        case TUS_PRESSED:
-            BLINK_ASSERT(classicState == DFCS_PUSHED);
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-            break;
-        }
-    } else if (TKP_THUMBVERT == part) {
-        ctype = WebThemeControlImpl::VerticalSliderThumbType;
-        switch (state) {
-        case TUS_NORMAL:
-            BLINK_ASSERT(classicState == dfcsNormal);
-            cstate = WebThemeControlImpl::NormalState;
-            break;
-
-        case TUS_HOT:
-            BLINK_ASSERT(classicState == DFCS_HOT);
-            cstate = WebThemeControlImpl::HotState;
-            break;
-
-        case TUS_DISABLED:
-            BLINK_ASSERT(classicState == DFCS_INACTIVE);
-            cstate = WebThemeControlImpl::DisabledState;
-            break;
-
-        case TUS_PRESSED:
-            BLINK_ASSERT(classicState == DFCS_PUSHED);
-            cstate = WebThemeControlImpl::PressedState;
-            break;
-
-        default:
-            BLINK_ASSERT_NOT_REACHED();
-            break;
-        }
-    } else if (TKP_TRACK == part) {
-        ctype = WebThemeControlImpl::HorizontalSliderTrackType;
-        BLINK_ASSERT(state == TRS_NORMAL);
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::NormalState;
-    } else if (TKP_TRACKVERT == part) {
-        ctype = WebThemeControlImpl::VerticalSliderTrackType;
-        BLINK_ASSERT(state == TRVS_NORMAL);
-        BLINK_ASSERT(classicState == dfcsNormal);
-        cstate = WebThemeControlImpl::NormalState;
-    } else
-        BLINK_ASSERT_NOT_REACHED();
-
-    drawControl(canvas, rect, ctype, cstate);
-}
-
-
-void WebThemeEngineImpl::paintProgressBar(blink::WebCanvas* canvas, const blink::WebRect& barRect, const blink::WebRect& valueRect, bool determinate, double)
-{
-    WebThemeControlImpl::Type ctype = WebThemeControlImpl::ProgressBarType;
-    WebThemeControlImpl::State cstate = determinate ? WebThemeControlImpl::NormalState : WebThemeControlImpl::IndeterminateState;
-    drawProgressBar(canvas, ctype, cstate, barRect, valueRect);
-}
-
-
-blink::WebSize WebThemeEngineImpl::getSize(int part)
-{
-    return blink::WebSize();
 }
 
+#endif
@@ -6,11 +6,22 @@
 #define NOMINMAX
 #endif
 
+#include "build/build_config.h"
 #include "../../platform/WebNonCopyable.h"
+#if defined(OS_WIN)
 #include "../../platform/win/WebThemeEngine.h"
+#else
+#include "../../platform/default/WebThemeEngine.h"
+#endif
+#include "../../platform/WebSize.h"
+#include "WebThemeControlCache.h"
 using namespace blink;
 
-class WebThemeEngineImpl 
+// Draws form controls and scrollbars as plain Skia shapes (see
+// WebThemeControlImpl). Windows theme part and state codes are translated
+// through static tables; on other platforms Blink's parts and states are
+// first turned into the same codes, so both paint the same controls.
+class WebThemeEngineImpl
     : public blink::WebThemeEngine
     , public blink::WebNonCopyable
 {
@@ -19,6 +30,7 @@ public:
     virtual ~WebThemeEngineImpl();
 
     // WebThemeEngine methods:
+#if defined(OS_WIN)
     virtual void paintButton(
         blink::WebCanvas*, int part, int state, int classicState,
         const blink::WebRect&);
@@ -58,7 +70,24 @@ public:
         bool determinate, double time);
 
     virtual blink::WebSize getSize(int part);
+#else
+    virtual blink::WebSize getSize(Part);
+
+    virtual void paint(
+        blink::WebCanvas*, Part, State, const blink::WebRect&,
+        const ExtraParams*);
+#endif
+
+    // getSize() reports the intrinsic part sizes of a static table in DIPs,
+    // as Blink lays out in them. Controls take the device scale from the
+    // matrix of the canvas they are drawn on, which the host scales.
+
+    // Rasterized controls, see WebThemeControlCache.
+    WebThemeControlCache& controlCache() { return m_controlCache; }
+
+private:
+    WebThemeControlCache m_controlCache;
 };
 
 
-#endif // 
+#endif // WebThemeEngineImpl_h
@@ -0,0 +1,369 @@
+
+#include "WebThreadImpl.h"
+
+#include <algorithm>
+#include <set>
+
+#include "base/bind.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop.h"
+#include "base/stl_util.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread.h"
+#include "base/threading/thread_local_storage.h"
+
+
+namespace
+{
+
+    // Idle threads kept for reuse; threads released beyond this are joined.
+    const size_t maxIdleThreads = 4;
+
+    class ThreadPool
+    {
+    public:
+        ~ThreadPool()
+        {
+            STLDeleteElements(&m_idle);
+        }
+
+        base::Thread* acquire(const std::string& name)
+        {
+            {
+                base::AutoLock locker(m_lock);
+                if (!m_idle.empty()) {
+                    base::Thread* thread = m_idle.back();
+                    m_idle.pop_back();
+                    thread->message_loop()->PostTask(FROM_HERE, base::Bind(&setThreadName, name));
+                    return thread;
+                }
+            }
+            base::Thread* thread = new base::Thread(name.c_str());
+            CHECK(thread->Start());
+            return thread;
+        }
+
+        void release(base::Thread* thread)
+        {
+            {
+                base::AutoLock locker(m_lock);
+                if (m_idle.size() < maxIdleThreads) {
+                    m_idle.push_back(thread);
+                    return;
+                }
+            }
+            delete thread;
+        }
+
+    private:
+        static void setThreadName(const std::string& name)
+        {
+            base::PlatformThread::SetName(name.c_str());
+        }
+
+        base::Lock m_lock;
+        std::vector<base::Thread*> m_idle;
+    };
+
+    base::LazyInstance<ThreadPool> threadPool = LAZY_INSTANCE_INITIALIZER;
+
+    // Live threads, for WebThreadBase::collectStats().
+    struct ThreadRegistry {
+        base::Lock lock;
+        std::set<WebThreadBase*> threads;
+    };
+
+    base::LazyInstance<ThreadRegistry>::Leaky threadRegistry = LAZY_INSTANCE_INITIALIZER;
+
+    void destroyCurrentThread(void* thread)
+    {
+        delete static_cast<WebThreadBase*>(thread);
+    }
+
+    // The slot is allocated on first use; LazyInstance makes that safe when
+    // several threads get there at once.
+    struct CurrentThreadSlot {
+        CurrentThreadSlot()
+            : slot(destroyCurrentThread)
+        {
+        }
+
+        base::ThreadLocalStorage::Slot slot;
+    };
+
+    base::LazyInstance<CurrentThreadSlot>::Leaky currentThreadSlot = LAZY_INSTANCE_INITIALIZER;
+
+    // Wraps the message loop of a thread Blink didn't create, such as the
+    // main thread. Lives until that thread exits.
+    class WebThreadForMessageLoop : public WebThreadBase
+    {
+    public:
+        WebThreadForMessageLoop()
+            : WebThreadBase(base::PlatformThread::GetName() ? base::PlatformThread::GetName() : "")
+        {
+            setMessageLoop(base::MessageLoopProxy::current());
+        }
+    };
+
+}
+
+class WebThreadBase::TaskCounters : public base::RefCountedThreadSafe<TaskCounters>
+{
+public:
+    TaskCounters()
+        : m_retired(false)
+        , m_queueDepth(0)
+        , m_tasksRun(0)
+    {
+    }
+
+    void didPost()
+    {
+        base::AutoLock locker(m_lock);
+        ++m_queueDepth;
+    }
+
+    // Returns false if the task must be dropped instead of run.
+    bool willRun(base::TimeTicks due)
+    {
+        base::TimeDelta latency = std::max(base::TimeTicks::Now() - due, base::TimeDelta());
+        base::AutoLock locker(m_lock);
+        if (m_retired)
+            return false;
+        --m_queueDepth;
+        ++m_tasksRun;
+        m_totalLatency += latency;
+        m_maxLatency = std::max(m_maxLatency, latency);
+        return true;
+    }
+
+    void retire()
+    {
+        base::AutoLock locker(m_lock);
+        m_retired = true;
+    }
+
+    void snapshot(Stats* stats) const
+    {
+        base::AutoLock locker(m_lock);
+        stats->queueDepth = m_queueDepth;
+        stats->tasksRun = m_tasksRun;
+        stats->totalLatency = m_totalLatency;
+        stats->maxLatency = m_maxLatency;
+    }
+
+private:
+    friend class base::RefCountedThreadSafe<TaskCounters>;
+    ~TaskCounters() { }
+
+    mutable base::Lock m_lock;
+    bool m_retired;
+    int m_queueDepth;
+    int64 m_tasksRun;
+    base::TimeDelta m_totalLatency;
+    base::TimeDelta m_maxLatency;
+};
+
+class WebThreadBase::TaskObserverAdapter : public base::MessageLoop::TaskObserver
+{
+public:
+    explicit TaskObserverAdapter(WebThread::TaskObserver* observer)
+        : m_observer(observer)
+    {
+    }
+
+    virtual void WillProcessTask(const base::PendingTask&)
+    {
+        m_observer->willProcessTask();
+    }
+
+    virtual void DidProcessTask(const base::PendingTask&)
+    {
+        m_observer->didProcessTask();
+    }
+
+private:
+    WebThread::TaskObserver* m_observer;
+};
+
+WebThreadBase::Stats::Stats()
+    : queueDepth(0)
+    , tasksRun(0)
+{
+}
+
+double WebThreadBase::Stats::averageLatencyMs() const
+{
+    if (!tasksRun)
+        return 0;
+    return totalLatency.InMillisecondsF() / tasksRun;
+}
+
+WebThreadBase::WebThreadBase(const std::string& name)
+    : m_counters(new TaskCounters)
+    , m_name(name)
+{
+    ThreadRegistry& registry = threadRegistry.Get();
+    base::AutoLock locker(registry.lock);
+    registry.threads.insert(this);
+}
+
+WebThreadBase::~WebThreadBase()
+{
+    {
+        ThreadRegistry& registry = threadRegistry.Get();
+        base::AutoLock locker(registry.lock);
+        registry.threads.erase(this);
+    }
+    removeTaskObservers();
+}
+
+WebThreadBase* WebThreadBase::current()
+{
+    base::ThreadLocalStorage::Slot& slot = currentThreadSlot.Get().slot;
+    WebThreadBase* thread = static_cast<WebThreadBase*>(slot.Get());
+    if (thread)
+        return thread;
+    if (!base::MessageLoop::current())
+        return 0;
+    thread = new WebThreadForMessageLoop;
+    slot.Set(thread);
+    return thread;
+}
+
+void WebThreadBase::collectStats(std::vector<Stats>* stats)
+{
+    ThreadRegistry& registry = threadRegistry.Get();
+    base::AutoLock locker(registry.lock);
+    for (std::set<WebThreadBase*>::const_iterator it = registry.threads.begin(); it != registry.threads.end(); ++it)
+        stats->push_back((*it)->stats());
+}
+
+WebThreadBase::Stats WebThreadBase::stats() const
+{
+    Stats stats;
+    stats.name = m_name;
+    m_counters->snapshot(&stats);
+    return stats;
+}
+
+void WebThreadBase::setMessageLoop(scoped_refptr<base::MessageLoopProxy> messageLoop)
+{
+    DCHECK(!m_messageLoop);
+    m_messageLoop = messageLoop;
+}
+
+void WebThreadBase::runTask(scoped_refptr<TaskCounters> counters, base::TimeTicks due, scoped_ptr<Task> task)
+{
+    if (counters->willRun(due))
+        task->run();
+}
+
+void WebThreadBase::postTask(Task* task)
+{
+    m_counters->didPost();
+    m_messageLoop->PostTask(FROM_HERE,
+        base::Bind(&runTask, m_counters, base::TimeTicks::Now(), base::Passed(make_scoped_ptr(task))));
+}
+
+void WebThreadBase::postDelayedTask(Task* task, long long delayMs)
+{
+    base::TimeDelta delay = base::TimeDelta::FromMilliseconds(delayMs);
+    m_counters->didPost();
+    m_messageLoop->PostDelayedTask(FROM_HERE,
+        base::Bind(&runTask, m_counters, base::TimeTicks::Now() + delay, base::Passed(make_scoped_ptr(task))),
+        delay);
+}
+
+bool WebThreadBase::isCurrentThread() const
+{
+    return m_messageLoop->BelongsToCurrentThread();
+}
+
+void WebThreadBase::addTaskObserver(TaskObserver* observer)
+{
+    CHECK(isCurrentThread());
+    TaskObserverAdapter*& adapter = m_taskObservers[observer];
+    DCHECK(!adapter);
+    adapter = new TaskObserverAdapter(observer);
+    base::MessageLoop::current()->AddTaskObserver(adapter);
+}
+
+void WebThreadBase::removeTaskObserver(TaskObserver* observer)
+{
+    CHECK(isCurrentThread());
+    std::map<TaskObserver*, TaskObserverAdapter*>::iterator it = m_taskObservers.find(observer);
+    if (it == m_taskObservers.end())
+        return;
+    base::MessageLoop::current()->RemoveTaskObserver(it->second);
+    delete it->second;
+    m_taskObservers.erase(it);
+}
+
+void WebThreadBase::enterRunLoop()
+{
+    CHECK(isCurrentThread());
+    CHECK(!base::MessageLoop::current()->is_running()); // We don't support nesting.
+    base::MessageLoop::current()->Run();
+}
+
+void WebThreadBase::exitRunLoop()
+{
+    CHECK(isCurrentThread());
+    CHECK(base::MessageLoop::current()->is_running());
+    base::MessageLoop::current()->Quit();
+}
+
+// The message loop outlives the wrapper, both for a pooled thread and for
+// the wrapper of the pooled thread's own loop, so the adapters must leave
+// it before they are deleted. At thread exit the loop may be gone already.
+void WebThreadBase::removeTaskObservers()
+{
+    base::MessageLoop* loop = base::MessageLoop::current();
+    for (std::map<TaskObserver*, TaskObserverAdapter*>::iterator it = m_taskObservers.begin(); it != m_taskObservers.end(); ++it) {
+        if (loop)
+            loop->RemoveTaskObserver(it->second);
+    }
+    STLDeleteValues(&m_taskObservers);
+}
+
+void WebThreadBase::retire()
+{
+    DCHECK(isCurrentThread());
+    m_counters->retire();
+    removeTaskObservers();
+
+    // The next owner gets a fresh wrapper from current().
+    base::ThreadLocalStorage::Slot& slot = currentThreadSlot.Get().slot;
+    delete static_cast<WebThreadBase*>(slot.Get());
+    slot.Set(0);
+}
+
+WebThreadImpl::WebThreadImpl(const char* name)
+    : WebThreadBase(name)
+    , m_thread(threadPool.Get().acquire(name))
+{
+    setMessageLoop(m_thread->message_loop_proxy());
+}
+
+// Runs after every task posted before the WebThread was deleted, as
+// base::Thread::Stop() would, and drops the delayed ones still pending.
+WebThreadImpl::~WebThreadImpl()
+{
+    DCHECK(!isCurrentThread());
+    base::WaitableEvent retired(false, false);
+    m_thread->message_loop()->PostTask(FROM_HERE,
+        base::Bind(&WebThreadImpl::retireAndSignal, base::Unretained(this), &retired));
+    retired.Wait();
+    threadPool.Get().release(m_thread);
+}
+
+void WebThreadImpl::retireAndSignal(base::WaitableEvent* retired)
+{
+    retire();
+    retired->Signal();
+}
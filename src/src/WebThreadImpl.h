@@ -0,0 +1,112 @@
+#ifndef WebThreadImpl_h
+#define WebThreadImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/time/time.h"
+
+#include "../../platform/WebThread.h"
+
+using namespace blink;
+
+namespace base {
+    class Thread;
+    class WaitableEvent;
+}
+
+// WebThread on top of a base::MessageLoop. Tasks are wrapped so that each
+// thread keeps count of its queue depth and of how long tasks waited between
+// being posted and being run.
+class WebThreadBase : public blink::WebThread
+{
+public:
+    struct Stats {
+        Stats();
+
+        std::string name;
+        // Tasks posted and not yet run, delayed ones included.
+        int queueDepth;
+        int64 tasksRun;
+        // Time from post (or, for delayed tasks, from the due time) to run.
+        base::TimeDelta totalLatency;
+        base::TimeDelta maxLatency;
+
+        double averageLatencyMs() const;
+    };
+
+    virtual ~WebThreadBase();
+
+    // The WebThread for the calling thread, created on first use for threads
+    // that have a message loop; null otherwise. Owned by the thread.
+    static WebThreadBase* current();
+
+    // Appends the stats of every live WebThread. Any thread.
+    static void collectStats(std::vector<Stats>*);
+
+    Stats stats() const;
+
+    // WebThread methods:
+    virtual void postTask(Task*);
+    virtual void postDelayedTask(Task*, long long delayMs);
+    virtual bool isCurrentThread() const;
+    virtual void addTaskObserver(TaskObserver*);
+    virtual void removeTaskObserver(TaskObserver*);
+    virtual void enterRunLoop();
+    virtual void exitRunLoop();
+
+protected:
+    class TaskCounters;
+
+    explicit WebThreadBase(const std::string& name);
+
+    // Called once, from the constructor of the subclass.
+    void setMessageLoop(scoped_refptr<base::MessageLoopProxy>);
+
+    // On this thread. Stops pending tasks from running and drops the task
+    // observers, leaving the message loop ready for another owner.
+    void retire();
+
+private:
+    class TaskObserverAdapter;
+
+    // On this thread.
+    void removeTaskObservers();
+
+    static void runTask(scoped_refptr<TaskCounters>, base::TimeTicks due, scoped_ptr<Task>);
+
+    scoped_refptr<TaskCounters> m_counters;
+    const std::string m_name;
+    scoped_refptr<base::MessageLoopProxy> m_messageLoop;
+    std::map<TaskObserver*, TaskObserverAdapter*> m_taskObservers;
+
+    DISALLOW_COPY_AND_ASSIGN(WebThreadBase);
+};
+
+// A thread created through Platform::createThread(). The underlying
+// base::Thread comes from a small shared pool: when the WebThread is deleted
+// its thread is parked for reuse instead of being joined, so embedders that
+// create short-lived threads don't pay for thread creation each time.
+class WebThreadImpl : public WebThreadBase
+{
+public:
+    explicit WebThreadImpl(const char* name);
+    virtual ~WebThreadImpl();
+
+private:
+    void retireAndSignal(base::WaitableEvent*);
+
+    base::Thread* m_thread;
+};
+
+
+#endif // WebThreadImpl_h
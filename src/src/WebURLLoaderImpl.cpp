@@ -0,0 +1,164 @@
+
+#include "WebURLLoaderImpl.h"
+
+#include "base/strings/string_util.h"
+#include "net/base/net_errors.h"
+
+#include "WebCookieJarImpl.h"
+
+#include "../../platform/WebData.h"
+#include "../../platform/WebString.h"
+#include "../../platform/WebURLError.h"
+#include "../../platform/WebURLLoadTiming.h"
+#include "../../platform/WebURLLoaderClient.h"
+#include "../../platform/WebURLRequest.h"
+#include "../../platform/WebURLResponse.h"
+
+
+namespace
+{
+
+    void populateResponse(const WebURL& url, const URLResponseHead& head, const URLLoadTimingInfo& timing, WebURLResponse* response)
+    {
+        response->initialize();
+        response->setURL(url);
+        response->setHTTPStatusCode(head.httpStatusCode);
+        response->setHTTPStatusText(WebString::fromUTF8(head.httpStatusText));
+        response->setMIMEType(WebString::fromUTF8(head.mimeType));
+        response->setTextEncodingName(WebString::fromUTF8(head.charset));
+        response->setExpectedContentLength(head.expectedContentLength);
+        response->setResponseTime(head.responseTime);
+        response->setWasCached(head.wasCached);
+        for (size_t i = 0; i < head.headers.size(); ++i)
+            response->addHTTPHeaderField(WebString::fromUTF8(head.headers[i].first), WebString::fromUTF8(head.headers[i].second));
+
+        WebURLLoadTiming loadTiming;
+        loadTiming.initialize();
+        loadTiming.setRequestTime(timing.requestTime);
+        loadTiming.setConnectStart(timing.connectStart);
+        loadTiming.setConnectEnd(timing.connectEnd);
+        loadTiming.setSendStart(timing.sendStart);
+        loadTiming.setSendEnd(timing.sendEnd);
+        loadTiming.setReceiveHeadersEnd(timing.receiveHeadersEnd);
+        response->setLoadTiming(loadTiming);
+        response->setConnectionReused(timing.connectionReused);
+    }
+
+    void populateError(const WebURL& url, int reason, WebURLError* error)
+    {
+        error->domain = WebString::fromUTF8(net::kErrorDomain);
+        error->reason = reason;
+        error->unreachableURL = url;
+        error->localizedDescription = WebString::fromUTF8(net::ErrorToString(reason));
+    }
+
+}
+
+WebURLLoaderImpl::WebURLLoaderImpl(URLLoaderEngine* engine, WebCookieJarImpl* cookieJar)
+    : m_engine(engine)
+    , m_cookieJar(cookieJar)
+    , m_useCookies(false)
+    , m_client(0)
+    , m_weakFactory(this)
+{
+}
+
+WebURLLoaderImpl::~WebURLLoaderImpl()
+{
+    cancel();
+}
+
+URLRequestInfo WebURLLoaderImpl::requestInfo(const WebURLRequest& request)
+{
+    URLRequestInfo info;
+    info.url = request.url();
+    info.method = request.httpMethod().utf8();
+    m_useCookies = m_cookieJar && request.allowStoredCredentials();
+    if (m_useCookies)
+        info.cookies = m_cookieJar->requestHeaderValue(info.url);
+    return info;
+}
+
+void WebURLLoaderImpl::storeCookies(const URLResponseHead& head)
+{
+    if (!m_useCookies)
+        return;
+    for (size_t i = 0; i < head.headers.size(); ++i) {
+        if (LowerCaseEqualsASCII(head.headers[i].first, "set-cookie"))
+            m_cookieJar->setCookieFromResponse(m_url, head.headers[i].second);
+    }
+}
+
+void WebURLLoaderImpl::loadSynchronously(const WebURLRequest& request, WebURLResponse& response, WebURLError& error, WebData& data)
+{
+    m_url = request.url();
+    URLResponseHead head;
+    std::string body;
+    int rv = m_engine->loadSynchronously(requestInfo(request), &head, &body, &m_timing);
+    if (rv != net::OK) {
+        populateError(m_url, rv, &error);
+        return;
+    }
+    storeCookies(head);
+    populateResponse(m_url, head, m_timing, &response);
+    data.assign(body.data(), body.size());
+}
+
+void WebURLLoaderImpl::loadAsynchronously(const WebURLRequest& request, WebURLLoaderClient* client)
+{
+    DCHECK(!m_job);
+    m_url = request.url();
+    m_client = client;
+    m_job = m_engine->start(requestInfo(request), this);
+}
+
+void WebURLLoaderImpl::cancel()
+{
+    m_client = 0;
+    if (m_job) {
+        m_job->cancel();
+        m_job = NULL;
+    }
+}
+
+void WebURLLoaderImpl::setDefersLoading(bool defers)
+{
+    if (m_job)
+        m_job->setDefersLoading(defers);
+}
+
+void WebURLLoaderImpl::didReceiveResponseHead(const URLResponseHead& head, const URLLoadTimingInfo& timing)
+{
+    m_timing = timing;
+    storeCookies(head);
+    WebURLResponse response;
+    populateResponse(m_url, head, timing, &response);
+    // The client may cancel, and delete us, from didReceiveResponse.
+    base::WeakPtr<WebURLLoaderImpl> self = m_weakFactory.GetWeakPtr();
+    m_client->didReceiveResponse(this, response);
+    if (!self || !m_client)
+        return;
+    if (head.cachedMetadata)
+        m_client->didReceiveCachedMetadata(this, head.cachedMetadata->data(), head.cachedMetadata->size());
+}
+
+void WebURLLoaderImpl::didReceiveBodyData(const char* data, int length)
+{
+    m_client->didReceiveData(this, data, length, length);
+}
+
+void WebURLLoaderImpl::didFinishLoading(int error, const URLLoadTimingInfo& timing)
+{
+    m_timing = timing;
+    // The client may delete us from either callback.
+    WebURLLoaderClient* client = m_client;
+    m_client = 0;
+    m_job = NULL;
+    if (error == net::OK) {
+        client->didFinishLoading(this, timing.responseEnd);
+        return;
+    }
+    WebURLError webError;
+    populateError(m_url, error, &webError);
+    client->didFail(this, webError);
+}
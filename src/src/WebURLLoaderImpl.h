@@ -0,0 +1,64 @@
+#ifndef WebURLLoaderImpl_h
+#define WebURLLoaderImpl_h
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+
+#include "../../platform/WebURL.h"
+#include "../../platform/WebURLLoader.h"
+#include "URLLoaderEngine.h"
+
+using namespace blink;
+
+class WebCookieJarImpl;
+
+// WebURLLoader on top of the shared URLLoaderEngine. One instance serves one
+// request and lives on the main thread. Requests that may use credentials
+// send the jar's cookies and store the cookies their response sets.
+class WebURLLoaderImpl
+    : public blink::WebURLLoader
+    , public URLLoaderJobClient
+{
+public:
+    // |cookieJar| may be null.
+    WebURLLoaderImpl(URLLoaderEngine*, WebCookieJarImpl* cookieJar);
+    virtual ~WebURLLoaderImpl();
+
+    // WebURLLoader methods:
+    virtual void loadSynchronously(const WebURLRequest&, WebURLResponse&, WebURLError&, WebData&);
+    virtual void loadAsynchronously(const WebURLRequest&, WebURLLoaderClient*);
+    virtual void cancel();
+    virtual void setDefersLoading(bool);
+
+    // Timing of the request so far; complete once the client has been told
+    // the load finished.
+    const URLLoadTimingInfo& timing() const { return m_timing; }
+
+    // URLLoaderJobClient methods:
+    virtual void didReceiveResponseHead(const URLResponseHead&, const URLLoadTimingInfo&);
+    virtual void didReceiveBodyData(const char* data, int length);
+    virtual void didFinishLoading(int error, const URLLoadTimingInfo&);
+
+private:
+    URLRequestInfo requestInfo(const WebURLRequest&);
+    void storeCookies(const URLResponseHead&);
+
+    URLLoaderEngine* m_engine;
+    WebCookieJarImpl* m_cookieJar;
+    // Whether the current request may send and set cookies.
+    bool m_useCookies;
+    WebURLLoaderClient* m_client;
+    scoped_refptr<URLLoaderEngine::Job> m_job;
+    WebURL m_url;
+    URLLoadTimingInfo m_timing;
+
+    // Tells a callback whether the client deleted us from inside it.
+    base::WeakPtrFactory<WebURLLoaderImpl> m_weakFactory;
+};
+
+
+#endif // WebURLLoaderImpl_h
@@ -1,22 +1,130 @@
 
 #include "WebViewClientImpl.h"
 
+#include <cmath>
 
-WebViewClientImpl::WebViewClientImpl()
+#include "base/bind.h"
+#include "build/build_config.h"
+
+#include "BackingStore.h"
+#include "FrameScheduler.h"
+#include "WebCompositorSupportImpl.h"
+#include "WebLayerTreeViewImpl.h"
+
+#include "../../platform/Platform.h"
+#include "../../web/WebView.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#endif
+
+
+namespace
 {
 
+    float systemDeviceScaleFactor()
+    {
+#if defined(OS_WIN)
+        HDC screen = GetDC(0);
+        int dpi = GetDeviceCaps(screen, LOGPIXELSX);
+        ReleaseDC(0, screen);
+        if (dpi > 0)
+            return dpi / 96.0f;
+#endif
+        return 1;
+    }
+
+}
+
+WebViewClientImpl::WebViewClientImpl()
+    : m_backingStore(0)
+    , m_webView(0)
+    , m_frameScheduler(0)
+    , m_compositorActive(false)
+    , m_deviceScaleFactor(systemDeviceScaleFactor())
+{
 }
 WebViewClientImpl::~WebViewClientImpl()
 {
 
 }
+
+void WebViewClientImpl::setLoadingStoppedCallback(const base::Closure& callback)
+{
+    m_loadingStoppedCallback = callback;
+}
+
+void WebViewClientImpl::setBackingStore(BackingStore* backingStore)
+{
+    m_backingStore = backingStore;
+    if (m_backingStore)
+        m_backingStore->setDeviceScaleFactor(m_deviceScaleFactor);
+}
+
+void WebViewClientImpl::setWebView(WebView* webView)
+{
+    m_webView = webView;
+    if (m_webView)
+        m_webView->setDeviceScaleFactor(m_deviceScaleFactor);
+}
+
+void WebViewClientImpl::resize(const WebSize& size)
+{
+    m_size = size;
+    if (m_backingStore)
+        m_backingStore->resize(size);
+    // Rounded up, so the page covers every device pixel.
+    if (m_webView) {
+        m_webView->resize(WebSize(static_cast<int>(ceilf(size.width / m_deviceScaleFactor)),
+                                  static_cast<int>(ceilf(size.height / m_deviceScaleFactor))));
+    }
+}
+
+void WebViewClientImpl::setFrameScheduler(FrameScheduler* frameScheduler)
+{
+    m_frameScheduler = frameScheduler;
+}
+
+void WebViewClientImpl::setDeviceScaleFactor(float scale)
+{
+    if (scale <= 0 || scale == m_deviceScaleFactor)
+        return;
+    m_deviceScaleFactor = scale;
+    if (m_backingStore)
+        m_backingStore->setDeviceScaleFactor(scale);
+    if (m_webView)
+        m_webView->setDeviceScaleFactor(scale);
+    // The same device pixels hold a different number of DIPs.
+    if (!m_size.isEmpty())
+        resize(m_size);
+}
+
+WebLayerTreeViewImpl* WebViewClientImpl::activeLayerTreeView()
+{
+    return m_compositorActive ? m_layerTreeView.get() : 0;
+}
+
+void WebViewClientImpl::setCompositeCallback(const base::Closure& callback)
+{
+    m_compositeCallback = callback;
+    if (m_layerTreeView)
+        m_layerTreeView->setPresentCallback(callback);
+}
 //////////////////////////////////////////////////////////////////////////
 // Called when a region of the WebWidget needs to be re-painted.
-void WebViewClientImpl::didInvalidateRect(const WebRect&) { }
+void WebViewClientImpl::didInvalidateRect(const WebRect& rect)
+{
+    if (m_backingStore)
+        m_backingStore->invalidate(rect);
+}
 
 // Called when a region of the WebWidget, given by clipRect, should be
 // scrolled by the specified dx and dy amounts.
-void WebViewClientImpl::didScrollRect(int dx, int dy, const WebRect& clipRect) { }
+void WebViewClientImpl::didScrollRect(int dx, int dy, const WebRect& clipRect)
+{
+    if (m_backingStore)
+        m_backingStore->scrollRect(dx, dy, clipRect);
+}
 
 // Called when the Widget has changed size as a result of an auto-resize.
 void WebViewClientImpl::didAutoResize(const WebSize& newSize) { }
@@ -24,18 +132,36 @@ void WebViewClientImpl::didAutoResize(const WebSize& newSize) { }
 // Called when the compositor is enabled or disabled. The parameter to
 // didActivateCompositor() is meaningless.
 // FIXME: Remove parameter from didActivateCompositor().
-void WebViewClientImpl::didActivateCompositor(int deprecated) { }
-void WebViewClientImpl::didDeactivateCompositor() { }
+void WebViewClientImpl::didActivateCompositor(int deprecated)
+{
+    m_compositorActive = true;
+}
+
+void WebViewClientImpl::didDeactivateCompositor()
+{
+    m_compositorActive = false;
+    // Back to the backing store, which has missed every invalidation since.
+    if (m_backingStore)
+        m_backingStore->invalidateAll();
+}
 
 // Attempt to initialize compositing for this widget. If this is successful,
 // layerTreeView() will return a valid WebLayerTreeView.
-void WebViewClientImpl::initializeLayerTreeView() { }
+void WebViewClientImpl::initializeLayerTreeView()
+{
+    WebCompositorSupportImpl* support = static_cast<WebCompositorSupportImpl*>(Platform::current()->compositorSupport());
+    if (!support || m_layerTreeView)
+        return;
+    m_layerTreeView.reset(new WebLayerTreeViewImpl(support->compositorLoop(),
+        base::Bind(&WebViewClientImpl::scheduleAnimation, AsWeakPtr())));
+    m_layerTreeView->setPresentCallback(m_compositeCallback);
+}
 
 // Return a compositing view used for this widget. This is owned by the
 // WebWidgetClient.
 WebLayerTreeView* WebViewClientImpl::layerTreeView()
 {
-    return 0;
+    return m_layerTreeView.get();
 }
 
 // Sometimes the WebWidget enters a state where it will generate a sequence
@@ -65,14 +191,18 @@ void WebViewClientImpl::didCommitAndDrawCompositorFrame() { }
 void WebViewClientImpl::didCompleteSwapBuffers() { }
 
 // Called when a call to WebWidget::animate is required
-void WebViewClientImpl::scheduleAnimation() { }
+void WebViewClientImpl::scheduleAnimation()
+{
+    if (m_frameScheduler)
+        m_frameScheduler->setNeedsFrame();
+}
 
 // Called to query the state of the rendering back-end. Should return true
 // when scheduleAnimation (or possibly some other cause for another frame)
 // was called, but before WebWidget::animate actually does a frame.
 bool WebViewClientImpl::isCompositorFramePending() const
 {
-    return false;
+    return m_frameScheduler && m_frameScheduler->framePending();
 }
 
 // Called when the widget acquires or loses focus, respectively.
@@ -131,13 +261,15 @@ WebRect WebViewClientImpl::rootWindowRect()
 // displayed.
 WebScreenInfo WebViewClientImpl::screenInfo()
 {
-    return WebScreenInfo();
+    WebScreenInfo info;
+    info.deviceScaleFactor = m_deviceScaleFactor;
+    return info;
 }
 
 // Called to get the scale factor of the display.
 float WebViewClientImpl::deviceScaleFactor()
 {
-    return 1;
+    return m_deviceScaleFactor;
 }
 
 // When this method gets called, WebWidgetClient implementation should
@@ -249,7 +381,11 @@ void WebViewClientImpl::initializeHelperPluginWebFrame(WebHelperPlugin*) { }
 
 // These notifications bracket any loading that occurs in the WebView.
 void WebViewClientImpl::didStartLoading() { }
-void WebViewClientImpl::didStopLoading() { }
+void WebViewClientImpl::didStopLoading()
+{
+    if (!m_loadingStoppedCallback.is_null())
+        m_loadingStoppedCallback.Run();
+}
 
 // Notification that some progress was made loading the current page.
 // loadProgress is a value between 0 (nothing loaded) and 1.0 (frame fully
@@ -5,12 +5,18 @@
 #define NOMINMAX
 #endif
 
+#include "base/callback.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
 
 #include "../../web/webviewclient.h"
 
 using namespace blink;
 
+class BackingStore;
+class FrameScheduler;
+class WebLayerTreeViewImpl;
+
 class WebViewClientImpl
     : public blink::WebViewClient
     , public base::SupportsWeakPtr<WebViewClientImpl>
@@ -18,6 +24,36 @@ class WebViewClientImpl
 public:
     WebViewClientImpl();
     ~WebViewClientImpl();
+
+    // Run by didStopLoading(). Hosts without a window (see HeadlessHost) use
+    // this to quit their run loop once the page has settled.
+    void setLoadingStoppedCallback(const base::Closure& callback);
+
+    // Where invalidations are recorded. Not owned; may be null.
+    void setBackingStore(BackingStore* backingStore);
+
+    // The view this client serves. Not owned; may be null.
+    void setWebView(WebView* webView);
+
+    // Sizes the view for |size| device pixels: Blink lays out in DIPs, and
+    // the backing store keeps device pixels.
+    void resize(const WebSize& size);
+
+    // Where scheduleAnimation() requests go. Not owned; may be null.
+    void setFrameScheduler(FrameScheduler* frameScheduler);
+
+    // The scale factor of the display the view is shown on, the system DPI
+    // over 96 on Windows and 1 elsewhere by default. Blink gets it through
+    // WebView::setDeviceScaleFactor() and screenInfo(); the backing store,
+    // or the compositor, rasters at it.
+    void setDeviceScaleFactor(float scale);
+
+    // The compositor while Blink is in compositing mode, else null. Hosts
+    // commit() it in their frames instead of painting the backing store.
+    WebLayerTreeViewImpl* activeLayerTreeView();
+    // Run after every composite; hosts copy the compositor's output then.
+    void setCompositeCallback(const base::Closure& callback);
+
     //////////////////////////////////////////////////////////////////////////
     // Called when a region of the WebWidget needs to be re-painted.
     virtual void didInvalidateRect(const WebRect&) ;
@@ -438,7 +474,16 @@ public:
     virtual void draggableRegionsChanged() ;
 
 private:
-
+    base::Closure m_loadingStoppedCallback;
+    BackingStore* m_backingStore;
+    WebView* m_webView;
+    // In device pixels.
+    WebSize m_size;
+    FrameScheduler* m_frameScheduler;
+    scoped_ptr<WebLayerTreeViewImpl> m_layerTreeView;
+    bool m_compositorActive;
+    base::Closure m_compositeCallback;
+    float m_deviceScaleFactor;
 };
 
 
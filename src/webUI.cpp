@@ -17,12 +17,18 @@
 #include "src/PlatformImpl.h"
 #include "src/WebViewClientImpl.h"
 #include "src/WebFrameClientImpl.h"
+#include "src/BackingStore.h"
+#include "src/FrameScheduler.h"
+#include "src/TileRasterizer.h"
+#include "src/WebLayerTreeViewImpl.h"
 
 #define enable_webkit
 #ifdef enable_webkit
 
 #define NOMINMAX
 #include "src/WebKitHeader.h"
+#include "base/run_loop.h"
+#include "third_party/skia/include/core/SkRegion.h"
 
 #endif
 
@@ -35,12 +41,136 @@ TCHAR szTitle[MAX_LOADSTRING];					// 
 TCHAR szWindowClass[MAX_LOADSTRING];			// 
 HWND hWnd;
 
+#ifdef enable_webkit
+blink::WebView* webView;
+WebViewClientImpl* webViewClient;
+BackingStore* backingStore;
+FrameScheduler* frameScheduler;
+#endif
+
 // ˴ģаĺǰ: 
 ATOM				MyRegisterClass(HINSTANCE hInstance);
 BOOL				InitInstance(HINSTANCE, int);
 LRESULT CALLBACK	WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK	About(HWND, UINT, WPARAM, LPARAM);
 
+#ifdef enable_webkit
+// Runs accelerators ahead of the usual dispatch while base's message loop
+// pumps the window messages.
+class AcceleratorDispatcher : public base::MessagePumpDispatcher
+{
+public:
+    explicit AcceleratorDispatcher(HACCEL accelerators)
+        : m_accelerators(accelerators)
+    {
+    }
+
+    virtual bool Dispatch(const MSG& msg)
+    {
+        MSG message = msg;
+        if (!TranslateAccelerator(message.hwnd, m_accelerators, &message)) {
+            TranslateMessage(&message);
+            DispatchMessage(&message);
+        }
+        return true;
+    }
+
+private:
+    HACCEL m_accelerators;
+};
+
+// Damage reported by the backing store becomes part of the window's update
+// region, so WM_PAINT covers it.
+void invalidateWindowRect(const blink::WebRect& rect)
+{
+    RECT windowRect = { rect.x, rect.y, rect.x + rect.width, rect.y + rect.height };
+    InvalidateRect(hWnd, &windowRect, FALSE);
+}
+
+// One FrameScheduler frame: animations tick at the vsync time and the
+// damage they cause is painted and shown right away.
+// In compositing mode the frame only commits the layers; the window is
+// invalidated once the compositor thread has drawn them.
+void runFrame(double frameTime)
+{
+    webView->animate(frameTime);
+    webView->layout();
+    if (WebLayerTreeViewImpl* layerTreeView = webViewClient->activeLayerTreeView()) {
+        layerTreeView->commit();
+        return;
+    }
+    SkRegion updated;
+    backingStore->paint(webView, &updated);
+    UpdateWindow(hWnd);
+}
+
+void didComposite()
+{
+    InvalidateRect(hWnd, NULL, FALSE);
+}
+
+// The vsync interval of the primary display, 60 Hz if it isn't known.
+base::TimeDelta displayInterval()
+{
+    HDC screen = GetDC(NULL);
+    int hz = GetDeviceCaps(screen, VREFRESH);
+    ReleaseDC(NULL, screen);
+    if (hz <= 1)
+        hz = 60;
+    return base::TimeDelta::FromMicroseconds(base::Time::kMicrosecondsPerSecond / hz);
+}
+
+// Copies the rects of |updateRegion| from |bitmap| to the window.
+void blitBitmap(HDC hdc, HRGN updateRegion, const SkBitmap& bitmap)
+{
+    DWORD size = GetRegionData(updateRegion, 0, NULL);
+    if (!size || bitmap.isNull())
+        return;
+    std::vector<char> buffer(size);
+    RGNDATA* data = reinterpret_cast<RGNDATA*>(&buffer[0]);
+    if (!GetRegionData(updateRegion, size, data))
+        return;
+
+    SkAutoLockPixels lock(bitmap);
+    BITMAPINFO info = { 0 };
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = bitmap.width();
+    info.bmiHeader.biHeight = -bitmap.height(); // top-down
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    const RECT* rects = reinterpret_cast<const RECT*>(data->Buffer);
+    for (DWORD i = 0; i < data->rdh.nCount; ++i) {
+        RECT rect = rects[i];
+        rect.right = std::min<LONG>(rect.right, bitmap.width());
+        rect.bottom = std::min<LONG>(rect.bottom, bitmap.height());
+        if (rect.right <= rect.left || rect.bottom <= rect.top)
+            continue;
+        // The source origin is the DIB's lower-left corner even for a
+        // top-down bitmap.
+        SetDIBitsToDevice(hdc, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top,
+                          rect.left, bitmap.height() - rect.bottom, 0, bitmap.height(),
+                          bitmap.getPixels(), &info, DIB_RGB_COLORS);
+    }
+}
+
+// Shows the compositor's last frame, or repaints whatever damage is left
+// outside of frames and shows the backing store.
+void paintWebView(HDC hdc, HRGN updateRegion)
+{
+    if (WebLayerTreeViewImpl* layerTreeView = webViewClient->activeLayerTreeView()) {
+        base::AutoLock locker(layerTreeView->outputLock());
+        blitBitmap(hdc, updateRegion, layerTreeView->output());
+        return;
+    }
+    webView->layout();
+    SkRegion updated;
+    backingStore->paint(webView, &updated);
+    blitBitmap(hdc, updateRegion, backingStore->bitmap());
+}
+#endif
+
 int APIENTRY _tWinMain(_In_ HINSTANCE hInstance,
     _In_opt_ HINSTANCE hPrevInstance,
     _In_ LPTSTR    lpCmdLine,
@@ -68,14 +198,10 @@ int APIENTRY _tWinMain(_In_ HINSTANCE hInstance,
 
     //////////////////////////////////////////////////////////////////////////
 #ifdef enable_webkit
-    PlatformImpl pl;
-    blink::initialize(&pl);
-    blink::WebRuntimeFeatures::enableStableFeatures(true);
-    blink::WebRuntimeFeatures::enableExperimentalFeatures(true);
-    blink::WebRuntimeFeatures::enableTestOnlyFeatures(true);
-
     CommandLine::Init(0, NULL);
     base::AtExitManager atexit;
+    // Pumps the window messages; PlatformImpl and the loaders post to it.
+    base::MessageLoopForUI mainLoop;
     base::FilePath exe;
     PathService::Get(base::FILE_EXE, &exe);
     base::FilePath log_filename = exe.ReplaceExtension(FILE_PATH_LITERAL("log"));
@@ -97,15 +223,40 @@ int APIENTRY _tWinMain(_In_ HINSTANCE hInstance,
     base::i18n::InitializeICU();
     url_util::Initialize();
 
+    PlatformImpl pl;
+    blink::initialize(&pl);
+    blink::WebRuntimeFeatures::enableStableFeatures(true);
+    blink::WebRuntimeFeatures::enableExperimentalFeatures(true);
+    blink::WebRuntimeFeatures::enableTestOnlyFeatures(true);
 
     WebViewClientImpl* client = new WebViewClientImpl;
     blink::WebView* view = blink::WebView::create(client);
+    view->settings()->setThreadedHTMLParser(true);
 
     WebFrameClientImpl* frameclient = new WebFrameClientImpl;
     blink::WebFrame* frame = blink::WebFrame::create(frameclient);
 
     view->setMainFrame(frame);
 
+    RECT clientRect;
+    GetClientRect(hWnd, &clientRect);
+    blink::WebSize viewSize(clientRect.right - clientRect.left, clientRect.bottom - clientRect.top);
+    backingStore = new BackingStore(viewSize);
+    backingStore->setDamageCallback(base::Bind(&invalidateWindowRect));
+    client->setBackingStore(backingStore);
+    client->setWebView(view);
+    client->resize(viewSize);
+    if (pl.numberOfProcessors() > 1) {
+        backingStore->setRasterizer(new TileRasterizer(pl.numberOfProcessors()));
+        view->settings()->setDeferredImageDecodingEnabled(true);
+    }
+    frameScheduler = new FrameScheduler(base::Bind(&runFrame), displayInterval());
+    client->setFrameScheduler(frameScheduler);
+    client->setCompositeCallback(base::Bind(&didComposite));
+    view->settings()->setAcceleratedCompositingEnabled(true);
+    webViewClient = client;
+    webView = view;
+
     blink::WebURLRequest urlRequest;
     urlRequest.initialize();
     urlRequest.setURL(blink::WebURL(GURL("www.baidu.com")));
@@ -116,6 +267,11 @@ int APIENTRY _tWinMain(_In_ HINSTANCE hInstance,
 
 
     // Ϣѭ: 
+#ifdef enable_webkit
+    AcceleratorDispatcher dispatcher(hAccelTable);
+    base::RunLoop(&dispatcher).Run();
+    msg.wParam = 0;
+#else
     while (GetMessage(&msg, NULL, 0, 0))
     {
         if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
@@ -124,6 +280,7 @@ int APIENTRY _tWinMain(_In_ HINSTANCE hInstance,
             DispatchMessage(&msg);
         }
     }
+#endif
 
     return (int)msg.wParam;
 }
@@ -222,10 +379,41 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         }
         break;
     case WM_PAINT:
+#ifdef enable_webkit
+        if (webView) {
+            HRGN updateRegion = CreateRectRgn(0, 0, 0, 0);
+            GetUpdateRgn(hWnd, updateRegion, FALSE);
+            hdc = BeginPaint(hWnd, &ps);
+            paintWebView(hdc, updateRegion);
+            EndPaint(hWnd, &ps);
+            DeleteObject(updateRegion);
+            break;
+        }
+#endif
         hdc = BeginPaint(hWnd, &ps);
         // TODO:  ڴͼ...
         EndPaint(hWnd, &ps);
         break;
+#ifdef enable_webkit
+    case WM_SIZE:
+        if (webView && LOWORD(lParam) && HIWORD(lParam)) {
+            webViewClient->resize(blink::WebSize(LOWORD(lParam), HIWORD(lParam)));
+        }
+        break;
+    case WM_MOUSEWHEEL:
+        // Scrolled on the compositor thread against the cached layers.
+        if (webView && webViewClient->activeLayerTreeView()) {
+            int lines = GET_WHEEL_DELTA_WPARAM(wParam) * 3 / WHEEL_DELTA;
+            webViewClient->activeLayerTreeView()->scrollBy(blink::WebSize(0, -lines * 40));
+            break;
+        }
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    case WM_ERASEBKGND:
+        // The backing store covers the whole client area.
+        if (webView)
+            return 1;
+        return DefWindowProc(hWnd, message, wParam, lParam);
+#endif
     case WM_DESTROY:
         PostQuitMessage(0);
         break;
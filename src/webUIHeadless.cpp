@@ -0,0 +1,597 @@
+// webUIHeadless.cpp : offscreen entry point for render farms.
+//
+// Usage: webUI_headless [--size=WxH] [--frames=N] [--jobs=N]
+//                       [--load-timeout-ms=N] [--timer-slack-ms=N]
+//                       [--sample-interval-ms=N] [--vsync-hz=N]
+//                       [--realtime-vsync] [--raster-threads=N]
+//                       [--compositing] [--device-scale-factor=F] url...
+//        webUI_headless --mime-benchmark=N
+//        webUI_headless --idb-benchmark=N
+//        webUI_headless --theme-benchmark=N
+//
+// Each url is loaded into a windowless WebView and painted into a raster
+// SkBitmap. With --jobs=N the url list is split across N worker processes,
+// since Blink only supports one main thread per process; --jobs=0 starts one
+// worker per processor. --timer-slack-ms lets Blink's timers fire up to N ms
+// late so that idle pages wake the CPU less often. One line of stats is
+// printed per page, and one per Blink thread at the end of each job.
+// --sample-interval-ms=N samples Blink's phase every N ms and prints a flat
+// profile at the end of each job.
+//
+// Frames run on a virtual vsync of --vsync-hz (60 by default): pages see
+// that frame rate while frames run back to back. --realtime-vsync waits for
+// each tick instead, which makes the skipped frame count meaningful.
+//
+// Large damage is rastered in tiles on one thread per processor;
+// --raster-threads=N overrides that and 1 paints on the main thread only.
+// Comparing the frame times of the two at --size=1920x1080 and 3840x2160
+// shows the speedup. --compositing renders pages with composited layers
+// through the software layer compositor; painted_px then counts layer
+// pixels rastered at commit.
+//
+// Form controls and scrollbars are drawn through a theme batch (see
+// WebThemeBatch.h); theme_shapes against theme_draws shows how many Skia
+// draws that saved, which is largest on pages full of scrollbars.
+// --device-scale-factor=F renders the page for a display of F device pixels
+// per DIP (2 for a typical HiDPI screen); --size stays in device pixels.
+//
+// --mime-benchmark=N loads no pages: it times N MIME type checks against
+// PlatformImpl's registry (see WebMimeRegistryImpl.h) and against
+// net::IsSupportedMimeType(), and prints the nanoseconds per check of each.
+// It fails unless the two agree on every type net lists, for each kind of
+// check.
+//
+// --idb-benchmark=N loads no pages either: it inserts N records into an
+// IndexedDB backing store in a temporary directory (see IDBBackingStore.h),
+// committing every idbBenchmarkBatch puts with one fsync, then reads them
+// all back through one cursor and through short range cursors. It prints
+// the rates and how many log writes, flushes and compactions it took.
+//
+// --theme-benchmark=N loads no pages either: it paints N form controls and
+// scrollbar parts onto a bitmap through WebThemeControlCache, and N more
+// drawn directly by WebThemeControlImpl, and prints the nanoseconds per
+// control of each. The cache is filled first, so only blits are timed.
+//
+// Set WEBUI_TRACE_CATEGORIES (and optionally WEBUI_TRACE_FILE) to record a
+// Chrome JSON trace of each job; see TraceRecorder.h. The "webui" category
+// adds per-frame counters of repainted and scroll-copied pixels.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/i18n/icu_util.h"
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/stringprintf.h"
+#include "base/sys_info.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "net/base/mime_util.h"
+#include "url/url_util.h"
+
+#include "../../web/WebKit.h"
+#include "../../web/WebRuntimeFeatures.h"
+
+#include "src/HeadlessHost.h"
+#include "src/IDBBackingStore.h"
+#include "src/PlatformImpl.h"
+#include "src/TraceRecorder.h"
+#include "src/WebMimeRegistryImpl.h"
+#include "src/WebThemeControlCache.h"
+#include "src/WebThemeControlImpl.h"
+#include "src/WebThreadImpl.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+
+
+namespace
+{
+
+    const int defaultWidth = 1280;
+    const int defaultHeight = 720;
+    const int defaultFrames = 60;
+    const int defaultLoadTimeoutMs = 30000;
+    const int defaultVsyncHz = 60;
+
+    int intSwitch(const CommandLine& commandLine, const char* name, int defaultValue)
+    {
+        int value;
+        if (!commandLine.HasSwitch(name) || !base::StringToInt(commandLine.GetSwitchValueASCII(name), &value) || value < 0)
+            return defaultValue;
+        return value;
+    }
+
+    double doubleSwitch(const CommandLine& commandLine, const char* name, double defaultValue)
+    {
+        double value;
+        if (!commandLine.HasSwitch(name) || !base::StringToDouble(commandLine.GetSwitchValueASCII(name), &value) || value <= 0)
+            return defaultValue;
+        return value;
+    }
+
+    WebSize sizeSwitch(const CommandLine& commandLine)
+    {
+        std::vector<std::string> parts;
+        base::SplitString(commandLine.GetSwitchValueASCII("size"), 'x', &parts);
+        int width, height;
+        if (parts.size() != 2 || !base::StringToInt(parts[0], &width) || !base::StringToInt(parts[1], &height) || width <= 0 || height <= 0)
+            return WebSize(defaultWidth, defaultHeight);
+        return WebSize(width, height);
+    }
+
+    void printStats(int job, const HeadlessHost::PageStats& stats)
+    {
+        printf("job=%d loaded=%d load_ms=%.1f frames=%d frame_avg_ms=%.3f frame_min_ms=%.3f frame_max_ms=%.3f fps=%.1f frame_p50_ms=%.3f frame_p90_ms=%.3f frame_p99_ms=%.3f skipped=%lld painted_px=%lld copied_px=%lld repaint_ratio=%.3f theme_shapes=%lld theme_draws=%lld url=%s\n",
+               job, stats.loaded ? 1 : 0, stats.loadTimeMs(), stats.frameCount,
+               stats.averageFrameTimeMs(), stats.minFrameTime.InMillisecondsF(),
+               stats.maxFrameTime.InMillisecondsF(), stats.framesPerSecond(),
+               stats.frameTimeP50.InMillisecondsF(), stats.frameTimeP90.InMillisecondsF(),
+               stats.frameTimeP99.InMillisecondsF(), static_cast<long long>(stats.skippedFrames),
+               static_cast<long long>(stats.paintedPixels), static_cast<long long>(stats.copiedPixels),
+               stats.repaintRatio(), static_cast<long long>(stats.themeShapes),
+               static_cast<long long>(stats.themeDraws), stats.url.c_str());
+        fflush(stdout);
+    }
+
+    void printThreadStats(int job)
+    {
+        std::vector<WebThreadBase::Stats> threads;
+        WebThreadBase::collectStats(&threads);
+        for (size_t i = 0; i < threads.size(); ++i) {
+            const WebThreadBase::Stats& stats = threads[i];
+            printf("job=%d thread=%s tasks=%lld queued=%d latency_avg_ms=%.3f latency_max_ms=%.3f\n",
+                   job, stats.name.c_str(), static_cast<long long>(stats.tasksRun), stats.queueDepth,
+                   stats.averageLatencyMs(), stats.maxLatency.InMillisecondsF());
+        }
+        fflush(stdout);
+    }
+
+    void printProfile(int job, const SamplingProfiler& profiler)
+    {
+        int64 ticks = profiler.tickCount();
+        if (!ticks)
+            return;
+        std::vector<SamplingProfiler::Sample> samples;
+        profiler.collect(&samples);
+
+        // Phase totals for the main thread, then the flat profile.
+        int64 phases[SamplingProfiler::PhaseCount] = { 0 };
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (!samples[i].bucket)
+                phases[samples[i].phase] += samples[i].count;
+        }
+        for (int phase = 0; phase < SamplingProfiler::PhaseCount; ++phase) {
+            printf("job=%d phase=%s samples=%lld percent=%.1f\n",
+                   job, SamplingProfiler::phaseName(static_cast<SamplingProfiler::Phase>(phase)),
+                   static_cast<long long>(phases[phase]), 100.0 * phases[phase] / ticks);
+        }
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const SamplingProfiler::Sample& sample = samples[i];
+            if (sample.phase == SamplingProfiler::PhaseIdle)
+                continue;
+            printf("job=%d bucket=%d state=%s/%s samples=%lld percent=%.1f\n",
+                   job, sample.bucket, sample.category.c_str(), sample.name.c_str(),
+                   static_cast<long long>(sample.count), 100.0 * sample.count / ticks);
+        }
+        fflush(stdout);
+    }
+
+    // A mix of the types Blink checks while loading pages, hits and misses.
+    const char* const benchmarkMimeTypes[] = {
+        "text/html",
+        "text/css",
+        "image/png",
+        "image/jpeg",
+        "image/svg+xml",
+        "application/javascript",
+        "text/javascript",
+        "application/json",
+        "application/ld+json",
+        "text/csv",
+        "application/octet-stream",
+        "video/mp4",
+    };
+
+    // Every type net/base/mime_util.cc lists, kept apart from the registry's
+    // own tables so a type they miss shows up, and a few that its rules
+    // rather than its tables decide.
+    const char* const netMimeTypes[] = {
+        // Image types.
+        "image/jpeg", "image/pjpeg", "image/jpg", "image/webp", "image/png", "image/gif", "image/bmp",
+        "image/vnd.microsoft.icon", "image/x-icon", "image/x-xbitmap",
+        // Non-image types.
+        "image/svg+xml", "application/xml", "application/atom+xml", "application/rss+xml",
+        "application/xhtml+xml", "application/json", "multipart/related", "multipart/x-mixed-replace",
+        // Certificate types.
+        "application/x-x509-user-cert", "application/x-x509-ca-cert", "application/x-pkcs12",
+        // Media types, common and proprietary.
+        "audio/ogg", "application/ogg", "video/ogg", "video/webm", "audio/webm", "audio/wav", "audio/x-wav",
+        "application/vnd.apple.mpegurl", "application/x-mpegurl",
+        "video/mp4", "video/x-m4v", "audio/mp4", "audio/x-m4a", "audio/mp3", "audio/x-mp3", "audio/mpeg",
+        // JavaScript types.
+        "text/javascript", "text/ecmascript", "application/javascript", "application/ecmascript",
+        "application/x-javascript", "text/javascript1.1", "text/javascript1.2", "text/javascript1.3",
+        "text/jscript", "text/livescript",
+        // Unsupported text types.
+        "text/calendar", "text/x-calendar", "text/x-vcalendar", "text/vcalendar", "text/vcard",
+        "text/x-vcard", "text/directory", "text/ldif", "text/qif", "text/x-qif", "text/x-csv", "text/x-vcf",
+        "text/rtf", "text/comma-separated-values", "text/csv", "text/tab-separated-values", "text/tsv",
+        "text/ofx", "text/vnd.sun.j2me.app-descriptor",
+        // Decided by rules.
+        "text/html", "text/plain", "text/x-unknown", "application/ld+json", "application/json+x",
+        "application/octet-stream", "application/pdf", "video/x-unknown", "image/tiff",
+    };
+
+    // Returns the number of types on which the registry and net disagree,
+    // reporting each.
+    int compareWithNet(const WebMimeRegistryImpl& registry)
+    {
+        int mismatches = 0;
+        for (size_t i = 0; i < arraysize(netMimeTypes); ++i) {
+            const std::string type = netMimeTypes[i];
+            if (registry.isSupportedImageMimeType(type) != net::IsSupportedImageMimeType(type)
+                || registry.isSupportedJavaScriptMimeType(type) != net::IsSupportedJavascriptMimeType(type)
+                || registry.isSupportedNonImageMimeType(type) != net::IsSupportedNonImageMimeType(type)
+                || registry.isSupportedMimeType(type) != net::IsSupportedMimeType(type)) {
+                fprintf(stderr, "registry and net disagree on %s\n", type.c_str());
+                ++mismatches;
+            }
+        }
+        return mismatches;
+    }
+
+    template <typename Check>
+    double nanosecondsPerCheck(Check check, int lookups, int* supported)
+    {
+        base::TimeTicks start = base::TimeTicks::Now();
+        for (int i = 0; i < lookups; ++i) {
+            if (check(benchmarkMimeTypes[i % arraysize(benchmarkMimeTypes)]))
+                ++*supported;
+        }
+        return lookups ? (base::TimeTicks::Now() - start).InMicrosecondsF() * 1000 / lookups : 0;
+    }
+
+    struct RegistryCheck {
+        explicit RegistryCheck(const WebMimeRegistryImpl& registry) : registry(registry) { }
+        bool operator()(const std::string& type) const { return registry.isSupportedMimeType(type); }
+        const WebMimeRegistryImpl& registry;
+    };
+
+    struct NetCheck {
+        bool operator()(const std::string& type) const { return net::IsSupportedMimeType(type); }
+    };
+
+    int runMimeBenchmark(int lookups)
+    {
+        base::AtExitManager atexit;
+        WebMimeRegistryImpl registry;
+
+        // Warm up net's lazily built tables so they aren't timed.
+        int netSupported = 0;
+        nanosecondsPerCheck(NetCheck(), arraysize(benchmarkMimeTypes), &netSupported);
+
+        int registrySupported = 0;
+        netSupported = 0;
+        double registryNs = nanosecondsPerCheck(RegistryCheck(registry), lookups, &registrySupported);
+        double netNs = nanosecondsPerCheck(NetCheck(), lookups, &netSupported);
+        int mismatches = compareWithNet(registry);
+        printf("mime_lookups=%d registry_ns=%.1f net_ns=%.1f speedup=%.2f types_compared=%d mismatches=%d\n",
+               lookups, registryNs, netNs, registryNs > 0 ? netNs / registryNs : 0,
+               static_cast<int>(arraysize(netMimeTypes)), mismatches);
+        if (registrySupported != netSupported) {
+            fprintf(stderr, "registry and net disagree: %d and %d types supported\n", registrySupported, netSupported);
+            return 1;
+        }
+        return mismatches ? 1 : 0;
+    }
+
+    // Controls a form-heavy page paints, at their usual sizes.
+    struct BenchmarkControl {
+        WebThemeControlImpl::Type type;
+        WebThemeControlImpl::State state;
+        int width;
+        int height;
+    };
+
+    const BenchmarkControl benchmarkControls[] = {
+        { WebThemeControlImpl::PushButtonType, WebThemeControlImpl::NormalState, 80, 24 },
+        { WebThemeControlImpl::PushButtonType, WebThemeControlImpl::HotState, 80, 24 },
+        { WebThemeControlImpl::UncheckedBoxType, WebThemeControlImpl::NormalState, 13, 13 },
+        { WebThemeControlImpl::CheckedBoxType, WebThemeControlImpl::NormalState, 13, 13 },
+        { WebThemeControlImpl::UncheckedRadioType, WebThemeControlImpl::NormalState, 13, 13 },
+        { WebThemeControlImpl::CheckedRadioType, WebThemeControlImpl::NormalState, 13, 13 },
+        { WebThemeControlImpl::DropDownButtonType, WebThemeControlImpl::NormalState, 17, 20 },
+        { WebThemeControlImpl::UpArrowType, WebThemeControlImpl::NormalState, 15, 14 },
+        { WebThemeControlImpl::DownArrowType, WebThemeControlImpl::NormalState, 15, 14 },
+        { WebThemeControlImpl::VerticalScrollThumbType, WebThemeControlImpl::NormalState, 15, 120 },
+        { WebThemeControlImpl::HorizontalSliderThumbType, WebThemeControlImpl::NormalState, 11, 21 },
+    };
+
+    const int themeBenchmarkCanvasSize = 512;
+
+    template <typename Draw>
+    double nanosecondsPerControl(Draw draw, SkCanvas* canvas, int controls)
+    {
+        base::TimeTicks start = base::TimeTicks::Now();
+        for (int i = 0; i < controls; ++i) {
+            const BenchmarkControl& control = benchmarkControls[i % arraysize(benchmarkControls)];
+            // Spread the controls over the canvas, at integer positions.
+            int x = (i * 37) % (themeBenchmarkCanvasSize - control.width);
+            int y = (i * 53) % (themeBenchmarkCanvasSize - control.height);
+            draw(canvas, SkIRect::MakeXYWH(x, y, control.width, control.height), control);
+        }
+        return controls ? (base::TimeTicks::Now() - start).InMicrosecondsF() * 1000 / controls : 0;
+    }
+
+    struct CachedDraw {
+        explicit CachedDraw(WebThemeControlCache& cache) : cache(cache) { }
+        void operator()(SkCanvas* canvas, const SkIRect& irect, const BenchmarkControl& control) const
+        {
+            cache.draw(canvas, irect, control.type, control.state);
+        }
+        WebThemeControlCache& cache;
+    };
+
+    struct DirectDraw {
+        void operator()(SkCanvas* canvas, const SkIRect& irect, const BenchmarkControl& control) const
+        {
+            WebThemeControlImpl(canvas, irect, control.type, control.state).draw();
+        }
+    };
+
+    int runThemeBenchmark(int controls)
+    {
+        base::AtExitManager atexit;
+        SkBitmap bitmap;
+        bitmap.setConfig(SkBitmap::kARGB_8888_Config, themeBenchmarkCanvasSize, themeBenchmarkCanvasSize);
+        if (!bitmap.allocPixels()) {
+            fprintf(stderr, "cannot allocate the canvas\n");
+            return 1;
+        }
+        bitmap.eraseARGB(0xFF, 0xFF, 0xFF, 0xFF);
+        SkCanvas canvas(bitmap);
+
+        // Raster every control once so the timed loop only blits.
+        WebThemeControlCache cache;
+        nanosecondsPerControl(CachedDraw(cache), &canvas, arraysize(benchmarkControls));
+        cache.resetStats();
+
+        double cachedNs = nanosecondsPerControl(CachedDraw(cache), &canvas, controls);
+        double directNs = nanosecondsPerControl(DirectDraw(), &canvas, controls);
+        printf("theme_controls=%d cached_ns=%.1f direct_ns=%.1f speedup=%.2f cache_entries=%d cache_bytes=%lld\n",
+               controls, cachedNs, directNs, cachedNs > 0 ? directNs / cachedNs : 0,
+               static_cast<int>(cache.entryCount()), static_cast<long long>(cache.bytes()));
+        if (cache.misses() || cache.bypasses()) {
+            fprintf(stderr, "cache served %lld of %d controls\n", static_cast<long long>(cache.hits()), controls);
+            return 1;
+        }
+        return 0;
+    }
+
+    const int idbBenchmarkBatch = 1000;
+    const int idbBenchmarkValueBytes = 200;
+    // A range of idbBenchmarkRangeLength records every idbBenchmarkRangeStride.
+    const int idbBenchmarkRangeLength = 100;
+    const int idbBenchmarkRangeStride = 1000;
+
+    std::string numberKey(int number)
+    {
+        std::string key;
+        IDBBackingStore::encodeNumber(IDBBackingStore::NumberKey, number, &key);
+        return key;
+    }
+
+    // Returns the number of records the cursor visited.
+    int scan(IDBBackingStore::Transaction* transaction, int64 objectStoreId, const IDBBackingStore::KeyRange& range)
+    {
+        IDBBackingStore::Cursor cursor;
+        cursor.objectStoreId = objectStoreId;
+        cursor.range = range;
+        int visited = 0;
+        while (transaction->advance(&cursor))
+            ++visited;
+        return visited;
+    }
+
+    int runIDBBenchmark(int records)
+    {
+        base::AtExitManager atexit;
+        base::ScopedTempDir directory;
+        base::Thread background("IndexedDBCompaction");
+        if (!directory.CreateUniqueTempDir() || !background.Start()) {
+            fprintf(stderr, "cannot set up the backing store\n");
+            return 1;
+        }
+
+        const int64 objectStoreId = 1;
+        IDBBackingStore backingStore(directory.path(), background.message_loop_proxy());
+        if (!backingStore.open()) {
+            fprintf(stderr, "cannot open the backing store\n");
+            return 1;
+        }
+        IDBObjectStoreInfo info;
+        info.id = objectStoreId;
+        IDBBackingStore::Transaction setup(&backingStore);
+        setup.setVersion(1);
+        setup.createObjectStore(info);
+        setup.commit();
+
+        const std::string value(idbBenchmarkValueBytes, 'v');
+        base::TimeTicks start = base::TimeTicks::Now();
+        for (int i = 0; i < records;) {
+            IDBBackingStore::Transaction batch(&backingStore);
+            std::string primaryKey;
+            for (int end = std::min(records, i + idbBenchmarkBatch); i < end; ++i)
+                batch.put(objectStoreId, numberKey(i), value, false, IDBBackingStore::IndexKeys(), &primaryKey);
+            if (!batch.commit()) {
+                fprintf(stderr, "commit failed after %d records\n", i);
+                return 1;
+            }
+        }
+        double insertSeconds = (base::TimeTicks::Now() - start).InSecondsF();
+
+        IDBBackingStore::Transaction reader(&backingStore);
+        start = base::TimeTicks::Now();
+        int scanned = scan(&reader, objectStoreId, IDBBackingStore::KeyRange());
+        double scanSeconds = (base::TimeTicks::Now() - start).InSecondsF();
+
+        start = base::TimeTicks::Now();
+        int ranges = 0;
+        int rangeRecords = 0;
+        for (int i = 0; i < records; i += idbBenchmarkRangeStride, ++ranges) {
+            IDBBackingStore::KeyRange range;
+            range.lower = numberKey(i);
+            range.upper = numberKey(i + idbBenchmarkRangeLength);
+            range.upperOpen = true;
+            rangeRecords += scan(&reader, objectStoreId, range);
+        }
+        double rangeSeconds = (base::TimeTicks::Now() - start).InSecondsF();
+
+        backingStore.store()->waitForBackgroundWork();
+        LogStructuredStore::Stats stats = backingStore.store()->stats();
+        printf("idb_records=%d inserts_per_sec=%.0f scan_records_per_sec=%.0f range_scans=%d range_records=%d range_scans_per_sec=%.0f"
+               " log_writes=%lld flushes=%lld compactions=%lld tables=%d\n",
+               records, insertSeconds > 0 ? records / insertSeconds : 0, scanSeconds > 0 ? scanned / scanSeconds : 0,
+               ranges, rangeRecords, rangeSeconds > 0 ? ranges / rangeSeconds : 0, static_cast<long long>(stats.logWrites),
+               static_cast<long long>(stats.flushes), static_cast<long long>(stats.compactions), static_cast<int>(stats.tables));
+        if (scanned != records) {
+            fprintf(stderr, "read back %d of %d records\n", scanned, records);
+            return 1;
+        }
+        return 0;
+    }
+
+    // Renders every url whose index is congruent to |job| modulo |jobs|.
+    int runJob(const CommandLine& commandLine, int job, int jobs)
+    {
+        base::AtExitManager atexit;
+        base::MessageLoop mainLoop;
+
+        logging::LoggingSettings settings;
+        settings.logging_dest = logging::LOG_TO_SYSTEM_DEBUG_LOG;
+        logging::InitLogging(settings);
+        logging::SetLogItems(true, true, true, true);
+
+        base::i18n::InitializeICU();
+        url_util::Initialize();
+
+        bool tracing = TraceRecorder::startFromEnvironment();
+
+        // PlatformImpl captures the current message loop, so it must be
+        // constructed after |mainLoop|.
+        PlatformImpl platform;
+        platform.SetSharedTimerSlack(base::TimeDelta::FromMilliseconds(
+            intSwitch(commandLine, "timer-slack-ms", 0)));
+        blink::initialize(&platform);
+        blink::WebRuntimeFeatures::enableStableFeatures(true);
+
+        if (int sampleIntervalMs = intSwitch(commandLine, "sample-interval-ms", 0))
+            platform.samplingProfiler().start(base::TimeDelta::FromMilliseconds(sampleIntervalMs));
+
+        const CommandLine::StringVector& urls = commandLine.GetArgs();
+        int frames = intSwitch(commandLine, "frames", defaultFrames);
+        base::TimeDelta loadTimeout = base::TimeDelta::FromMilliseconds(
+            intSwitch(commandLine, "load-timeout-ms", defaultLoadTimeoutMs));
+
+        int failures = 0;
+        base::TimeTicks jobStart = base::TimeTicks::Now();
+        int pages = 0;
+        {
+            HeadlessHost host(sizeSwitch(commandLine));
+            int vsyncHz = intSwitch(commandLine, "vsync-hz", defaultVsyncHz);
+            if (vsyncHz > 0)
+                host.frameScheduler().setInterval(base::TimeDelta::FromMicroseconds(base::Time::kMicrosecondsPerSecond / vsyncHz));
+            host.frameScheduler().setVirtualClock(!commandLine.HasSwitch("realtime-vsync"));
+            if (int rasterThreads = intSwitch(commandLine, "raster-threads", 0))
+                host.setRasterThreads(rasterThreads);
+            host.setCompositingEnabled(commandLine.HasSwitch("compositing"));
+            host.setDeviceScaleFactor(static_cast<float>(doubleSwitch(commandLine, "device-scale-factor", 1)));
+            for (size_t i = job; i < urls.size(); i += jobs) {
+                HeadlessHost::PageStats stats;
+                if (!host.renderPage(GURL(urls[i]), frames, loadTimeout, &stats))
+                    ++failures;
+                printStats(job, stats);
+                ++pages;
+            }
+        }
+        double seconds = (base::TimeTicks::Now() - jobStart).InSecondsF();
+        printf("job=%d pages=%d failures=%d seconds=%.2f pages_per_second=%.2f\n",
+               job, pages, failures, seconds, seconds > 0 ? pages / seconds : 0);
+        fflush(stdout);
+        printThreadStats(job);
+        platform.samplingProfiler().stop();
+        printProfile(job, platform.samplingProfiler());
+
+        if (tracing) {
+            base::FilePath traceFile = TraceRecorder::fileFromEnvironment();
+            if (jobs > 1)
+                traceFile = traceFile.InsertBeforeExtensionASCII(base::StringPrintf(".job%d", job));
+            TraceRecorder::stop(traceFile);
+        }
+
+        blink::shutdown();
+        return failures ? 1 : 0;
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    CommandLine::Init(argc, argv);
+    const CommandLine& commandLine = *CommandLine::ForCurrentProcess();
+
+    if (commandLine.HasSwitch("mime-benchmark"))
+        return runMimeBenchmark(intSwitch(commandLine, "mime-benchmark", 1000000));
+    if (commandLine.HasSwitch("idb-benchmark"))
+        return runIDBBenchmark(intSwitch(commandLine, "idb-benchmark", 1000000));
+    if (commandLine.HasSwitch("theme-benchmark"))
+        return runThemeBenchmark(intSwitch(commandLine, "theme-benchmark", 100000));
+
+    if (commandLine.GetArgs().empty()) {
+        fprintf(stderr, "usage: %s [--size=WxH] [--frames=N] [--jobs=N] [--load-timeout-ms=N] [--timer-slack-ms=N] [--sample-interval-ms=N] [--vsync-hz=N] [--realtime-vsync] [--raster-threads=N] [--compositing] [--device-scale-factor=F] url...\n"
+                "       %s --mime-benchmark=N\n"
+                "       %s --idb-benchmark=N\n"
+                "       %s --theme-benchmark=N\n", argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
+
+    int jobs = intSwitch(commandLine, "jobs", 1);
+    if (!jobs)
+        jobs = base::SysInfo::NumberOfProcessors();
+    jobs = std::min<int>(jobs, commandLine.GetArgs().size());
+    if (jobs <= 1)
+        return runJob(commandLine, 0, 1);
+
+    std::vector<pid_t> children;
+    for (int job = 0; job < jobs; ++job) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (!pid)
+            _exit(runJob(commandLine, job, jobs));
+        children.push_back(pid);
+    }
+
+    int result = children.size() == static_cast<size_t>(jobs) ? 0 : 1;
+    for (size_t i = 0; i < children.size(); ++i) {
+        int status = 0;
+        if (waitpid(children[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+            result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,103 @@
+# Linux/POSIX build of the offscreen host. The Win32 webUI.exe is still built
+# from webUI.vcxproj; this target shares the client classes in src/ with it.
+{
+  'variables': {
+    'chromium_src_dir': '../../../..',
+  },
+  'targets': [
+    {
+      'target_name': 'webUI_headless',
+      'type': 'executable',
+      'dependencies': [
+        '<(chromium_src_dir)/base/base.gyp:base',
+        '<(chromium_src_dir)/base/base.gyp:base_i18n',
+        '<(chromium_src_dir)/net/net.gyp:net',
+        '<(chromium_src_dir)/skia/skia.gyp:skia',
+        '<(chromium_src_dir)/url/url.gyp:url_lib',
+        '<(chromium_src_dir)/third_party/WebKit/public/blink.gyp:blink',
+      ],
+      'include_dirs': [
+        '.',
+        '<(chromium_src_dir)',
+        '../web',
+        '../platform',
+        '../../',
+        '<(chromium_src_dir)/v8/include',
+        '<(chromium_src_dir)/skia/config',
+      ],
+      'sources': [
+        'webUIHeadless.cpp',
+        'src/BackingStore.cpp',
+        'src/BackingStore.h',
+        'src/DiscardableMemoryAllocator.cpp',
+        'src/DiscardableMemoryAllocator.h',
+        'src/DiskCache.cpp',
+        'src/DiskCache.h',
+        'src/FileIOPool.cpp',
+        'src/FileIOPool.h',
+        'src/FrameScheduler.cpp',
+        'src/FrameScheduler.h',
+        'src/HeadlessHost.cpp',
+        'src/HeadlessHost.h',
+        'src/IDBBackingStore.cpp',
+        'src/IDBBackingStore.h',
+        'src/IDBDatabaseBackend.cpp',
+        'src/IDBDatabaseBackend.h',
+        'src/LogStructuredStore.cpp',
+        'src/LogStructuredStore.h',
+        'src/PlatformImpl.cpp',
+        'src/PlatformImpl.h',
+        'src/ProcessMemory.cpp',
+        'src/ProcessMemory.h',
+        'src/SamplingProfiler.cpp',
+        'src/SamplingProfiler.h',
+        'src/TileRasterizer.cpp',
+        'src/TileRasterizer.h',
+        'src/TraceRecorder.cpp',
+        'src/TraceRecorder.h',
+        'src/URLLoaderEngine.cpp',
+        'src/URLLoaderEngine.h',
+        'src/WebAnimationImpl.cpp',
+        'src/WebAnimationImpl.h',
+        'src/WebBlobRegistryImpl.cpp',
+        'src/WebBlobRegistryImpl.h',
+        'src/WebCompositorSupportImpl.cpp',
+        'src/WebCompositorSupportImpl.h',
+        'src/WebCookieJarImpl.cpp',
+        'src/WebCookieJarImpl.h',
+        'src/WebFileSystemImpl.cpp',
+        'src/WebFileSystemImpl.h',
+        'src/WebFileUtilitiesImpl.cpp',
+        'src/WebFileUtilitiesImpl.h',
+        'src/WebFrameClientImpl.cpp',
+        'src/WebFrameClientImpl.h',
+        'src/WebIDBCursorImpl.cpp',
+        'src/WebIDBCursorImpl.h',
+        'src/WebIDBDatabaseImpl.cpp',
+        'src/WebIDBDatabaseImpl.h',
+        'src/WebIDBFactoryImpl.cpp',
+        'src/WebIDBFactoryImpl.h',
+        'src/WebLayerImpl.cpp',
+        'src/WebLayerImpl.h',
+        'src/WebLayerTreeViewImpl.cpp',
+        'src/WebLayerTreeViewImpl.h',
+        'src/WebMimeRegistryImpl.cpp',
+        'src/WebMimeRegistryImpl.h',
+        'src/WebThemeBatch.cpp',
+        'src/WebThemeBatch.h',
+        'src/WebThemeControlCache.cpp',
+        'src/WebThemeControlCache.h',
+        'src/WebThemeControlImpl.cpp',
+        'src/WebThemeControlImpl.h',
+        'src/WebThemeEngineImpl.cpp',
+        'src/WebThemeEngineImpl.h',
+        'src/WebThreadImpl.cpp',
+        'src/WebThreadImpl.h',
+        'src/WebURLLoaderImpl.cpp',
+        'src/WebURLLoaderImpl.h',
+        'src/WebViewClientImpl.cpp',
+        'src/WebViewClientImpl.h',
+      ],
+    },
+  ],
+}